@@ -0,0 +1,294 @@
+#include "TextSearch.h"
+#include "GrammarRegistry.h"
+
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+
+namespace
+{
+
+/** @brief Size of the generated log in megabytes, unless given on the command line */
+const int DEFAULT_LOG_SIZE_MB = 256;
+
+/** @brief Runs of the search kernel; the fastest one is reported */
+const int KERNEL_REPEATS = 3;
+
+/** @brief Log lines between two lines containing the needle */
+const int NEEDLE_INTERVAL = 997;
+
+/** @brief Size of the generated source file in megabytes, unless given on the command line */
+const int DEFAULT_SOURCE_SIZE_MB = 16;
+
+/** @brief Runs of each highlighting scan; the fastest one is reported */
+const int HIGHLIGHT_REPEATS = 3;
+
+/**
+ * @brief Generates an ASCII log of roughly the given size
+ * @param size Size in characters, which equals the size of the file in bytes
+ * @param needle Text added to every NEEDLE_INTERVAL-th line
+ */
+QString generateLog(qsizetype size, const QString &needle)
+{
+    static const char *const levels[] = { "INFO ", "DEBUG", "WARN ", "ERROR" };
+
+    QString text;
+    text.reserve(size + 256);
+    quint32 state = 12345;
+    for (qint64 line = 0; text.size() < size; ++line) {
+        state = state * 1103515245u + 12345u;
+        text += QStringLiteral("2025-03-14 %1:%2:%3.%4 %5 [worker-%6] request %7 handled in %8 ms")
+                    .arg(line / 3600000 % 24, 2, 10, QLatin1Char('0'))
+                    .arg(line / 60000 % 60, 2, 10, QLatin1Char('0'))
+                    .arg(line / 1000 % 60, 2, 10, QLatin1Char('0'))
+                    .arg(line % 1000, 3, 10, QLatin1Char('0'))
+                    .arg(QLatin1String(levels[state >> 30]))
+                    .arg(state >> 26)
+                    .arg(state & 0xfffff)
+                    .arg(state >> 20 & 0x3ff);
+        if (line % NEEDLE_INTERVAL == 0) {
+            text += QStringLiteral(" after ") + needle;
+        }
+        text += QLatin1Char('\n');
+    }
+    return text;
+}
+
+/**
+ * @brief Times a search
+ * @param repeats Number of runs; the fastest one is returned
+ * @param run Search to time, returning the number of matches
+ * @param matches Receives the number of matches
+ * @return Seconds taken by the fastest run
+ */
+double measure(int repeats, const std::function<qsizetype()> &run, qsizetype &matches)
+{
+    double best = 0;
+    for (int i = 0; i < repeats; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        matches = run();
+        const double seconds = double(timer.nsecsElapsed()) / 1e9;
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+void report(const char *name, qsizetype bytes, qsizetype matches, double seconds)
+{
+    std::printf("  %-18s %9lld matches %9.3f s %8.2f GB/s\n", name, static_cast<long long>(matches), seconds,
+                seconds > 0 ? double(bytes) / seconds / 1e9 : 0.0);
+}
+
+/**
+ * @brief Compares LiteralSearcher with QTextDocument::find() on a log
+ *
+ * Every find in the editor used to walk the document's blocks with
+ * QTextDocument::find(); LiteralSearcher scans the plain text snapshot.
+ * Throughput is given in bytes of the log file scanned per second.
+ */
+void benchmarkLiteralSearch(const QString &log, const QString &needle)
+{
+    std::printf("Literal search for \"%s\" in a %lld MB log\n", qPrintable(needle),
+                static_cast<long long>(log.size() / (1024 * 1024)));
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextDocument document;
+    document.setPlainText(log);
+    std::printf("  (document built in %.1f s, not counted)\n", double(timer.elapsed()) / 1000);
+
+    struct Case
+    {
+        const char *name;
+        SearchOptions options;
+    };
+    const Case cases[] = {
+        { "case sensitive", { true, false, false } },
+        { "ignore case", { false, false, false } },
+        { "whole words", { false, true, false } },
+    };
+
+    for (const Case &searchCase : cases) {
+        std::printf("%s\n", searchCase.name);
+
+        qsizetype kernelMatches = 0;
+        const LiteralSearcher searcher(needle, searchCase.options);
+        const double kernelSeconds = measure(KERNEL_REPEATS, [&]() {
+            qsizetype count = 0;
+            qsizetype position = 0;
+            while ((position = searcher.find(log, position, log.size())) >= 0) {
+                ++count;
+                position += searcher.length();
+            }
+            return count;
+        }, kernelMatches);
+        report("LiteralSearcher", log.size(), kernelMatches, kernelSeconds);
+
+        QTextDocument::FindFlags flags;
+        if (searchCase.options.caseSensitive) {
+            flags |= QTextDocument::FindCaseSensitively;
+        }
+        if (searchCase.options.wholeWords) {
+            flags |= QTextDocument::FindWholeWords;
+        }
+
+        // The document path is slow enough that one run is telling
+        qsizetype documentMatches = 0;
+        const double documentSeconds = measure(1, [&]() {
+            qsizetype count = 0;
+            QTextCursor cursor(&document);
+            while (!(cursor = document.find(needle, cursor, flags)).isNull()) {
+                ++count;
+            }
+            return count;
+        }, documentMatches);
+        report("QTextDocument", log.size(), documentMatches, documentSeconds);
+
+        if (kernelMatches != documentMatches) {
+            std::printf("  warning: the match counts differ\n");
+        }
+        if (kernelSeconds > 0) {
+            std::printf("  speedup %.1fx\n", documentSeconds / kernelSeconds);
+        }
+    }
+}
+
+/**
+ * @brief Generates C++ source lines with every kind of token the rules match
+ * @param size Size in characters
+ */
+QStringList generateSource(qsizetype size)
+{
+    static const char *const lines[] = {
+        "#include <vector>",
+        "#define MAX_ITEMS 4096",
+        "",
+        "static int computeScore(const Widget &widget, double weight) // weighted",
+        "{",
+        "    const char *label = \"Widget 42 // not a comment\";",
+        "    for (int i = 0; i < MAX_ITEMS; ++i) {",
+        "        total += Helper::apply(widget.value(i), 3.14159) * weight;",
+        "    }",
+        "    return std::max(total, 0x7f) + Settings::instance().offset(17);",
+        "}",
+    };
+
+    QStringList result;
+    qsizetype total = 0;
+    for (qsizetype i = 0; total < size; ++i) {
+        const QString line = QString::fromLatin1(lines[i % std::size(lines)]);
+        total += line.size() + 1;
+        result.append(line);
+    }
+    return result;
+}
+
+/**
+ * @brief Compares MultiPatternMatcher with matching every rule on its own
+ *
+ * Before the rules were combined, the highlighter ran one globalMatch()
+ * per rule over every line. Both paths record their spans the same way
+ * the highlighter does. The span counts may differ slightly, because the
+ * combined scan does not report lower priority matches inside a higher
+ * priority one.
+ */
+void benchmarkHighlighting(const QStringList &lines, qsizetype size)
+{
+    const std::shared_ptr<const Grammar> grammar = GrammarRegistry::instance().grammar(QStringLiteral("cpp"));
+    if (!grammar) {
+        std::printf("The cpp grammar is not available\n");
+        return;
+    }
+
+    std::printf("\nHighlighting rules of the cpp grammar over %lld lines (%lld MB)\n",
+                static_cast<long long>(lines.size()), static_cast<long long>(size / (1024 * 1024)));
+    if (!grammar->matcher.isValid()) {
+        std::printf("  the rules cannot be combined, so the highlighter matches them one by one\n");
+    }
+
+    QVector<TokenSpan> spans;
+    qsizetype loopSpans = 0;
+    const double loopSeconds = measure(HIGHLIGHT_REPEATS, [&]() {
+        qsizetype count = 0;
+        for (const QString &line : lines) {
+            spans.clear();
+            for (const HighlightingRule &rule : grammar->rules) {
+                QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(line);
+                while (matchIterator.hasNext()) {
+                    const QRegularExpressionMatch match = matchIterator.next();
+                    if (match.capturedLength() > 0) {
+                        TokenSpan span;
+                        span.start = quint32(match.capturedStart());
+                        span.length = quint32(match.capturedLength());
+                        span.type = quint32(rule.type);
+                        spans.append(span);
+                    }
+                }
+            }
+            count += spans.size();
+        }
+        return count;
+    }, loopSpans);
+    report("per-rule loop", size, loopSpans, loopSeconds);
+
+    if (!grammar->matcher.isValid()) {
+        return;
+    }
+
+    qsizetype matcherSpans = 0;
+    const double matcherSeconds = measure(HIGHLIGHT_REPEATS, [&]() {
+        qsizetype count = 0;
+        for (const QString &line : lines) {
+            spans.clear();
+            grammar->matcher.scan(line, spans);
+            count += spans.size();
+        }
+        return count;
+    }, matcherSpans);
+    report("combined scan", size, matcherSpans, matcherSeconds);
+
+    if (matcherSeconds > 0) {
+        std::printf("  speedup %.1fx\n", loopSeconds / matcherSeconds);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // QTextDocument needs a GUI application, but nothing is shown
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    const QStringList arguments = app.arguments();
+    if (arguments.contains(QStringLiteral("--help"))) {
+        std::printf("Usage: %s [log size in MB] [needle] [source size in MB]\n", qPrintable(arguments.constFirst()));
+        return 0;
+    }
+    const int megabytes = arguments.size() > 1 ? arguments.at(1).toInt() : DEFAULT_LOG_SIZE_MB;
+    const QString needle = arguments.size() > 2 ? arguments.at(2) : QStringLiteral("Connection reset");
+    const int sourceMegabytes = arguments.size() > 3 ? arguments.at(3).toInt() : DEFAULT_SOURCE_SIZE_MB;
+    if (megabytes <= 0 || needle.isEmpty() || sourceMegabytes <= 0) {
+        std::fprintf(stderr, "Invalid arguments, see --help\n");
+        return 1;
+    }
+
+    {
+        const QString log = generateLog(qsizetype(megabytes) * 1024 * 1024, needle);
+        benchmarkLiteralSearch(log, needle);
+    }
+
+    const qsizetype sourceSize = qsizetype(sourceMegabytes) * 1024 * 1024;
+    benchmarkHighlighting(generateSource(sourceSize), sourceSize);
+    return 0;
+}
@@ -0,0 +1,469 @@
+#include "BracketStructure.h"
+#include "SyntaxHighlighter.h"
+
+#include <QTextDocument>
+#include <QTextBlock>
+
+BracketStructure::BracketStructure(QTextDocument *document, QObject *parent)
+    : QObject(parent)
+    , m_document(document)
+    , m_root(-1)
+    , m_blockCount(0)
+    , m_seed(0x9e3779b9u)
+{
+    if (m_document) {
+        m_blockCount = m_document->blockCount();
+        insertBlocks(0, m_blockCount);
+        connect(m_document, &QTextDocument::contentsChange, this, &BracketStructure::onContentsChange);
+    }
+}
+
+void BracketStructure::setBlockBrackets(int blockNumber, const QVector<BracketToken> &brackets)
+{
+    if (blockNumber < 0 || blockNumber >= size(m_root)) {
+        return;
+    }
+    setSummary(m_root, blockNumber, summarize(brackets));
+}
+
+int BracketStructure::matchingBracket(int position) const
+{
+    if (!m_document) {
+        return -1;
+    }
+
+    const QTextBlock block = m_document->findBlock(position);
+    const QVector<BracketToken> *brackets = blockBrackets(block);
+    if (!brackets) {
+        return -1;
+    }
+
+    const quint32 offset = quint32(position - block.position());
+    for (int i = 0; i < brackets->size(); ++i) {
+        const BracketToken &token = brackets->at(i);
+        if (token.offset != offset) {
+            continue;
+        }
+
+        int depth = depthBefore(block.blockNumber());
+        for (int j = 0; j < i; ++j) {
+            depth += isOpeningBracket(brackets->at(j).character) ? 1 : -1;
+        }
+
+        // An opening bracket is closed where the depth first falls back to
+        // its own level; a closing bracket is opened where it last rose from it
+        if (isOpeningBracket(token.character)) {
+            return findClosing(block.blockNumber(), i, depth);
+        }
+        return findOpening(block.blockNumber(), i, depth - 1);
+    }
+
+    return -1;
+}
+
+QPair<int, int> BracketStructure::enclosingScope(int position) const
+{
+    if (!m_document) {
+        return qMakePair(-1, -1);
+    }
+
+    const QTextBlock block = m_document->findBlock(position);
+    if (!block.isValid()) {
+        return qMakePair(-1, -1);
+    }
+
+    const QVector<BracketToken> *brackets = blockBrackets(block);
+    const quint32 offset = quint32(position - block.position());
+
+    int depth = depthBefore(block.blockNumber());
+    int tokenIndex = 0;
+    if (brackets) {
+        while (tokenIndex < brackets->size() && brackets->at(tokenIndex).offset < offset) {
+            depth += isOpeningBracket(brackets->at(tokenIndex).character) ? 1 : -1;
+            ++tokenIndex;
+        }
+    }
+
+    const int open = findOpening(block.blockNumber(), tokenIndex, depth - 1);
+    if (open < 0) {
+        return qMakePair(-1, -1);
+    }
+    return qMakePair(open, matchingBracket(open));
+}
+
+int BracketStructure::foldEnd(int blockNumber) const
+{
+    if (!m_document) {
+        return -1;
+    }
+
+    const QTextBlock block = m_document->findBlockByNumber(blockNumber);
+    const QVector<BracketToken> *brackets = blockBrackets(block);
+    if (!brackets) {
+        return -1;
+    }
+
+    // The fold starts at the outermost bracket left open at the end of the line
+    QVector<int> unclosed;
+    for (int i = 0; i < brackets->size(); ++i) {
+        if (isOpeningBracket(brackets->at(i).character)) {
+            unclosed.append(i);
+        } else if (!unclosed.isEmpty()) {
+            unclosed.removeLast();
+        }
+    }
+    if (unclosed.isEmpty()) {
+        return -1;
+    }
+
+    const int match = matchingBracket(block.position() + int(brackets->at(unclosed.first()).offset));
+    if (match < 0) {
+        return -1;
+    }
+
+    const int endBlock = m_document->findBlock(match).blockNumber();
+    return endBlock > blockNumber ? endBlock : -1;
+}
+
+bool BracketStructure::isOpeningBracket(QChar ch)
+{
+    return ch == QLatin1Char('(') || ch == QLatin1Char('[') || ch == QLatin1Char('{');
+}
+
+bool BracketStructure::isClosingBracket(QChar ch)
+{
+    return ch == QLatin1Char(')') || ch == QLatin1Char(']') || ch == QLatin1Char('}');
+}
+
+bool BracketStructure::isMatchingPair(QChar open, QChar close)
+{
+    return (open == QLatin1Char('(') && close == QLatin1Char(')'))
+        || (open == QLatin1Char('[') && close == QLatin1Char(']'))
+        || (open == QLatin1Char('{') && close == QLatin1Char('}'));
+}
+
+void BracketStructure::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved);
+    Q_UNUSED(charsAdded);
+
+    const int blockCount = m_document->blockCount();
+    if (blockCount == m_blockCount) {
+        return;
+    }
+
+    // Blocks merged into or split from the first changed block sit right after it;
+    // the highlighter re-lexes the whole changed range afterwards
+    const QTextBlock block = m_document->findBlock(position);
+    const int firstBlock = block.isValid() ? block.blockNumber() : blockCount - 1;
+    if (blockCount > m_blockCount) {
+        insertBlocks(firstBlock + 1, blockCount - m_blockCount);
+    } else {
+        removeBlocks(firstBlock + 1, m_blockCount - blockCount);
+    }
+    m_blockCount = blockCount;
+}
+
+BracketStructure::Summary BracketStructure::combine(const Summary &first, const Summary &second)
+{
+    Summary result;
+    result.delta = first.delta + second.delta;
+    result.minAfter = qMin(first.minAfter, first.delta + second.minAfter);
+    result.minBefore = qMin(first.minBefore, first.delta + second.minBefore);
+    return result;
+}
+
+BracketStructure::Summary BracketStructure::summarize(const QVector<BracketToken> &brackets)
+{
+    Summary summary;
+    for (const BracketToken &token : brackets) {
+        summary.minBefore = qMin(summary.minBefore, summary.delta);
+        summary.delta += isOpeningBracket(token.character) ? 1 : -1;
+        summary.minAfter = qMin(summary.minAfter, summary.delta);
+    }
+    return summary;
+}
+
+const QVector<BracketToken> *BracketStructure::blockBrackets(const QTextBlock &block)
+{
+    if (!block.isValid()) {
+        return nullptr;
+    }
+
+    const HighlightBlockData *data = static_cast<const HighlightBlockData *>(block.userData());
+    if (!data || data->brackets.isEmpty()) {
+        return nullptr;
+    }
+    return &data->brackets;
+}
+
+int BracketStructure::createNode()
+{
+    // xorshift32 is plenty for treap priorities
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+
+    Node node;
+    node.priority = m_seed;
+    node.size = 1;
+    node.left = -1;
+    node.right = -1;
+
+    if (!m_freeNodes.isEmpty()) {
+        const int index = m_freeNodes.takeLast();
+        m_nodes[index] = node;
+        return index;
+    }
+
+    m_nodes.append(node);
+    return m_nodes.size() - 1;
+}
+
+void BracketStructure::releaseTree(int node)
+{
+    if (node < 0) {
+        return;
+    }
+    releaseTree(m_nodes.at(node).left);
+    releaseTree(m_nodes.at(node).right);
+    m_freeNodes.append(node);
+}
+
+void BracketStructure::update(int node)
+{
+    Node &n = m_nodes[node];
+    n.size = 1 + size(n.left) + size(n.right);
+    n.aggregate = combine(combine(aggregate(n.left), n.summary), aggregate(n.right));
+}
+
+int BracketStructure::size(int node) const
+{
+    return node < 0 ? 0 : m_nodes.at(node).size;
+}
+
+const BracketStructure::Summary &BracketStructure::aggregate(int node) const
+{
+    static const Summary empty;
+    return node < 0 ? empty : m_nodes.at(node).aggregate;
+}
+
+void BracketStructure::split(int node, int count, int &left, int &right)
+{
+    if (node < 0) {
+        left = -1;
+        right = -1;
+        return;
+    }
+
+    int first = -1;
+    int second = -1;
+    const int leftSize = size(m_nodes.at(node).left);
+    if (count <= leftSize) {
+        split(m_nodes.at(node).left, count, first, second);
+        m_nodes[node].left = second;
+        update(node);
+        left = first;
+        right = node;
+    } else {
+        split(m_nodes.at(node).right, count - leftSize - 1, first, second);
+        m_nodes[node].right = first;
+        update(node);
+        left = node;
+        right = second;
+    }
+}
+
+int BracketStructure::merge(int left, int right)
+{
+    if (left < 0) {
+        return right;
+    }
+    if (right < 0) {
+        return left;
+    }
+
+    if (m_nodes.at(left).priority > m_nodes.at(right).priority) {
+        const int merged = merge(m_nodes.at(left).right, right);
+        m_nodes[left].right = merged;
+        update(left);
+        return left;
+    }
+
+    const int merged = merge(left, m_nodes.at(right).left);
+    m_nodes[right].left = merged;
+    update(right);
+    return right;
+}
+
+void BracketStructure::insertBlocks(int index, int count)
+{
+    int inserted = -1;
+    for (int i = 0; i < count; ++i) {
+        const int node = createNode();
+        update(node);
+        inserted = merge(inserted, node);
+    }
+
+    int left = -1;
+    int right = -1;
+    split(m_root, index, left, right);
+    m_root = merge(merge(left, inserted), right);
+}
+
+void BracketStructure::removeBlocks(int index, int count)
+{
+    int left = -1;
+    int middle = -1;
+    int right = -1;
+    split(m_root, index, left, right);
+    split(right, count, middle, right);
+    releaseTree(middle);
+    m_root = merge(left, right);
+}
+
+void BracketStructure::setSummary(int node, int index, const Summary &summary)
+{
+    const int leftSize = size(m_nodes.at(node).left);
+    if (index < leftSize) {
+        setSummary(m_nodes.at(node).left, index, summary);
+    } else if (index == leftSize) {
+        m_nodes[node].summary = summary;
+    } else {
+        setSummary(m_nodes.at(node).right, index - leftSize - 1, summary);
+    }
+    update(node);
+}
+
+int BracketStructure::depthBefore(int index) const
+{
+    int depth = 0;
+    int node = m_root;
+    while (node >= 0) {
+        const Node &n = m_nodes.at(node);
+        const int leftSize = size(n.left);
+        if (index < leftSize) {
+            node = n.left;
+            continue;
+        }
+
+        depth += aggregate(n.left).delta;
+        if (index == leftSize) {
+            break;
+        }
+        depth += n.summary.delta;
+        index -= leftSize + 1;
+        node = n.right;
+    }
+    return depth;
+}
+
+int BracketStructure::findFirstAfter(int node, int base, int offset, int minIndex, int threshold) const
+{
+    if (node < 0) {
+        return -1;
+    }
+
+    const Node &n = m_nodes.at(node);
+    if (base + n.size <= minIndex || offset + n.aggregate.minAfter > threshold) {
+        return -1;
+    }
+
+    const int found = findFirstAfter(n.left, base, offset, minIndex, threshold);
+    if (found >= 0) {
+        return found;
+    }
+
+    const int index = base + size(n.left);
+    const int nodeOffset = offset + aggregate(n.left).delta;
+    if (index >= minIndex && nodeOffset + n.summary.minAfter <= threshold) {
+        return index;
+    }
+
+    return findFirstAfter(n.right, index + 1, nodeOffset + n.summary.delta, minIndex, threshold);
+}
+
+int BracketStructure::findLastBefore(int node, int base, int offset, int maxIndex, int threshold) const
+{
+    if (node < 0) {
+        return -1;
+    }
+
+    const Node &n = m_nodes.at(node);
+    if (base > maxIndex || offset + n.aggregate.minBefore > threshold) {
+        return -1;
+    }
+
+    const int index = base + size(n.left);
+    const int nodeOffset = offset + aggregate(n.left).delta;
+    const int found = findLastBefore(n.right, index + 1, nodeOffset + n.summary.delta, maxIndex, threshold);
+    if (found >= 0) {
+        return found;
+    }
+
+    if (index <= maxIndex && nodeOffset + n.summary.minBefore <= threshold) {
+        return index;
+    }
+
+    return findLastBefore(n.left, base, offset, maxIndex, threshold);
+}
+
+int BracketStructure::findOpening(int blockNumber, int tokenIndex, int threshold) const
+{
+    // Look for the last bracket before tokenIndex entered at depth <= threshold
+    int block = blockNumber;
+    int limit = tokenIndex;
+    while (block >= 0) {
+        const QTextBlock textBlock = m_document->findBlockByNumber(block);
+        const QVector<BracketToken> *brackets = blockBrackets(textBlock);
+        if (brackets) {
+            int depth = depthBefore(block);
+            int found = -1;
+            const int count = limit < 0 ? brackets->size() : qMin(limit, int(brackets->size()));
+            for (int i = 0; i < count; ++i) {
+                if (depth <= threshold) {
+                    found = i;
+                }
+                depth += isOpeningBracket(brackets->at(i).character) ? 1 : -1;
+            }
+            if (found >= 0) {
+                return textBlock.position() + int(brackets->at(found).offset);
+            }
+        }
+
+        if (block != blockNumber) {
+            // The tree reported this block, so the bracket must have been in it
+            return -1;
+        }
+        block = findLastBefore(m_root, 0, 0, blockNumber - 1, threshold);
+        limit = -1;
+    }
+    return -1;
+}
+
+int BracketStructure::findClosing(int blockNumber, int tokenIndex, int threshold) const
+{
+    // Look for the first bracket after tokenIndex leaving depth <= threshold
+    int block = blockNumber;
+    int start = tokenIndex + 1;
+    while (block >= 0) {
+        const QTextBlock textBlock = m_document->findBlockByNumber(block);
+        const QVector<BracketToken> *brackets = blockBrackets(textBlock);
+        if (brackets) {
+            int depth = depthBefore(block);
+            for (int i = 0; i < brackets->size(); ++i) {
+                depth += isOpeningBracket(brackets->at(i).character) ? 1 : -1;
+                if (i >= start && depth <= threshold) {
+                    return textBlock.position() + int(brackets->at(i).offset);
+                }
+            }
+        }
+
+        if (block != blockNumber) {
+            return -1;
+        }
+        block = findFirstAfter(m_root, 0, 0, blockNumber + 1, threshold);
+        start = 0;
+    }
+    return -1;
+}
@@ -0,0 +1,207 @@
+/**
+ * @file BracketStructure.h
+ * @brief Incrementally maintained bracket nesting of a document
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QPair>
+#include <QChar>
+
+class QTextDocument;
+class QTextBlock;
+
+/**
+ * @struct BracketToken
+ * @brief A bracket character found outside strings and comments
+ */
+struct BracketToken
+{
+    quint32 offset;  ///< Offset of the bracket within its block
+    QChar character; ///< One of ( ) [ ] { }
+};
+
+/**
+ * @class BracketStructure
+ * @brief Answers bracket matching, scope and folding queries in logarithmic time
+ *
+ * The bracket tokens of each block are produced by SyntaxHighlighter while
+ * it lexes the block, so brackets inside strings and comments are already
+ * excluded. Each block is reduced to a summary of its nesting (net depth
+ * change and the lowest depth reached before and after each bracket), and
+ * the summaries are kept in a balanced tree indexed by block number.
+ *
+ * Queries use the tree to skip whole runs of blocks whose nesting cannot
+ * contain the answer, so only the block holding the result is scanned.
+ * Edits only update the summaries of re-lexed blocks; blocks inserted or
+ * removed by an edit are spliced into the tree without touching the rest.
+ *
+ * The structure must be connected to the document before the highlighter,
+ * so block insertions are applied before the highlighter reports the
+ * tokens of the new blocks.
+ *
+ * @see SyntaxHighlighter, HighlightBlockData
+ */
+class BracketStructure : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the structure for a document
+     * @param document Document to track (may be nullptr)
+     * @param parent Parent object
+     */
+    explicit BracketStructure(QTextDocument *document, QObject *parent = nullptr);
+
+    /**
+     * @brief Records the brackets of a block after it was lexed
+     * @param blockNumber Number of the block
+     * @param brackets Brackets of the block in text order
+     */
+    void setBlockBrackets(int blockNumber, const QVector<BracketToken> &brackets);
+
+    /**
+     * @brief Finds the bracket matching the one at a position
+     * @param position Document position of a bracket character
+     * @return Position of the matching bracket, or -1 if there is none
+     */
+    int matchingBracket(int position) const;
+
+    /**
+     * @brief Finds the innermost bracket pair enclosing a position
+     * @param position Document position
+     * @return Positions of the opening and closing bracket; -1 where missing
+     */
+    QPair<int, int> enclosingScope(int position) const;
+
+    /**
+     * @brief Gets the range folded by a block
+     * @param blockNumber Number of the block that would show the fold marker
+     * @return Number of the last block of the fold, or -1 if the block opens
+     *         no bracket that is closed on a later line
+     */
+    int foldEnd(int blockNumber) const;
+
+    /**
+     * @brief Checks whether a character is an opening bracket
+     * @param ch Character to test
+     * @return true for ( [ and {
+     */
+    static bool isOpeningBracket(QChar ch);
+
+    /**
+     * @brief Checks whether a character is a closing bracket
+     * @param ch Character to test
+     * @return true for ) ] and }
+     */
+    static bool isClosingBracket(QChar ch);
+
+    /**
+     * @brief Checks whether two brackets form a pair
+     * @param open Opening bracket
+     * @param close Closing bracket
+     * @return true if close is the counterpart of open
+     */
+    static bool isMatchingPair(QChar open, QChar close);
+
+private slots:
+    /**
+     * @brief Splices blocks added or removed by an edit into the tree
+     * @param position Start of the change
+     * @param charsRemoved Number of removed characters
+     * @param charsAdded Number of added characters
+     */
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    /** @brief Marker for "no bracket in run"; large enough to survive additions */
+    static const int NO_DEPTH = 1 << 29;
+
+    /**
+     * @struct Summary
+     * @brief Nesting summary of one block or of a run of blocks
+     *
+     * Depths are relative to the start of the run. The minimums are
+     * NO_DEPTH when the run contains no brackets.
+     */
+    struct Summary
+    {
+        int delta = 0;              ///< Depth change across the run
+        int minAfter = NO_DEPTH;    ///< Lowest depth right after any bracket
+        int minBefore = NO_DEPTH;   ///< Lowest depth right before any bracket
+    };
+
+    /**
+     * @struct Node
+     * @brief Implicit treap node holding one block summary
+     */
+    struct Node
+    {
+        Summary summary;     ///< Summary of this block
+        Summary aggregate;   ///< Summary of the whole subtree
+        quint32 priority;    ///< Heap priority
+        int size;            ///< Number of blocks in the subtree
+        int left;            ///< Left child, or -1
+        int right;           ///< Right child, or -1
+    };
+
+    /** @brief Combines the summaries of two adjacent runs */
+    static Summary combine(const Summary &first, const Summary &second);
+
+    /** @brief Summarizes the brackets of a single block */
+    static Summary summarize(const QVector<BracketToken> &brackets);
+
+    /** @brief Gets the bracket tokens stored for a block */
+    static const QVector<BracketToken> *blockBrackets(const QTextBlock &block);
+
+    // Treap Maintenance
+    int createNode();
+    void releaseTree(int node);
+    void update(int node);
+    int size(int node) const;
+    const Summary &aggregate(int node) const;
+    void split(int node, int count, int &left, int &right);
+    int merge(int left, int right);
+    void insertBlocks(int index, int count);
+    void removeBlocks(int index, int count);
+    void setSummary(int node, int index, const Summary &summary);
+
+    // Treap Queries
+    /** @brief Gets the depth at the start of a block */
+    int depthBefore(int index) const;
+
+    /** @brief Finds the first block at or after minIndex dropping to threshold after a bracket */
+    int findFirstAfter(int node, int base, int offset, int minIndex, int threshold) const;
+
+    /** @brief Finds the last block at or before maxIndex at threshold before a bracket */
+    int findLastBefore(int node, int base, int offset, int maxIndex, int threshold) const;
+
+    /** @brief Finds the opening bracket closed by depth falling back to threshold */
+    int findOpening(int blockNumber, int tokenIndex, int threshold) const;
+
+    /** @brief Finds the closing bracket where depth falls to threshold */
+    int findClosing(int blockNumber, int tokenIndex, int threshold) const;
+
+    /** @brief Tracked document */
+    QTextDocument *m_document;
+
+    /** @brief Node storage; released nodes are reused */
+    QVector<Node> m_nodes;
+
+    /** @brief Indices of released nodes */
+    QVector<int> m_freeNodes;
+
+    /** @brief Root of the treap, or -1 */
+    int m_root;
+
+    /** @brief Block count after the last processed change */
+    int m_blockCount;
+
+    /** @brief State of the priority generator */
+    quint32 m_seed;
+};
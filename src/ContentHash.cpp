@@ -0,0 +1,85 @@
+#include "ContentHash.h"
+
+#include <QFile>
+#include <QHashFunctions>
+
+namespace
+{
+
+/** @brief Fixed seed, so equal content hashes equally within a run */
+const quint64 HASH_SEED = Q_UINT64_C(0x9e3779b97f4a7c15);
+
+} // namespace
+
+ContentHash::ContentHash()
+    : m_state(HASH_SEED)
+    , m_length(0)
+{
+}
+
+void ContentHash::addData(QByteArrayView data)
+{
+    m_length += data.size();
+
+    // Top up a partial block first
+    if (!m_buffer.isEmpty()) {
+        const qsizetype take = qMin<qsizetype>(BLOCK_SIZE - m_buffer.size(), data.size());
+        m_buffer.append(data.first(take));
+        data = data.sliced(take);
+        if (m_buffer.size() < BLOCK_SIZE) {
+            return;
+        }
+        addBlock(m_buffer);
+        m_buffer.clear();
+    }
+
+    // Whole blocks are hashed in place
+    while (data.size() >= BLOCK_SIZE) {
+        addBlock(data.first(BLOCK_SIZE));
+        data = data.sliced(BLOCK_SIZE);
+    }
+    m_buffer.append(data);
+}
+
+quint64 ContentHash::result() const
+{
+    quint64 state = m_state;
+    if (!m_buffer.isEmpty()) {
+        state = qHash(QByteArrayView(m_buffer), size_t(state));
+    }
+    return qHash(m_length, size_t(state));
+}
+
+quint64 ContentHash::hash(QByteArrayView data)
+{
+    ContentHash contentHash;
+    contentHash.addData(data);
+    return contentHash.result();
+}
+
+std::optional<quint64> ContentHash::hashFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return std::nullopt;
+    }
+
+    ContentHash contentHash;
+    QByteArray block(BLOCK_SIZE, Qt::Uninitialized);
+    for (;;) {
+        const qint64 read = file.read(block.data(), BLOCK_SIZE);
+        if (read < 0) {
+            return std::nullopt;
+        }
+        if (read == 0) {
+            break;
+        }
+        contentHash.addData(QByteArrayView(block.constData(), read));
+    }
+    return contentHash.result();
+}
+
+void ContentHash::addBlock(QByteArrayView block)
+{
+    m_state = qHash(block, size_t(m_state));
+}
@@ -0,0 +1,78 @@
+/**
+ * @file ContentHash.h
+ * @brief Fast streaming 64-bit hash of file contents
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <optional>
+
+/**
+ * @class ContentHash
+ * @brief Non-cryptographic hash for telling whether file content changed
+ *
+ * Data is hashed in blocks of BLOCK_SIZE bytes with Qt's hash function,
+ * which uses the AES instructions of the processor where available, and
+ * each block is chained into the next through the seed. The result only
+ * depends on the bytes, not on how they were split across addData()
+ * calls, so a file hashed while streaming matches the same content hashed
+ * from memory. Results are not stable across Qt versions and must not be
+ * stored.
+ *
+ * @see TextEditor
+ */
+class ContentHash
+{
+public:
+    /**
+     * @brief Starts an empty hash
+     */
+    ContentHash();
+
+    /**
+     * @brief Appends data to the hashed content
+     * @param data Next bytes of the content
+     */
+    void addData(QByteArrayView data);
+
+    /**
+     * @brief Gets the hash of the content added so far
+     * @return 64-bit hash
+     */
+    quint64 result() const;
+
+    /**
+     * @brief Hashes content held in memory
+     * @param data Content
+     * @return 64-bit hash
+     */
+    static quint64 hash(QByteArrayView data);
+
+    /**
+     * @brief Hashes a file, reading it in blocks
+     * @param filePath File to read in text mode, like documents are loaded
+     * @return 64-bit hash, or nothing if the file cannot be read
+     */
+    static std::optional<quint64> hashFile(const QString &filePath);
+
+    /** @brief Bytes hashed per block */
+    static const int BLOCK_SIZE = 1024 * 1024;
+
+private:
+    /** @brief Chains one block into the state */
+    void addBlock(QByteArrayView block);
+
+    /** @brief Partial block not hashed yet */
+    QByteArray m_buffer;
+
+    /** @brief Hash of the complete blocks so far */
+    quint64 m_state;
+
+    /** @brief Bytes added so far */
+    qint64 m_length;
+};
@@ -0,0 +1,150 @@
+#include "DocumentSearch.h"
+
+#include <QPromise>
+#include <QThreadPool>
+#include <QRegularExpression>
+#include <atomic>
+#include <memory>
+
+DocumentSearch::DocumentSearch(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<DocumentSearchResult>::resultReadyAt, this, &DocumentSearch::onResultReady);
+    connect(&m_watcher, &QFutureWatcher<DocumentSearchResult>::finished, this, &DocumentSearch::onFinished);
+}
+
+DocumentSearch::~DocumentSearch()
+{
+    cancel();
+}
+
+void DocumentSearch::start(const QVector<QString> &texts, const QString &pattern, const SearchOptions &options)
+{
+    cancel();
+
+    auto promise = std::make_shared<QPromise<DocumentSearchResult>>();
+    m_watcher.setFuture(promise->future());
+    promise->start();
+
+    if (texts.isEmpty()) {
+        promise->finish();
+        return;
+    }
+
+    // The last document to finish completes the search
+    auto remaining = std::make_shared<std::atomic<int>>(int(texts.size()));
+    for (int document = 0; document < texts.size(); ++document) {
+        const QString text = texts.at(document);
+        QThreadPool::globalInstance()->start([promise, remaining, document, text, pattern, options]() {
+            if (!promise->isCanceled()) {
+                DocumentSearchResult result = searchDocument(*promise, document, text, pattern, options);
+                if (!promise->isCanceled()) {
+                    promise->addResult(std::move(result));
+                }
+            }
+            if (--*remaining == 0) {
+                promise->finish();
+            }
+        });
+    }
+}
+
+void DocumentSearch::cancel()
+{
+    if (!m_watcher.isFinished()) {
+        m_watcher.cancel();
+    }
+}
+
+bool DocumentSearch::isRunning() const
+{
+    return !m_watcher.isFinished();
+}
+
+void DocumentSearch::onResultReady(int index)
+{
+    emit documentSearched(m_watcher.resultAt(index));
+}
+
+void DocumentSearch::onFinished()
+{
+    if (!m_watcher.future().isCanceled()) {
+        emit finished();
+    }
+}
+
+DocumentSearchResult DocumentSearch::searchDocument(QPromise<DocumentSearchResult> &promise, int document,
+                                                    const QString &text, const QString &pattern,
+                                                    const SearchOptions &options)
+{
+    DocumentSearchResult result;
+    result.document = document;
+
+    QRegularExpression expression;
+    QRegularExpressionMatchIterator matchIterator;
+    std::unique_ptr<LiteralSearcher> literal;
+    if (options.useRegex) {
+        expression = TextSearch::compile(pattern, options);
+        matchIterator = expression.globalMatch(text);
+    } else {
+        literal.reset(new LiteralSearcher(pattern, options));
+    }
+
+    int line = 1;
+    qsizetype lineStart = 0;
+    qsizetype scanned = 0;
+    qsizetype position = 0;
+
+    while (!promise.isCanceled()) {
+        qsizetype matchStart = -1;
+        qsizetype matchLength = 0;
+
+        if (literal) {
+            matchStart = literal->find(text, position, text.size());
+            matchLength = literal->length();
+        } else {
+            while (matchIterator.hasNext()) {
+                const QRegularExpressionMatch match = matchIterator.next();
+                // Empty matches cannot be selected
+                if (match.capturedLength() > 0) {
+                    matchStart = match.capturedStart();
+                    matchLength = match.capturedLength();
+                    break;
+                }
+            }
+        }
+
+        if (matchStart < 0) {
+            break;
+        }
+        position = matchStart + matchLength;
+
+        if (result.matches.size() >= MAX_MATCHES) {
+            result.truncated = true;
+            break;
+        }
+
+        // Advance the line counter up to the match
+        for (; scanned < matchStart; ++scanned) {
+            if (text.at(scanned) == QLatin1Char('\n')) {
+                ++line;
+                lineStart = scanned + 1;
+            }
+        }
+
+        qsizetype lineEnd = text.indexOf(QLatin1Char('\n'), lineStart);
+        if (lineEnd < 0) {
+            lineEnd = text.size();
+        }
+
+        DocumentMatch match;
+        match.start = matchStart;
+        match.length = matchLength;
+        match.line = line;
+        match.column = int(matchStart - lineStart) + 1;
+        match.lineText = text.mid(lineStart, qMin(lineEnd - lineStart, qsizetype(MAX_LINE_TEXT)));
+        result.matches.append(match);
+    }
+
+    return result;
+}
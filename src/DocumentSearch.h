@@ -0,0 +1,131 @@
+/**
+ * @file DocumentSearch.h
+ * @brief Concurrent search of several document snapshots
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QFutureWatcher>
+
+#include "TextSearch.h"
+
+template <typename T> class QPromise;
+
+/**
+ * @struct DocumentMatch
+ * @brief A match within one document
+ */
+struct DocumentMatch
+{
+    qsizetype start = 0;  ///< Offset of the match in the snapshot
+    qsizetype length = 0; ///< Length of the match
+    int line = 0;         ///< Line of the match (1-based)
+    int column = 0;       ///< Column of the match (1-based)
+    QString lineText;     ///< Text of the line, shortened if very long
+};
+
+/**
+ * @struct DocumentSearchResult
+ * @brief All matches within one document
+ */
+struct DocumentSearchResult
+{
+    int document = -1;              ///< Index of the document in the searched list
+    QVector<DocumentMatch> matches; ///< Matches in text order
+    bool truncated = false;         ///< Whether the search stopped at MAX_MATCHES
+};
+
+/**
+ * @class DocumentSearch
+ * @brief Searches a set of document snapshots concurrently
+ *
+ * Each snapshot is searched by its own task on the global thread pool, and
+ * the matches of a document are reported as soon as that document is done.
+ * Snapshots are implicitly shared strings, so starting a search copies no
+ * text. Starting a new search cancels the one in progress, and results of
+ * a cancelled search are never reported.
+ *
+ * @see FindReplacePanel, TextEditor::plainTextSnapshot()
+ */
+class DocumentSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle search
+     * @param parent Parent object
+     */
+    explicit DocumentSearch(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor - cancels a search in progress
+     */
+    ~DocumentSearch();
+
+    /**
+     * @brief Starts a search, cancelling any search in progress
+     * @param texts Document snapshots to search
+     * @param pattern Search pattern (must be valid for regex searches)
+     * @param options Search options
+     */
+    void start(const QVector<QString> &texts, const QString &pattern, const SearchOptions &options);
+
+    /**
+     * @brief Cancels the search in progress, if any
+     */
+    void cancel();
+
+    /**
+     * @brief Checks whether a search is in progress
+     * @return true until finished() has been emitted or the search was cancelled
+     */
+    bool isRunning() const;
+
+    /** @brief Matches reported per document at most */
+    static const int MAX_MATCHES = 10000;
+
+signals:
+    /**
+     * @brief Emitted when a document has been searched
+     * @param result Matches within the document
+     */
+    void documentSearched(const DocumentSearchResult &result);
+
+    /**
+     * @brief Emitted when every document has been searched
+     */
+    void finished();
+
+private slots:
+    /** @brief Forwards the result of one document */
+    void onResultReady(int index);
+
+    /** @brief Forwards completion of the search */
+    void onFinished();
+
+private:
+    /**
+     * @brief Searches one document; runs on a worker thread
+     * @param promise Polled for cancellation
+     * @param document Index of the document
+     * @param text Snapshot to search
+     * @param pattern Search pattern
+     * @param options Search options
+     * @return Matches within the document
+     */
+    static DocumentSearchResult searchDocument(QPromise<DocumentSearchResult> &promise, int document,
+                                               const QString &text, const QString &pattern,
+                                               const SearchOptions &options);
+
+    /** @brief Watches the search in progress */
+    QFutureWatcher<DocumentSearchResult> m_watcher;
+
+    /** @brief Longest line text kept in a match */
+    static const int MAX_LINE_TEXT = 300;
+};
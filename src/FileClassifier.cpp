@@ -0,0 +1,216 @@
+#include "FileClassifier.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <optional>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+
+/**
+ * @brief Identity of one version of a file
+ */
+struct FileKey
+{
+    quint64 device = 0;  ///< Device holding the file
+    quint64 inode = 0;   ///< Inode of the file
+    qint64 modified = 0; ///< Modification time in nanoseconds
+    qint64 size = 0;     ///< Size in bytes
+    QString path;        ///< Path, only where device and inode are unavailable
+
+    bool operator==(const FileKey &other) const
+    {
+        return device == other.device && inode == other.inode && modified == other.modified
+               && size == other.size && path == other.path;
+    }
+};
+
+size_t qHash(const FileKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.device, key.inode, key.modified, key.size, key.path);
+}
+
+/**
+ * @brief Verdicts of unchanged files
+ */
+struct Cache
+{
+    QMutex mutex;
+    QHash<FileKey, FileClassifier::Kind> kinds;
+};
+
+Cache &cache()
+{
+    static Cache instance;
+    return instance;
+}
+
+std::optional<FileKey> fileKey(const QString &filePath)
+{
+    FileKey key;
+#ifdef Q_OS_UNIX
+    struct stat status;
+    if (::stat(QFile::encodeName(filePath).constData(), &status) != 0 || !S_ISREG(status.st_mode)) {
+        return std::nullopt;
+    }
+    key.device = quint64(status.st_dev);
+    key.inode = quint64(status.st_ino);
+#ifdef Q_OS_LINUX
+    key.modified = qint64(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#else
+    key.modified = qint64(status.st_mtime) * 1000000000;
+#endif
+    key.size = qint64(status.st_size);
+#else
+    const QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile()) {
+        return std::nullopt;
+    }
+    key.modified = fileInfo.lastModified().toMSecsSinceEpoch() * 1000000;
+    key.size = fileInfo.size();
+    key.path = fileInfo.absoluteFilePath();
+#endif
+    return key;
+}
+
+bool startsWith(QByteArrayView data, const char *prefix, qsizetype length)
+{
+    return data.size() >= length && std::equal(prefix, prefix + length, data.data());
+}
+
+/**
+ * @brief Length of a valid UTF-8 sequence starting at a position
+ * @return Sequence length, 0 if invalid, or -1 if cut off by the end of the data
+ */
+int utf8SequenceLength(const uchar *data, qsizetype available)
+{
+    const uchar lead = data[0];
+    int length = 0;
+    uchar min = 0x80;
+    uchar max = 0xbf;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        min = lead == 0xe0 ? 0xa0 : 0x80; // Overlong forms
+        max = lead == 0xed ? 0x9f : 0xbf; // Surrogates
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        min = lead == 0xf0 ? 0x90 : 0x80;
+        max = lead == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return 0;
+    }
+
+    for (int i = 1; i < length; ++i) {
+        if (i >= available) {
+            return -1;
+        }
+        const uchar next = data[i];
+        if (next < (i == 1 ? min : 0x80) || next > (i == 1 ? max : 0xbf)) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+} // namespace
+
+FileClassifier::Kind FileClassifier::classify(const QString &filePath)
+{
+    const std::optional<FileKey> key = fileKey(filePath);
+    if (!key) {
+        return Kind::Text;
+    }
+
+    Cache &shared = cache();
+    {
+        QMutexLocker locker(&shared.mutex);
+        const auto it = shared.kinds.constFind(*key);
+        if (it != shared.kinds.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return Kind::Text;
+    }
+    const QByteArray head = file.read(SNIFF_SIZE);
+    const Kind kind = classifyData(head, file.atEnd());
+
+    QMutexLocker locker(&shared.mutex);
+    if (shared.kinds.size() >= MAX_CACHE_ENTRIES) {
+        shared.kinds.clear();
+    }
+    shared.kinds.insert(*key, kind);
+    return kind;
+}
+
+bool FileClassifier::isText(const QString &filePath)
+{
+    return classify(filePath) != Kind::Binary;
+}
+
+FileClassifier::Kind FileClassifier::classifyData(QByteArrayView head, bool complete)
+{
+    if (head.size() > SNIFF_SIZE) {
+        head = head.first(SNIFF_SIZE);
+        complete = false;
+    }
+
+    // Byte order marks
+    if (startsWith(head, "\xef\xbb\xbf", 3)) {
+        return Kind::Text;
+    }
+    if (startsWith(head, "\xff\xfe\x00\x00", 4) || startsWith(head, "\x00\x00\xfe\xff", 4)
+        || startsWith(head, "\xff\xfe", 2) || startsWith(head, "\xfe\xff", 2)) {
+        return Kind::WideText;
+    }
+
+    if (head.contains('\0')) {
+        return Kind::Binary;
+    }
+    if (startsWith(head, "#!", 2)) {
+        return Kind::Text;
+    }
+
+    const uchar *data = reinterpret_cast<const uchar *>(head.data());
+    const qsizetype size = head.size();
+    qsizetype suspicious = 0;
+    for (qsizetype i = 0; i < size;) {
+        const uchar ch = data[i];
+        if (ch < 0x80) {
+            // Tabs, line breaks, form feeds and escape sequences are common in text
+            if (ch < 0x20 && ch != '\t' && ch != '\n' && ch != '\r' && ch != '\f' && ch != '\v' && ch != 0x1b
+                && ch != '\b') {
+                ++suspicious;
+            } else if (ch == 0x7f) {
+                ++suspicious;
+            }
+            ++i;
+            continue;
+        }
+
+        const int length = utf8SequenceLength(data + i, size - i);
+        if (length > 0) {
+            i += length;
+        } else if (length < 0 && !complete) {
+            break; // Cut off by the end of the block
+        } else {
+            ++suspicious;
+            ++i;
+        }
+    }
+
+    return suspicious * 100 > size * MAX_SUSPICIOUS_PERCENT ? Kind::Binary : Kind::Text;
+}
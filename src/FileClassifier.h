@@ -0,0 +1,69 @@
+/**
+ * @file FileClassifier.h
+ * @brief Text or binary classification of files by their content
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QByteArrayView>
+#include <QString>
+
+/**
+ * @class FileClassifier
+ * @brief Decides whether a file holds text by sniffing its first block
+ *
+ * Only the first SNIFF_SIZE bytes are inspected, so the file name does not
+ * matter. A Unicode byte order mark makes the file text, as does a "#!"
+ * script line. Otherwise a NUL byte makes it binary, as do more than
+ * MAX_SUSPICIOUS_PERCENT percent of control characters and bytes that are
+ * not valid UTF-8; this leaves room for stray Latin-1 characters.
+ *
+ * Verdicts for files are cached, keyed by device, inode, modification
+ * time and size, so unchanged files are classified once however often
+ * they are clicked, opened or searched. All functions are thread-safe.
+ *
+ * @see FileExplorer, FileSearchEngine
+ */
+class FileClassifier
+{
+public:
+    /** @brief Kind of content */
+    enum class Kind {
+        Text,     ///< UTF-8 (or ASCII) text, possibly with stray non-UTF-8 bytes
+        WideText, ///< UTF-16 or UTF-32 text with a byte order mark
+        Binary    ///< Anything else
+    };
+
+    /**
+     * @brief Classifies a file, using the cache when the file is unchanged
+     * @param filePath Path of the file
+     * @return Kind of the content; Text for unreadable files, so opening them reports the error
+     */
+    static Kind classify(const QString &filePath);
+
+    /**
+     * @brief Checks whether a file can be opened in the editor
+     * @param filePath Path of the file
+     * @return true unless the file is binary
+     */
+    static bool isText(const QString &filePath);
+
+    /**
+     * @brief Classifies the first block of a file
+     * @param head Start of the file; only the first SNIFF_SIZE bytes are inspected
+     * @param complete Whether head is the whole file, so a sequence cut at its end is invalid
+     * @return Kind of the content
+     */
+    static Kind classifyData(QByteArrayView head, bool complete);
+
+    /** @brief Bytes inspected at the start of a file */
+    static const int SNIFF_SIZE = 8192;
+
+    /** @brief Control characters and invalid UTF-8 bytes tolerated in text, in percent */
+    static const int MAX_SUSPICIOUS_PERCENT = 10;
+
+    /** @brief Cached verdicts beyond which the cache starts over */
+    static const int MAX_CACHE_ENTRIES = 65536;
+};
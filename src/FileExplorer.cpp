@@ -1,4 +1,6 @@
 #include "FileExplorer.h"
+#include "FileClassifier.h"
+#include "PathIndex.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -16,14 +18,25 @@
 FileExplorer::FileExplorer(QWidget *parent)
     : QWidget(parent)
     , m_treeView(nullptr)
-    , m_fileSystemModel(nullptr)
+    , m_fileTreeModel(nullptr)
+    , m_filterModel(nullptr)
+    , m_filterEdit(nullptr)
+    , m_pathIndex(nullptr)
+    , m_filterExpandedCount(0)
     , m_pathEdit(nullptr)
     , m_browseButton(nullptr)
+    , m_operationQueue(nullptr)
+    , m_progressWidget(nullptr)
+    , m_progressLabel(nullptr)
+    , m_progressBar(nullptr)
+    , m_cancelButton(nullptr)
     , m_contextMenu(nullptr)
     , m_newFileAction(nullptr)
     , m_newFolderAction(nullptr)
     , m_deleteAction(nullptr)
     , m_renameAction(nullptr)
+    , m_copyToAction(nullptr)
+    , m_moveToAction(nullptr)
     , m_copyPathAction(nullptr)
     , m_revealAction(nullptr)
     , m_currentPath()
@@ -56,30 +69,63 @@ void FileExplorer::setupUI()
     pathLayout->addWidget(m_pathEdit);
     pathLayout->addWidget(m_browseButton);
     
+    // Filter box
+    m_filterEdit = new QLineEdit(this);
+    m_filterEdit->setPlaceholderText(tr("Filter files"));
+    m_filterEdit->setClearButtonEnabled(true);
+    
     // Tree view
     m_treeView = new QTreeView(this);
-    m_fileSystemModel = new QFileSystemModel(this);
-    m_fileSystemModel->setRootPath("");
-    
-    m_treeView->setModel(m_fileSystemModel);
-    m_treeView->setRootIndex(m_fileSystemModel->index(QDir::currentPath()));
-    
-    // Hide size, type, and date columns
-    m_treeView->hideColumn(1);
-    m_treeView->hideColumn(2);
-    m_treeView->hideColumn(3);
+    m_fileTreeModel = new FileTreeModel(this);
+    m_filterModel = new FileFilterModel(this);
+    m_filterModel->setSourceModel(m_fileTreeModel);
+    m_treeView->setModel(m_filterModel);
     
     m_treeView->setHeaderHidden(true);
     m_treeView->setContextMenuPolicy(Qt::CustomContextMenu);
     
+    // Progress of background file operations
+    m_operationQueue = new FileOperationQueue(this);
+    m_progressWidget = new QWidget(this);
+    QHBoxLayout *progressLayout = new QHBoxLayout(m_progressWidget);
+    progressLayout->setContentsMargins(0, 0, 0, 0);
+    m_progressLabel = new QLabel(m_progressWidget);
+    m_progressLabel->setTextFormat(Qt::PlainText);
+    m_progressBar = new QProgressBar(m_progressWidget);
+    m_progressBar->setTextVisible(false);
+    m_progressBar->setMaximumWidth(80);
+    m_cancelButton = new QPushButton(tr("Cancel"), m_progressWidget);
+    progressLayout->addWidget(m_progressLabel, 1);
+    progressLayout->addWidget(m_progressBar);
+    progressLayout->addWidget(m_cancelButton);
+    m_progressWidget->hide();
+    
     layout->addLayout(pathLayout);
+    layout->addWidget(m_filterEdit);
     layout->addWidget(m_treeView);
+    layout->addWidget(m_progressWidget);
     
     // Connections
     connect(m_browseButton, &QPushButton::clicked, this, &FileExplorer::browseFolder);
     connect(m_treeView, &QTreeView::doubleClicked, this, &FileExplorer::onItemDoubleClicked);
     connect(m_treeView, &QTreeView::clicked, this, &FileExplorer::onItemClicked);
     connect(m_treeView, &QTreeView::customContextMenuRequested, this, &FileExplorer::onCustomContextMenuRequested);
+    connect(m_cancelButton, &QPushButton::clicked, m_operationQueue, &FileOperationQueue::cancel);
+    connect(m_operationQueue, &FileOperationQueue::started, this, &FileExplorer::onOperationStarted);
+    connect(m_operationQueue, &FileOperationQueue::progress, this, &FileExplorer::onOperationProgress);
+    connect(m_operationQueue, &FileOperationQueue::finished, this, &FileExplorer::onOperationFinished);
+    connect(m_operationQueue, &FileOperationQueue::idle, m_progressWidget, &QWidget::hide);
+    connect(m_filterEdit, &QLineEdit::textChanged, this, &FileExplorer::onFilterTextChanged);
+    connect(&m_filterWatcher, &QFutureWatcher<QStringList>::finished, this, &FileExplorer::onFilterFinished);
+    connect(m_fileTreeModel, &FileTreeModel::directoryLoaded, this, &FileExplorer::onDirectoryLoaded);
+    
+    // Only expanded folders are watched for changes
+    connect(m_treeView, &QTreeView::expanded, this, [this](const QModelIndex &index) {
+        m_fileTreeModel->setWatched(m_filterModel->mapToSource(index), true);
+    });
+    connect(m_treeView, &QTreeView::collapsed, this, [this](const QModelIndex &index) {
+        m_fileTreeModel->setWatched(m_filterModel->mapToSource(index), false);
+    });
 }
 
 void FileExplorer::setupContextMenu()
@@ -90,6 +136,8 @@ void FileExplorer::setupContextMenu()
     m_newFolderAction = new QAction(tr("New Folder"), this);
     m_deleteAction = new QAction(tr("Delete"), this);
     m_renameAction = new QAction(tr("Rename"), this);
+    m_copyToAction = new QAction(tr("Copy To..."), this);
+    m_moveToAction = new QAction(tr("Move To..."), this);
     m_copyPathAction = new QAction(tr("Copy Path"), this);
     m_revealAction = new QAction(tr("Reveal in File Manager"), this);
     
@@ -97,6 +145,8 @@ void FileExplorer::setupContextMenu()
     m_contextMenu->addAction(m_newFolderAction);
     m_contextMenu->addSeparator();
     m_contextMenu->addAction(m_renameAction);
+    m_contextMenu->addAction(m_copyToAction);
+    m_contextMenu->addAction(m_moveToAction);
     m_contextMenu->addAction(m_deleteAction);
     m_contextMenu->addSeparator();
     m_contextMenu->addAction(m_copyPathAction);
@@ -106,6 +156,8 @@ void FileExplorer::setupContextMenu()
     connect(m_newFolderAction, &QAction::triggered, this, &FileExplorer::createNewFolder);
     connect(m_deleteAction, &QAction::triggered, this, &FileExplorer::deleteItem);
     connect(m_renameAction, &QAction::triggered, this, &FileExplorer::renameItem);
+    connect(m_copyToAction, &QAction::triggered, this, &FileExplorer::copyItemTo);
+    connect(m_moveToAction, &QAction::triggered, this, &FileExplorer::moveItemTo);
     connect(m_copyPathAction, &QAction::triggered, this, &FileExplorer::copyPath);
     connect(m_revealAction, &QAction::triggered, this, &FileExplorer::revealInSystem);
 }
@@ -114,9 +166,15 @@ void FileExplorer::setRootPath(const QString &path)
 {
     QDir dir(path);
     if (dir.exists()) {
+        const bool changed = (dir.absolutePath() != m_currentPath);
         m_currentPath = dir.absolutePath();
         m_pathEdit->setText(m_currentPath);
-        m_treeView->setRootIndex(m_fileSystemModel->index(m_currentPath));
+        
+        if (changed) {
+            m_filterEdit->clear();
+            m_fileTreeModel->setRootPath(m_currentPath);
+            emit rootPathChanged(m_currentPath);
+        }
     }
 }
 
@@ -125,22 +183,33 @@ QString FileExplorer::rootPath() const
     return m_currentPath;
 }
 
+void FileExplorer::setPathIndex(PathIndex *pathIndex)
+{
+    m_pathIndex = pathIndex;
+    
+    // Filter again once a fresh index is available
+    connect(m_pathIndex, &PathIndex::indexReady, this, [this]() {
+        if (!m_filterEdit->text().trimmed().isEmpty()) {
+            onFilterTextChanged(m_filterEdit->text());
+        }
+    });
+}
+
 void FileExplorer::refresh()
 {
-    // QFileSystemModel automatically refreshes in Qt6
-    // Force refresh by setting the root path again
-    QString currentPath = m_currentPath;
-    setRootPath(currentPath);
+    // Watched folders follow changes on their own; this also catches
+    // changes to folders that are loaded but collapsed
+    m_fileTreeModel->refresh();
 }
 
 void FileExplorer::onItemDoubleClicked(const QModelIndex &index)
 {
     if (!index.isValid()) return;
     
-    QString filePath = m_fileSystemModel->filePath(index);
+    QString filePath = index.data(FileTreeModel::FilePathRole).toString();
     QFileInfo fileInfo(filePath);
     
-    if (fileInfo.isFile() && isValidTextFile(filePath)) {
+    if (fileInfo.isFile() && FileClassifier::isText(filePath)) {
         emit fileDoubleClicked(filePath);
     }
 }
@@ -149,7 +218,7 @@ void FileExplorer::onItemClicked(const QModelIndex &index)
 {
     if (!index.isValid()) return;
     
-    QString filePath = m_fileSystemModel->filePath(index);
+    QString filePath = index.data(FileTreeModel::FilePathRole).toString();
     emit fileSelected(filePath);
 }
 
@@ -159,16 +228,20 @@ void FileExplorer::onCustomContextMenuRequested(const QPoint &pos)
     updateActions();
     
     if (index.isValid()) {
-        QString filePath = m_fileSystemModel->filePath(index);
+        QString filePath = index.data(FileTreeModel::FilePathRole).toString();
         QFileInfo fileInfo(filePath);
         
         m_deleteAction->setEnabled(true);
         m_renameAction->setEnabled(true);
+        m_copyToAction->setEnabled(true);
+        m_moveToAction->setEnabled(true);
         m_copyPathAction->setEnabled(true);
         m_revealAction->setEnabled(true);
     } else {
         m_deleteAction->setEnabled(false);
         m_renameAction->setEnabled(false);
+        m_copyToAction->setEnabled(false);
+        m_moveToAction->setEnabled(false);
         m_copyPathAction->setEnabled(false);
         m_revealAction->setEnabled(false);
     }
@@ -226,7 +299,7 @@ void FileExplorer::deleteItem()
     QModelIndex index = m_treeView->currentIndex();
     if (!index.isValid()) return;
     
-    QString filePath = m_fileSystemModel->filePath(index);
+    QString filePath = index.data(FileTreeModel::FilePathRole).toString();
     QFileInfo fileInfo(filePath);
     
     QString message;
@@ -240,20 +313,8 @@ void FileExplorer::deleteItem()
                                                            QMessageBox::Yes | QMessageBox::No);
     
     if (ret == QMessageBox::Yes) {
-        if (fileInfo.isDir()) {
-            QDir dir(filePath);
-            if (!dir.removeRecursively()) {
-                QMessageBox::warning(this, tr("Error"), 
-                                   tr("Could not delete folder: %1").arg(fileInfo.fileName()));
-            }
-        } else {
-            QFile file(filePath);
-            if (!file.remove()) {
-                QMessageBox::warning(this, tr("Error"), 
-                                   tr("Could not delete file: %1").arg(fileInfo.fileName()));
-            }
-        }
-        refresh();
+        // Runs in the background; the tree follows through its folder watches
+        m_operationQueue->enqueue({ FileOperationQueue::Type::Delete, filePath, QString() });
     }
 }
 
@@ -262,7 +323,7 @@ void FileExplorer::renameItem()
     QModelIndex index = m_treeView->currentIndex();
     if (!index.isValid()) return;
     
-    QString filePath = m_fileSystemModel->filePath(index);
+    QString filePath = index.data(FileTreeModel::FilePathRole).toString();
     QFileInfo fileInfo(filePath);
     
     bool ok;
@@ -272,12 +333,184 @@ void FileExplorer::renameItem()
     
     if (ok && !newName.isEmpty() && newName != fileInfo.fileName()) {
         QString newPath = QDir(fileInfo.absolutePath()).filePath(newName);
-        QFile file(filePath);
-        if (!file.rename(newPath)) {
-            QMessageBox::warning(this, tr("Error"), 
-                               tr("Could not rename: %1").arg(fileInfo.fileName()));
-        } else {
-            refresh();
+        m_operationQueue->enqueue({ FileOperationQueue::Type::Rename, filePath, newPath });
+    }
+}
+
+void FileExplorer::copyItemTo()
+{
+    transferItem(FileOperationQueue::Type::Copy);
+}
+
+void FileExplorer::moveItemTo()
+{
+    transferItem(FileOperationQueue::Type::Move);
+}
+
+void FileExplorer::transferItem(FileOperationQueue::Type type)
+{
+    QModelIndex index = m_treeView->currentIndex();
+    if (!index.isValid()) return;
+    
+    QString filePath = index.data(FileTreeModel::FilePathRole).toString();
+    QFileInfo fileInfo(filePath);
+    
+    QString title = (type == FileOperationQueue::Type::Copy) ? tr("Copy To") : tr("Move To");
+    QString dir = QFileDialog::getExistingDirectory(this, title, fileInfo.absolutePath());
+    if (dir.isEmpty()) return;
+    
+    QString newPath = QDir(dir).filePath(fileInfo.fileName());
+    if (QFileInfo(newPath).absoluteFilePath() == fileInfo.absoluteFilePath()) return;
+    
+    // A folder cannot go into itself or one of its subfolders
+    QString sourcePath = fileInfo.canonicalFilePath();
+    QString targetPath = QDir(QFileInfo(dir).canonicalFilePath()).filePath(fileInfo.fileName());
+    if (!sourcePath.isEmpty() && (targetPath == sourcePath || targetPath.startsWith(sourcePath + '/'))) {
+        QMessageBox::warning(this, title,
+                           tr("Cannot copy or move '%1' into itself.").arg(fileInfo.fileName()));
+        return;
+    }
+    
+    m_operationQueue->enqueue({ type, filePath, newPath });
+}
+
+void FileExplorer::onOperationStarted(const FileOperationQueue::Operation &operation)
+{
+    QString name = QFileInfo(operation.source).fileName();
+    QString text;
+    switch (operation.type) {
+        case FileOperationQueue::Type::Delete:
+            text = tr("Deleting %1").arg(name);
+            break;
+        case FileOperationQueue::Type::Copy:
+            text = tr("Copying %1").arg(name);
+            break;
+        case FileOperationQueue::Type::Move:
+            text = tr("Moving %1").arg(name);
+            break;
+        case FileOperationQueue::Type::Rename:
+            text = tr("Renaming %1").arg(name);
+            break;
+    }
+    
+    int pending = m_operationQueue->pendingCount();
+    if (pending > 0) {
+        text += tr(" (%n more queued)", nullptr, pending);
+    }
+    
+    m_progressLabel->setText(text);
+    m_progressBar->setRange(0, 0);
+    m_progressWidget->show();
+}
+
+void FileExplorer::onOperationProgress(int value, int maximum, const QString &text)
+{
+    m_progressBar->setRange(0, maximum);
+    if (maximum > 0) {
+        m_progressBar->setValue(value);
+    }
+    if (!text.isEmpty()) {
+        m_progressLabel->setText(text);
+    }
+}
+
+void FileExplorer::onOperationFinished(const FileOperationQueue::Operation &operation, const QStringList &errors,
+                                       bool canceled)
+{
+    if (canceled || errors.isEmpty()) return;
+    
+    // Long error lists are cut short
+    static const int maxErrorsShown = 10;
+    QStringList shown = errors.mid(0, maxErrorsShown);
+    if (errors.size() > maxErrorsShown) {
+        shown.append(tr("... and %n more", nullptr, int(errors.size() - maxErrorsShown)));
+    }
+    
+    QMessageBox::warning(this, tr("Error"),
+                         tr("Could not complete the operation on %1:\n\n%2")
+                             .arg(QFileInfo(operation.source).fileName(), shown.join(QLatin1Char('\n'))));
+}
+
+void FileExplorer::onFilterTextChanged(const QString &text)
+{
+    // Each keystroke supersedes the search still running
+    m_filterWatcher.cancel();
+    
+    if (text.trimmed().isEmpty()) {
+        if (m_filterModel->isFiltering()) {
+            m_filterModel->clearMatches();
+            m_treeView->collapseAll();
+            if (m_treeView->currentIndex().isValid()) {
+                m_treeView->scrollTo(m_treeView->currentIndex());
+            }
+        }
+        return;
+    }
+    
+    if (!m_pathIndex || QDir::cleanPath(m_pathIndex->rootPath()) != m_currentPath) {
+        return;
+    }
+    
+    // Matching runs once the index is ready, see setPathIndex()
+    m_pathIndex->refresh(FILTER_INDEX_MAX_AGE);
+    if (!m_pathIndex->isReady()) {
+        return;
+    }
+    
+    m_filterWatcher.setFuture(m_pathIndex->filter(text, MAX_FILTER_RESULTS));
+}
+
+void FileExplorer::onFilterFinished()
+{
+    if (m_filterWatcher.future().isCanceled() || m_filterWatcher.future().resultCount() == 0) {
+        return;
+    }
+    
+    const QStringList paths = m_filterWatcher.result();
+    m_filterModel->setMatches(m_currentPath, paths);
+    m_filterExpandedCount = 0;
+    expandMatches(QModelIndex());
+    
+    if (paths.size() >= MAX_FILTER_RESULTS) {
+        m_filterEdit->setToolTip(tr("Showing the first %1 matching files").arg(MAX_FILTER_RESULTS));
+    } else {
+        m_filterEdit->setToolTip(tr("%n matching file(s)", nullptr, int(paths.size())));
+    }
+}
+
+void FileExplorer::onDirectoryLoaded(const QString &path)
+{
+    if (!m_filterModel->isFiltering()) return;
+    
+    // Continue expanding towards the matches as folders arrive
+    const QModelIndex sourceIndex = m_fileTreeModel->indexForPath(path);
+    const QModelIndex index = m_filterModel->mapFromSource(sourceIndex);
+    if (sourceIndex.isValid() && !index.isValid()) return;
+    
+    expandMatches(index);
+}
+
+void FileExplorer::expandMatches(const QModelIndex &parent)
+{
+    // Folders are listed lazily; expanding one lists it, and its matches
+    // are expanded in turn when onDirectoryLoaded() reports it
+    const int rows = m_filterModel->rowCount(parent);
+    for (int row = 0; row < rows; ++row) {
+        const QModelIndex index = m_filterModel->index(row, 0, parent);
+        const QString path = index.data(FileTreeModel::FilePathRole).toString();
+        if (!m_filterModel->isMatchAncestor(path)) {
+            continue;
+        }
+        
+        if (!m_treeView->isExpanded(index)) {
+            if (m_filterExpandedCount >= MAX_FILTER_EXPANDED) {
+                continue;
+            }
+            ++m_filterExpandedCount;
+            m_treeView->expand(index);
+        }
+        if (m_filterModel->rowCount(index) > 0) {
+            expandMatches(index);
         }
     }
 }
@@ -287,7 +520,7 @@ void FileExplorer::copyPath()
     QModelIndex index = m_treeView->currentIndex();
     if (!index.isValid()) return;
     
-    QString filePath = m_fileSystemModel->filePath(index);
+    QString filePath = index.data(FileTreeModel::FilePathRole).toString();
     QApplication::clipboard()->setText(filePath);
 }
 
@@ -296,7 +529,7 @@ void FileExplorer::revealInSystem()
     QModelIndex index = m_treeView->currentIndex();
     if (!index.isValid()) return;
     
-    QString filePath = m_fileSystemModel->filePath(index);
+    QString filePath = index.data(FileTreeModel::FilePathRole).toString();
     QDesktopServices::openUrl(QUrl::fromLocalFile(QFileInfo(filePath).absolutePath()));
 }
 
@@ -305,20 +538,3 @@ void FileExplorer::updateActions()
     // Actions are always enabled in current implementation
     // This method is here for future enhancements
 }
-
-bool FileExplorer::isValidTextFile(const QString &filePath) const
-{
-    QFileInfo fileInfo(filePath);
-    QString suffix = fileInfo.suffix().toLower();
-    
-    // List of supported text file extensions
-    QStringList textExtensions = {
-        "txt", "cpp", "c", "h", "hpp", "cxx", "cc",
-        "py", "js", "ts", "json", "xml", "html", "htm",
-        "css", "scss", "less", "md", "rst", "yaml", "yml",
-        "ini", "cfg", "conf", "log", "csv", "tsv"
-    };
-    
-    return textExtensions.contains(suffix) || suffix.isEmpty();
-}
-
@@ -6,13 +6,21 @@
 #include <QHBoxLayout>
 #include <QLineEdit>
 #include <QPushButton>
-#include <QFileSystemModel>
+#include <QProgressBar>
+#include <QLabel>
 #include <QHeaderView>
 #include <QMenu>
 #include <QAction>
 #include <QContextMenuEvent>
 #include <QModelIndex>
 #include <QDir>
+#include <QFutureWatcher>
+
+#include "FileTreeModel.h"
+#include "FileOperationQueue.h"
+#include "FileFilterModel.h"
+
+class PathIndex;
 
 class FileExplorer : public QWidget
 {
@@ -24,12 +32,14 @@ public:
 
     void setRootPath(const QString &path);
     QString rootPath() const;
+    void setPathIndex(PathIndex *pathIndex);
     
     void refresh();
 
 signals:
     void fileDoubleClicked(const QString &filePath);
     void fileSelected(const QString &filePath);
+    void rootPathChanged(const QString &path);
 
 private slots:
     void onItemDoubleClicked(const QModelIndex &index);
@@ -40,6 +50,14 @@ private slots:
     void createNewFolder();
     void deleteItem();
     void renameItem();
+    void copyItemTo();
+    void moveItemTo();
+    void onOperationStarted(const FileOperationQueue::Operation &operation);
+    void onOperationProgress(int value, int maximum, const QString &text);
+    void onOperationFinished(const FileOperationQueue::Operation &operation, const QStringList &errors, bool canceled);
+    void onFilterTextChanged(const QString &text);
+    void onFilterFinished();
+    void onDirectoryLoaded(const QString &path);
     void copyPath();
     void revealInSystem();
 
@@ -47,20 +65,38 @@ private:
     void setupUI();
     void setupContextMenu();
     void updateActions();
-    bool isValidTextFile(const QString &filePath) const;
+    void transferItem(FileOperationQueue::Type type);
+    void expandMatches(const QModelIndex &parent);
     
     QTreeView *m_treeView;
-    QFileSystemModel *m_fileSystemModel;
+    FileTreeModel *m_fileTreeModel;
+    FileFilterModel *m_filterModel;
+    QLineEdit *m_filterEdit;
+    PathIndex *m_pathIndex;
+    QFutureWatcher<QStringList> m_filterWatcher;
+    int m_filterExpandedCount;
     QLineEdit *m_pathEdit;
     QPushButton *m_browseButton;
     
+    FileOperationQueue *m_operationQueue;
+    QWidget *m_progressWidget;
+    QLabel *m_progressLabel;
+    QProgressBar *m_progressBar;
+    QPushButton *m_cancelButton;
+    
     QMenu *m_contextMenu;
     QAction *m_newFileAction;
     QAction *m_newFolderAction;
     QAction *m_deleteAction;
     QAction *m_renameAction;
+    QAction *m_copyToAction;
+    QAction *m_moveToAction;
     QAction *m_copyPathAction;
     QAction *m_revealAction;
     
     QString m_currentPath;
+    
+    static const int MAX_FILTER_RESULTS = 5000;
+    static const int MAX_FILTER_EXPANDED = 200;
+    static const int FILTER_INDEX_MAX_AGE = 60 * 1000;
 };
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "FileFilterModel.h"
+#include "FileTreeModel.h"
+
+FileFilterModel::FileFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_filtering(false)
+{
+}
+
+void FileFilterModel::setMatches(const QString &rootPath, const QStringList &filePaths)
+{
+    QSet<QString> files;
+    QSet<QString> directories;
+    files.reserve(filePaths.size());
+    for (const QString &filePath : filePaths) {
+        files.insert(filePath);
+
+        // Stop at the first folder already known; its parents are too
+        qsizetype slash = filePath.lastIndexOf(QLatin1Char('/'));
+        while (slash > rootPath.size()) {
+            const QString directory = filePath.left(slash);
+            if (directories.contains(directory)) {
+                break;
+            }
+            directories.insert(directory);
+            slash = filePath.lastIndexOf(QLatin1Char('/'), slash - 1);
+        }
+    }
+
+    m_files.swap(files);
+    m_directories.swap(directories);
+    m_filtering = true;
+    invalidateFilter();
+}
+
+void FileFilterModel::clearMatches()
+{
+    if (!m_filtering) {
+        return;
+    }
+
+    m_files.clear();
+    m_directories.clear();
+    m_filtering = false;
+    invalidateFilter();
+}
+
+bool FileFilterModel::isFiltering() const
+{
+    return m_filtering;
+}
+
+bool FileFilterModel::isMatchAncestor(const QString &path) const
+{
+    return m_directories.contains(path);
+}
+
+bool FileFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (!m_filtering) {
+        return true;
+    }
+
+    const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+    const QString path = index.data(FileTreeModel::FilePathRole).toString();
+    return m_files.contains(path) || m_directories.contains(path);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file FileFilterModel.h
+ * @brief Proxy model showing only the files matching the explorer filter
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @class FileFilterModel
+ * @brief Hides every entry of a FileTreeModel except given files and their folders
+ *
+ * The matching files come from PathIndex::filter(), which searches the
+ * whole workspace, while the source model only knows the folders listed
+ * so far. Rows are therefore accepted by path: a file is shown when it
+ * matched, and a folder when it contains a match. Folders listed later
+ * are filtered as their rows arrive, so the view can expand towards the
+ * matches lazily (see isMatchAncestor()).
+ *
+ * @see FileExplorer, FileTreeModel
+ */
+class FileFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a model that shows everything
+     * @param parent Parent object
+     */
+    explicit FileFilterModel(QObject *parent = nullptr);
+
+    /**
+     * @brief Shows only the given files and the folders leading to them
+     * @param rootPath Root folder of the source model
+     * @param filePaths Absolute paths of the files to show
+     */
+    void setMatches(const QString &rootPath, const QStringList &filePaths);
+
+    /**
+     * @brief Shows every entry again
+     */
+    void clearMatches();
+
+    /**
+     * @brief Checks whether entries are being filtered
+     * @return true between setMatches() and clearMatches()
+     */
+    bool isFiltering() const;
+
+    /**
+     * @brief Checks whether a folder contains a matching file
+     * @param path Absolute folder path
+     * @return true if the folder is to be expanded to reveal matches
+     */
+    bool isMatchAncestor(const QString &path) const;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    /** @brief Whether entries are being filtered */
+    bool m_filtering;
+
+    /** @brief Matching files */
+    QSet<QString> m_files;
+
+    /** @brief Folders containing matching files, below the root */
+    QSet<QString> m_directories;
+};
@@ -0,0 +1,553 @@
+#include "FileOperationQueue.h"
+#include "Utils.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QPromise>
+#include <QThreadPool>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <memory>
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+/**
+ * @brief State of one running operation
+ */
+class Worker
+{
+public:
+    explicit Worker(QPromise<QStringList> &promise)
+        : m_promise(promise)
+    {
+    }
+
+    bool isCanceled() const
+    {
+        return m_promise.isCanceled();
+    }
+
+    QStringList errors() const
+    {
+        return m_errors;
+    }
+
+    /** @brief Deletes a file or folder tree */
+    void remove(const QString &path)
+    {
+        m_promise.setProgressRange(0, 0);
+        m_label = QFileInfo(path).fileName();
+        removeTree(path);
+    }
+
+    /** @brief Copies a file or folder tree to a path that must not exist */
+    void copy(const QString &source, const QString &target)
+    {
+        m_promise.setProgressRange(0, FileOperationQueue::PROGRESS_MAXIMUM);
+        m_label = QFileInfo(source).fileName();
+        if (QFileInfo::exists(target)) {
+            fail(target, EEXIST);
+            return;
+        }
+
+        m_totalBytes = treeSize(source);
+        copyTree(source, target);
+        if (isCanceled()) {
+            return;
+        }
+        m_promise.setProgressValue(FileOperationQueue::PROGRESS_MAXIMUM);
+    }
+
+    /** @brief Renames without overwriting; returns the error code, 0 on success */
+    static int renameNoReplace(const QString &source, const QString &target)
+    {
+#ifdef Q_OS_UNIX
+        const QByteArray nativeSource = QFile::encodeName(source);
+        const QByteArray nativeTarget = QFile::encodeName(target);
+#ifdef Q_OS_LINUX
+        // Atomic check; falls through on file systems without the flag. EINVAL
+        // also means a folder moved into itself, which run() rejects beforehand
+        if (::renameat2(AT_FDCWD, nativeSource.constData(), AT_FDCWD, nativeTarget.constData(), RENAME_NOREPLACE)
+            == 0) {
+            return 0;
+        }
+        if (errno != EINVAL && errno != ENOSYS) {
+            return errno;
+        }
+#endif
+        struct stat status;
+        if (::lstat(nativeTarget.constData(), &status) == 0) {
+            return EEXIST;
+        }
+        return ::rename(nativeSource.constData(), nativeTarget.constData()) == 0 ? 0 : errno;
+#else
+        if (QFileInfo::exists(target)) {
+            return EEXIST;
+        }
+        return QFile::rename(source, target) ? 0 : EIO;
+#endif
+    }
+
+    /** @brief Checks whether a target lies in the source itself or below it */
+    static bool isWithinSource(const QString &source, const QString &target)
+    {
+        // The target does not exist yet, so only its folder can be resolved
+        const QString sourcePath = QFileInfo(source).canonicalFilePath();
+        const QFileInfo targetInfo(target);
+        const QString targetFolder = QFileInfo(targetInfo.absolutePath()).canonicalFilePath();
+        if (sourcePath.isEmpty() || targetFolder.isEmpty()) {
+            return false;
+        }
+        const QString targetPath = QDir(targetFolder).filePath(targetInfo.fileName());
+        return targetPath == sourcePath || targetPath.startsWith(sourcePath + QLatin1Char('/'));
+    }
+
+    void fail(const QString &path, int error)
+    {
+        fail(path, QString::fromLocal8Bit(std::strerror(error)));
+    }
+
+    void fail(const QString &path, const QString &message)
+    {
+        m_errors.append(QStringLiteral("%1: %2").arg(QDir::toNativeSeparators(path), message));
+    }
+
+private:
+    void reportRemoved()
+    {
+        ++m_removedCount;
+        if (m_removedCount % FileOperationQueue::DELETE_REPORT_INTERVAL == 0) {
+            // Without a range the value is only a count, shown as a busy indicator
+            const int count = int(qMin<qint64>(m_removedCount, INT_MAX));
+            m_promise.setProgressValueAndText(count, QObject::tr("Deleting %1: %n items removed", nullptr, count)
+                                                         .arg(m_label));
+        }
+    }
+
+    void reportCopied(qint64 bytes)
+    {
+        m_copiedBytes += bytes;
+        const int value = m_totalBytes > 0
+                              ? int(qMin<qint64>(m_copiedBytes * FileOperationQueue::PROGRESS_MAXIMUM / m_totalBytes,
+                                                 FileOperationQueue::PROGRESS_MAXIMUM))
+                              : 0;
+        m_promise.setProgressValueAndText(value, QObject::tr("Copying %1: %2 of %3")
+                                                     .arg(m_label, Utils::formatFileSize(m_copiedBytes),
+                                                          Utils::formatFileSize(m_totalBytes)));
+    }
+
+    qint64 treeSize(const QString &path) const
+    {
+        const QFileInfo fileInfo(path);
+        if (!fileInfo.isDir() || fileInfo.isSymLink()) {
+            return fileInfo.isSymLink() ? 0 : fileInfo.size();
+        }
+
+        qint64 size = 0;
+        QDirIterator it(path, QDir::Files | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext() && !isCanceled()) {
+            it.next();
+            if (!it.fileInfo().isSymLink()) {
+                size += it.fileInfo().size();
+            }
+        }
+        return size;
+    }
+
+#ifdef Q_OS_UNIX
+    void removeTree(const QString &path)
+    {
+        const QByteArray nativePath = QFile::encodeName(path);
+        struct stat status;
+        if (::lstat(nativePath.constData(), &status) != 0) {
+            fail(path, errno);
+            return;
+        }
+        if (!S_ISDIR(status.st_mode)) {
+            if (::unlink(nativePath.constData()) != 0) {
+                fail(path, errno);
+            }
+            return;
+        }
+
+        const int fd = ::open(nativePath.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0) {
+            fail(path, errno);
+            return;
+        }
+        removeContents(fd, path);
+        if (!isCanceled() && ::rmdir(nativePath.constData()) != 0) {
+            fail(path, errno);
+        }
+    }
+
+    /** @brief Empties an open folder; takes ownership of the descriptor */
+    void removeContents(int fd, const QString &path)
+    {
+        DIR *dir = ::fdopendir(fd);
+        if (!dir) {
+            fail(path, errno);
+            ::close(fd);
+            return;
+        }
+
+        // Entries are unlinked relative to the folder, without resolving paths again
+        const int dirFd = ::dirfd(dir);
+        while (const dirent *entry = ::readdir(dir)) {
+            if (isCanceled()) {
+                break;
+            }
+
+            const char *name = entry->d_name;
+            if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) {
+                continue;
+            }
+
+            bool isDirectory = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN) {
+                struct stat status;
+                isDirectory = ::fstatat(dirFd, name, &status, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(status.st_mode);
+            }
+
+            if (isDirectory) {
+                const int childFd = ::openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (childFd < 0) {
+                    fail(childPath(path, name), errno);
+                    continue;
+                }
+                removeContents(childFd, childPath(path, name));
+                if (isCanceled()) {
+                    break;
+                }
+            }
+
+            if (::unlinkat(dirFd, name, isDirectory ? AT_REMOVEDIR : 0) != 0) {
+                fail(childPath(path, name), errno);
+            } else {
+                reportRemoved();
+            }
+        }
+        ::closedir(dir);
+    }
+
+    static QString childPath(const QString &path, const char *name)
+    {
+        return path + QLatin1Char('/') + QFile::decodeName(name);
+    }
+
+    void copyTree(const QString &source, const QString &target)
+    {
+        const QByteArray nativeSource = QFile::encodeName(source);
+        const QByteArray nativeTarget = QFile::encodeName(target);
+        struct stat status;
+        if (::lstat(nativeSource.constData(), &status) != 0) {
+            fail(source, errno);
+            return;
+        }
+
+        if (S_ISLNK(status.st_mode)) {
+            QByteArray link(status.st_size > 0 ? status.st_size : PATH_MAX, Qt::Uninitialized);
+            const ssize_t length = ::readlink(nativeSource.constData(), link.data(), size_t(link.size()));
+            if (length < 0) {
+                fail(source, errno);
+                return;
+            }
+            link.truncate(length);
+            if (::symlink(link.constData(), nativeTarget.constData()) != 0) {
+                fail(target, errno);
+            }
+            return;
+        }
+
+        if (S_ISDIR(status.st_mode)) {
+            if (::mkdir(nativeTarget.constData(), status.st_mode & 07777) != 0) {
+                fail(target, errno);
+                return;
+            }
+            QDirIterator it(source, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+            while (it.hasNext() && !isCanceled()) {
+                it.next();
+                copyTree(it.filePath(), QDir(target).filePath(it.fileName()));
+            }
+            return;
+        }
+
+        if (S_ISREG(status.st_mode)) {
+            copyFile(nativeSource, nativeTarget, status, target);
+        }
+    }
+
+    void copyFile(const QByteArray &source, const QByteArray &target, const struct stat &status,
+                  const QString &targetPath)
+    {
+        const int in = ::open(source.constData(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            fail(QFile::decodeName(source), errno);
+            return;
+        }
+        const int out = ::open(target.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, status.st_mode & 07777);
+        if (out < 0) {
+            fail(targetPath, errno);
+            ::close(in);
+            return;
+        }
+
+        int error = 0;
+#ifdef Q_OS_LINUX
+        // The kernel copies directly, or shares extents on file systems that can
+        bool kernelCopy = true;
+#else
+        bool kernelCopy = false;
+#endif
+        std::unique_ptr<char[]> buffer;
+        for (;;) {
+            if (isCanceled()) {
+                break;
+            }
+
+            ssize_t copied = -1;
+#ifdef Q_OS_LINUX
+            if (kernelCopy) {
+                copied = ::copy_file_range(in, nullptr, out, nullptr, FileOperationQueue::COPY_CHUNK_SIZE, 0);
+                if (copied < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                    kernelCopy = false;
+                    continue;
+                }
+            }
+#endif
+            if (!kernelCopy) {
+                if (!buffer) {
+                    buffer.reset(new char[FileOperationQueue::COPY_CHUNK_SIZE]);
+                }
+                copied = ::read(in, buffer.get(), FileOperationQueue::COPY_CHUNK_SIZE);
+                if (copied > 0 && !writeAll(out, buffer.get(), copied)) {
+                    copied = -1;
+                }
+            }
+
+            if (copied < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = errno;
+                break;
+            }
+            if (copied == 0) {
+                break;
+            }
+            reportCopied(copied);
+        }
+
+        ::close(in);
+        if (::close(out) != 0 && error == 0) {
+            error = errno;
+        }
+
+        // A partial copy is worse than none
+        if (error != 0 || isCanceled()) {
+            ::unlink(target.constData());
+            if (error != 0) {
+                fail(targetPath, error);
+            }
+        }
+    }
+
+    static bool writeAll(int fd, const char *data, ssize_t size)
+    {
+        while (size > 0) {
+            const ssize_t written = ::write(fd, data, size_t(size));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+#else
+    void removeTree(const QString &path)
+    {
+        const QFileInfo fileInfo(path);
+        if (!fileInfo.isDir() || fileInfo.isSymLink()) {
+            if (!QFile::remove(path)) {
+                fail(path, EIO);
+            }
+            return;
+        }
+
+        QDirIterator it(path, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        while (it.hasNext() && !isCanceled()) {
+            it.next();
+            removeTree(it.filePath());
+            reportRemoved();
+        }
+        if (!isCanceled() && !QDir().rmdir(path)) {
+            fail(path, EIO);
+        }
+    }
+
+    void copyTree(const QString &source, const QString &target)
+    {
+        const QFileInfo fileInfo(source);
+        if (fileInfo.isDir() && !fileInfo.isSymLink()) {
+            if (!QDir().mkdir(target)) {
+                fail(target, EIO);
+                return;
+            }
+            QDirIterator it(source, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+            while (it.hasNext() && !isCanceled()) {
+                it.next();
+                copyTree(it.filePath(), QDir(target).filePath(it.fileName()));
+            }
+            return;
+        }
+
+        if (!QFile::copy(source, target)) {
+            fail(target, EIO);
+            return;
+        }
+        reportCopied(fileInfo.size());
+    }
+#endif
+
+    QPromise<QStringList> &m_promise;
+    QStringList m_errors;
+    QString m_label;
+    qint64 m_removedCount = 0;
+    qint64 m_totalBytes = 0;
+    qint64 m_copiedBytes = 0;
+};
+
+} // namespace
+
+FileOperationQueue::FileOperationQueue(QObject *parent)
+    : QObject(parent)
+    , m_busy(false)
+{
+    connect(&m_watcher, &QFutureWatcher<QStringList>::finished, this, &FileOperationQueue::onOperationFinished);
+    connect(&m_watcher, &QFutureWatcher<QStringList>::progressValueChanged, this, [this](int value) {
+        emit progress(value, m_watcher.progressMaximum(), m_watcher.progressText());
+    });
+}
+
+FileOperationQueue::~FileOperationQueue()
+{
+    cancel();
+    m_watcher.waitForFinished();
+}
+
+void FileOperationQueue::enqueue(const Operation &operation)
+{
+    m_pending.append(operation);
+    if (!m_busy) {
+        startNext();
+    }
+}
+
+void FileOperationQueue::cancel()
+{
+    m_pending.clear();
+    if (m_busy) {
+        m_watcher.cancel();
+    }
+}
+
+bool FileOperationQueue::isBusy() const
+{
+    return m_busy;
+}
+
+int FileOperationQueue::pendingCount() const
+{
+    return int(m_pending.size());
+}
+
+void FileOperationQueue::onOperationFinished()
+{
+    const bool canceled = m_watcher.future().isCanceled();
+    const QStringList errors = (!canceled && m_watcher.future().resultCount() > 0) ? m_watcher.result()
+                                                                                  : QStringList();
+    const Operation operation = m_current;
+    m_busy = false;
+    emit finished(operation, errors, canceled);
+
+    if (!m_busy) {
+        startNext();
+    }
+}
+
+void FileOperationQueue::startNext()
+{
+    if (m_pending.isEmpty()) {
+        emit idle();
+        return;
+    }
+
+    m_current = m_pending.takeFirst();
+    m_busy = true;
+
+    auto promise = std::make_shared<QPromise<QStringList>>();
+    m_watcher.setFuture(promise->future());
+    promise->start();
+    emit started(m_current);
+
+    const Operation operation = m_current;
+    QThreadPool::globalInstance()->start([promise, operation]() {
+        QStringList errors = run(*promise, operation);
+        if (!promise->isCanceled()) {
+            promise->addResult(std::move(errors));
+        }
+        promise->finish();
+    });
+}
+
+QStringList FileOperationQueue::run(QPromise<QStringList> &promise, const Operation &operation)
+{
+    Worker worker(promise);
+
+    // Copying a folder into itself would keep finding the copy it creates
+    if (operation.type != Type::Delete && Worker::isWithinSource(operation.source, operation.target)) {
+        worker.fail(operation.target, QObject::tr("Cannot copy or move a folder into itself"));
+        return worker.errors();
+    }
+
+    switch (operation.type) {
+    case Type::Delete:
+        worker.remove(operation.source);
+        break;
+    case Type::Copy:
+        worker.copy(operation.source, operation.target);
+        break;
+    case Type::Move:
+    case Type::Rename: {
+        const int error = Worker::renameNoReplace(operation.source, operation.target);
+        if (error == EXDEV && operation.type == Type::Move) {
+            // Across file systems: copy, then delete the original only if everything arrived
+            worker.copy(operation.source, operation.target);
+            if (!worker.isCanceled() && worker.errors().isEmpty()) {
+                worker.remove(operation.source);
+            }
+        } else if (error != 0) {
+            worker.fail(operation.target, error);
+        }
+        break;
+    }
+    }
+    return worker.errors();
+}
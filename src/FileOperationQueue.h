@@ -0,0 +1,168 @@
+/**
+ * @file FileOperationQueue.h
+ * @brief Background queue of file operations started from the explorer
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+template <typename T> class QPromise;
+
+/**
+ * @class FileOperationQueue
+ * @brief Deletes, copies, moves and renames files and folders on a worker thread
+ *
+ * Operations run one at a time, in the order they were queued, on the
+ * global thread pool, so even deleting a large build folder never blocks
+ * the GUI. Progress is reported while an operation runs: as a fraction of
+ * the bytes for copies, and as a running count for deletions, whose size
+ * is not known in advance.
+ *
+ * On Unix, folders are deleted with unlinkat() relative to an open folder
+ * descriptor, so paths are not resolved again for every entry. Renames
+ * and moves use renameat2() with RENAME_NOREPLACE on Linux, so an existing
+ * target is never overwritten, and moves fall back to copying and
+ * deleting across file systems. File contents are copied with
+ * copy_file_range(), which lets the kernel (or the file system, by
+ * sharing extents) copy without passing the data through user space.
+ * Elsewhere the equivalent Qt functions are used.
+ *
+ * Cancelling stops the running operation between entries (or between
+ * chunks of a large file) and drops the queued ones. What was done so
+ * far is kept, except that a partially copied file is removed.
+ *
+ * The queue does not update any model; views follow the changes through
+ * their file watches (see FileTreeModel).
+ *
+ * @see FileExplorer
+ */
+class FileOperationQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Kind of operation */
+    enum class Type {
+        Delete, ///< Deletes source, recursively for folders
+        Copy,   ///< Copies source to target, recursively for folders
+        Move,   ///< Moves source to target
+        Rename  ///< Renames source to target within its folder
+    };
+
+    /**
+     * @struct Operation
+     * @brief One queued operation
+     */
+    struct Operation
+    {
+        Type type = Type::Delete; ///< Kind of operation
+        QString source;           ///< Path of the file or folder to operate on
+        QString target;           ///< New path for Copy, Move and Rename; never overwritten
+    };
+
+    /**
+     * @brief Constructs an idle queue
+     * @param parent Parent object
+     */
+    explicit FileOperationQueue(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor - cancels the running operation and waits for it
+     */
+    ~FileOperationQueue();
+
+    /**
+     * @brief Queues an operation; it starts at once if the queue is idle
+     * @param operation Operation to run
+     */
+    void enqueue(const Operation &operation);
+
+    /**
+     * @brief Cancels the running operation and drops the queued ones
+     */
+    void cancel();
+
+    /**
+     * @brief Checks whether an operation is running
+     * @return true until the last queued operation has finished
+     */
+    bool isBusy() const;
+
+    /**
+     * @brief Gets the number of operations waiting to run
+     * @return Queued operations, not counting the running one
+     */
+    int pendingCount() const;
+
+    /** @brief Bytes copied per chunk, between cancellation checks */
+    static const int COPY_CHUNK_SIZE = 8 * 1024 * 1024;
+
+    /** @brief Deleted entries between progress reports */
+    static const int DELETE_REPORT_INTERVAL = 256;
+
+    /** @brief Progress maximum for operations of known size */
+    static const int PROGRESS_MAXIMUM = 1000;
+
+signals:
+    /**
+     * @brief Emitted when an operation starts running
+     * @param operation The operation
+     */
+    void started(const FileOperationQueue::Operation &operation);
+
+    /**
+     * @brief Emitted while an operation runs
+     * @param value Progress value
+     * @param maximum Progress maximum, or 0 if the size is unknown
+     * @param text Description of the progress
+     */
+    void progress(int value, int maximum, const QString &text);
+
+    /**
+     * @brief Emitted when an operation has finished
+     * @param operation The operation
+     * @param errors Descriptions of the entries that failed
+     * @param canceled Whether the operation was cancelled
+     */
+    void finished(const FileOperationQueue::Operation &operation, const QStringList &errors, bool canceled);
+
+    /**
+     * @brief Emitted when the last queued operation has finished
+     */
+    void idle();
+
+private slots:
+    /** @brief Reports the finished operation and starts the next one */
+    void onOperationFinished();
+
+private:
+    /** @brief Starts the next queued operation, if any */
+    void startNext();
+
+    /**
+     * @brief Runs an operation on a worker thread
+     * @param promise Polled for cancellation; receives progress
+     * @param operation Operation to run
+     * @return Descriptions of the entries that failed
+     */
+    static QStringList run(QPromise<QStringList> &promise, const Operation &operation);
+
+    /** @brief Operations waiting to run */
+    QVector<Operation> m_pending;
+
+    /** @brief Operation running, valid while m_busy */
+    Operation m_current;
+
+    /** @brief Whether an operation is running */
+    bool m_busy;
+
+    /** @brief Watches the running operation */
+    QFutureWatcher<QStringList> m_watcher;
+};
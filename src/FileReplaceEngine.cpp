@@ -0,0 +1,289 @@
+#include "FileReplaceEngine.h"
+#include "FileSearchEngine.h"
+#include "SearchSession.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QPromise>
+#include <QStringDecoder>
+#include <atomic>
+#include <memory>
+
+FileReplaceEngine::FileReplaceEngine(QObject *parent)
+    : QObject(parent)
+    , m_filesTotal(0)
+    , m_filesDone(0)
+    , m_filesChanged(0)
+    , m_replacements(0)
+{
+    m_threadPool.setMaxThreadCount(MAX_CONCURRENT_FILES);
+
+    connect(&m_watcher, &QFutureWatcher<FileReplaceResult>::resultReadyAt, this, &FileReplaceEngine::onResultReady);
+    connect(&m_watcher, &QFutureWatcher<FileReplaceResult>::finished, this, &FileReplaceEngine::onFinished);
+    connect(&m_previewWatcher, &QFutureWatcher<QString>::finished, this, &FileReplaceEngine::onPreviewFinished);
+}
+
+FileReplaceEngine::~FileReplaceEngine()
+{
+    cancel();
+    if (!m_previewWatcher.isFinished()) {
+        m_previewWatcher.cancel();
+    }
+    m_threadPool.waitForDone();
+}
+
+bool FileReplaceEngine::start(const QStringList &files, const QString &pattern, const SearchOptions &options,
+                              const QString &replacement)
+{
+    cancel();
+
+    if (pattern.isEmpty() || (options.useRegex && !TextSearch::compile(pattern, options).isValid())) {
+        return false;
+    }
+
+    m_filesTotal = int(files.size());
+    m_filesDone = 0;
+    m_filesChanged = 0;
+    m_replacements = 0;
+
+    auto promise = std::make_shared<QPromise<FileReplaceResult>>();
+    m_watcher.setFuture(promise->future());
+    promise->start();
+
+    if (files.isEmpty()) {
+        promise->finish();
+        return true;
+    }
+
+    // The last file to finish completes the replacement
+    auto remaining = std::make_shared<std::atomic<int>>(int(files.size()));
+    for (const QString &filePath : files) {
+        m_threadPool.start([promise, remaining, filePath, pattern, options, replacement]() {
+            if (!promise->isCanceled()) {
+                promise->addResult(replaceInFile(filePath, pattern, options, replacement));
+            }
+            if (--*remaining == 0) {
+                promise->finish();
+            }
+        });
+    }
+    return true;
+}
+
+void FileReplaceEngine::cancel()
+{
+    if (m_watcher.isFinished()) {
+        return;
+    }
+
+    // Files being written finish atomically; queued ones are dropped, and
+    // the promise finishes once the last task holding it is gone
+    m_watcher.cancel();
+    m_threadPool.clear();
+}
+
+bool FileReplaceEngine::isRunning() const
+{
+    return !m_watcher.isFinished();
+}
+
+void FileReplaceEngine::preview(const QString &filePath, const QString &pattern, const SearchOptions &options,
+                                const QString &replacement)
+{
+    startPreview(filePath, [filePath, pattern, options, replacement](QPromise<QString> &promise) {
+        QString text;
+        QString error;
+        if (!readTextFile(filePath, text, error)) {
+            return error;
+        }
+        return buildDiff(promise, text, pattern, options, replacement);
+    });
+}
+
+void FileReplaceEngine::previewText(const QString &filePath, const QString &text, const QString &pattern,
+                                    const SearchOptions &options, const QString &replacement)
+{
+    startPreview(filePath, [text, pattern, options, replacement](QPromise<QString> &promise) {
+        return buildDiff(promise, text, pattern, options, replacement);
+    });
+}
+
+void FileReplaceEngine::startPreview(const QString &filePath, std::function<QString(QPromise<QString> &)> task)
+{
+    if (!m_previewWatcher.isFinished()) {
+        m_previewWatcher.cancel();
+    }
+
+    auto promise = std::make_shared<QPromise<QString>>();
+    m_previewPath = filePath;
+    m_previewWatcher.setFuture(promise->future());
+    promise->start();
+
+    QThreadPool::globalInstance()->start([promise, task]() {
+        if (!promise->isCanceled()) {
+            QString diff = task(*promise);
+            if (!promise->isCanceled()) {
+                promise->addResult(std::move(diff));
+            }
+        }
+        promise->finish();
+    });
+}
+
+bool FileReplaceEngine::readTextFile(const QString &filePath, QString &text, QString &error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+
+    if (file.size() > FileSearchEngine::MAX_FILE_SIZE) {
+        error = tr("File is too large");
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    if (FileSearchEngine::isBinaryData(data.constData(), data.size())) {
+        error = tr("Binary file");
+        return false;
+    }
+
+    // Writing back text that did not decode cleanly would corrupt the file
+    QStringDecoder decoder(QStringDecoder::Utf8,
+                           QStringDecoder::Flag::Stateless | QStringDecoder::Flag::ConvertInitialBom);
+    text = decoder(data);
+    if (decoder.hasError()) {
+        error = tr("File is not valid UTF-8");
+        return false;
+    }
+    return true;
+}
+
+void FileReplaceEngine::onResultReady(int index)
+{
+    const FileReplaceResult result = m_watcher.resultAt(index);
+
+    ++m_filesDone;
+    if (!result.error.isEmpty()) {
+        emit fileFailed(result.filePath, result.error);
+    } else if (result.replacements > 0) {
+        ++m_filesChanged;
+        m_replacements += result.replacements;
+    }
+    emit progress(m_filesDone, m_filesTotal);
+}
+
+void FileReplaceEngine::onFinished()
+{
+    if (!m_watcher.future().isCanceled()) {
+        emit finished(m_filesChanged, m_replacements);
+    }
+}
+
+void FileReplaceEngine::onPreviewFinished()
+{
+    if (!m_previewWatcher.future().isCanceled() && m_previewWatcher.future().resultCount() > 0) {
+        emit previewReady(m_previewPath, m_previewWatcher.result());
+    }
+}
+
+FileReplaceResult FileReplaceEngine::replaceInFile(const QString &filePath, const QString &pattern,
+                                                   const SearchOptions &options, const QString &replacement)
+{
+    FileReplaceResult result;
+    result.filePath = filePath;
+
+    QString text;
+    if (!readTextFile(filePath, text, result.error)) {
+        return result;
+    }
+
+    SearchSession session;
+    session.setPattern(pattern, options);
+    session.setText(text);
+    const QVector<SearchSession::Match> &matches = session.allMatches();
+    if (matches.isEmpty()) {
+        return result;
+    }
+
+    const qsizetype rangeStart = matches.constFirst().start;
+    const qsizetype rangeEnd = matches.constLast().start + matches.constLast().length;
+    QString replaced;
+    replaced.reserve(text.size());
+    replaced.append(QStringView(text).left(rangeStart));
+    replaced.append(SearchSession::replaceMatches(text, matches, replacement));
+    replaced.append(QStringView(text).mid(rangeEnd));
+
+    // The new content goes to a temporary file that atomically replaces
+    // the original on commit, keeping its permissions
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(replaced.toUtf8()) < 0 || !file.commit()) {
+        result.error = file.errorString();
+        return result;
+    }
+
+    result.replacements = int(matches.size());
+    return result;
+}
+
+QString FileReplaceEngine::buildDiff(QPromise<QString> &promise, const QString &text, const QString &pattern,
+                                     const SearchOptions &options, const QString &replacement)
+{
+    SearchSession session;
+    session.setPattern(pattern, options);
+    session.setText(text);
+    const QVector<SearchSession::Match> &matches = session.allMatches();
+
+    QString diff;
+    int hunks = 0;
+    int line = 1;
+    qsizetype scanned = 0;
+
+    for (qsizetype first = 0; first < matches.size() && !promise.isCanceled();) {
+        if (hunks == MAX_PREVIEW_HUNKS) {
+            diff += tr("... more changes not shown\n");
+            break;
+        }
+
+        // Group the matches that share lines into one hunk
+        const qsizetype matchStart = matches.at(first).start;
+        const qsizetype lineStart = matchStart > 0 ? text.lastIndexOf(QLatin1Char('\n'), matchStart - 1) + 1 : 0;
+        qsizetype last = first;
+        qsizetype lineEnd = -1;
+        do {
+            const SearchSession::Match &match = matches.at(last++);
+            lineEnd = text.indexOf(QLatin1Char('\n'), match.start + match.length);
+            if (lineEnd < 0) {
+                lineEnd = text.size();
+            }
+        } while (last < matches.size() && matches.at(last).start < lineEnd);
+
+        for (; scanned < lineStart; ++scanned) {
+            if (text.at(scanned) == QLatin1Char('\n')) {
+                ++line;
+            }
+        }
+
+        const QVector<SearchSession::Match> hunkMatches = matches.mid(first, last - first);
+        const qsizetype rangeStart = hunkMatches.constFirst().start;
+        const qsizetype rangeEnd = hunkMatches.constLast().start + hunkMatches.constLast().length;
+        const QString before = text.mid(lineStart, lineEnd - lineStart);
+        QString after = text.mid(lineStart, rangeStart - lineStart);
+        after.append(SearchSession::replaceMatches(text, hunkMatches, replacement));
+        after.append(QStringView(text).mid(rangeEnd, lineEnd - rangeEnd));
+
+        diff += QString("@@ %1 @@\n").arg(tr("line %1").arg(line));
+        for (const QString &oldLine : before.split(QLatin1Char('\n'))) {
+            diff += QLatin1Char('-') + oldLine + QLatin1Char('\n');
+        }
+        for (const QString &newLine : after.split(QLatin1Char('\n'))) {
+            diff += QLatin1Char('+') + newLine + QLatin1Char('\n');
+        }
+
+        ++hunks;
+        first = last;
+    }
+
+    return diff;
+}
@@ -0,0 +1,222 @@
+/**
+ * @file FileReplaceEngine.h
+ * @brief Parallel replacement across files on disk with atomic writes
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <functional>
+
+#include "TextSearch.h"
+
+template <typename T> class QPromise;
+
+/**
+ * @struct FileReplaceResult
+ * @brief Outcome of the replacement in one file
+ */
+struct FileReplaceResult
+{
+    QString filePath;     ///< File that was processed
+    int replacements = 0; ///< Number of matches replaced
+    QString error;        ///< Why the file was left unchanged, or empty
+};
+
+/**
+ * @class FileReplaceEngine
+ * @brief Replaces every match of a pattern in a list of files
+ *
+ * Files are processed on a dedicated thread pool that runs only a few
+ * files at a time, so a replacement across thousands of files neither
+ * floods the disk nor holds many large files in memory. Each changed file
+ * is written to a temporary file that then atomically replaces the
+ * original, so a failure or a cancellation never leaves a file half
+ * written. Binary files and files that are not valid UTF-8 are left alone.
+ *
+ * Files open in an editor should be replaced in memory instead (see
+ * TextEditor::replaceMatches()), and are not passed to the engine.
+ *
+ * A dry run is available per file through preview(), which describes the
+ * changed lines as a diff.
+ *
+ * @see FindInFilesPanel, SearchSession
+ */
+class FileReplaceEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle engine
+     * @param parent Parent object
+     */
+    explicit FileReplaceEngine(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor - cancels the replacement and waits for files being written
+     */
+    ~FileReplaceEngine();
+
+    /**
+     * @brief Starts replacing, cancelling any replacement in progress
+     * @param files Files to process
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param replacement Text inserted for every match
+     * @return false if the pattern is empty or an invalid regular expression
+     */
+    bool start(const QStringList &files, const QString &pattern, const SearchOptions &options,
+               const QString &replacement);
+
+    /**
+     * @brief Cancels the replacement in progress
+     *
+     * Files already written stay changed; no file is left half written.
+     */
+    void cancel();
+
+    /**
+     * @brief Checks whether a replacement is in progress
+     * @return true until finished() has been emitted or the replacement was cancelled
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Starts computing the diff of one file, cancelling an earlier preview
+     * @param filePath File to preview; its content is read from disk
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param replacement Text inserted for every match
+     */
+    void preview(const QString &filePath, const QString &pattern, const SearchOptions &options,
+                 const QString &replacement);
+
+    /**
+     * @brief Starts computing the diff of an open document, cancelling an earlier preview
+     * @param filePath File shown by the document
+     * @param text Document snapshot (see TextEditor::plainTextSnapshot())
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param replacement Text inserted for every match
+     */
+    void previewText(const QString &filePath, const QString &text, const QString &pattern,
+                     const SearchOptions &options, const QString &replacement);
+
+    /**
+     * @brief Reads a text file for replacement
+     * @param filePath File to read
+     * @param text Receives the decoded content
+     * @param error Receives the reason when the file cannot be used
+     * @return false for unreadable, oversized, binary and non-UTF-8 files
+     *
+     * A byte order mark is kept in the text, so writing it back preserves it.
+     */
+    static bool readTextFile(const QString &filePath, QString &text, QString &error);
+
+    /** @brief Files processed at the same time */
+    static const int MAX_CONCURRENT_FILES = 4;
+
+signals:
+    /**
+     * @brief Emitted after each file
+     * @param filesDone Files processed so far
+     * @param filesTotal Files to process
+     */
+    void progress(int filesDone, int filesTotal);
+
+    /**
+     * @brief Emitted when a file could not be changed
+     * @param filePath File that was left unchanged
+     * @param error Reason
+     */
+    void fileFailed(const QString &filePath, const QString &error);
+
+    /**
+     * @brief Emitted when every file has been processed
+     * @param filesChanged Number of files written
+     * @param replacements Number of matches replaced
+     */
+    void finished(int filesChanged, int replacements);
+
+    /**
+     * @brief Emitted when a preview is ready
+     * @param filePath File that was previewed
+     * @param diff Changed lines, each old line prefixed by '-' and each new one by '+'
+     */
+    void previewReady(const QString &filePath, const QString &diff);
+
+private slots:
+    /** @brief Accounts for one processed file */
+    void onResultReady(int index);
+
+    /** @brief Reports completion of the replacement */
+    void onFinished();
+
+    /** @brief Forwards a finished preview */
+    void onPreviewFinished();
+
+private:
+    /**
+     * @brief Replaces the matches in one file; runs on a worker thread
+     * @param filePath File to process
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param replacement Text inserted for every match
+     * @return Outcome for the file
+     */
+    static FileReplaceResult replaceInFile(const QString &filePath, const QString &pattern,
+                                           const SearchOptions &options, const QString &replacement);
+
+    /**
+     * @brief Describes the lines a replacement changes; runs on a worker thread
+     * @param promise Polled for cancellation
+     * @param text Text to replace in
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param replacement Text inserted for every match
+     * @return Diff of the changed lines
+     */
+    static QString buildDiff(QPromise<QString> &promise, const QString &text, const QString &pattern,
+                             const SearchOptions &options, const QString &replacement);
+
+    /**
+     * @brief Runs a preview on the global thread pool
+     * @param filePath File being previewed
+     * @param task Produces the diff
+     */
+    void startPreview(const QString &filePath, std::function<QString(QPromise<QString> &)> task);
+
+    /** @brief Pool bounding the number of files processed at once */
+    QThreadPool m_threadPool;
+
+    /** @brief Watches the replacement in progress */
+    QFutureWatcher<FileReplaceResult> m_watcher;
+
+    /** @brief Watches the preview in progress */
+    QFutureWatcher<QString> m_previewWatcher;
+
+    /** @brief File of the preview in progress */
+    QString m_previewPath;
+
+    /** @brief Number of files of the replacement */
+    int m_filesTotal;
+
+    /** @brief Files processed so far */
+    int m_filesDone;
+
+    /** @brief Files written so far */
+    int m_filesChanged;
+
+    /** @brief Matches replaced so far */
+    int m_replacements;
+
+    /** @brief Changed lines shown in a preview at most */
+    static const int MAX_PREVIEW_HUNKS = 1000;
+};
@@ -0,0 +1,450 @@
+#include "FileSearchEngine.h"
+#include "FileClassifier.h"
+#include "WorkspaceWalker.h"
+
+#include <QFileInfo>
+#include <QFile>
+#include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+#include <QRegularExpression>
+#include <atomic>
+
+/**
+ * @brief State shared between the engine and the worker tasks of one search
+ */
+struct FileSearchEngine::SearchState
+{
+    QThreadPool *threadPool = nullptr;
+    QString pattern;
+    SearchOptions options;
+    QVector<QRegularExpression> nameFilters;
+    std::unique_ptr<const LiteralSearcher> literal;
+    QByteArray utf8Needle;
+    quint64 searchId = 0;
+
+    std::atomic<bool> canceled { false };
+    std::atomic<bool> limitReached { false };
+    std::atomic<int> pendingTasks { 0 };
+    std::atomic<int> filesSearched { 0 };
+    std::atomic<int> resultCount { 0 };
+
+    QMutex mutex;
+    QVector<FileSearchResult> results;
+    QStringList changedFiles;
+};
+
+namespace
+{
+
+std::atomic<quint64> nextSearchId { 1 };
+
+} // namespace
+
+FileSearchEngine::FileSearchEngine(QObject *parent)
+    : QObject(parent)
+    , m_deliveryTimer(nullptr)
+{
+    m_threadPool.setMaxThreadCount(QThread::idealThreadCount());
+
+    m_deliveryTimer = new QTimer(this);
+    m_deliveryTimer->setInterval(DELIVERY_INTERVAL);
+    connect(m_deliveryTimer, &QTimer::timeout, this, &FileSearchEngine::deliverResults);
+}
+
+FileSearchEngine::~FileSearchEngine()
+{
+    cancel();
+    m_threadPool.waitForDone();
+}
+
+bool FileSearchEngine::start(const QString &rootPath, const QString &pattern, const SearchOptions &options,
+                             const QStringList &nameFilters)
+{
+    const std::shared_ptr<SearchState> state = createState(pattern, options, nameFilters);
+    if (!state) {
+        return false;
+    }
+
+    queueDirectory(state, WorkspaceWalker::root(rootPath));
+    m_deliveryTimer->start();
+    return true;
+}
+
+bool FileSearchEngine::startInScope(const FileSearchScope &scope, const QString &pattern, const SearchOptions &options,
+                                    const QStringList &nameFilters)
+{
+    const std::shared_ptr<SearchState> state = createState(pattern, options, nameFilters);
+    if (!state) {
+        return false;
+    }
+
+    // Count every batch up front so the search cannot look finished early
+    const QStringList &files = scope.files;
+    const QVector<IndexedFile> &indexedFiles = scope.indexedFiles;
+    state->pendingTasks += int((files.size() + FILE_BATCH_SIZE - 1) / FILE_BATCH_SIZE);
+    state->pendingTasks += int((indexedFiles.size() + CHECK_BATCH_SIZE - 1) / CHECK_BATCH_SIZE);
+    state->pendingTasks += int(scope.directories.size());
+    for (qsizetype start = 0; start < files.size(); start += FILE_BATCH_SIZE) {
+        const QStringList batch = files.mid(start, FILE_BATCH_SIZE);
+        m_threadPool.start([state, batch]() {
+            searchFiles(state, batch);
+            --state->pendingTasks;
+        });
+    }
+    for (qsizetype start = 0; start < indexedFiles.size(); start += CHECK_BATCH_SIZE) {
+        const QVector<IndexedFile> batch = indexedFiles.mid(start, CHECK_BATCH_SIZE);
+        m_threadPool.start([state, batch]() {
+            searchChangedFiles(state, batch);
+            --state->pendingTasks;
+        });
+    }
+    for (const QString &directory : scope.directories) {
+        const QString rootPath = scope.rootPath;
+        m_threadPool.start([state, rootPath, directory]() {
+            searchDirectory(state, WorkspaceWalker::directory(rootPath, directory));
+            --state->pendingTasks;
+        });
+    }
+    m_deliveryTimer->start();
+    return true;
+}
+
+std::shared_ptr<FileSearchEngine::SearchState> FileSearchEngine::createState(const QString &pattern,
+                                                                             const SearchOptions &options,
+                                                                             const QStringList &nameFilters)
+{
+    cancel();
+
+    if (pattern.isEmpty() || (options.useRegex && !TextSearch::compile(pattern, options).isValid())) {
+        return nullptr;
+    }
+
+    auto state = std::make_shared<SearchState>();
+    state->threadPool = &m_threadPool;
+    state->pattern = pattern;
+    state->options = options;
+    state->searchId = nextSearchId++;
+
+    for (const QString &filter : nameFilters) {
+        const QString trimmed = filter.trimmed();
+        if (!trimmed.isEmpty()) {
+            state->nameFilters.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(trimmed),
+                                                         QRegularExpression::CaseInsensitiveOption));
+        }
+    }
+
+    if (!options.useRegex) {
+        state->literal.reset(new LiteralSearcher(pattern, options));
+        if (options.caseSensitive) {
+            state->utf8Needle = pattern.toUtf8();
+        }
+    }
+
+    m_state = state;
+    return state;
+}
+
+void FileSearchEngine::cancel()
+{
+    if (!m_state) {
+        return;
+    }
+
+    // Running tasks notice the flag and stop; queued ones are dropped
+    m_state->canceled = true;
+    m_threadPool.clear();
+    m_state.reset();
+    m_deliveryTimer->stop();
+}
+
+bool FileSearchEngine::isRunning() const
+{
+    return m_state != nullptr;
+}
+
+bool FileSearchEngine::isBinaryData(const char *data, qint64 size)
+{
+    // Wide text would have to be decoded differently, so it is skipped too
+    const qsizetype head = qsizetype(qMin<qint64>(size, FileClassifier::SNIFF_SIZE));
+    return FileClassifier::classifyData(QByteArrayView(data, head), head == size) != FileClassifier::Kind::Text;
+}
+
+bool FileSearchEngine::acceptsFileName(const SearchState &state, const QString &fileName)
+{
+    if (state.nameFilters.isEmpty()) {
+        return true;
+    }
+
+    for (const QRegularExpression &filter : state.nameFilters) {
+        if (filter.match(fileName).hasMatch()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FileSearchEngine::deliverResults()
+{
+    // Receivers may cancel or restart the search while handling the signals
+    const std::shared_ptr<SearchState> state = m_state;
+    if (!state) {
+        return;
+    }
+
+    // Workers hand over their results before they finish, so once every
+    // task is done the final batch is already waiting
+    const bool done = state->pendingTasks.load() == 0;
+
+    QVector<FileSearchResult> results;
+    QStringList changedFiles;
+    {
+        QMutexLocker locker(&state->mutex);
+        results.swap(state->results);
+        changedFiles.swap(state->changedFiles);
+    }
+
+    if (!changedFiles.isEmpty()) {
+        emit indexedFilesChanged(changedFiles);
+        if (m_state != state) {
+            return;
+        }
+    }
+
+    if (!results.isEmpty()) {
+        emit resultsReady(results);
+        if (m_state != state) {
+            return;
+        }
+    }
+
+    const int filesSearched = state->filesSearched.load();
+    if (done) {
+        m_state.reset();
+        m_deliveryTimer->stop();
+        emit finished(filesSearched, state->limitReached.load());
+    } else {
+        emit progress(filesSearched);
+    }
+}
+
+void FileSearchEngine::queueDirectory(const std::shared_ptr<SearchState> &state,
+                                      const WorkspaceWalker::Directory &directory)
+{
+    ++state->pendingTasks;
+    state->threadPool->start([state, directory]() {
+        searchDirectory(state, directory);
+        --state->pendingTasks;
+    });
+}
+
+void FileSearchEngine::searchDirectory(const std::shared_ptr<SearchState> &state,
+                                       const WorkspaceWalker::Directory &directory)
+{
+    if (state->canceled) {
+        return;
+    }
+
+    QVector<QFileInfo> files;
+    QVector<WorkspaceWalker::Directory> subdirectories;
+    WorkspaceWalker::list(directory, files, subdirectories);
+    for (const WorkspaceWalker::Directory &subdirectory : std::as_const(subdirectories)) {
+        queueDirectory(state, subdirectory);
+    }
+
+    QVector<FileSearchResult> results;
+    auto handOver = [&state, &results]() {
+        if (results.isEmpty()) {
+            return;
+        }
+        QMutexLocker locker(&state->mutex);
+        state->results.append(results);
+        results.clear();
+    };
+
+    for (const QFileInfo &fileInfo : std::as_const(files)) {
+        if (state->canceled) {
+            break;
+        }
+        if (!acceptsFileName(*state, fileInfo.fileName())) {
+            continue;
+        }
+
+        searchFile(*state, fileInfo.filePath(), results);
+        ++state->filesSearched;
+
+        if (results.size() >= RESULT_BATCH_SIZE) {
+            handOver();
+        }
+    }
+
+    handOver();
+}
+
+void FileSearchEngine::searchFiles(const std::shared_ptr<SearchState> &state, const QStringList &files)
+{
+    QVector<FileSearchResult> results;
+    for (const QString &filePath : files) {
+        if (state->canceled) {
+            break;
+        }
+
+        const qsizetype slash = filePath.lastIndexOf(QLatin1Char('/'));
+        if (!acceptsFileName(*state, filePath.mid(slash + 1))) {
+            continue;
+        }
+
+        searchFile(*state, filePath, results);
+        ++state->filesSearched;
+    }
+
+    if (!results.isEmpty()) {
+        QMutexLocker locker(&state->mutex);
+        state->results.append(results);
+    }
+}
+
+void FileSearchEngine::searchChangedFiles(const std::shared_ptr<SearchState> &state,
+                                         const QVector<IndexedFile> &files)
+{
+    QVector<FileSearchResult> results;
+    QStringList changedFiles;
+    for (const IndexedFile &file : files) {
+        if (state->canceled) {
+            break;
+        }
+
+        const qsizetype slash = file.filePath.lastIndexOf(QLatin1Char('/'));
+        if (!acceptsFileName(*state, file.filePath.mid(slash + 1))) {
+            continue;
+        }
+
+        // Deleted files are left to the index to notice
+        const QFileInfo fileInfo(file.filePath);
+        if (!fileInfo.isFile()
+            || (fileInfo.size() == file.size && fileInfo.lastModified().toMSecsSinceEpoch() == file.modified)) {
+            continue;
+        }
+
+        changedFiles.append(file.filePath);
+        searchFile(*state, file.filePath, results);
+        ++state->filesSearched;
+    }
+
+    if (!results.isEmpty() || !changedFiles.isEmpty()) {
+        QMutexLocker locker(&state->mutex);
+        state->results.append(results);
+        state->changedFiles.append(changedFiles);
+    }
+}
+
+void FileSearchEngine::searchFile(SearchState &state, const QString &filePath, QVector<FileSearchResult> &results)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const qint64 size = file.size();
+    if (size <= 0 || size > MAX_FILE_SIZE) {
+        return;
+    }
+
+    QByteArray buffer;
+    const char *data = reinterpret_cast<const char *>(file.map(0, size));
+    if (!data) {
+        // Some file systems cannot be mapped
+        buffer = file.readAll();
+        data = buffer.constData();
+    }
+
+    if (isBinaryData(data, size)) {
+        return;
+    }
+
+    // Reject files without the needle before paying for UTF-8 decoding
+    if (!state.utf8Needle.isEmpty()
+        && QByteArray::fromRawData(data, qsizetype(size)).indexOf(state.utf8Needle) < 0) {
+        return;
+    }
+
+    const QString text = QString::fromUtf8(data, qsizetype(size));
+
+    // Each worker thread compiles its own copy of the expression once per search
+    thread_local quint64 expressionSearchId = 0;
+    thread_local QRegularExpression expression;
+    if (state.options.useRegex && expressionSearchId != state.searchId) {
+        expression = TextSearch::compile(state.pattern, state.options);
+        expressionSearchId = state.searchId;
+    }
+
+    QRegularExpressionMatchIterator matchIterator;
+    if (state.options.useRegex) {
+        matchIterator = expression.globalMatch(text);
+    }
+
+    int line = 1;
+    qsizetype lineStart = 0;
+    qsizetype scanned = 0;
+    int lastReportedLine = 0;
+    qsizetype position = 0;
+
+    while (!state.canceled) {
+        qsizetype matchStart = -1;
+        qsizetype matchLength = 0;
+
+        if (state.options.useRegex) {
+            while (matchIterator.hasNext()) {
+                const QRegularExpressionMatch match = matchIterator.next();
+                if (match.capturedLength() > 0) {
+                    matchStart = match.capturedStart();
+                    matchLength = match.capturedLength();
+                    break;
+                }
+            }
+        } else {
+            matchStart = state.literal->find(text, position, text.size());
+            matchLength = state.literal->length();
+        }
+
+        if (matchStart < 0) {
+            break;
+        }
+        position = matchStart + matchLength;
+
+        // Advance the line counter up to the match
+        for (; scanned < matchStart; ++scanned) {
+            if (text.at(scanned) == QLatin1Char('\n')) {
+                ++line;
+                lineStart = scanned + 1;
+            }
+        }
+
+        // One result per line, pointing at its first match
+        if (line == lastReportedLine) {
+            continue;
+        }
+        lastReportedLine = line;
+
+        if (state.resultCount.fetch_add(1) >= MAX_RESULTS) {
+            state.limitReached = true;
+            state.canceled = true;
+            break;
+        }
+
+        qsizetype lineEnd = text.indexOf(QLatin1Char('\n'), lineStart);
+        if (lineEnd < 0) {
+            lineEnd = text.size();
+        }
+
+        FileSearchResult result;
+        result.filePath = filePath;
+        result.line = line;
+        result.column = int(matchStart - lineStart) + 1;
+        result.length = int(qMin(matchLength, lineEnd - matchStart));
+        result.lineText = text.mid(lineStart, qMin<qsizetype>(lineEnd - lineStart, MAX_LINE_TEXT));
+        results.append(result);
+    }
+}
@@ -0,0 +1,251 @@
+/**
+ * @file FileSearchEngine.h
+ * @brief Parallel search of the files below a directory
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QThreadPool>
+#include <memory>
+
+#include "TextSearch.h"
+#include "WorkspaceWalker.h"
+
+class QTimer;
+
+/**
+ * @struct FileSearchResult
+ * @brief A line of a file containing at least one match
+ */
+struct FileSearchResult
+{
+    QString filePath; ///< Absolute path of the file
+    int line;         ///< Line number (1-based)
+    int column;       ///< Column of the first match on the line (1-based)
+    int length;       ///< Length of the first match on the line
+    QString lineText; ///< Text of the line, shortened if very long
+};
+
+/**
+ * @struct IndexedFile
+ * @brief A file together with the size and modification time it was indexed at
+ */
+struct IndexedFile
+{
+    QString filePath; ///< Absolute path of the file
+    qint64 size;      ///< Size when indexed
+    qint64 modified;  ///< Modification time when indexed, in milliseconds since the epoch
+};
+
+/**
+ * @struct FileSearchScope
+ * @brief Files to search instead of a whole directory tree, e.g. from TrigramIndex
+ */
+struct FileSearchScope
+{
+    QString rootPath;                   ///< Workspace root whose ignore files apply
+    QStringList files;                  ///< Absolute paths of files that are always searched
+    QVector<IndexedFile> indexedFiles;  ///< Files searched only if they changed since being indexed
+    QStringList directories;            ///< Folders searched with everything below them
+};
+
+/**
+ * @class FileSearchEngine
+ * @brief Searches a directory tree on a pool of worker threads
+ *
+ * The tree is walked in parallel: every directory is a separate task on a
+ * dedicated thread pool, and each task queues its subdirectories as new
+ * tasks before searching its own files. Idle workers therefore always
+ * pick up pending directories, which keeps all cores busy on deep as well
+ * as wide trees. Folders are listed through WorkspaceWalker, so ignored
+ * files are never searched and ignored folders never entered.
+ *
+ * Files are memory-mapped. Files whose first block FileClassifier does not
+ * classify as UTF-8 text are skipped. For case-sensitive literal searches the raw
+ * bytes are checked for the UTF-8 needle first, so files without a match
+ * are never decoded. Matching files are decoded and run through the same
+ * LiteralSearcher or regular expression used for in-editor search.
+ *
+ * When a search is narrowed to a FileSearchScope, the workers also compare
+ * the size and modification time of the other indexed files with the
+ * disk, so files changed since they were indexed are searched as well.
+ *
+ * Results are collected by the workers and handed to the GUI thread in
+ * batches. A search can be cancelled at any time; results of a cancelled
+ * search are never reported.
+ *
+ * @see FindInFilesPanel, LiteralSearcher
+ */
+class FileSearchEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle search engine
+     * @param parent Parent object
+     */
+    explicit FileSearchEngine(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor - cancels the search and waits for the workers
+     */
+    ~FileSearchEngine();
+
+    /**
+     * @brief Starts a search, cancelling any search in progress
+     * @param rootPath Directory to search below
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param nameFilters Wildcard patterns file names must match (empty for all files)
+     * @return false if the pattern is empty or an invalid regular expression
+     */
+    bool start(const QString &rootPath, const QString &pattern, const SearchOptions &options,
+               const QStringList &nameFilters = QStringList());
+
+    /**
+     * @brief Starts a search of given files, cancelling any search in progress
+     * @param scope Files to search
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param nameFilters Wildcard patterns file names must match (empty for all files)
+     * @return false if the pattern is empty or an invalid regular expression
+     */
+    bool startInScope(const FileSearchScope &scope, const QString &pattern, const SearchOptions &options,
+                      const QStringList &nameFilters = QStringList());
+
+    /**
+     * @brief Cancels the search in progress, if any
+     */
+    void cancel();
+
+    /**
+     * @brief Checks whether a search is in progress
+     * @return true until finished() has been emitted or the search was cancelled
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Checks whether file contents are not searchable UTF-8 text
+     * @param data File contents
+     * @param size Size of the contents
+     * @return true if FileClassifier does not classify the first block as text
+     */
+    static bool isBinaryData(const char *data, qint64 size);
+
+    /** @brief Larger files are not searched */
+    static const qint64 MAX_FILE_SIZE = 64 * 1024 * 1024;
+
+signals:
+    /**
+     * @brief Emitted with each batch of new results
+     * @param results Matching lines found since the previous batch
+     */
+    void resultsReady(const QVector<FileSearchResult> &results);
+
+    /**
+     * @brief Emitted periodically while searching
+     * @param filesSearched Number of files examined so far
+     */
+    void progress(int filesSearched);
+
+    /**
+     * @brief Emitted when a search completes
+     * @param filesSearched Number of files examined
+     * @param limitReached Whether the search stopped at MAX_RESULTS results
+     */
+    void finished(int filesSearched, bool limitReached);
+
+    /**
+     * @brief Emitted with indexed files that differ from their indexed state
+     * @param filePaths Absolute paths of the changed files
+     */
+    void indexedFilesChanged(const QStringList &filePaths);
+
+private slots:
+    /** @brief Hands collected results to the GUI and detects completion */
+    void deliverResults();
+
+private:
+    struct SearchState;
+
+    /**
+     * @brief Searches the files of one directory and queues its subdirectories
+     * @param state Shared state of the search
+     * @param directory Directory to process
+     */
+    static void searchDirectory(const std::shared_ptr<SearchState> &state,
+                                const WorkspaceWalker::Directory &directory);
+
+    /**
+     * @brief Searches a batch of listed files
+     * @param state Shared state of the search
+     * @param files Files to search
+     */
+    static void searchFiles(const std::shared_ptr<SearchState> &state, const QStringList &files);
+
+    /**
+     * @brief Searches the files of a batch that changed since they were indexed
+     * @param state Shared state of the search
+     * @param files Indexed files to check
+     */
+    static void searchChangedFiles(const std::shared_ptr<SearchState> &state, const QVector<IndexedFile> &files);
+
+    /**
+     * @brief Searches one file
+     * @param state Shared state of the search
+     * @param filePath File to search
+     * @param results Receives the matching lines
+     */
+    static void searchFile(SearchState &state, const QString &filePath, QVector<FileSearchResult> &results);
+
+    /**
+     * @brief Queues a directory task
+     * @param state Shared state of the search
+     * @param directory Directory to process
+     */
+    static void queueDirectory(const std::shared_ptr<SearchState> &state, const WorkspaceWalker::Directory &directory);
+
+    /**
+     * @brief Prepares the shared state of a new search
+     * @return nullptr if the pattern is empty or invalid
+     */
+    std::shared_ptr<SearchState> createState(const QString &pattern, const SearchOptions &options,
+                                             const QStringList &nameFilters);
+
+    /** @brief Checks a file name against the name filters of a search */
+    static bool acceptsFileName(const SearchState &state, const QString &fileName);
+
+    /** @brief Pool running the directory tasks */
+    QThreadPool m_threadPool;
+
+    /** @brief State of the current search, or nullptr when idle */
+    std::shared_ptr<SearchState> m_state;
+
+    /** @brief Timer delivering results to the GUI thread */
+    QTimer *m_deliveryTimer;
+
+    /** @brief Interval between result deliveries in milliseconds */
+    static const int DELIVERY_INTERVAL = 100;
+
+    /** @brief Results collected by a worker before it hands them over */
+    static const int RESULT_BATCH_SIZE = 64;
+
+    /** @brief Listed files searched by one task */
+    static const int FILE_BATCH_SIZE = 64;
+
+    /** @brief Indexed files checked for changes by one task */
+    static const int CHECK_BATCH_SIZE = 1024;
+
+    /** @brief The search stops after this many matching lines */
+    static const int MAX_RESULTS = 100000;
+
+    /** @brief Longest line text kept in a result */
+    static const int MAX_LINE_TEXT = 300;
+};
@@ -0,0 +1,565 @@
+#include "FileTreeModel.h"
+#include "FileWatchService.h"
+#include "WorkspaceWalker.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPalette>
+#include <QPersistentModelIndex>
+#include <QThreadPool>
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Folder or file known to the model
+ */
+struct FileTreeModel::Node
+{
+    QString name;             ///< File name; the absolute path for the root
+    Node *parent = nullptr;   ///< Containing folder, nullptr for the root
+    int row = 0;              ///< Position within the parent's children
+    bool isDirectory = false; ///< Whether the node is a folder
+    bool ignored = false;     ///< Whether an ignore file matches the entry
+    bool fetched = false;     ///< Whether the folder has been listed completely
+    bool watched = false;     ///< Whether the folder is watched for changes
+    bool stale = false;       ///< Whether the folder may have changed since it was listed
+    quint64 listingId = 0;    ///< Listing in progress, or 0
+    std::vector<std::unique_ptr<Node>> children; ///< Entries of a folder
+};
+
+/**
+ * @brief Model reachable from listing tasks until it is destroyed
+ */
+struct FileTreeModel::ListingTarget
+{
+    QMutex mutex;                  ///< Guards model
+    FileTreeModel *model = nullptr; ///< Model to deliver to, nullptr once destroyed
+};
+
+FileTreeModel::FileTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_listingTarget(std::make_shared<ListingTarget>())
+    , m_nextListingId(1)
+{
+    m_listingTarget->model = this;
+}
+
+FileTreeModel::~FileTreeModel()
+{
+    // Listings still running drop their results from now on
+    QMutexLocker locker(&m_listingTarget->mutex);
+    m_listingTarget->model = nullptr;
+}
+
+void FileTreeModel::setRootPath(const QString &path)
+{
+    const QString rootPath = QDir(path).absolutePath();
+    if (m_root && m_root->name == rootPath) {
+        return;
+    }
+
+    beginResetModel();
+    FileWatchService::instance().unwatchAll(this);
+    m_root = std::make_unique<Node>();
+    m_root->name = rootPath;
+    m_root->isDirectory = true;
+    endResetModel();
+
+    m_root->watched = true;
+    watchDirectory(rootPath);
+    startListing(m_root.get(), true);
+}
+
+QString FileTreeModel::rootPath() const
+{
+    return m_root ? m_root->name : QString();
+}
+
+QString FileTreeModel::filePath(const QModelIndex &index) const
+{
+    const Node *node = nodeFromIndex(index);
+    return node ? nodePath(node) : QString();
+}
+
+QModelIndex FileTreeModel::indexForPath(const QString &path) const
+{
+    const Node *node = findNode(path);
+    return node ? indexFromNode(node) : QModelIndex();
+}
+
+bool FileTreeModel::isDirectory(const QModelIndex &index) const
+{
+    const Node *node = nodeFromIndex(index);
+    return node && node->isDirectory;
+}
+
+void FileTreeModel::setWatched(const QModelIndex &index, bool watched)
+{
+    Node *node = nodeFromIndex(index);
+    if (!node || !node->isDirectory || node == m_root.get() || node->watched == watched) {
+        return;
+    }
+
+    node->watched = watched;
+    const QString path = nodePath(node);
+    if (!watched) {
+        FileWatchService::instance().unwatch(path, this);
+        node->stale = true;
+        return;
+    }
+
+    watchDirectory(path);
+    if (node->stale && node->fetched && node->listingId == 0) {
+        node->stale = false;
+        startListing(node, false);
+    }
+}
+
+void FileTreeModel::refresh()
+{
+    if (!m_root) {
+        return;
+    }
+
+    QVector<Node *> pending { m_root.get() };
+    while (!pending.isEmpty()) {
+        Node *node = pending.takeLast();
+        if (!node->fetched) {
+            continue;
+        }
+        if (node->listingId == 0) {
+            startListing(node, false);
+        } else {
+            node->stale = true;
+        }
+        for (const std::unique_ptr<Node> &child : node->children) {
+            if (child->isDirectory) {
+                pending.append(child.get());
+            }
+        }
+    }
+}
+
+// QAbstractItemModel interface
+
+QModelIndex FileTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    const Node *parentNode = nodeFromIndex(parent);
+    if (!parentNode || column != 0 || row < 0 || row >= int(parentNode->children.size())) {
+        return QModelIndex();
+    }
+    return createIndex(row, column, parentNode->children[row].get());
+}
+
+QModelIndex FileTreeModel::parent(const QModelIndex &child) const
+{
+    const Node *node = nodeFromIndex(child);
+    if (!node || node == m_root.get()) {
+        return QModelIndex();
+    }
+    return indexFromNode(node->parent);
+}
+
+int FileTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+    const Node *node = nodeFromIndex(parent);
+    return node ? int(node->children.size()) : 0;
+}
+
+int FileTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return 1;
+}
+
+QVariant FileTreeModel::data(const QModelIndex &index, int role) const
+{
+    const Node *node = index.isValid() ? nodeFromIndex(index) : nullptr;
+    if (!node) {
+        return QVariant();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        return node->name;
+    case Qt::DecorationRole:
+        // Generic icons; asking the platform for per-file icons stats every file
+        return m_iconProvider.icon(node->isDirectory ? QFileIconProvider::Folder : QFileIconProvider::File);
+    case Qt::ToolTipRole:
+    case FilePathRole:
+        return nodePath(node);
+    case IsDirectoryRole:
+        return node->isDirectory;
+    case Qt::ForegroundRole:
+        // Ignored entries stay visible, but dimmed
+        if (node->ignored) {
+            return QGuiApplication::palette().color(QPalette::Disabled, QPalette::Text);
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags FileTreeModel::flags(const QModelIndex &index) const
+{
+    const Node *node = index.isValid() ? nodeFromIndex(index) : nullptr;
+    if (!node) {
+        return Qt::NoItemFlags;
+    }
+
+    Qt::ItemFlags itemFlags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    if (!node->isDirectory) {
+        itemFlags |= Qt::ItemNeverHasChildren;
+    }
+    return itemFlags;
+}
+
+bool FileTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    const Node *node = nodeFromIndex(parent);
+    if (!node || !node->isDirectory) {
+        return false;
+    }
+
+    // Folders show an expander until listing proves them empty
+    return !node->fetched || !node->children.empty();
+}
+
+bool FileTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    const Node *node = nodeFromIndex(parent);
+    return node && node->isDirectory && !node->fetched && node->listingId == 0;
+}
+
+void FileTreeModel::fetchMore(const QModelIndex &parent)
+{
+    Node *node = nodeFromIndex(parent);
+    if (node && node->isDirectory && !node->fetched && node->listingId == 0) {
+        startListing(node, true);
+    }
+}
+
+void FileTreeModel::onDirectoryChanged(const QString &path)
+{
+    Node *node = findNode(path);
+    if (!node) {
+        return;
+    }
+
+    // Changes during a listing may have been missed; list once more afterwards
+    if (node->listingId != 0) {
+        node->stale = true;
+    } else if (node->fetched) {
+        startListing(node, false);
+    }
+}
+
+// Helpers
+
+FileTreeModel::Node *FileTreeModel::nodeFromIndex(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return m_root.get();
+    }
+    return static_cast<Node *>(index.internalPointer());
+}
+
+QModelIndex FileTreeModel::indexFromNode(const Node *node) const
+{
+    if (!node || node == m_root.get()) {
+        return QModelIndex();
+    }
+    return createIndex(node->row, 0, const_cast<Node *>(node));
+}
+
+FileTreeModel::Node *FileTreeModel::findNode(const QString &path) const
+{
+    if (!m_root) {
+        return nullptr;
+    }
+
+    const QString absolutePath = QDir(path).absolutePath();
+    if (absolutePath == m_root->name) {
+        return m_root.get();
+    }
+
+    const QString prefix = m_root->name.endsWith(QLatin1Char('/')) ? m_root->name : m_root->name + QLatin1Char('/');
+    if (!absolutePath.startsWith(prefix)) {
+        return nullptr;
+    }
+
+    Node *node = m_root.get();
+    const QStringList names = absolutePath.mid(prefix.size()).split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    for (const QString &name : names) {
+        const auto it = std::find_if(node->children.begin(), node->children.end(),
+                                     [&name](const std::unique_ptr<Node> &child) { return child->name == name; });
+        if (it == node->children.end()) {
+            return nullptr;
+        }
+        node = it->get();
+    }
+    return node;
+}
+
+QString FileTreeModel::nodePath(const Node *node) const
+{
+    QStringList names;
+    for (; node->parent; node = node->parent) {
+        names.prepend(node->name);
+    }
+    if (names.isEmpty()) {
+        return node->name;
+    }
+
+    QString path = node->name;
+    if (!path.endsWith(QLatin1Char('/'))) {
+        path += QLatin1Char('/');
+    }
+    path += names.join(QLatin1Char('/'));
+    return path;
+}
+
+void FileTreeModel::startListing(Node *node, bool batched)
+{
+    const quint64 listingId = m_nextListingId++;
+    node->listingId = listingId;
+
+    const QString path = nodePath(node);
+    const QString rootPath = m_root->name;
+    std::shared_ptr<ListingTarget> target = m_listingTarget;
+    QThreadPool::globalInstance()->start([target, rootPath, path, listingId, batched]() {
+        const auto deliver = [&target, &path, listingId](QVector<Entry> entries, bool finished) {
+            // Posting under the lock keeps the model alive until the event is queued
+            QMutexLocker locker(&target->mutex);
+            FileTreeModel *model = target->model;
+            if (!model) {
+                return false;
+            }
+            QMetaObject::invokeMethod(
+                model,
+                [model, path, listingId, entries = std::move(entries), finished]() {
+                    model->onListingBatch(path, listingId, entries, finished);
+                },
+                Qt::QueuedConnection);
+            return true;
+        };
+
+        const WorkspaceWalker::Directory directory = WorkspaceWalker::directory(rootPath, path);
+        QVector<Entry> entries;
+        QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot);
+        while (it.hasNext()) {
+            it.next();
+            const QFileInfo fileInfo = it.fileInfo();
+            entries.append({ it.fileName(), fileInfo.isDir(), WorkspaceWalker::isIgnored(directory, fileInfo) });
+            if (batched && entries.size() == LISTING_BATCH_SIZE) {
+                if (!deliver(std::move(entries), false)) {
+                    return;
+                }
+                entries = QVector<Entry>();
+            }
+        }
+        deliver(std::move(entries), true);
+    });
+}
+
+void FileTreeModel::onListingBatch(const QString &path, quint64 listingId, QVector<Entry> entries, bool finished)
+{
+    Node *node = findNode(path);
+    if (!node || node->listingId != listingId) {
+        return;
+    }
+
+    if (!node->fetched) {
+        appendChildren(node, entries);
+    } else if (finished) {
+        applyListing(node, std::move(entries));
+    }
+    if (!finished) {
+        return;
+    }
+
+    const bool firstListing = !node->fetched;
+    node->listingId = 0;
+    node->fetched = true;
+    if (firstListing) {
+        sortChildren(node);
+        if (node->children.empty()) {
+            // Let the view drop the expander of an empty folder
+            const QModelIndex index = indexFromNode(node);
+            if (index.isValid()) {
+                emit dataChanged(index, index);
+            }
+        }
+    }
+    emit directoryLoaded(path);
+
+    if (node->stale && (node->watched || !node->parent)) {
+        node->stale = false;
+        startListing(node, false);
+    }
+}
+
+void FileTreeModel::appendChildren(Node *node, const QVector<Entry> &entries)
+{
+    if (entries.isEmpty()) {
+        return;
+    }
+
+    // Each batch is sorted; the whole folder is sorted once listing completes
+    QVector<Entry> sorted = entries;
+    std::sort(sorted.begin(), sorted.end(), [](const Entry &left, const Entry &right) {
+        return lessThan(left.name, left.isDirectory, right.name, right.isDirectory);
+    });
+
+    const int first = int(node->children.size());
+    beginInsertRows(indexFromNode(node), first, first + int(sorted.size()) - 1);
+    node->children.reserve(node->children.size() + sorted.size());
+    for (const Entry &entry : std::as_const(sorted)) {
+        auto child = std::make_unique<Node>();
+        child->name = entry.name;
+        child->parent = node;
+        child->isDirectory = entry.isDirectory;
+        child->ignored = entry.ignored;
+        node->children.push_back(std::move(child));
+    }
+    renumber(node, first);
+    endInsertRows();
+}
+
+void FileTreeModel::sortChildren(Node *node)
+{
+    const auto compare = [](const std::unique_ptr<Node> &left, const std::unique_ptr<Node> &right) {
+        return lessThan(left->name, left->isDirectory, right->name, right->isDirectory);
+    };
+    if (std::is_sorted(node->children.begin(), node->children.end(), compare)) {
+        return;
+    }
+
+    const QList<QPersistentModelIndex> parents { QPersistentModelIndex(indexFromNode(node)) };
+    emit layoutAboutToBeChanged(parents, QAbstractItemModel::VerticalSortHint);
+
+    std::stable_sort(node->children.begin(), node->children.end(), compare);
+    renumber(node, 0);
+
+    // Nodes keep their identity, so persistent indexes only change rows
+    QModelIndexList from;
+    QModelIndexList to;
+    const QModelIndexList persistent = persistentIndexList();
+    for (const QModelIndex &index : persistent) {
+        Node *child = static_cast<Node *>(index.internalPointer());
+        if (child->parent == node && child->row != index.row()) {
+            from.append(index);
+            to.append(createIndex(child->row, index.column(), child));
+        }
+    }
+    changePersistentIndexList(from, to);
+
+    emit layoutChanged(parents, QAbstractItemModel::VerticalSortHint);
+}
+
+void FileTreeModel::applyListing(Node *node, QVector<Entry> entries)
+{
+    QHash<QString, Entry> added;
+    added.reserve(entries.size());
+    for (const Entry &entry : std::as_const(entries)) {
+        added.insert(entry.name, entry);
+    }
+
+    const QModelIndex parentIndex = indexFromNode(node);
+
+    // Remove the entries that are gone, or that changed between file and folder
+    for (int row = int(node->children.size()) - 1; row >= 0; --row) {
+        Node *child = node->children[row].get();
+        const auto it = added.constFind(child->name);
+        if (it != added.constEnd() && it->isDirectory == child->isDirectory) {
+            if (it->ignored != child->ignored) {
+                child->ignored = it->ignored;
+                const QModelIndex index = this->index(row, 0, parentIndex);
+                emit dataChanged(index, index, { Qt::ForegroundRole });
+            }
+            added.remove(child->name);
+            continue;
+        }
+
+        beginRemoveRows(parentIndex, row, row);
+        unwatchTree(child);
+        node->children.erase(node->children.begin() + row);
+        renumber(node, row);
+        endRemoveRows();
+    }
+
+    // Insert the new entries at their sorted position
+    std::sort(entries.begin(), entries.end(), [](const Entry &left, const Entry &right) {
+        return lessThan(left.name, left.isDirectory, right.name, right.isDirectory);
+    });
+    for (const Entry &entry : std::as_const(entries)) {
+        if (!added.contains(entry.name)) {
+            continue;
+        }
+
+        const auto position = std::lower_bound(node->children.begin(), node->children.end(), entry,
+                                               [](const std::unique_ptr<Node> &child, const Entry &value) {
+                                                   return lessThan(child->name, child->isDirectory, value.name,
+                                                                   value.isDirectory);
+                                               });
+        const int row = int(position - node->children.begin());
+
+        auto child = std::make_unique<Node>();
+        child->name = entry.name;
+        child->parent = node;
+        child->isDirectory = entry.isDirectory;
+        child->ignored = entry.ignored;
+
+        beginInsertRows(parentIndex, row, row);
+        node->children.insert(node->children.begin() + row, std::move(child));
+        renumber(node, row);
+        endInsertRows();
+    }
+}
+
+void FileTreeModel::watchDirectory(const QString &path)
+{
+    FileWatchService::instance().watch(path, this, [this](const QString &changedPath) {
+        onDirectoryChanged(changedPath);
+    });
+}
+
+void FileTreeModel::unwatchTree(Node *node)
+{
+    if (node->watched) {
+        FileWatchService::instance().unwatch(nodePath(node), this);
+        node->watched = false;
+    }
+    for (const std::unique_ptr<Node> &child : node->children) {
+        if (child->isDirectory) {
+            unwatchTree(child.get());
+        }
+    }
+}
+
+void FileTreeModel::renumber(Node *node, int from)
+{
+    for (int row = from; row < int(node->children.size()); ++row) {
+        node->children[row]->row = row;
+    }
+}
+
+bool FileTreeModel::lessThan(const QString &leftName, bool leftIsDirectory, const QString &rightName,
+                             bool rightIsDirectory)
+{
+    if (leftIsDirectory != rightIsDirectory) {
+        return leftIsDirectory;
+    }
+    const int result = QString::compare(leftName, rightName, Qt::CaseInsensitive);
+    return result != 0 ? result < 0 : leftName < rightName;
+}
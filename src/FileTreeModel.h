@@ -0,0 +1,204 @@
+/**
+ * @file FileTreeModel.h
+ * @brief Lazily loaded file tree of one folder for the file explorer
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QFileIconProvider>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+/**
+ * @class FileTreeModel
+ * @brief Item model of the files below a folder, loaded as folders are expanded
+ *
+ * Unlike QFileSystemModel, which is typically rooted at the file system
+ * root, the model only knows the chosen folder. A folder is listed the
+ * first time the view asks for its children. Listing runs on a worker
+ * thread, and entries arrive in batches, so large or slow (e.g. network)
+ * folders never block the GUI. Only the root and the expanded folders are
+ * watched for changes (see FileWatchService), and a change lists the folder again and applies
+ * the difference.
+ *
+ * Hidden files are not shown. Entries matched by .gitignore or .ignore
+ * files (see WorkspaceWalker) are shown dimmed. Folders are sorted before
+ * files, and names are sorted ignoring case.
+ *
+ * @see FileExplorer
+ */
+class FileTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    /** @brief Custom data roles */
+    enum Roles {
+        FilePathRole = Qt::UserRole + 1, ///< Absolute path of the entry
+        IsDirectoryRole                  ///< Whether the entry is a folder
+    };
+
+    /**
+     * @brief Constructs an empty model
+     * @param parent Parent object
+     */
+    explicit FileTreeModel(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~FileTreeModel();
+
+    /**
+     * @brief Sets the folder shown by the model
+     * @param path Folder; its entries are the top-level rows
+     */
+    void setRootPath(const QString &path);
+
+    /**
+     * @brief Gets the folder shown by the model
+     * @return Absolute folder path
+     */
+    QString rootPath() const;
+
+    /**
+     * @brief Gets the path of an entry
+     * @param index Index of the entry; the invalid index is the root folder
+     * @return Absolute path
+     */
+    QString filePath(const QModelIndex &index) const;
+
+    /**
+     * @brief Gets the index of a loaded entry
+     * @param path Absolute path of the entry
+     * @return Index of the entry; invalid for the root or paths not loaded yet
+     */
+    QModelIndex indexForPath(const QString &path) const;
+
+    /**
+     * @brief Checks whether an entry is a folder
+     * @param index Index of the entry
+     * @return true for folders and the root
+     */
+    bool isDirectory(const QModelIndex &index) const;
+
+    /**
+     * @brief Starts or stops watching a folder, typically as it is expanded or collapsed
+     * @param index Index of the folder
+     * @param watched Whether changes to the folder should be followed
+     *
+     * A folder that was not watched for a while is listed again when
+     * watching resumes.
+     */
+    void setWatched(const QModelIndex &index, bool watched);
+
+    /**
+     * @brief Lists every loaded folder again
+     */
+    void refresh();
+
+    // QAbstractItemModel interface
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    /** @brief Entries delivered to the GUI thread at once while listing */
+    static const int LISTING_BATCH_SIZE = 256;
+
+signals:
+    /**
+     * @brief Emitted when a folder has been listed completely
+     * @param path Absolute folder path
+     */
+    void directoryLoaded(const QString &path);
+
+private:
+    struct Node;
+    struct ListingTarget;
+
+    /**
+     * @brief Folder entry found by a listing
+     */
+    struct Entry
+    {
+        QString name;             ///< File name
+        bool isDirectory = false; ///< Whether the entry is a folder
+        bool ignored = false;     ///< Whether an ignore file matches the entry
+    };
+
+    /** @brief Gets the node of an index; the invalid index is the root */
+    Node *nodeFromIndex(const QModelIndex &index) const;
+
+    /** @brief Gets the index of a node; the root has the invalid index */
+    QModelIndex indexFromNode(const Node *node) const;
+
+    /** @brief Finds the loaded node of a path, or nullptr */
+    Node *findNode(const QString &path) const;
+
+    /** @brief Gets the absolute path of a node */
+    QString nodePath(const Node *node) const;
+
+    /**
+     * @brief Lists a folder on a worker thread
+     * @param node Folder to list
+     * @param batched Whether to show entries as they arrive (first listing)
+     *                rather than applying the difference once listing is done
+     */
+    void startListing(Node *node, bool batched);
+
+    /**
+     * @brief Receives listed entries on the GUI thread
+     * @param path Folder being listed
+     * @param listingId Listing the entries belong to
+     * @param entries Entries of this batch
+     * @param finished Whether this is the last batch
+     */
+    void onListingBatch(const QString &path, quint64 listingId, QVector<Entry> entries, bool finished);
+
+    /** @brief Appends newly listed children to a folder */
+    void appendChildren(Node *node, const QVector<Entry> &entries);
+
+    /** @brief Sorts the children of a folder, keeping persistent indexes valid */
+    void sortChildren(Node *node);
+
+    /** @brief Replaces the children of a folder by a new listing, row by row */
+    void applyListing(Node *node, QVector<Entry> entries);
+
+    /** @brief Lists a changed folder again */
+    void onDirectoryChanged(const QString &path);
+
+    /** @brief Subscribes to changes of a folder */
+    void watchDirectory(const QString &path);
+
+    /** @brief Stops watching a folder and every folder below it */
+    void unwatchTree(Node *node);
+
+    /** @brief Updates the cached rows of children from a position on */
+    static void renumber(Node *node, int from);
+
+    /** @brief Ordering of entries: folders first, then by name ignoring case */
+    static bool lessThan(const QString &leftName, bool leftIsDirectory, const QString &rightName,
+                         bool rightIsDirectory);
+
+    /** @brief Root folder */
+    std::unique_ptr<Node> m_root;
+
+    /** @brief Provides folder and file icons */
+    QFileIconProvider m_iconProvider;
+
+    /** @brief Lets listing tasks reach the model while it exists */
+    std::shared_ptr<ListingTarget> m_listingTarget;
+
+    /** @brief Id given to the next listing */
+    quint64 m_nextListingId;
+};
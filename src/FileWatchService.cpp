@@ -0,0 +1,199 @@
+#include "FileWatchService.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <utility>
+
+FileWatchService &FileWatchService::instance()
+{
+    // Owned by the application, so the watcher goes away before the event loop
+    static FileWatchService *service = new FileWatchService(QCoreApplication::instance());
+    return *service;
+}
+
+FileWatchService::FileWatchService(QObject *parent)
+    : QObject(parent)
+    , m_watcher(nullptr)
+    , m_debounceTimer(nullptr)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &FileWatchService::onPathChanged);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &FileWatchService::onPathChanged);
+
+    m_debounceTimer = new QTimer(this);
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(DEBOUNCE_INTERVAL);
+    connect(m_debounceTimer, &QTimer::timeout, this, &FileWatchService::dispatchPendingChanges);
+}
+
+bool FileWatchService::watch(const QString &path, QObject *subscriber, const Handler &handler)
+{
+    return watch(QStringList { path }, subscriber, handler) == 1;
+}
+
+int FileWatchService::watch(const QStringList &paths, QObject *subscriber, const Handler &handler)
+{
+    if (!subscriber) {
+        return 0;
+    }
+
+    QStringList newPaths;
+    QStringList knownPaths;
+    for (const QString &path : paths) {
+        const QString normalized = normalizedPath(path);
+        if (normalized.isEmpty()) {
+            continue;
+        }
+        (m_subscriptions.contains(normalized) ? knownPaths : newPaths).append(normalized);
+    }
+
+    // One call for all new paths; adding them one by one is much slower
+    const QStringList failedPaths = newPaths.isEmpty() ? QStringList() : m_watcher->addPaths(newPaths);
+    const QSet<QString> failed(failedPaths.cbegin(), failedPaths.cend());
+
+    int watched = 0;
+    for (const QStringList *list : { &knownPaths, &newPaths }) {
+        for (const QString &path : *list) {
+            if (!failed.contains(path)) {
+                addSubscription(path, subscriber, handler);
+                ++watched;
+            }
+        }
+    }
+    return watched;
+}
+
+void FileWatchService::unwatch(const QString &path, QObject *subscriber)
+{
+    const QString normalized = normalizedPath(path);
+    auto it = m_subscriptions.find(normalized);
+    if (it == m_subscriptions.end()) {
+        return;
+    }
+
+    QVector<Subscription> &subscriptions = it.value();
+    subscriptions.removeIf([subscriber](const Subscription &subscription) {
+        return subscription.subscriber == subscriber;
+    });
+    if (subscriptions.isEmpty()) {
+        m_subscriptions.erase(it);
+        m_pendingPaths.remove(normalized);
+        m_watcher->removePath(normalized);
+    }
+
+    auto paths = m_subscriberPaths.find(subscriber);
+    if (paths != m_subscriberPaths.end()) {
+        paths->remove(normalized);
+        if (paths->isEmpty()) {
+            m_subscriberPaths.erase(paths);
+            disconnect(subscriber, &QObject::destroyed, this, nullptr);
+        }
+    }
+}
+
+void FileWatchService::unwatchAll(QObject *subscriber)
+{
+    const QSet<QString> paths = m_subscriberPaths.value(subscriber);
+    QStringList unwatched;
+    for (const QString &path : paths) {
+        auto it = m_subscriptions.find(path);
+        if (it == m_subscriptions.end()) {
+            continue;
+        }
+        it->removeIf([subscriber](const Subscription &subscription) {
+            return subscription.subscriber == subscriber;
+        });
+        if (it->isEmpty()) {
+            m_subscriptions.erase(it);
+            m_pendingPaths.remove(path);
+            unwatched.append(path);
+        }
+    }
+
+    if (!unwatched.isEmpty()) {
+        m_watcher->removePaths(unwatched);
+    }
+    if (m_subscriberPaths.remove(subscriber)) {
+        disconnect(subscriber, &QObject::destroyed, this, nullptr);
+    }
+}
+
+int FileWatchService::watchedCount(QObject *subscriber) const
+{
+    return int(m_subscriberPaths.value(subscriber).size());
+}
+
+void FileWatchService::onPathChanged(const QString &path)
+{
+    if (m_pendingPaths.isEmpty()) {
+        m_pendingAge.start();
+    }
+    m_pendingPaths.insert(path);
+
+    // Keep waiting for quiet, but never longer than the maximum delay
+    if (m_pendingAge.elapsed() + DEBOUNCE_INTERVAL <= MAX_DEBOUNCE_DELAY) {
+        m_debounceTimer->start();
+    } else if (!m_debounceTimer->isActive()) {
+        m_debounceTimer->start(0);
+    }
+}
+
+void FileWatchService::dispatchPendingChanges()
+{
+    m_debounceTimer->setInterval(DEBOUNCE_INTERVAL);
+    const QSet<QString> paths = std::exchange(m_pendingPaths, QSet<QString>());
+    const QStringList watchedFiles = m_watcher->files();
+    const QStringList watchedDirectories = m_watcher->directories();
+    QSet<QString> watched(watchedFiles.cbegin(), watchedFiles.cend());
+    watched.unite(QSet<QString>(watchedDirectories.cbegin(), watchedDirectories.cend()));
+
+    for (const QString &path : paths) {
+        if (!m_subscriptions.contains(path)) {
+            continue;
+        }
+
+        // Renaming a file over a watched one drops the watch; pick up the new file
+        if (!watched.contains(path) && QFileInfo::exists(path)) {
+            m_watcher->addPath(path);
+        }
+
+        // Handlers may subscribe or unsubscribe, so work on a copy
+        const QVector<Subscription> subscriptions = m_subscriptions.value(path);
+        for (const Subscription &subscription : subscriptions) {
+            if (m_subscriberPaths.value(subscription.subscriber).contains(path)) {
+                subscription.handler(path);
+            }
+        }
+    }
+}
+
+void FileWatchService::addSubscription(const QString &path, QObject *subscriber, const Handler &handler)
+{
+    QVector<Subscription> &subscriptions = m_subscriptions[path];
+    for (Subscription &subscription : subscriptions) {
+        if (subscription.subscriber == subscriber) {
+            subscription.handler = handler;
+            return;
+        }
+    }
+    subscriptions.append({ subscriber, handler });
+
+    QSet<QString> &paths = m_subscriberPaths[subscriber];
+    if (paths.isEmpty()) {
+        connect(subscriber, &QObject::destroyed, this, &FileWatchService::onSubscriberDestroyed);
+    }
+    paths.insert(path);
+}
+
+void FileWatchService::onSubscriberDestroyed(QObject *subscriber)
+{
+    unwatchAll(subscriber);
+}
+
+QString FileWatchService::normalizedPath(const QString &path)
+{
+    return path.isEmpty() ? QString() : QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+}
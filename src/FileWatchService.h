@@ -0,0 +1,146 @@
+/**
+ * @file FileWatchService.h
+ * @brief Application-wide file and folder watching with coalesced notifications
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QElapsedTimer>
+#include <functional>
+
+class QFileSystemWatcher;
+class QTimer;
+
+/**
+ * @class FileWatchService
+ * @brief Watches files and folders for all subscribers through one watcher
+ *
+ * Open tabs, the file explorer and the search index subscribe to the
+ * paths they care about here instead of owning watchers of their own. On
+ * Linux the service therefore uses a single inotify descriptor, and a
+ * path watched by several subscribers is watched once.
+ *
+ * Notifications are coalesced: a path that changes repeatedly, e.g.
+ * while a tool writes a file in chunks, is reported once after it has
+ * been quiet for DEBOUNCE_INTERVAL, and at least every MAX_DEBOUNCE_DELAY
+ * while changes keep coming. A file replaced by renaming another file over
+ * it, as atomic saves do, stays watched.
+ *
+ * Subscriptions end when the subscriber is destroyed.
+ */
+class FileWatchService : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Called with the watched path that changed */
+    using Handler = std::function<void(const QString &path)>;
+
+    /**
+     * @brief Gets the application-wide service
+     * @return Service instance, created on first access
+     */
+    static FileWatchService &instance();
+
+    /**
+     * @brief Subscribes to changes of a file or folder
+     * @param path Absolute path of an existing file or folder
+     * @param subscriber Object the subscription belongs to
+     * @param handler Called on the GUI thread when the path changes or is removed
+     * @return false if the path could not be watched
+     */
+    bool watch(const QString &path, QObject *subscriber, const Handler &handler);
+
+    /**
+     * @brief Subscribes to changes of several files or folders at once
+     * @param paths Absolute paths of existing files or folders
+     * @param subscriber Object the subscriptions belong to
+     * @param handler Called on the GUI thread for each changed path
+     * @return Number of paths that are now watched for the subscriber
+     */
+    int watch(const QStringList &paths, QObject *subscriber, const Handler &handler);
+
+    /**
+     * @brief Ends a subscription
+     * @param path Path passed to watch()
+     * @param subscriber Object the subscription belongs to
+     */
+    void unwatch(const QString &path, QObject *subscriber);
+
+    /**
+     * @brief Ends every subscription of a subscriber
+     * @param subscriber Object the subscriptions belong to
+     */
+    void unwatchAll(QObject *subscriber);
+
+    /**
+     * @brief Gets the number of paths a subscriber watches
+     * @param subscriber Object the subscriptions belong to
+     * @return Number of paths
+     */
+    int watchedCount(QObject *subscriber) const;
+
+    /** @brief Quiet time before a change is reported in milliseconds */
+    static const int DEBOUNCE_INTERVAL = 100;
+
+    /** @brief Longest delay of a report while changes keep coming in milliseconds */
+    static const int MAX_DEBOUNCE_DELAY = 1000;
+
+private slots:
+    /** @brief Records a change reported by the watcher */
+    void onPathChanged(const QString &path);
+
+    /** @brief Reports the changes collected since the last dispatch */
+    void dispatchPendingChanges();
+
+private:
+    /**
+     * @brief Constructs the service
+     * @param parent Parent object
+     */
+    explicit FileWatchService(QObject *parent = nullptr);
+
+    /**
+     * @brief Subscription of one object to one path
+     */
+    struct Subscription
+    {
+        QObject *subscriber = nullptr; ///< Object the subscription belongs to
+        Handler handler;               ///< Called when the path changes
+    };
+
+    /** @brief Records a subscription to a path that is already watched */
+    void addSubscription(const QString &path, QObject *subscriber, const Handler &handler);
+
+    /** @brief Drops the subscriptions of a destroyed object */
+    void onSubscriberDestroyed(QObject *subscriber);
+
+    /** @brief Normalizes a path so equal paths compare equal */
+    static QString normalizedPath(const QString &path);
+
+    /** @brief Single watcher for all paths */
+    QFileSystemWatcher *m_watcher;
+
+    /** @brief Delays reports until changes settle */
+    QTimer *m_debounceTimer;
+
+    /** @brief Time since the oldest unreported change */
+    QElapsedTimer m_pendingAge;
+
+    /** @brief Subscriptions by watched path */
+    QHash<QString, QVector<Subscription>> m_subscriptions;
+
+    /** @brief Paths by subscriber */
+    QHash<QObject *, QSet<QString>> m_subscriberPaths;
+
+    /** @brief Paths changed since the last dispatch */
+    QSet<QString> m_pendingPaths;
+};
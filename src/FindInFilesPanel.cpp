@@ -0,0 +1,529 @@
+#include "FindInFilesPanel.h"
+#include "TrigramIndex.h"
+#include "TabWidget.h"
+#include "TextEditor.h"
+#include "SearchSession.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QDir>
+#include <QRegularExpression>
+#include <QMessageBox>
+#include <QFileInfo>
+
+FindInFilesResultModel::FindInFilesResultModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int FindInFilesResultModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_results.size());
+}
+
+QVariant FindInFilesResultModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_results.size()) {
+        return QVariant();
+    }
+
+    const FileSearchResult &result = m_results.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        // Built on demand; the view only asks for the visible rows
+        return QString("%1:%2: %3")
+            .arg(QDir(m_rootPath).relativeFilePath(result.filePath))
+            .arg(result.line)
+            .arg(result.lineText.trimmed());
+    case Qt::ToolTipRole:
+        return result.filePath;
+    case FilePathRole:
+        return result.filePath;
+    case LineRole:
+        return result.line;
+    case ColumnRole:
+        return result.column;
+    default:
+        return QVariant();
+    }
+}
+
+void FindInFilesResultModel::setRootPath(const QString &rootPath)
+{
+    m_rootPath = rootPath;
+}
+
+void FindInFilesResultModel::appendResults(const QVector<FileSearchResult> &results)
+{
+    if (results.isEmpty()) {
+        return;
+    }
+
+    const int first = int(m_results.size());
+    beginInsertRows(QModelIndex(), first, first + int(results.size()) - 1);
+    m_results.append(results);
+    endInsertRows();
+
+    for (const FileSearchResult &result : results) {
+        m_files.insert(result.filePath);
+    }
+}
+
+void FindInFilesResultModel::clear()
+{
+    beginResetModel();
+    m_results.clear();
+    m_files.clear();
+    endResetModel();
+}
+
+int FindInFilesResultModel::fileCount() const
+{
+    return int(m_files.size());
+}
+
+QStringList FindInFilesResultModel::files() const
+{
+    QStringList files(m_files.cbegin(), m_files.cend());
+    files.sort();
+    return files;
+}
+
+FindInFilesPanel::FindInFilesPanel(QWidget *parent)
+    : QWidget(parent)
+    , m_findLineEdit(nullptr)
+    , m_filterLineEdit(nullptr)
+    , m_replaceLineEdit(nullptr)
+    , m_searchButton(nullptr)
+    , m_cancelButton(nullptr)
+    , m_replaceAllButton(nullptr)
+    , m_caseSensitiveCheckBox(nullptr)
+    , m_wholeWordsCheckBox(nullptr)
+    , m_useRegexCheckBox(nullptr)
+    , m_previewCheckBox(nullptr)
+    , m_statusLabel(nullptr)
+    , m_resultView(nullptr)
+    , m_previewView(nullptr)
+    , m_resultModel(nullptr)
+    , m_searchEngine(nullptr)
+    , m_replaceEngine(nullptr)
+    , m_trigramIndex(nullptr)
+    , m_tabWidget(nullptr)
+    , m_openFilesChanged(0)
+    , m_openReplacements(0)
+{
+    setupUI();
+    setupConnections();
+    setSearching(false);
+}
+
+FindInFilesPanel::~FindInFilesPanel()
+{
+}
+
+void FindInFilesPanel::setupUI()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setSpacing(5);
+    mainLayout->setContentsMargins(10, 5, 10, 5);
+
+    // Find section
+    QHBoxLayout *findLayout = new QHBoxLayout();
+
+    QLabel *findLabel = new QLabel(tr("Find:"), this);
+    findLabel->setMinimumWidth(60);
+
+    m_findLineEdit = new QLineEdit(this);
+    m_findLineEdit->setPlaceholderText(tr("Enter text to find in files..."));
+
+    m_searchButton = new QPushButton(tr("Search"), this);
+    m_cancelButton = new QPushButton(tr("Cancel"), this);
+
+    findLayout->addWidget(findLabel);
+    findLayout->addWidget(m_findLineEdit, 1);
+    findLayout->addWidget(m_searchButton);
+    findLayout->addWidget(m_cancelButton);
+
+    // Filter section
+    QHBoxLayout *filterLayout = new QHBoxLayout();
+
+    QLabel *filterLabel = new QLabel(tr("Files:"), this);
+    filterLabel->setMinimumWidth(60);
+
+    m_filterLineEdit = new QLineEdit(this);
+    m_filterLineEdit->setPlaceholderText(tr("File name patterns, e.g. *.cpp; *.h (empty for all files)"));
+
+    filterLayout->addWidget(filterLabel);
+    filterLayout->addWidget(m_filterLineEdit, 1);
+
+    // Replace section
+    QHBoxLayout *replaceLayout = new QHBoxLayout();
+
+    QLabel *replaceLabel = new QLabel(tr("Replace:"), this);
+    replaceLabel->setMinimumWidth(60);
+
+    m_replaceLineEdit = new QLineEdit(this);
+    m_replaceLineEdit->setPlaceholderText(tr("Replacement for the matches found"));
+
+    m_replaceAllButton = new QPushButton(tr("Replace All"), this);
+
+    replaceLayout->addWidget(replaceLabel);
+    replaceLayout->addWidget(m_replaceLineEdit, 1);
+    replaceLayout->addWidget(m_replaceAllButton);
+
+    // Options section
+    QHBoxLayout *optionsLayout = new QHBoxLayout();
+
+    m_caseSensitiveCheckBox = new QCheckBox(tr("Case sensitive"), this);
+    m_wholeWordsCheckBox = new QCheckBox(tr("Whole words"), this);
+    m_useRegexCheckBox = new QCheckBox(tr("Regular expression"), this);
+    m_previewCheckBox = new QCheckBox(tr("Preview replacement"), this);
+
+    m_statusLabel = new QLabel(this);
+    m_statusLabel->setStyleSheet("color: gray; font-style: italic;");
+
+    optionsLayout->addWidget(m_caseSensitiveCheckBox);
+    optionsLayout->addWidget(m_wholeWordsCheckBox);
+    optionsLayout->addWidget(m_useRegexCheckBox);
+    optionsLayout->addWidget(m_previewCheckBox);
+    optionsLayout->addStretch();
+    optionsLayout->addWidget(m_statusLabel);
+
+    // Results - uniform row heights let the view lay out only visible rows
+    m_resultModel = new FindInFilesResultModel(this);
+    m_resultView = new QListView(this);
+    m_resultView->setModel(m_resultModel);
+    m_resultView->setUniformItemSizes(true);
+    m_resultView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_resultView->setTextElideMode(Qt::ElideRight);
+
+    // Diff of the selected file, computed only while previewing
+    m_previewView = new QPlainTextEdit(this);
+    m_previewView->setReadOnly(true);
+    m_previewView->setLineWrapMode(QPlainTextEdit::NoWrap);
+    m_previewView->setFont(QFont("Consolas", 9));
+    m_previewView->hide();
+
+    mainLayout->addLayout(findLayout);
+    mainLayout->addLayout(filterLayout);
+    mainLayout->addLayout(replaceLayout);
+    mainLayout->addLayout(optionsLayout);
+    mainLayout->addWidget(m_resultView, 1);
+    mainLayout->addWidget(m_previewView, 1);
+
+    m_searchEngine = new FileSearchEngine(this);
+    m_replaceEngine = new FileReplaceEngine(this);
+}
+
+void FindInFilesPanel::setupConnections()
+{
+    connect(m_findLineEdit, &QLineEdit::returnPressed, this, &FindInFilesPanel::startSearch);
+    connect(m_filterLineEdit, &QLineEdit::returnPressed, this, &FindInFilesPanel::startSearch);
+    connect(m_searchButton, &QPushButton::clicked, this, &FindInFilesPanel::startSearch);
+    connect(m_cancelButton, &QPushButton::clicked, this, &FindInFilesPanel::cancelSearch);
+
+    connect(m_replaceAllButton, &QPushButton::clicked, this, &FindInFilesPanel::replaceAll);
+    connect(m_previewCheckBox, &QCheckBox::toggled, this, &FindInFilesPanel::onPreviewToggled);
+    connect(m_replaceLineEdit, &QLineEdit::textChanged, this, [this]() {
+        m_previewedFile.clear(); // The diff depends on the replacement
+        updatePreview();
+    });
+
+    connect(m_resultView, &QListView::activated, this, &FindInFilesPanel::onResultActivated);
+    connect(m_resultView->selectionModel(), &QItemSelectionModel::currentChanged, this, &FindInFilesPanel::updatePreview);
+
+    connect(m_searchEngine, &FileSearchEngine::resultsReady, this, &FindInFilesPanel::onResultsReady);
+    connect(m_searchEngine, &FileSearchEngine::progress, this, &FindInFilesPanel::onSearchProgress);
+    connect(m_searchEngine, &FileSearchEngine::finished, this, &FindInFilesPanel::onSearchFinished);
+    connect(m_searchEngine, &FileSearchEngine::indexedFilesChanged, this, [this](const QStringList &filePaths) {
+        if (m_trigramIndex) {
+            for (const QString &filePath : filePaths) {
+                m_trigramIndex->fileChanged(filePath);
+            }
+        }
+    });
+
+    connect(m_replaceEngine, &FileReplaceEngine::previewReady, this, &FindInFilesPanel::onPreviewReady);
+    connect(m_replaceEngine, &FileReplaceEngine::progress, this, &FindInFilesPanel::onReplaceProgress);
+    connect(m_replaceEngine, &FileReplaceEngine::fileFailed, this, &FindInFilesPanel::onReplaceFileFailed);
+    connect(m_replaceEngine, &FileReplaceEngine::finished, this, &FindInFilesPanel::onReplaceFinished);
+}
+
+void FindInFilesPanel::setRootPath(const QString &rootPath)
+{
+    m_rootPath = rootPath;
+}
+
+QString FindInFilesPanel::rootPath() const
+{
+    return m_rootPath;
+}
+
+void FindInFilesPanel::setTrigramIndex(TrigramIndex *index)
+{
+    m_trigramIndex = index;
+}
+
+void FindInFilesPanel::setTabWidget(TabWidget *tabWidget)
+{
+    m_tabWidget = tabWidget;
+}
+
+void FindInFilesPanel::setFindText(const QString &text)
+{
+    m_findLineEdit->setText(text);
+}
+
+void FindInFilesPanel::focusFindText()
+{
+    m_findLineEdit->setFocus();
+    m_findLineEdit->selectAll();
+}
+
+void FindInFilesPanel::startSearch()
+{
+    const QString text = m_findLineEdit->text();
+    if (text.isEmpty() || m_rootPath.isEmpty() || m_replaceEngine->isRunning()) {
+        return;
+    }
+
+    m_searchEngine->cancel();
+    m_resultModel->clear();
+    m_resultModel->setRootPath(m_rootPath);
+    m_previewedFile.clear();
+    m_previewView->clear();
+
+    const QStringList filters = m_filterLineEdit->text().split(QRegularExpression("[;,\\s]+"), Qt::SkipEmptyParts);
+    const SearchOptions options = searchOptions();
+
+    // The index narrows the search to files containing all required trigrams
+    FileSearchScope scope;
+    const bool indexed = m_trigramIndex && m_trigramIndex->candidateFiles(text, options, m_rootPath, scope);
+    const bool started = indexed ? m_searchEngine->startInScope(scope, text, options, filters)
+                                 : m_searchEngine->start(m_rootPath, text, options, filters);
+    if (!started) {
+        m_statusLabel->setText(tr("Invalid regular expression"));
+        setSearching(false);
+        return;
+    }
+
+    // Replacing applies to the matches listed, whatever is typed later
+    m_searchedPattern = text;
+    m_searchedOptions = options;
+
+    m_statusLabel->setText(tr("Searching..."));
+    setSearching(true);
+}
+
+void FindInFilesPanel::cancelSearch()
+{
+    if (m_replaceEngine->isRunning()) {
+        // Files already written stay changed
+        m_replaceEngine->cancel();
+        m_statusLabel->setText(tr("Replacement cancelled"));
+        setSearching(false);
+        return;
+    }
+
+    if (!m_searchEngine->isRunning()) {
+        return;
+    }
+
+    m_searchEngine->cancel();
+    m_statusLabel->setText(tr("Search cancelled: %1 match(es) in %2 file(s)")
+                               .arg(m_resultModel->rowCount())
+                               .arg(m_resultModel->fileCount()));
+    setSearching(false);
+}
+
+void FindInFilesPanel::replaceAll()
+{
+    if (m_searchEngine->isRunning() || m_replaceEngine->isRunning() || m_resultModel->rowCount() == 0) {
+        return;
+    }
+
+    const QStringList files = m_resultModel->files();
+    const QString replacement = m_replaceLineEdit->text();
+    const QMessageBox::StandardButton answer = QMessageBox::question(
+        this, tr("Replace in Files"),
+        tr("Replace every match of \"%1\" with \"%2\" in %3 file(s)?\n\n"
+           "Changes to files that are not open cannot be undone.")
+            .arg(m_searchedPattern, replacement)
+            .arg(files.size()));
+    if (answer != QMessageBox::Yes) {
+        return;
+    }
+
+    // Open documents are changed in memory, each as a single undo step
+    QStringList diskFiles;
+    m_openFilesChanged = 0;
+    m_openReplacements = 0;
+    m_failedFiles.clear();
+    for (const QString &filePath : files) {
+        TextEditor *editor = m_tabWidget ? m_tabWidget->editorAt(m_tabWidget->findFile(filePath)) : nullptr;
+        if (!editor) {
+            diskFiles.append(filePath);
+            continue;
+        }
+        if (editor->isReadOnly()) {
+            onReplaceFileFailed(filePath, tr("the document is read-only in the editor"));
+            continue;
+        }
+
+        SearchSession session;
+        session.setPattern(m_searchedPattern, m_searchedOptions);
+        session.setText(editor->plainTextSnapshot());
+        const QVector<SearchSession::Match> &matches = session.allMatches();
+        if (!matches.isEmpty()) {
+            editor->replaceMatches(matches, replacement);
+            ++m_openFilesChanged;
+            m_openReplacements += int(matches.size());
+        }
+    }
+
+    // The listed lines are out of date once the files change
+    m_resultModel->clear();
+    m_previewedFile.clear();
+    m_previewView->clear();
+
+    m_replaceEngine->start(diskFiles, m_searchedPattern, m_searchedOptions, replacement);
+    m_statusLabel->setText(tr("Replacing..."));
+    setSearching(true);
+}
+
+void FindInFilesPanel::onPreviewToggled(bool checked)
+{
+    m_previewView->setVisible(checked);
+    m_previewedFile.clear();
+    updatePreview();
+}
+
+void FindInFilesPanel::updatePreview()
+{
+    if (!m_previewCheckBox->isChecked()) {
+        return;
+    }
+
+    // Diffs are computed per file, and only for the file being looked at
+    const QString filePath = currentResultFile();
+    if (filePath.isEmpty()) {
+        m_previewedFile.clear();
+        m_previewView->clear();
+        return;
+    }
+    if (filePath == m_previewedFile) {
+        return;
+    }
+
+    m_previewedFile = filePath;
+    m_previewView->setPlainText(tr("Computing changes..."));
+
+    TextEditor *editor = m_tabWidget ? m_tabWidget->editorAt(m_tabWidget->findFile(filePath)) : nullptr;
+    if (editor) {
+        m_replaceEngine->previewText(filePath, editor->plainTextSnapshot(), m_searchedPattern, m_searchedOptions,
+                                     m_replaceLineEdit->text());
+    } else {
+        m_replaceEngine->preview(filePath, m_searchedPattern, m_searchedOptions, m_replaceLineEdit->text());
+    }
+}
+
+void FindInFilesPanel::onPreviewReady(const QString &filePath, const QString &diff)
+{
+    if (filePath != m_previewedFile) {
+        return;
+    }
+
+    m_previewView->setPlainText(diff.isEmpty() ? tr("No changes in %1").arg(QFileInfo(filePath).fileName()) : diff);
+}
+
+void FindInFilesPanel::onReplaceProgress(int filesDone, int filesTotal)
+{
+    m_statusLabel->setText(tr("Replacing... %1 of %2 file(s)").arg(filesDone).arg(filesTotal));
+}
+
+void FindInFilesPanel::onReplaceFileFailed(const QString &filePath, const QString &error)
+{
+    m_failedFiles.append(QStringLiteral("%1: %2").arg(QDir::toNativeSeparators(filePath), error));
+}
+
+void FindInFilesPanel::onReplaceFinished(int filesChanged, int replacements)
+{
+    QString status = tr("Replaced %1 occurrence(s) in %2 file(s)")
+                         .arg(replacements + m_openReplacements)
+                         .arg(filesChanged + m_openFilesChanged);
+    if (!m_failedFiles.isEmpty()) {
+        status += tr(", %1 file(s) could not be changed").arg(m_failedFiles.size());
+    }
+    m_statusLabel->setText(status);
+    setSearching(false);
+
+    if (m_failedFiles.isEmpty()) {
+        return;
+    }
+
+    // Long failure lists are cut short
+    QStringList shown = m_failedFiles.mid(0, MAX_FAILURES_SHOWN);
+    if (m_failedFiles.size() > MAX_FAILURES_SHOWN) {
+        shown.append(tr("... and %n more", nullptr, int(m_failedFiles.size() - MAX_FAILURES_SHOWN)));
+    }
+    QMessageBox::warning(this, tr("Replace in Files"),
+                         tr("These files were left unchanged:\n\n%1").arg(shown.join(QLatin1Char('\n'))));
+}
+
+void FindInFilesPanel::onResultsReady(const QVector<FileSearchResult> &results)
+{
+    m_resultModel->appendResults(results);
+}
+
+void FindInFilesPanel::onSearchProgress(int filesSearched)
+{
+    m_statusLabel->setText(tr("Searching... %1 match(es), %2 file(s) searched")
+                               .arg(m_resultModel->rowCount())
+                               .arg(filesSearched));
+}
+
+void FindInFilesPanel::onSearchFinished(int filesSearched, bool limitReached)
+{
+    QString status = tr("%1 match(es) in %2 file(s), %3 file(s) searched")
+                         .arg(m_resultModel->rowCount())
+                         .arg(m_resultModel->fileCount())
+                         .arg(filesSearched);
+    if (limitReached) {
+        status += tr(" (result limit reached)");
+    }
+    m_statusLabel->setText(status);
+    setSearching(false);
+}
+
+void FindInFilesPanel::onResultActivated(const QModelIndex &index)
+{
+    if (!index.isValid()) {
+        return;
+    }
+
+    emit resultActivated(index.data(FindInFilesResultModel::FilePathRole).toString(),
+                         index.data(FindInFilesResultModel::LineRole).toInt(),
+                         index.data(FindInFilesResultModel::ColumnRole).toInt());
+}
+
+void FindInFilesPanel::setSearching(bool searching)
+{
+    m_searchButton->setEnabled(!searching);
+    m_cancelButton->setEnabled(searching);
+    m_replaceAllButton->setEnabled(!searching && m_resultModel->rowCount() > 0);
+}
+
+QString FindInFilesPanel::currentResultFile() const
+{
+    const QModelIndex index = m_resultView->currentIndex();
+    return index.isValid() ? index.data(FindInFilesResultModel::FilePathRole).toString() : QString();
+}
+
+SearchOptions FindInFilesPanel::searchOptions() const
+{
+    SearchOptions options;
+    options.caseSensitive = m_caseSensitiveCheckBox->isChecked();
+    options.wholeWords = m_wholeWordsCheckBox->isChecked();
+    options.useRegex = m_useRegexCheckBox->isChecked();
+    return options;
+}
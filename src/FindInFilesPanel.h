@@ -0,0 +1,123 @@
+#pragma once
+
+#include <QWidget>
+#include <QAbstractListModel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QCheckBox>
+#include <QLabel>
+#include <QListView>
+#include <QPlainTextEdit>
+#include <QVector>
+#include <QSet>
+
+#include "FileSearchEngine.h"
+#include "FileReplaceEngine.h"
+
+class TrigramIndex;
+class TabWidget;
+
+class FindInFilesResultModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        FilePathRole = Qt::UserRole,
+        LineRole,
+        ColumnRole
+    };
+
+    explicit FindInFilesResultModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void setRootPath(const QString &rootPath);
+    void appendResults(const QVector<FileSearchResult> &results);
+    void clear();
+    int fileCount() const;
+    QStringList files() const;
+
+private:
+    QVector<FileSearchResult> m_results;
+    QString m_rootPath;
+    QSet<QString> m_files;
+};
+
+class FindInFilesPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FindInFilesPanel(QWidget *parent = nullptr);
+    ~FindInFilesPanel();
+
+    void setRootPath(const QString &rootPath);
+    QString rootPath() const;
+
+    void setTrigramIndex(TrigramIndex *index);
+    void setTabWidget(TabWidget *tabWidget);
+
+    void setFindText(const QString &text);
+    void focusFindText();
+
+public slots:
+    void startSearch();
+    void cancelSearch();
+    void replaceAll();
+
+signals:
+    void resultActivated(const QString &filePath, int line, int column);
+
+private slots:
+    void onResultsReady(const QVector<FileSearchResult> &results);
+    void onSearchProgress(int filesSearched);
+    void onSearchFinished(int filesSearched, bool limitReached);
+    void onResultActivated(const QModelIndex &index);
+    void onPreviewToggled(bool checked);
+    void updatePreview();
+    void onPreviewReady(const QString &filePath, const QString &diff);
+    void onReplaceProgress(int filesDone, int filesTotal);
+    void onReplaceFileFailed(const QString &filePath, const QString &error);
+    void onReplaceFinished(int filesChanged, int replacements);
+
+private:
+    void setupUI();
+    void setupConnections();
+    void setSearching(bool searching);
+    QString currentResultFile() const;
+    SearchOptions searchOptions() const;
+
+    QLineEdit *m_findLineEdit;
+    QLineEdit *m_filterLineEdit;
+    QLineEdit *m_replaceLineEdit;
+    QPushButton *m_searchButton;
+    QPushButton *m_cancelButton;
+    QPushButton *m_replaceAllButton;
+
+    QCheckBox *m_caseSensitiveCheckBox;
+    QCheckBox *m_wholeWordsCheckBox;
+    QCheckBox *m_useRegexCheckBox;
+    QCheckBox *m_previewCheckBox;
+
+    QLabel *m_statusLabel;
+    QListView *m_resultView;
+    QPlainTextEdit *m_previewView;
+
+    FindInFilesResultModel *m_resultModel;
+    FileSearchEngine *m_searchEngine;
+    FileReplaceEngine *m_replaceEngine;
+    TrigramIndex *m_trigramIndex;
+    TabWidget *m_tabWidget;
+    QString m_rootPath;
+
+    QString m_searchedPattern;
+    SearchOptions m_searchedOptions;
+    QString m_previewedFile;
+    int m_openFilesChanged;
+    int m_openReplacements;
+    QStringList m_failedFiles;
+
+    static const int MAX_FAILURES_SHOWN = 10;
+};
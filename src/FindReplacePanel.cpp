@@ -1,5 +1,7 @@
 #include "FindReplacePanel.h"
 #include "TextEditor.h"
+#include "TabWidget.h"
+#include "MatchCounter.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -21,10 +23,18 @@ FindReplacePanel::FindReplacePanel(QWidget *parent)
     , m_caseSensitiveCheckBox(nullptr)
     , m_wholeWordsCheckBox(nullptr)
     , m_useRegexCheckBox(nullptr)
+    , m_allDocumentsCheckBox(nullptr)
     , m_findLabel(nullptr)
     , m_replaceLabel(nullptr)
     , m_statusLabel(nullptr)
+    , m_resultsTree(nullptr)
     , m_textEditor(nullptr)
+    , m_tabWidget(nullptr)
+    , m_matchCounter(nullptr)
+    , m_countTimer(nullptr)
+    , m_documentSearch(nullptr)
+    , m_documentResultsValid(false)
+    , m_documentMatchCount(0)
     , m_findPanelVisible(false)
     , m_replacePanelVisible(false)
 {
@@ -88,6 +98,7 @@ void FindReplacePanel::setupUI()
     m_caseSensitiveCheckBox = new QCheckBox(tr("Case sensitive"), this);
     m_wholeWordsCheckBox = new QCheckBox(tr("Whole words"), this);
     m_useRegexCheckBox = new QCheckBox(tr("Regular expression"), this);
+    m_allDocumentsCheckBox = new QCheckBox(tr("All open documents"), this);
     
     m_statusLabel = new QLabel(this);
     m_statusLabel->setStyleSheet("color: gray; font-style: italic;");
@@ -95,6 +106,7 @@ void FindReplacePanel::setupUI()
     optionsLayout->addWidget(m_caseSensitiveCheckBox);
     optionsLayout->addWidget(m_wholeWordsCheckBox);
     optionsLayout->addWidget(m_useRegexCheckBox);
+    optionsLayout->addWidget(m_allDocumentsCheckBox);
     optionsLayout->addStretch();
     optionsLayout->addWidget(m_statusLabel);
     
@@ -103,11 +115,26 @@ void FindReplacePanel::setupUI()
     mainLayout->addLayout(replaceLayout);
     mainLayout->addLayout(optionsLayout);
     
+    // Results of the all-documents search, grouped by tab
+    m_resultsTree = new QTreeWidget(this);
+    m_resultsTree->setHeaderHidden(true);
+    m_resultsTree->setUniformRowHeights(true);
+    m_resultsTree->hide();
+    mainLayout->addWidget(m_resultsTree, 1);
+    
     // Initially hide replace section
     m_replaceLabel->hide();
     m_replaceLineEdit->hide();
     m_replaceButton->hide();
     m_replaceAllButton->hide();
+    
+    // Match counting runs in the background once typing pauses
+    m_matchCounter = new MatchCounter(this);
+    m_countTimer = new QTimer(this);
+    m_countTimer->setSingleShot(true);
+    m_countTimer->setInterval(200);
+    
+    m_documentSearch = new DocumentSearch(this);
 }
 
 void FindReplacePanel::setupConnections()
@@ -125,12 +152,23 @@ void FindReplacePanel::setupConnections()
     connect(m_caseSensitiveCheckBox, &QCheckBox::toggled, this, &FindReplacePanel::onOptionsChanged);
     connect(m_wholeWordsCheckBox, &QCheckBox::toggled, this, &FindReplacePanel::onOptionsChanged);
     connect(m_useRegexCheckBox, &QCheckBox::toggled, this, &FindReplacePanel::onOptionsChanged);
+    
+    connect(m_countTimer, &QTimer::timeout, this, &FindReplacePanel::startMatchCount);
+    connect(m_matchCounter, &MatchCounter::progress, this, &FindReplacePanel::onMatchCountProgress);
+    connect(m_matchCounter, &MatchCounter::finished, this, &FindReplacePanel::onMatchCountFinished);
+    
+    connect(m_findLineEdit, &QLineEdit::textChanged, this, &FindReplacePanel::invalidateDocumentResults);
+    connect(m_allDocumentsCheckBox, &QCheckBox::toggled, this, &FindReplacePanel::onAllDocumentsToggled);
+    connect(m_resultsTree, &QTreeWidget::itemActivated, this, &FindReplacePanel::onResultItemActivated);
+    connect(m_documentSearch, &DocumentSearch::documentSearched, this, &FindReplacePanel::onDocumentSearched);
+    connect(m_documentSearch, &DocumentSearch::finished, this, &FindReplacePanel::onDocumentSearchFinished);
 }
 
 void FindReplacePanel::setTextEditor(TextEditor *editor)
 {
+    clearSearchHighlight();
     m_textEditor = editor;
-    updateFindButtons();
+    onFindTextChanged(); // Recount for the new document
 }
 
 TextEditor *FindReplacePanel::textEditor() const
@@ -138,6 +176,11 @@ TextEditor *FindReplacePanel::textEditor() const
     return m_textEditor;
 }
 
+void FindReplacePanel::setTabWidget(TabWidget *tabWidget)
+{
+    m_tabWidget = tabWidget;
+}
+
 void FindReplacePanel::showFindPanel()
 {
     m_findPanelVisible = true;
@@ -160,6 +203,7 @@ void FindReplacePanel::showFindPanel()
     m_findLineEdit->selectAll();
     
     show();
+    onFindTextChanged(); // Restore the match highlights
 }
 
 void FindReplacePanel::showReplacePanel()
@@ -183,12 +227,14 @@ void FindReplacePanel::showReplacePanel()
     m_findLineEdit->selectAll();
     
     show();
+    onFindTextChanged(); // Restore the match highlights
 }
 
 void FindReplacePanel::hidePanels()
 {
     m_findPanelVisible = false;
     m_replacePanelVisible = false;
+    clearSearchHighlight();
     hide();
 }
 
@@ -204,6 +250,11 @@ QString FindReplacePanel::findText() const
 
 void FindReplacePanel::findNext()
 {
+    if (m_allDocumentsCheckBox->isChecked()) {
+        navigateDocumentResults(true);
+        return;
+    }
+    
     if (!m_textEditor || m_findLineEdit->text().isEmpty()) {
         return;
     }
@@ -213,6 +264,11 @@ void FindReplacePanel::findNext()
 
 void FindReplacePanel::findPrevious()
 {
+    if (m_allDocumentsCheckBox->isChecked()) {
+        navigateDocumentResults(false);
+        return;
+    }
+    
     if (!m_textEditor || m_findLineEdit->text().isEmpty()) {
         return;
     }
@@ -222,7 +278,8 @@ void FindReplacePanel::findPrevious()
 
 void FindReplacePanel::replace()
 {
-    if (!m_textEditor || m_findLineEdit->text().isEmpty()) {
+    // Previews and followed files are read-only, but cursors would still edit them
+    if (!m_textEditor || m_textEditor->isReadOnly() || m_findLineEdit->text().isEmpty()) {
         return;
     }
     
@@ -250,150 +307,378 @@ void FindReplacePanel::replace()
 
 void FindReplacePanel::replaceAll()
 {
-    if (!m_textEditor || m_findLineEdit->text().isEmpty()) {
+    if (!m_textEditor || m_textEditor->isReadOnly() || m_findLineEdit->text().isEmpty()) {
         return;
     }
     
-    QTextCursor cursor = m_textEditor->textCursor();
-    cursor.movePosition(QTextCursor::Start);
-    m_textEditor->setTextCursor(cursor);
+    if (!m_searchSession.setPattern(m_findLineEdit->text(), searchOptions())) {
+        m_statusLabel->setText(tr("Invalid regular expression"));
+        return;
+    }
     
-    int replacements = 0;
+    // Matches come from the unmodified snapshot, so replacements are never re-matched
+    const QString snapshot = m_textEditor->plainTextSnapshot();
+    m_searchSession.setText(snapshot);
+    const QVector<SearchSession::Match> matches = m_searchSession.allMatches();
     
-    while (performFind(m_findLineEdit->text(), true)) {
-        QTextCursor currentCursor = m_textEditor->textCursor();
-        if (currentCursor.hasSelection()) {
-            currentCursor.insertText(m_replaceLineEdit->text());
-            replacements++;
-        } else {
-            break;
-        }
+    if (matches.isEmpty()) {
+        m_statusLabel->setText(tr("Replaced %1 occurrence(s)").arg(0));
+        return;
     }
     
-    m_statusLabel->setText(tr("Replaced %1 occurrence(s)").arg(replacements));
+    m_textEditor->replaceMatches(matches, m_replaceLineEdit->text());
+    
+    m_statusLabel->setText(tr("Replaced %1 occurrence(s)").arg(matches.size()));
 }
 
 void FindReplacePanel::onFindTextChanged()
 {
     updateFindButtons();
     
+    // A newer keystroke supersedes any count still running
+    m_matchCounter->cancel();
+    
     if (!m_findLineEdit->text().isEmpty()) {
-        int matches = countMatches(m_findLineEdit->text());
-        if (matches > 0) {
-            m_statusLabel->setText(tr("%1 match(es) found").arg(matches));
-        } else {
-            m_statusLabel->setText(tr("No matches found"));
-        }
+        m_countTimer->start();
     } else {
+        m_countTimer->stop();
         m_statusLabel->clear();
+        clearSearchHighlight();
+    }
+}
+
+void FindReplacePanel::startMatchCount()
+{
+    const QString text = m_findLineEdit->text();
+    if (!m_textEditor || text.isEmpty()) {
+        return;
+    }
+    
+    const SearchOptions options = searchOptions();
+    if (options.useRegex && !TextSearch::compile(text, options).isValid()) {
+        m_statusLabel->setText(tr("Invalid regular expression"));
+        clearSearchHighlight();
+        return;
+    }
+    
+    if (isVisible()) {
+        m_textEditor->setSearchHighlight(text, options);
+        m_highlightedEditor = m_textEditor;
+    }
+    
+    m_statusLabel->setText(tr("Counting..."));
+    m_matchCounter->start(m_textEditor->plainTextSnapshot(), text, options);
+}
+
+void FindReplacePanel::clearSearchHighlight()
+{
+    if (m_highlightedEditor) {
+        m_highlightedEditor->clearSearchHighlight();
+    }
+    m_highlightedEditor = nullptr;
+}
+
+void FindReplacePanel::onMatchCountProgress(int matches)
+{
+    if (matches > 0) {
+        m_statusLabel->setText(tr("%1+ matches so far").arg(matches));
+    }
+}
+
+void FindReplacePanel::onMatchCountFinished(int matches)
+{
+    if (matches > 0) {
+        m_statusLabel->setText(tr("%1 match(es) found").arg(matches));
+    } else {
+        m_statusLabel->setText(tr("No matches found"));
     }
 }
 
 void FindReplacePanel::onOptionsChanged()
 {
+    invalidateDocumentResults();
     onFindTextChanged(); // Refresh match count
 }
 
-void FindReplacePanel::onCloseButtonClicked()
+void FindReplacePanel::onAllDocumentsToggled(bool checked)
 {
-    hidePanels();
+    invalidateDocumentResults();
+    m_resultsTree->setVisible(checked);
+    
+    if (checked && !m_findLineEdit->text().isEmpty()) {
+        startDocumentSearch();
+    }
 }
 
-void FindReplacePanel::updateFindButtons()
+void FindReplacePanel::invalidateDocumentResults()
 {
-    bool hasText = !m_findLineEdit->text().isEmpty();
-    bool hasEditor = (m_textEditor != nullptr);
+    m_documentSearch->cancel();
+    m_documentResultsValid = false;
+    m_resultsTree->clear();
+    m_documentItems.clear();
+}
+
+void FindReplacePanel::startDocumentSearch()
+{
+    const QString text = m_findLineEdit->text();
+    if (!m_tabWidget || text.isEmpty()) {
+        return;
+    }
     
-    m_findNextButton->setEnabled(hasText && hasEditor);
-    m_findPreviousButton->setEnabled(hasText && hasEditor);
-    m_replaceButton->setEnabled(hasText && hasEditor && m_replacePanelVisible);
-    m_replaceAllButton->setEnabled(hasText && hasEditor && m_replacePanelVisible);
+    const SearchOptions options = searchOptions();
+    if (options.useRegex && !TextSearch::compile(text, options).isValid()) {
+        m_statusLabel->setText(tr("Invalid regular expression"));
+        return;
+    }
+    
+    invalidateDocumentResults();
+    
+    // Snapshots are shared with the editors, so taking them copies no text
+    m_searchedEditors.clear();
+    m_searchedSnapshots.clear();
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        TextEditor *editor = m_tabWidget->editorAt(i);
+        if (editor) {
+            m_searchedEditors.append(editor);
+            m_searchedSnapshots.append(editor->plainTextSnapshot());
+        }
+    }
+    
+    m_documentItems.fill(nullptr, m_searchedEditors.size());
+    m_documentMatchCount = 0;
+    m_searchedPattern = text;
+    m_searchedOptions = options;
+    m_documentResultsValid = true;
+    
+    m_statusLabel->setText(tr("Searching %1 document(s)...").arg(m_searchedEditors.size()));
+    m_documentSearch->start(m_searchedSnapshots, text, options);
 }
 
-bool FindReplacePanel::performFind(const QString &text, bool forward)
+bool FindReplacePanel::documentResultsCurrent() const
 {
-    if (!m_textEditor || text.isEmpty()) {
+    if (!m_documentResultsValid || !m_tabWidget) {
         return false;
     }
     
-    QTextDocument::FindFlags flags;
-    
-    if (!forward) {
-        flags |= QTextDocument::FindBackward;
+    const SearchOptions options = searchOptions();
+    if (m_searchedPattern != m_findLineEdit->text()
+        || m_searchedOptions.caseSensitive != options.caseSensitive
+        || m_searchedOptions.wholeWords != options.wholeWords
+        || m_searchedOptions.useRegex != options.useRegex) {
+        return false;
     }
     
-    if (m_caseSensitiveCheckBox->isChecked()) {
-        flags |= QTextDocument::FindCaseSensitively;
+    // Opened tabs or edited documents make the results stale
+    if (m_tabWidget->count() != m_searchedEditors.size()) {
+        return false;
+    }
+    for (int i = 0; i < m_searchedEditors.size(); ++i) {
+        const TextEditor *editor = m_searchedEditors.at(i);
+        if (!editor) {
+            return false;
+        }
+        const QString snapshot = editor->plainTextSnapshot();
+        if (snapshot.constData() != m_searchedSnapshots.at(i).constData()
+            || snapshot.size() != m_searchedSnapshots.at(i).size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FindReplacePanel::onDocumentSearched(const DocumentSearchResult &result)
+{
+    if (result.matches.isEmpty() || result.document < 0 || result.document >= m_documentItems.size()) {
+        return;
     }
     
-    if (m_wholeWordsCheckBox->isChecked()) {
-        flags |= QTextDocument::FindWholeWords;
+    TextEditor *editor = m_searchedEditors.at(result.document);
+    if (!editor) {
+        return;
     }
     
-    QTextCursor cursor;
+    const int tabIndex = m_tabWidget->indexOf(editor);
+    const QString title = tabIndex >= 0 ? m_tabWidget->tabText(tabIndex) : editor->filePath();
+    
+    QTreeWidgetItem *documentItem = new QTreeWidgetItem();
+    documentItem->setText(0, tr("%1 (%2%3)")
+                                 .arg(title)
+                                 .arg(result.matches.size())
+                                 .arg(result.truncated ? QStringLiteral("+") : QString()));
+    documentItem->setData(0, Qt::UserRole, result.document);
+    documentItem->setToolTip(0, editor->filePath());
+    
+    for (const DocumentMatch &match : result.matches) {
+        QTreeWidgetItem *matchItem = new QTreeWidgetItem(documentItem);
+        matchItem->setText(0, QString("%1:%2: %3").arg(match.line).arg(match.column).arg(match.lineText.trimmed()));
+        matchItem->setData(0, Qt::UserRole, result.document);
+        matchItem->setData(0, Qt::UserRole + 1, qlonglong(match.start));
+        matchItem->setData(0, Qt::UserRole + 2, qlonglong(match.length));
+    }
     
-    if (m_useRegexCheckBox->isChecked()) {
-        QRegularExpression regex(text);
-        if (!m_caseSensitiveCheckBox->isChecked()) {
-            regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+    // Documents finish in any order; keep the groups in tab order
+    int position = 0;
+    for (int i = 0; i < result.document; ++i) {
+        if (m_documentItems.at(i)) {
+            ++position;
         }
-        cursor = m_textEditor->document()->find(regex, m_textEditor->textCursor(), flags);
-    } else {
-        cursor = m_textEditor->document()->find(text, m_textEditor->textCursor(), flags);
     }
+    m_resultsTree->insertTopLevelItem(position, documentItem);
+    documentItem->setExpanded(true);
     
-    if (!cursor.isNull()) {
-        m_textEditor->setTextCursor(cursor);
-        return true;
-    } else {
-        // Wrap around search
-        QTextCursor startCursor = m_textEditor->textCursor();
-        startCursor.movePosition(forward ? QTextCursor::Start : QTextCursor::End);
-        
-        if (m_useRegexCheckBox->isChecked()) {
-            QRegularExpression regex(text);
-            if (!m_caseSensitiveCheckBox->isChecked()) {
-                regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
-            }
-            cursor = m_textEditor->document()->find(regex, startCursor, flags);
-        } else {
-            cursor = m_textEditor->document()->find(text, startCursor, flags);
-        }
-        
-        if (!cursor.isNull()) {
-            m_textEditor->setTextCursor(cursor);
-            return true;
-        }
+    m_documentItems[result.document] = documentItem;
+    m_documentMatchCount += int(result.matches.size());
+}
+
+void FindReplacePanel::onDocumentSearchFinished()
+{
+    if (m_documentMatchCount == 0) {
+        m_statusLabel->setText(tr("No matches found"));
+        return;
     }
     
-    return false;
+    m_statusLabel->setText(tr("%1 match(es) in %2 document(s)")
+                               .arg(m_documentMatchCount)
+                               .arg(m_resultsTree->topLevelItemCount()));
+    
+    if (!m_resultsTree->currentItem()) {
+        navigateDocumentResults(true);
+    }
 }
 
-int FindReplacePanel::countMatches(const QString &text)
+void FindReplacePanel::navigateDocumentResults(bool forward)
 {
-    if (!m_textEditor || text.isEmpty()) {
-        return 0;
+    if (m_findLineEdit->text().isEmpty()) {
+        return;
+    }
+    
+    // Results are reused until the pattern or a document changes
+    if (!documentResultsCurrent()) {
+        startDocumentSearch();
+        return;
+    }
+    if (m_documentSearch->isRunning()) {
+        return;
+    }
+    
+    QTreeWidgetItem *current = m_resultsTree->currentItem();
+    QTreeWidgetItem *documentItem = current ? (current->parent() ? current->parent() : current) : nullptr;
+    int group = documentItem ? m_resultsTree->indexOfTopLevelItem(documentItem) : -1;
+    int index = (current && current->parent()) ? documentItem->indexOfChild(current) : -1;
+    
+    const int groupCount = m_resultsTree->topLevelItemCount();
+    if (groupCount == 0) {
+        return;
+    }
+    
+    if (group < 0) {
+        group = forward ? 0 : groupCount - 1;
+        index = forward ? -1 : m_resultsTree->topLevelItem(group)->childCount();
+    }
+    
+    // Step within the group, moving to the neighbouring group at its ends
+    index += forward ? 1 : -1;
+    if (index >= m_resultsTree->topLevelItem(group)->childCount()) {
+        group = (group + 1) % groupCount;
+        index = 0;
+    } else if (index < 0) {
+        group = (group + groupCount - 1) % groupCount;
+        index = m_resultsTree->topLevelItem(group)->childCount() - 1;
     }
     
-    QTextDocument::FindFlags flags;
+    QTreeWidgetItem *next = m_resultsTree->topLevelItem(group)->child(index);
+    m_resultsTree->setCurrentItem(next);
+    showDocumentResult(next);
+}
+
+void FindReplacePanel::onResultItemActivated(QTreeWidgetItem *item)
+{
+    showDocumentResult(item);
+}
+
+void FindReplacePanel::showDocumentResult(QTreeWidgetItem *item)
+{
+    if (!item || !item->parent() || !m_tabWidget) {
+        return;
+    }
     
-    if (m_caseSensitiveCheckBox->isChecked()) {
-        flags |= QTextDocument::FindCaseSensitively;
+    const int document = item->data(0, Qt::UserRole).toInt();
+    TextEditor *editor = m_searchedEditors.value(document);
+    const int tabIndex = editor ? m_tabWidget->indexOf(editor) : -1;
+    if (tabIndex < 0) {
+        m_statusLabel->setText(tr("The document has been closed"));
+        return;
     }
     
-    if (m_wholeWordsCheckBox->isChecked()) {
-        flags |= QTextDocument::FindWholeWords;
+    m_tabWidget->setCurrentIndex(tabIndex);
+    
+    // Positions come from the search snapshot; clamp in case the document was edited since
+    const int lastPosition = editor->document()->characterCount() - 1;
+    const int start = int(qMin(item->data(0, Qt::UserRole + 1).toLongLong(), qlonglong(lastPosition)));
+    const int end = int(qMin(start + item->data(0, Qt::UserRole + 2).toLongLong(), qlonglong(lastPosition)));
+    
+    QTextCursor cursor(editor->document());
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+    editor->setTextCursor(cursor);
+    editor->ensureCursorVisible();
+}
+
+void FindReplacePanel::onCloseButtonClicked()
+{
+    hidePanels();
+}
+
+void FindReplacePanel::updateFindButtons()
+{
+    bool hasText = !m_findLineEdit->text().isEmpty();
+    bool hasEditor = (m_textEditor != nullptr);
+    bool canEdit = hasEditor && !m_textEditor->isReadOnly();
+    
+    m_findNextButton->setEnabled(hasText && hasEditor);
+    m_findPreviousButton->setEnabled(hasText && hasEditor);
+    m_replaceButton->setEnabled(hasText && canEdit && m_replacePanelVisible);
+    m_replaceAllButton->setEnabled(hasText && canEdit && m_replacePanelVisible);
+}
+
+bool FindReplacePanel::performFind(const QString &text, bool forward)
+{
+    if (!m_textEditor || text.isEmpty()) {
+        return false;
     }
     
-    int count = 0;
-    QTextCursor cursor = m_textEditor->document()->find(text, 0, flags);
+    // The session keeps the compiled pattern and the matches found so far
+    // until the pattern, options or document change
+    if (!m_searchSession.setPattern(text, searchOptions())) {
+        m_statusLabel->setText(tr("Invalid regular expression"));
+        return false;
+    }
+    m_searchSession.setText(m_textEditor->plainTextSnapshot());
     
-    while (!cursor.isNull()) {
-        count++;
-        cursor = m_textEditor->document()->find(text, cursor, flags);
+    // Snapshot offsets are document positions
+    const QTextCursor current = m_textEditor->textCursor();
+    const SearchSession::Match match = forward
+        ? m_searchSession.findNext(current.selectionEnd())
+        : m_searchSession.findPrevious(current.selectionStart());
+    
+    if (!match.isValid()) {
+        return false;
     }
     
-    return count;
+    QTextCursor cursor(m_textEditor->document());
+    cursor.setPosition(int(match.start));
+    cursor.setPosition(int(match.start + match.length), QTextCursor::KeepAnchor);
+    m_textEditor->setTextCursor(cursor);
+    return true;
+}
+
+SearchOptions FindReplacePanel::searchOptions() const
+{
+    SearchOptions options;
+    options.caseSensitive = m_caseSensitiveCheckBox->isChecked();
+    options.wholeWords = m_wholeWordsCheckBox->isChecked();
+    options.useRegex = m_useRegexCheckBox->isChecked();
+    return options;
 }
 
 void FindReplacePanel::keyPressEvent(QKeyEvent *event)
@@ -12,8 +12,18 @@
 #include <QKeyEvent>
 #include <QCloseEvent>
 #include <QRegularExpression>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QPointer>
+#include <QVector>
+
+#include "TextSearch.h"
+#include "SearchSession.h"
+#include "DocumentSearch.h"
 
 class TextEditor;
+class TabWidget;
+class MatchCounter;
 
 class FindReplacePanel : public QWidget
 {
@@ -25,6 +35,7 @@ public:
 
     void setTextEditor(TextEditor *editor);
     TextEditor *textEditor() const;
+    void setTabWidget(TabWidget *tabWidget);
     
     void showFindPanel();
     void showReplacePanel();
@@ -52,13 +63,26 @@ protected:
 private slots:
     void onOptionsChanged();
     void onCloseButtonClicked();
+    void startMatchCount();
+    void onMatchCountProgress(int matches);
+    void onMatchCountFinished(int matches);
+    void onAllDocumentsToggled(bool checked);
+    void onDocumentSearched(const DocumentSearchResult &result);
+    void onDocumentSearchFinished();
+    void onResultItemActivated(QTreeWidgetItem *item);
+    void invalidateDocumentResults();
 
 private:
     void setupUI();
     void setupConnections();
     void updateFindButtons();
     bool performFind(const QString &text, bool forward = true);
-    int countMatches(const QString &text);
+    SearchOptions searchOptions() const;
+    void startDocumentSearch();
+    bool documentResultsCurrent() const;
+    void navigateDocumentResults(bool forward);
+    void showDocumentResult(QTreeWidgetItem *item);
+    void clearSearchHighlight();
     
     QLineEdit *m_findLineEdit;
     QLineEdit *m_replaceLineEdit;
@@ -71,12 +95,28 @@ private:
     QCheckBox *m_caseSensitiveCheckBox;
     QCheckBox *m_wholeWordsCheckBox;
     QCheckBox *m_useRegexCheckBox;
+    QCheckBox *m_allDocumentsCheckBox;
     
     QLabel *m_findLabel;
     QLabel *m_replaceLabel;
     QLabel *m_statusLabel;
+    QTreeWidget *m_resultsTree;
     
     TextEditor *m_textEditor;
+    QPointer<TextEditor> m_highlightedEditor;
+    TabWidget *m_tabWidget;
+    MatchCounter *m_matchCounter;
+    SearchSession m_searchSession;
+    QTimer *m_countTimer;
+    
+    DocumentSearch *m_documentSearch;
+    QVector<QPointer<TextEditor>> m_searchedEditors;
+    QVector<QString> m_searchedSnapshots;
+    QVector<QTreeWidgetItem*> m_documentItems;
+    QString m_searchedPattern;
+    SearchOptions m_searchedOptions;
+    bool m_documentResultsValid;
+    int m_documentMatchCount;
     bool m_findPanelVisible;
     bool m_replacePanelVisible;
 };
\ No newline at end of file
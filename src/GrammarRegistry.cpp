@@ -0,0 +1,323 @@
+#include "GrammarRegistry.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <algorithm>
+
+namespace
+{
+
+const quint32 CACHE_MAGIC = 0x4752414d; // "MARG"
+const quint32 CACHE_VERSION = 1;
+
+const char *const BUILTIN_GRAMMAR_PATH = ":/resources/grammars";
+
+struct TokenTypeName
+{
+    const char *name;
+    TokenType type;
+};
+
+const TokenTypeName TOKEN_TYPE_NAMES[] = {
+    { "keyword", TokenType::Keyword },
+    { "class", TokenType::Class },
+    { "comment", TokenType::Comment },
+    { "multiLineComment", TokenType::MultiLineComment },
+    { "string", TokenType::String },
+    { "function", TokenType::Function },
+    { "number", TokenType::Number },
+    { "operator", TokenType::Operator },
+    { "preprocessor", TokenType::Preprocessor },
+    { "tag", TokenType::Tag },
+};
+
+TokenType tokenTypeFromName(const QString &name)
+{
+    for (const TokenTypeName &entry : TOKEN_TYPE_NAMES) {
+        if (name == QLatin1String(entry.name)) {
+            return entry.type;
+        }
+    }
+    return TokenType::None;
+}
+
+QStringList toStringList(const QJsonValue &value)
+{
+    QStringList result;
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue &item : array) {
+        if (item.isString()) {
+            result << item.toString();
+        }
+    }
+    return result;
+}
+
+QStringList definitionFiles()
+{
+    QStringList files;
+    const QStringList directories = {
+        QString::fromLatin1(BUILTIN_GRAMMAR_PATH),
+        QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("grammars")
+    };
+
+    // Built-in grammars come first so that user files override them
+    for (const QString &directory : directories) {
+        QDir dir(directory);
+        const QStringList entries = dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name);
+        for (const QString &entry : entries) {
+            files << dir.filePath(entry);
+        }
+    }
+    return files;
+}
+
+} // namespace
+
+bool Grammar::isKeyword(QStringView word) const
+{
+    auto it = std::lower_bound(keywords.cbegin(), keywords.cend(), word,
+                               [](const QString &keyword, QStringView value) {
+                                   return QStringView(keyword) < value;
+                               });
+    return it != keywords.cend() && QStringView(*it) == word;
+}
+
+GrammarRegistry &GrammarRegistry::instance()
+{
+    static GrammarRegistry registry;
+    return registry;
+}
+
+GrammarRegistry::GrammarRegistry()
+{
+    loadDefinitions();
+}
+
+std::shared_ptr<const Grammar> GrammarRegistry::grammar(const QString &language)
+{
+    const QString name = m_aliases.value(language, language);
+
+    auto compiled = m_compiled.constFind(name);
+    if (compiled != m_compiled.constEnd()) {
+        return compiled.value();
+    }
+
+    auto definition = m_definitions.constFind(name);
+    if (definition == m_definitions.constEnd()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<const Grammar> result = compile(definition.value());
+    m_compiled.insert(name, result);
+    return result;
+}
+
+QString GrammarRegistry::languageForFile(const QString &filePath) const
+{
+    QFileInfo fileInfo(filePath);
+
+    auto byName = m_fileNames.constFind(fileInfo.fileName());
+    if (byName != m_fileNames.constEnd()) {
+        return byName.value();
+    }
+
+    return m_extensions.value(fileInfo.suffix().toLower(), "text");
+}
+
+QStringList GrammarRegistry::languages() const
+{
+    QStringList result = m_definitions.keys();
+    result.sort();
+    return result;
+}
+
+void GrammarRegistry::loadDefinitions()
+{
+    const QStringList files = definitionFiles();
+
+    QHash<QString, QString> stamps;
+    for (const QString &file : files) {
+        stamps.insert(file, sourceStamp(file));
+    }
+
+    // Fast path: every source file is unchanged since the cache was written
+    QFile cacheFile(cacheFilePath());
+    if (cacheFile.open(QIODevice::ReadOnly)) {
+        QDataStream in(&cacheFile);
+        in.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        QHash<QString, QString> cachedStamps;
+        QVector<GrammarDefinition> cachedDefinitions;
+        in >> magic >> version;
+        if (magic == CACHE_MAGIC && version == CACHE_VERSION) {
+            in >> cachedStamps >> cachedDefinitions;
+            if (in.status() == QDataStream::Ok && cachedStamps == stamps) {
+                for (const GrammarDefinition &definition : cachedDefinitions) {
+                    registerDefinition(definition);
+                }
+                return;
+            }
+        }
+    }
+
+    QVector<GrammarDefinition> definitions;
+    for (const QString &file : files) {
+        GrammarDefinition definition;
+        if (parseDefinitionFile(file, definition)) {
+            definitions.append(definition);
+            registerDefinition(definition);
+        }
+    }
+
+    QDir().mkpath(QFileInfo(cacheFilePath()).absolutePath());
+    QSaveFile saveFile(cacheFilePath());
+    if (saveFile.open(QIODevice::WriteOnly)) {
+        QDataStream out(&saveFile);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << CACHE_MAGIC << CACHE_VERSION << stamps << definitions;
+        saveFile.commit();
+    }
+}
+
+bool GrammarRegistry::parseDefinitionFile(const QString &filePath, GrammarDefinition &definition)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject()) {
+        qWarning("Invalid grammar definition %s: %s", qPrintable(filePath), qPrintable(error.errorString()));
+        return false;
+    }
+
+    const QJsonObject root = document.object();
+    definition.name = root.value("name").toString();
+    if (definition.name.isEmpty()) {
+        return false;
+    }
+
+    definition.aliases = toStringList(root.value("aliases"));
+    definition.extensions = toStringList(root.value("extensions"));
+    definition.fileNames = toStringList(root.value("filenames"));
+    definition.keywords = toStringList(root.value("keywords"));
+
+    const QJsonArray rules = root.value("rules").toArray();
+    for (const QJsonValue &value : rules) {
+        const QJsonObject object = value.toObject();
+        GrammarRuleDefinition rule;
+        rule.type = tokenTypeFromName(object.value("type").toString());
+        rule.pattern = object.value("pattern").toString();
+        if (rule.type != TokenType::None && !rule.pattern.isEmpty()) {
+            definition.rules.append(rule);
+        }
+    }
+
+    const QJsonObject blockComment = root.value("blockComment").toObject();
+    definition.blockCommentStart = blockComment.value("start").toString();
+    definition.blockCommentEnd = blockComment.value("end").toString();
+
+    return true;
+}
+
+std::shared_ptr<const Grammar> GrammarRegistry::compile(const GrammarDefinition &definition)
+{
+    auto grammar = std::make_shared<Grammar>();
+    grammar->name = definition.name;
+
+    grammar->keywords = definition.keywords;
+    std::sort(grammar->keywords.begin(), grammar->keywords.end());
+    grammar->keywords.erase(std::unique(grammar->keywords.begin(), grammar->keywords.end()),
+                            grammar->keywords.end());
+
+    for (const GrammarRuleDefinition &ruleDefinition : definition.rules) {
+        HighlightingRule rule;
+        rule.pattern = QRegularExpression(ruleDefinition.pattern);
+        rule.type = ruleDefinition.type;
+        if (!rule.pattern.isValid()) {
+            qWarning("Invalid pattern in grammar %s: %s", qPrintable(definition.name),
+                     qPrintable(rule.pattern.errorString()));
+            continue;
+        }
+        rule.pattern.optimize();
+        grammar->rules.append(rule);
+    }
+    grammar->matcher.build(grammar->rules);
+
+    if (!definition.blockCommentStart.isEmpty() && !definition.blockCommentEnd.isEmpty()) {
+        grammar->blockCommentStart = QRegularExpression(definition.blockCommentStart);
+        grammar->blockCommentEnd = QRegularExpression(definition.blockCommentEnd);
+        grammar->blockCommentStart.optimize();
+        grammar->blockCommentEnd.optimize();
+        grammar->hasBlockComments = grammar->blockCommentStart.isValid() && grammar->blockCommentEnd.isValid();
+    }
+
+    return grammar;
+}
+
+QString GrammarRegistry::sourceStamp(const QString &filePath)
+{
+    QFileInfo fileInfo(filePath);
+    return QString("%1:%2").arg(fileInfo.size()).arg(fileInfo.lastModified().toMSecsSinceEpoch());
+}
+
+QString GrammarRegistry::cacheFilePath()
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(cacheDir).filePath("grammars.bin");
+}
+
+void GrammarRegistry::registerDefinition(const GrammarDefinition &definition)
+{
+    m_definitions.insert(definition.name, definition);
+    m_compiled.remove(definition.name);
+
+    for (const QString &alias : definition.aliases) {
+        m_aliases.insert(alias, definition.name);
+    }
+    for (const QString &extension : definition.extensions) {
+        m_extensions.insert(extension.toLower(), definition.name);
+    }
+    for (const QString &fileName : definition.fileNames) {
+        m_fileNames.insert(fileName, definition.name);
+    }
+}
+
+QDataStream &operator<<(QDataStream &stream, const GrammarRuleDefinition &rule)
+{
+    return stream << quint8(rule.type) << rule.pattern;
+}
+
+QDataStream &operator>>(QDataStream &stream, GrammarRuleDefinition &rule)
+{
+    quint8 type = 0;
+    stream >> type >> rule.pattern;
+    rule.type = TokenType(type);
+    return stream;
+}
+
+QDataStream &operator<<(QDataStream &stream, const GrammarDefinition &definition)
+{
+    return stream << definition.name << definition.aliases << definition.extensions
+                  << definition.fileNames << definition.keywords << definition.rules
+                  << definition.blockCommentStart << definition.blockCommentEnd;
+}
+
+QDataStream &operator>>(QDataStream &stream, GrammarDefinition &definition)
+{
+    return stream >> definition.name >> definition.aliases >> definition.extensions
+                  >> definition.fileNames >> definition.keywords >> definition.rules
+                  >> definition.blockCommentStart >> definition.blockCommentEnd;
+}
@@ -0,0 +1,199 @@
+/**
+ * @file GrammarRegistry.h
+ * @brief Declarative grammar definitions and the registry that compiles them
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QRegularExpression>
+#include <QDataStream>
+#include <memory>
+
+#include "SyntaxHighlighter.h"
+#include "MultiPatternMatcher.h"
+
+/**
+ * @struct GrammarRuleDefinition
+ * @brief A single pattern rule as written in a grammar file
+ */
+struct GrammarRuleDefinition
+{
+    TokenType type;  ///< Token type assigned to matches
+    QString pattern; ///< Regular expression source
+};
+
+/**
+ * @struct GrammarDefinition
+ * @brief Parsed but uncompiled contents of a grammar definition file
+ *
+ * Grammar files are JSON documents of the form:
+ * @code
+ * {
+ *     "name": "cpp",
+ *     "aliases": ["c"],
+ *     "extensions": ["cpp", "h"],
+ *     "filenames": [],
+ *     "keywords": ["if", "while"],
+ *     "rules": [{"type": "comment", "pattern": "//[^\\n]*"}],
+ *     "blockComment": {"start": "<!--", "end": "-->"}
+ * }
+ * @endcode
+ * Keywords are applied first; rules follow in file order, later rules
+ * taking precedence over earlier ones where they overlap.
+ */
+struct GrammarDefinition
+{
+    QString name;                          ///< Language identifier
+    QStringList aliases;                   ///< Alternative language identifiers
+    QStringList extensions;                ///< File extensions (lower case, no dot)
+    QStringList fileNames;                 ///< Exact file names (e.g. ".bashrc")
+    QStringList keywords;                  ///< Words highlighted as keywords
+    QVector<GrammarRuleDefinition> rules;  ///< Pattern rules in priority order
+    QString blockCommentStart;             ///< Block comment opening pattern, if any
+    QString blockCommentEnd;               ///< Block comment closing pattern, if any
+};
+
+/**
+ * @struct Grammar
+ * @brief Compiled, ready-to-run form of a GrammarDefinition
+ *
+ * Keywords are kept as a sorted list and looked up per word with a binary
+ * search instead of running one regular expression per keyword. All
+ * patterns are compiled and JIT-optimized once when the grammar is built,
+ * and the rules are additionally combined into a MultiPatternMatcher so a
+ * line is scanned once rather than once per rule.
+ */
+struct Grammar
+{
+    QString name;                             ///< Language identifier
+    QVector<QString> keywords;                ///< Sorted keyword list
+    QVector<HighlightingRule> rules;          ///< Compiled pattern rules
+    MultiPatternMatcher matcher;              ///< All rules combined into one scan
+    QRegularExpression blockCommentStart;     ///< Block comment opening pattern
+    QRegularExpression blockCommentEnd;       ///< Block comment closing pattern
+    bool hasBlockComments = false;            ///< Whether block comments are defined
+
+    /**
+     * @brief Checks whether a word is a keyword of this grammar
+     * @param word Word to look up
+     * @return true if the word is a keyword
+     */
+    bool isKeyword(QStringView word) const;
+};
+
+/**
+ * @class GrammarRegistry
+ * @brief Discovers, caches and compiles language grammars
+ *
+ * Grammar definitions are read from the built-in ":/resources/grammars"
+ * resource directory and from a "grammars" directory in the user's
+ * application data location, where files override built-ins of the same
+ * name. Adding a language therefore only requires dropping in a new
+ * definition file.
+ *
+ * Parsed definitions are cached in binary form in the application cache
+ * directory, keyed by each source file's size and modification time, so a
+ * normal startup reads one small file instead of parsing JSON. Patterns
+ * are only compiled when a language is first used.
+ *
+ * @see SyntaxHighlighter, Grammar
+ */
+class GrammarRegistry
+{
+public:
+    /**
+     * @brief Gets the application-wide registry
+     * @return Registry instance, loaded on first access
+     */
+    static GrammarRegistry &instance();
+
+    /**
+     * @brief Gets the compiled grammar for a language
+     * @param language Language identifier or alias
+     * @return Compiled grammar, or nullptr for plain text and unknown languages
+     */
+    std::shared_ptr<const Grammar> grammar(const QString &language);
+
+    /**
+     * @brief Detects the language of a file from its name
+     * @param filePath Path of the file
+     * @return Language identifier, or "text" if no grammar claims the file
+     */
+    QString languageForFile(const QString &filePath) const;
+
+    /**
+     * @brief Gets the identifiers of all known languages
+     * @return Sorted list of language identifiers
+     */
+    QStringList languages() const;
+
+private:
+    /**
+     * @brief Constructs the registry and loads grammar definitions
+     */
+    GrammarRegistry();
+
+    /** @brief Loads definitions from the binary cache or the source files */
+    void loadDefinitions();
+
+    /**
+     * @brief Parses a grammar definition file
+     * @param filePath Path of the JSON definition
+     * @param definition Receives the parsed definition
+     * @return true if the file is a valid grammar definition
+     */
+    static bool parseDefinitionFile(const QString &filePath, GrammarDefinition &definition);
+
+    /**
+     * @brief Compiles a definition into an executable grammar
+     * @param definition Parsed definition
+     * @return Compiled grammar with optimized patterns
+     */
+    static std::shared_ptr<const Grammar> compile(const GrammarDefinition &definition);
+
+    /**
+     * @brief Gets the stamp identifying the current version of a source file
+     * @param filePath Path of the definition file
+     * @return Size and modification time combined into one string
+     */
+    static QString sourceStamp(const QString &filePath);
+
+    /** @brief Gets the path of the binary definition cache */
+    static QString cacheFilePath();
+
+    /** @brief Registers a definition's name, aliases and file associations */
+    void registerDefinition(const GrammarDefinition &definition);
+
+    /** @brief Definitions by language identifier */
+    QHash<QString, GrammarDefinition> m_definitions;
+
+    /** @brief Canonical language identifier by alias */
+    QHash<QString, QString> m_aliases;
+
+    /** @brief Language identifier by file extension */
+    QHash<QString, QString> m_extensions;
+
+    /** @brief Language identifier by exact file name */
+    QHash<QString, QString> m_fileNames;
+
+    /** @brief Grammars compiled so far, by language identifier */
+    QHash<QString, std::shared_ptr<const Grammar>> m_compiled;
+};
+
+/** @brief Serializes a grammar rule definition for the binary cache */
+QDataStream &operator<<(QDataStream &stream, const GrammarRuleDefinition &rule);
+
+/** @brief Deserializes a grammar rule definition from the binary cache */
+QDataStream &operator>>(QDataStream &stream, GrammarRuleDefinition &rule);
+
+/** @brief Serializes a grammar definition for the binary cache */
+QDataStream &operator<<(QDataStream &stream, const GrammarDefinition &definition);
+
+/** @brief Deserializes a grammar definition from the binary cache */
+QDataStream &operator>>(QDataStream &stream, GrammarDefinition &definition);
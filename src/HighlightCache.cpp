@@ -0,0 +1,209 @@
+#include "HighlightCache.h"
+
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+
+namespace
+{
+
+const quint32 CACHE_MAGIC = 0x4354484d; // "MHTC"
+const quint32 CACHE_VERSION = 4;
+
+struct CacheHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 blockCount;
+    quint32 spanCount;
+};
+
+const quint32 MAX_SPAN_LENGTH = 0x00ffffff;
+
+} // namespace
+
+HighlightCache::HighlightCache()
+    : m_blocks(nullptr)
+    , m_spans(nullptr)
+    , m_blockCount(0)
+    , m_spanCount(0)
+{
+}
+
+HighlightCache::~HighlightCache()
+{
+    // QFile unmaps all of its mappings when it is closed
+    m_file.close();
+}
+
+std::unique_ptr<HighlightCache> HighlightCache::load(const QTextDocument *document, const QString &language)
+{
+    if (!document || document->blockCount() < MIN_CACHED_BLOCKS || language == "text") {
+        return nullptr;
+    }
+
+    std::unique_ptr<HighlightCache> cache(new HighlightCache());
+    cache->m_file.setFileName(cacheFilePath(document, language));
+    if (!cache->m_file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    const qint64 fileSize = cache->m_file.size();
+    if (fileSize < qint64(sizeof(CacheHeader))) {
+        return nullptr;
+    }
+
+    const uchar *data = cache->m_file.map(0, fileSize);
+    if (!data) {
+        return nullptr;
+    }
+
+    const CacheHeader *header = reinterpret_cast<const CacheHeader *>(data);
+    const qint64 expectedSize = qint64(sizeof(CacheHeader))
+        + qint64(header->blockCount) * qint64(sizeof(BlockRecord))
+        + qint64(header->spanCount) * qint64(sizeof(SpanRecord));
+
+    if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION || fileSize != expectedSize) {
+        return nullptr;
+    }
+
+    cache->m_blockCount = header->blockCount;
+    cache->m_spanCount = header->spanCount;
+    cache->m_blocks = reinterpret_cast<const BlockRecord *>(data + sizeof(CacheHeader));
+    cache->m_spans = reinterpret_cast<const SpanRecord *>(
+        data + sizeof(CacheHeader) + header->blockCount * sizeof(BlockRecord));
+
+    return cache;
+}
+
+bool HighlightCache::store(const QTextDocument *document, const QString &language)
+{
+    if (!document || document->blockCount() < MIN_CACHED_BLOCKS || language == "text") {
+        return false;
+    }
+
+    QVector<BlockRecord> blocks;
+    QVector<SpanRecord> spans;
+    blocks.reserve(document->blockCount());
+
+    for (QTextBlock block = document->firstBlock(); block.isValid(); block = block.next()) {
+        BlockRecord record;
+        record.textHash = hashBlockText(block.text());
+        record.endState = qMax(block.userState(), 0);
+        record.firstSpan = quint32(spans.size());
+        record.spanCount = 0;
+
+        const HighlightBlockData *data = static_cast<const HighlightBlockData *>(block.userData());
+        if (data) {
+            for (const TokenSpan &span : data->spans) {
+                SpanRecord spanRecord;
+                spanRecord.start = span.start;
+                spanRecord.lengthAndType = (span.length & MAX_SPAN_LENGTH) | (quint32(span.type) << 24);
+                spans.append(spanRecord);
+                ++record.spanCount;
+            }
+        }
+
+        blocks.append(record);
+    }
+
+    const QString filePath = cacheFilePath(document, language);
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    CacheHeader header;
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.blockCount = quint32(blocks.size());
+    header.spanCount = quint32(spans.size());
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(blocks.constData()), blocks.size() * sizeof(BlockRecord));
+    file.write(reinterpret_cast<const char *>(spans.constData()), spans.size() * sizeof(SpanRecord));
+
+    if (!file.commit()) {
+        return false;
+    }
+
+    pruneCacheDirectory(QFileInfo(filePath).absolutePath());
+    return true;
+}
+
+quint32 HighlightCache::hashBlockText(QStringView text)
+{
+    quint32 hash = 2166136261u;
+    for (QChar ch : text) {
+        hash ^= ch.unicode();
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+const HighlightCache::BlockRecord *HighlightCache::block(int blockNumber) const
+{
+    if (blockNumber < 0 || quint32(blockNumber) >= m_blockCount) {
+        return nullptr;
+    }
+
+    const BlockRecord *record = &m_blocks[blockNumber];
+    if (quint64(record->firstSpan) + record->spanCount > m_spanCount) {
+        return nullptr;
+    }
+    return record;
+}
+
+int HighlightCache::previousState(int blockNumber) const
+{
+    if (blockNumber <= 0 || quint32(blockNumber) > m_blockCount) {
+        return 0;
+    }
+    return m_blocks[blockNumber - 1].endState;
+}
+
+QVector<TokenSpan> HighlightCache::spans(const BlockRecord &record) const
+{
+    QVector<TokenSpan> result;
+    result.reserve(record.spanCount);
+
+    for (quint32 i = 0; i < record.spanCount; ++i) {
+        const SpanRecord &span = m_spans[record.firstSpan + i];
+        TokenSpan token;
+        token.start = span.start;
+        token.length = span.lengthAndType & MAX_SPAN_LENGTH;
+        token.type = span.lengthAndType >> 24;
+        result.append(token);
+    }
+
+    return result;
+}
+
+QString HighlightCache::cacheFilePath(const QTextDocument *document, const QString &language)
+{
+    // Hash the UTF-16 content directly to avoid an extra encoding pass
+    const QString content = document->toPlainText();
+    const QByteArrayView bytes(reinterpret_cast<const char *>(content.constData()),
+                               content.size() * qsizetype(sizeof(QChar)));
+    const QByteArray key = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1).toHex();
+
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(cacheDir).filePath(QString("highlight/%1-%2.mthc")
+                                   .arg(QString::fromLatin1(key), language));
+}
+
+void HighlightCache::pruneCacheDirectory(const QString &directory)
+{
+    QDir dir(directory);
+    const QFileInfoList entries = dir.entryInfoList(QStringList() << "*.mthc", QDir::Files, QDir::Time);
+
+    for (int i = MAX_ENTRIES; i < entries.size(); ++i) {
+        QFile::remove(entries.at(i).absoluteFilePath());
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * @file HighlightCache.h
+ * @brief Persistent on-disk cache of syntax highlighting results
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QString>
+#include <QFile>
+#include <QVector>
+#include <QStringView>
+#include <memory>
+
+#include "SyntaxHighlighter.h"
+
+class QTextDocument;
+
+/**
+ * @class HighlightCache
+ * @brief Memory-mapped store of per-block lexer states and token spans
+ *
+ * HighlightCache persists the highlighting results of a document so that
+ * reopening a previously seen file can be colored without lexing it again.
+ * Cache files live in the application cache directory and are keyed by the
+ * SHA-1 of the document content and the language identifier.
+ *
+ * File layout (native byte order, naturally aligned):
+ * - Header: magic, format version, block count, span count
+ * - Block table: one BlockRecord per text block
+ * - Span table: packed SpanRecord entries referenced by the block table
+ *
+ * The file is mapped read-only and records are read in place. Each block
+ * record carries a hash of the block text, so blocks edited since the cache
+ * was written are detected and lexed normally.
+ *
+ * @see SyntaxHighlighter, HighlightBlockData
+ */
+class HighlightCache
+{
+public:
+    /**
+     * @struct BlockRecord
+     * @brief Cached lexer result for a single text block
+     */
+    struct BlockRecord
+    {
+        quint32 textHash;   ///< Hash of the block text (see hashBlockText())
+        qint32 endState;    ///< Block state after highlighting
+        quint32 firstSpan;  ///< Index of the first span in the span table
+        quint32 spanCount;  ///< Number of spans belonging to the block
+    };
+
+    /**
+     * @struct SpanRecord
+     * @brief Packed token span: 24-bit length and 8-bit token type
+     */
+    struct SpanRecord
+    {
+        quint32 start;         ///< Offset of the span within its block
+        quint32 lengthAndType; ///< Length in the low 24 bits, TokenType in the high 8 bits
+    };
+
+    /**
+     * @brief Destructor - unmaps and closes the cache file
+     */
+    ~HighlightCache();
+
+    /**
+     * @brief Opens the cache entry for a document, if one exists
+     * @param document Document whose content identifies the entry
+     * @param language Language identifier used for highlighting
+     * @return Mapped cache, or nullptr if there is no valid entry
+     */
+    static std::unique_ptr<HighlightCache> load(const QTextDocument *document, const QString &language);
+
+    /**
+     * @brief Writes the current highlighting results of a document to disk
+     * @param document Fully highlighted document
+     * @param language Language identifier used for highlighting
+     * @return true if the cache entry was written
+     *
+     * Small documents and plain text are not cached. Old entries are pruned
+     * so the cache directory stays bounded.
+     */
+    static bool store(const QTextDocument *document, const QString &language);
+
+    /**
+     * @brief Hashes the text of a block for cache validation
+     * @param text Block text
+     * @return 32-bit FNV-1a hash, stable across runs and machines
+     */
+    static quint32 hashBlockText(QStringView text);
+
+    /**
+     * @brief Gets the cached record for a block
+     * @param blockNumber Zero-based block number
+     * @return Record, or nullptr if the block is outside the cached range
+     */
+    const BlockRecord *block(int blockNumber) const;
+
+    /**
+     * @brief Gets the state a block was lexed with when the cache was written
+     * @param blockNumber Zero-based block number
+     * @return End state of the preceding block, or 0 for the first block
+     */
+    int previousState(int blockNumber) const;
+
+    /**
+     * @brief Decodes the spans referenced by a block record
+     * @param record Block record obtained from block()
+     * @return Token spans in application order
+     */
+    QVector<TokenSpan> spans(const BlockRecord &record) const;
+
+private:
+    /**
+     * @brief Constructs an empty cache; use load() to obtain instances
+     */
+    HighlightCache();
+
+    /**
+     * @brief Builds the cache file path for a document and language
+     * @param document Document whose content identifies the entry
+     * @param language Language identifier
+     * @return Absolute path inside the cache directory
+     */
+    static QString cacheFilePath(const QTextDocument *document, const QString &language);
+
+    /** @brief Removes the least recently written entries above MAX_ENTRIES */
+    static void pruneCacheDirectory(const QString &directory);
+
+    /** @brief Mapped cache file */
+    QFile m_file;
+
+    /** @brief Block table inside the mapping */
+    const BlockRecord *m_blocks;
+
+    /** @brief Span table inside the mapping */
+    const SpanRecord *m_spans;
+
+    /** @brief Number of records in the block table */
+    quint32 m_blockCount;
+
+    /** @brief Number of records in the span table */
+    quint32 m_spanCount;
+
+    /** @brief Documents with fewer blocks are highlighted without caching */
+    static const int MIN_CACHED_BLOCKS = 500;
+
+    /** @brief Maximum number of cache files kept on disk */
+    static const int MAX_ENTRIES = 200;
+};
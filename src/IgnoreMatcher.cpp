@@ -0,0 +1,223 @@
+#include "IgnoreMatcher.h"
+
+namespace
+{
+
+bool hasWildcards(QStringView text)
+{
+    for (const QChar ch : text) {
+        if (ch == QLatin1Char('*') || ch == QLatin1Char('?') || ch == QLatin1Char('[') || ch == QLatin1Char('\\')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+void IgnoreMatcher::addPatterns(const QByteArray &content)
+{
+    for (const QByteArray &line : content.split('\n')) {
+        addPattern(QString::fromUtf8(line));
+    }
+}
+
+bool IgnoreMatcher::isEmpty() const
+{
+    return m_rules.isEmpty();
+}
+
+IgnoreMatcher::Match IgnoreMatcher::match(QStringView relativePath, bool isDirectory) const
+{
+    if (m_rules.isEmpty()) {
+        return Match::None;
+    }
+
+    const QStringView name = relativePath.mid(relativePath.lastIndexOf(QLatin1Char('/')) + 1);
+    int best = -1;
+
+    // Later rules win, so each list is searched from its end
+    const auto consider = [this, &best, isDirectory](const QVector<int> &ids) {
+        for (auto it = ids.crbegin(); it != ids.crend() && *it > best; ++it) {
+            if (!m_rules.at(*it).directoryOnly || isDirectory) {
+                best = *it;
+                return;
+            }
+        }
+    };
+
+    const QString nameString = name.toString();
+    const auto names = m_names.constFind(nameString);
+    if (names != m_names.constEnd()) {
+        consider(names.value());
+    }
+
+    if (!m_extensions.isEmpty()) {
+        for (qsizetype dot = nameString.indexOf(QLatin1Char('.')); dot >= 0;
+             dot = nameString.indexOf(QLatin1Char('.'), dot + 1)) {
+            const auto extensions = m_extensions.constFind(nameString.mid(dot));
+            if (extensions != m_extensions.constEnd()) {
+                consider(extensions.value());
+            }
+        }
+    }
+
+    for (auto it = m_otherRules.crbegin(); it != m_otherRules.crend() && *it > best; ++it) {
+        const Rule &rule = m_rules.at(*it);
+        if ((!rule.directoryOnly || isDirectory) && ruleMatches(rule, relativePath, name)) {
+            best = *it;
+            break;
+        }
+    }
+
+    if (best < 0) {
+        return Match::None;
+    }
+    return m_rules.at(best).negated ? Match::Included : Match::Ignored;
+}
+
+void IgnoreMatcher::addPattern(QString pattern)
+{
+    if (pattern.endsWith(QLatin1Char('\r'))) {
+        pattern.chop(1);
+    }
+
+    // Trailing spaces are dropped unless escaped
+    while (pattern.endsWith(QLatin1Char(' ')) && !pattern.endsWith(QLatin1String("\\ "))) {
+        pattern.chop(1);
+    }
+    if (pattern.isEmpty() || pattern.startsWith(QLatin1Char('#'))) {
+        return;
+    }
+
+    Rule rule;
+    if (pattern.startsWith(QLatin1Char('!'))) {
+        rule.negated = true;
+        pattern.remove(0, 1);
+    } else if (pattern.startsWith(QLatin1String("\\!")) || pattern.startsWith(QLatin1String("\\#"))) {
+        pattern.remove(0, 1);
+    }
+
+    if (pattern.endsWith(QLatin1Char('/'))) {
+        rule.directoryOnly = true;
+        pattern.chop(1);
+    }
+
+    // "**/name" matches at any depth, like a plain name
+    while (pattern.startsWith(QLatin1String("**/"))) {
+        pattern.remove(0, 3);
+        if (pattern.contains(QLatin1Char('/'))) {
+            pattern.prepend(QLatin1String("**/"));
+            break;
+        }
+    }
+
+    rule.anchored = pattern.contains(QLatin1Char('/'));
+    if (pattern.startsWith(QLatin1Char('/'))) {
+        pattern.remove(0, 1);
+    }
+    if (pattern.isEmpty()) {
+        return;
+    }
+
+    const int id = int(m_rules.size());
+    const QStringView body(pattern);
+    if (!hasWildcards(body)) {
+        rule.kind = rule.anchored ? Kind::Path : Kind::Name;
+        rule.literal = pattern;
+    } else if (!rule.anchored && body.startsWith(QLatin1Char('*')) && !hasWildcards(body.mid(1))) {
+        rule.literal = pattern.mid(1);
+        rule.kind = rule.literal.startsWith(QLatin1Char('.')) ? Kind::Extension : Kind::Suffix;
+    } else if (!rule.anchored && body.endsWith(QLatin1Char('*')) && !hasWildcards(body.chopped(1))) {
+        rule.kind = Kind::Prefix;
+        rule.literal = pattern.chopped(1);
+    } else {
+        rule.kind = Kind::Regex;
+        rule.regex = QRegularExpression(globToRegex(body));
+        if (!rule.regex.isValid()) {
+            return;
+        }
+        rule.regex.optimize();
+    }
+
+    if (rule.kind == Kind::Name) {
+        m_names[rule.literal].append(id);
+    } else if (rule.kind == Kind::Extension) {
+        m_extensions[rule.literal].append(id);
+    } else {
+        m_otherRules.append(id);
+    }
+    m_rules.append(rule);
+}
+
+bool IgnoreMatcher::ruleMatches(const Rule &rule, QStringView relativePath, QStringView name)
+{
+    switch (rule.kind) {
+    case Kind::Path:
+        return relativePath == rule.literal;
+    case Kind::Prefix:
+        return name.startsWith(rule.literal);
+    case Kind::Suffix:
+        return name.endsWith(rule.literal);
+    case Kind::Regex:
+        return rule.regex.match(rule.anchored ? relativePath : name).hasMatch();
+    case Kind::Name:
+    case Kind::Extension:
+        break;
+    }
+    return false;
+}
+
+QString IgnoreMatcher::globToRegex(QStringView glob)
+{
+    QString regex = QStringLiteral("\\A");
+    for (qsizetype i = 0; i < glob.size(); ++i) {
+        const QChar ch = glob.at(i);
+        if (ch == QLatin1Char('*')) {
+            const bool doubleStar = i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('*');
+            const bool atComponentStart = i == 0 || glob.at(i - 1) == QLatin1Char('/');
+            if (doubleStar && atComponentStart && i + 2 < glob.size() && glob.at(i + 2) == QLatin1Char('/')) {
+                // "**/": any number of folders, including none
+                regex += QLatin1String("(?:.*/)?");
+                i += 2;
+            } else if (doubleStar && atComponentStart && i + 2 == glob.size()) {
+                // Trailing "/**": everything inside
+                regex += QLatin1String(".*");
+                i += 1;
+            } else {
+                while (i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('*')) {
+                    ++i;
+                }
+                regex += QLatin1String("[^/]*");
+            }
+        } else if (ch == QLatin1Char('?')) {
+            regex += QLatin1String("[^/]");
+        } else if (ch == QLatin1Char('[')) {
+            const qsizetype close = glob.indexOf(QLatin1Char(']'), i + 2);
+            if (close < 0) {
+                regex += QLatin1String("\\[");
+                continue;
+            }
+            QStringView set = glob.mid(i + 1, close - i - 1);
+            regex += QLatin1Char('[');
+            if (set.startsWith(QLatin1Char('!')) || set.startsWith(QLatin1Char('^'))) {
+                regex += QLatin1Char('^');
+                set = set.mid(1);
+            }
+            for (const QChar member : set) {
+                if (member == QLatin1Char('\\') || member == QLatin1Char('[') || member == QLatin1Char(']')) {
+                    regex += QLatin1Char('\\');
+                }
+                regex += member;
+            }
+            regex += QLatin1Char(']');
+            i = close;
+        } else if (ch == QLatin1Char('\\') && i + 1 < glob.size()) {
+            regex += QRegularExpression::escape(glob.mid(++i, 1));
+        } else {
+            regex += QRegularExpression::escape(glob.mid(i, 1));
+        }
+    }
+    regex += QLatin1String("\\z");
+    return regex;
+}
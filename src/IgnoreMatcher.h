@@ -0,0 +1,113 @@
+/**
+ * @file IgnoreMatcher.h
+ * @brief Compiled patterns of one .gitignore style file
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @class IgnoreMatcher
+ * @brief Decides whether paths are ignored by the patterns of one ignore file
+ *
+ * Patterns follow the .gitignore syntax: '*', '?' and character classes
+ * match within one path component, '**' matches across components, a
+ * leading '!' re-includes, a trailing '/' only matches folders, and a
+ * pattern containing a '/' is relative to the folder of the ignore file
+ * rather than matching names at any depth. The last matching pattern wins.
+ *
+ * Patterns are compiled once. Plain names and extensions ("*.o") are
+ * looked up in hash tables, other literal prefixes and suffixes are
+ * compared directly, and only the remaining patterns run as compiled
+ * regular expressions. Patterns are checked from the last one backwards,
+ * and checking stops as soon as no later pattern can win.
+ *
+ * A built matcher is immutable and can be shared between threads.
+ *
+ * @see WorkspaceWalker
+ */
+class IgnoreMatcher
+{
+public:
+    /** @brief Outcome of matching a path */
+    enum class Match {
+        None,    ///< No pattern matches
+        Ignored, ///< The last matching pattern ignores the path
+        Included ///< The last matching pattern is negated
+    };
+
+    /**
+     * @brief Adds the patterns of an ignore file
+     * @param content File content, one pattern per line
+     *
+     * Patterns added later take precedence over earlier ones.
+     */
+    void addPatterns(const QByteArray &content);
+
+    /**
+     * @brief Checks whether any pattern was added
+     * @return true if the matcher never matches
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Matches a path against the patterns
+     * @param relativePath Path relative to the folder of the ignore file
+     * @param isDirectory Whether the path is a folder
+     * @return Outcome of the last matching pattern
+     */
+    Match match(QStringView relativePath, bool isDirectory) const;
+
+private:
+    /** @brief How a pattern is compared */
+    enum class Kind {
+        Name,      ///< Whole name equals the literal (hashed)
+        Extension, ///< Name ends with the literal, which starts with '.' (hashed)
+        Path,      ///< Relative path equals the literal
+        Prefix,    ///< Name starts with the literal
+        Suffix,    ///< Name ends with the literal
+        Regex      ///< Compiled regular expression
+    };
+
+    /**
+     * @brief One compiled pattern
+     */
+    struct Rule
+    {
+        Kind kind = Kind::Name;     ///< How the pattern is compared
+        QString literal;            ///< Literal part, for all kinds but Regex
+        QRegularExpression regex;   ///< Compiled pattern, for Regex
+        bool negated = false;       ///< Whether the pattern re-includes
+        bool directoryOnly = false; ///< Whether the pattern only matches folders
+        bool anchored = false;      ///< Whether the pattern matches the relative path, not the name
+    };
+
+    /** @brief Parses and compiles one pattern line */
+    void addPattern(QString pattern);
+
+    /** @brief Compares a non-hashed rule */
+    static bool ruleMatches(const Rule &rule, QStringView relativePath, QStringView name);
+
+    /** @brief Translates a glob into an anchored regular expression */
+    static QString globToRegex(QStringView glob);
+
+    /** @brief Compiled patterns in file order */
+    QVector<Rule> m_rules;
+
+    /** @brief Rules of kind Name by name */
+    QHash<QString, QVector<int>> m_names;
+
+    /** @brief Rules of kind Extension by extension */
+    QHash<QString, QVector<int>> m_extensions;
+
+    /** @brief Rules of the other kinds, in file order */
+    QVector<int> m_otherRules;
+};
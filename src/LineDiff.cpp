@@ -0,0 +1,146 @@
+#include "LineDiff.h"
+
+#include <QHash>
+#include <QPromise>
+#include <QStringView>
+
+namespace
+{
+
+/**
+ * @brief Splits a text into lines and maps each distinct line to an id
+ */
+QVector<int> internLines(QStringView text, QHash<QStringView, int> &ids)
+{
+    QVector<int> lines;
+    for (const QStringView line : text.split(u'\n')) {
+        const auto it = ids.constFind(line);
+        if (it != ids.constEnd()) {
+            lines.append(it.value());
+        } else {
+            const int id = int(ids.size());
+            ids.insert(line, id);
+            lines.append(id);
+        }
+    }
+    return lines;
+}
+
+} // namespace
+
+QVector<LineDiff::Hunk> LineDiff::compute(QPromise<QVector<Hunk>> &promise, const QString &oldText,
+                                          const QString &newText)
+{
+    QVector<Hunk> hunks;
+    if (oldText == newText) {
+        return hunks;
+    }
+
+    QHash<QStringView, int> ids;
+    const QVector<int> oldLines = internLines(oldText, ids);
+    const QVector<int> newLines = internLines(newText, ids);
+
+    // Skip the common leading and trailing lines
+    int prefix = 0;
+    while (prefix < oldLines.size() && prefix < newLines.size() && oldLines.at(prefix) == newLines.at(prefix)) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < oldLines.size() - prefix && suffix < newLines.size() - prefix
+           && oldLines.at(oldLines.size() - 1 - suffix) == newLines.at(newLines.size() - 1 - suffix)) {
+        ++suffix;
+    }
+
+    const int *a = oldLines.constData() + prefix;
+    const int *b = newLines.constData() + prefix;
+    const int n = int(oldLines.size()) - prefix - suffix;
+    const int m = int(newLines.size()) - prefix - suffix;
+    if (n == 0 && m == 0) {
+        return hunks;
+    }
+
+    // Myers: v[k] is the furthest old line reached on diagonal k = x - y.
+    // The v of each edit distance is kept for walking the path back.
+    const int maxDistance = qMin(n + m, int(MAX_EDIT_DISTANCE));
+    const int offset = maxDistance + 1;
+    QVector<int> v(2 * offset + 1, 0);
+    QVector<QVector<int>> trace;
+    int distance = -1;
+    for (int d = 0; d <= maxDistance && distance < 0; ++d) {
+        if (promise.isCanceled()) {
+            return hunks;
+        }
+
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1]
+                                                                                     : v[offset + k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                ++x;
+                ++y;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                distance = d;
+                break;
+            }
+        }
+        trace.append(v.mid(offset - d, 2 * d + 1));
+    }
+
+    QVector<bool> deleted(n, false);
+    QVector<bool> inserted(m, false);
+    if (distance < 0) {
+        // Too different; replace the whole middle
+        deleted.fill(true);
+        inserted.fill(true);
+    } else {
+        int x = n;
+        int y = m;
+        for (int d = distance; d > 0; --d) {
+            const QVector<int> &previous = trace.at(d - 1);
+            const auto previousX = [&previous, d](int k) { return previous.at(k + d - 1); };
+
+            const int k = x - y;
+            const bool down = (k == -d || (k != d && previousX(k - 1) < previousX(k + 1)));
+            const int previousK = down ? k + 1 : k - 1;
+            const int startX = previousX(previousK);
+            const int startY = startX - previousK;
+            if (down) {
+                inserted[startY] = true;
+            } else {
+                deleted[startX] = true;
+            }
+            x = startX;
+            y = startY;
+        }
+    }
+
+    // Walk both texts together; unmatched runs form the hunks
+    int i = 0;
+    int j = 0;
+    while (i < n || j < m) {
+        if (i < n && j < m && !deleted.at(i) && !inserted.at(j)) {
+            ++i;
+            ++j;
+            continue;
+        }
+
+        Hunk hunk;
+        hunk.oldStart = prefix + i;
+        hunk.newStart = prefix + j;
+        while (i < n && deleted.at(i)) {
+            ++i;
+        }
+        while (j < m && inserted.at(j)) {
+            ++j;
+        }
+        hunk.oldCount = prefix + i - hunk.oldStart;
+        hunk.newCount = prefix + j - hunk.newStart;
+        if (hunk.oldCount == 0 && hunk.newCount == 0) {
+            break; // Cannot happen with a valid edit script
+        }
+        hunks.append(hunk);
+    }
+    return hunks;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file LineDiff.h
+ * @brief Line-based difference between two texts
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+template <typename T> class QPromise;
+
+/**
+ * @class LineDiff
+ * @brief Finds the lines to replace to turn one text into another
+ *
+ * Lines are interned to integers, so equal lines are compared once by
+ * content and then as numbers. The common leading and trailing lines are
+ * skipped, and the rest is compared with Myers' algorithm, which finds a
+ * shortest edit script in O((N + M) D) time for D changed lines. When
+ * the texts differ in more than MAX_EDIT_DISTANCE lines, everything
+ * between the common leading and trailing lines becomes a single hunk.
+ *
+ * Lines are separated by '\n', as in QTextDocument::toPlainText().
+ *
+ * @see TextEditor::reloadText()
+ */
+class LineDiff
+{
+public:
+    /**
+     * @struct Hunk
+     * @brief Consecutive old lines replaced by consecutive new lines
+     */
+    struct Hunk
+    {
+        int oldStart = 0; ///< First replaced line of the old text
+        int oldCount = 0; ///< Number of old lines replaced, 0 for an insertion
+        int newStart = 0; ///< First inserted line of the new text
+        int newCount = 0; ///< Number of new lines inserted, 0 for a deletion
+    };
+
+    /**
+     * @brief Compares two texts; may run on a worker thread
+     * @param promise Polled for cancellation
+     * @param oldText Text to change
+     * @param newText Text to change it into
+     * @return Hunks in increasing line order; empty if the texts are equal
+     */
+    static QVector<Hunk> compute(QPromise<QVector<Hunk>> &promise, const QString &oldText, const QString &newText);
+
+    /** @brief Changed lines beyond which the texts are replaced as a whole */
+    static const int MAX_EDIT_DISTANCE = 2000;
+};
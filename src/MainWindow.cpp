@@ -3,9 +3,14 @@
 #include "TextEditor.h"
 #include "FileExplorer.h"
 #include "FindReplacePanel.h"
+#include "FindInFilesPanel.h"
+#include "TrigramIndex.h"
+#include "PathIndex.h"
+#include "QuickOpenDialog.h"
 #include "SettingsManager.h"
 #include "ThemeManager.h"
 #include "ErrorHandler.h"
+#include "FileClassifier.h"
 
 #include <QApplication>
 #include <QMenuBar>
@@ -25,16 +30,22 @@
 #include <QFileInfo>
 #include <QDateTime>
 #include <QActionGroup>
+#include <QScrollBar>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_tabWidget(nullptr)
     , m_fileExplorer(nullptr)
     , m_findReplacePanel(nullptr)
+    , m_findInFilesPanel(nullptr)
+    , m_trigramIndex(nullptr)
+    , m_pathIndex(nullptr)
+    , m_quickOpenDialog(nullptr)
     , m_settingsManager(nullptr)
     , m_themeManager(nullptr)
     , m_fileExplorerDock(nullptr)
     , m_findReplaceDock(nullptr)
+    , m_findInFilesDock(nullptr)
     , m_recentFilesMenu(nullptr)
     , m_clearRecentFilesAction(nullptr)
     , m_autoSaveTimer(nullptr)
@@ -151,6 +162,23 @@ void MainWindow::openFile(const QString &filePath)
         return;
     }
     
+    // Binary files would only show garbage
+    if (!FileClassifier::isText(filePath)) {
+        QMessageBox::StandardButton result = QMessageBox::question(
+            this,
+            tr("Binary File"),
+            tr("The file '%1' does not appear to be a text file.\n\n"
+               "Do you want to open it anyway?")
+                .arg(fileInfo.fileName()),
+            QMessageBox::Yes | QMessageBox::No,
+            QMessageBox::No
+        );
+        
+        if (result != QMessageBox::Yes) {
+            return;
+        }
+    }
+    
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         bool retry = ErrorHandler::handleFileError(this, filePath, file.errorString(),
@@ -161,18 +189,52 @@ void MainWindow::openFile(const QString &filePath)
         return;
     }
     
-    QTextStream in(&file);
+    const QByteArray data = file.readAll();
+    QTextStream in(data);
     QString content = in.readAll();
     
-    TextEditor *editor = new TextEditor(this);
+    // A previewed file turns its preview tab into a regular tab
+    TextEditor *editor = nullptr;
+    int index = -1;
+    if (m_previewEditor && m_previewEditor->previewPath() == filePath) {
+        editor = m_previewEditor;
+        index = m_tabWidget->indexOf(editor);
+    }
+    
+    int cursorPosition = 0;
+    int scrollPosition = 0;
+    if (index >= 0) {
+        m_previewEditor = nullptr;
+        cursorPosition = editor->textCursor().position();
+        scrollPosition = editor->verticalScrollBar()->value();
+        editor->endPreview();
+    } else {
+        editor = new TextEditor(this);
+    }
+    
     editor->setPlainText(content);
     editor->setFilePath(filePath);
+    editor->setDiskContent(data);
     editor->setModified(false);
     
     // Connect file change detection
     connect(editor, &TextEditor::fileChangedExternally, this, &MainWindow::onFileChangedExternally);
     
-    int index = m_tabWidget->addTab(editor, fileInfo.fileName());
+    if (index >= 0) {
+        // The preview showed the start of the file, so the same place exists
+        QTextCursor cursor = editor->textCursor();
+        cursor.setPosition(qMin(cursorPosition, editor->document()->characterCount() - 1));
+        editor->setTextCursor(cursor);
+        editor->verticalScrollBar()->setValue(scrollPosition);
+        m_tabWidget->updateTabTitle(index);
+        
+        // The panel enables replacing only for editable documents
+        if (m_findReplacePanel && m_tabWidget->currentEditor() == editor) {
+            m_findReplacePanel->setTextEditor(editor);
+        }
+    } else {
+        index = m_tabWidget->addTab(editor, fileInfo.fileName());
+    }
     m_tabWidget->setCurrentIndex(index);
     
     m_settingsManager->addRecentFile(filePath);
@@ -182,6 +244,56 @@ void MainWindow::openFile(const QString &filePath)
     updateActions();
 }
 
+void MainWindow::previewFile(const QString &filePath)
+{
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile()) {
+        return;
+    }
+    
+    // Files already open are shown as they are
+    int index = m_tabWidget->findFile(filePath);
+    if (index >= 0) {
+        m_tabWidget->setCurrentIndex(index);
+        return;
+    }
+    
+    if (!FileClassifier::isText(filePath)) {
+        return;
+    }
+    
+    TextEditor *editor = m_previewEditor;
+    index = editor ? m_tabWidget->indexOf(editor) : -1;
+    if (index >= 0 && editor->previewPath() == filePath) {
+        m_tabWidget->setCurrentIndex(index);
+        return;
+    }
+    
+    if (index < 0) {
+        editor = new TextEditor(this);
+        connect(editor, &TextEditor::promotionRequested, this, &MainWindow::promotePreview);
+        index = m_tabWidget->addTab(editor, fileInfo.fileName());
+        m_previewEditor = editor;
+    }
+    
+    if (!editor->showPreview(filePath)) {
+        statusBar()->showMessage(tr("Cannot preview %1").arg(fileInfo.fileName()), 3000);
+        return;
+    }
+    
+    m_tabWidget->updateTabTitle(index);
+    m_tabWidget->setCurrentIndex(index);
+    updateActions();
+    updateWindowTitle();
+}
+
+void MainWindow::promotePreview()
+{
+    if (m_previewEditor) {
+        openFile(m_previewEditor->previewPath());
+    }
+}
+
 void MainWindow::saveFile()
 {
     TextEditor *editor = m_tabWidget->currentEditor();
@@ -319,6 +431,80 @@ void MainWindow::replace()
     m_findReplacePanel->showReplacePanel();
 }
 
+void MainWindow::quickOpen()
+{
+    if (!m_quickOpenDialog) {
+        m_quickOpenDialog = new QuickOpenDialog(m_pathIndex, this);
+        connect(m_quickOpenDialog, &QuickOpenDialog::fileSelected, this, [this](const QString &filePath) {
+            const int tabIndex = m_tabWidget->findFile(filePath);
+            if (tabIndex >= 0) {
+                m_tabWidget->setCurrentIndex(tabIndex);
+            } else {
+                openFile(filePath);
+            }
+        });
+    }
+    
+    // Pick up files created since the last walk
+    m_pathIndex->refresh(PATH_INDEX_MAX_AGE);
+    
+    QStringList openFiles;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        TextEditor *editor = m_tabWidget->editorAt(i);
+        if (editor && !editor->filePath().isEmpty()) {
+            openFiles.append(editor->filePath());
+        }
+    }
+    m_quickOpenDialog->setPreferredFiles(openFiles, m_settingsManager->loadRecentFiles());
+    m_quickOpenDialog->popup();
+}
+
+void MainWindow::findInFiles()
+{
+    m_findInFilesPanel->setRootPath(m_fileExplorer->rootPath());
+    
+    // Start from the selected text, as editors usually do
+    TextEditor *editor = m_tabWidget->currentEditor();
+    if (editor && editor->textCursor().hasSelection()) {
+        const QString selection = editor->textCursor().selectedText();
+        if (!selection.contains(QChar::ParagraphSeparator)) {
+            m_findInFilesPanel->setFindText(selection);
+        }
+    }
+    
+    m_findInFilesDock->show();
+    m_findInFilesDock->raise();
+    m_findInFilesPanel->focusFindText();
+}
+
+void MainWindow::openSearchResult(const QString &filePath, int line, int column)
+{
+    const QString canonicalPath = QFileInfo(filePath).canonicalFilePath();
+    
+    const int tabIndex = m_tabWidget->findFile(filePath);
+    if (tabIndex >= 0) {
+        m_tabWidget->setCurrentIndex(tabIndex);
+    } else {
+        openFile(filePath);
+    }
+    
+    TextEditor *editor = m_tabWidget->currentEditor();
+    if (!editor || QFileInfo(editor->filePath()).canonicalFilePath() != canonicalPath) {
+        return; // Opening failed or was declined
+    }
+    
+    const QTextBlock block = editor->document()->findBlockByNumber(line - 1);
+    if (!block.isValid()) {
+        return;
+    }
+    
+    QTextCursor cursor(block);
+    cursor.setPosition(block.position() + qMin(column - 1, block.length() - 1));
+    editor->setTextCursor(cursor);
+    editor->ensureCursorVisible();
+    editor->setFocus();
+}
+
 void MainWindow::zoomIn()
 {
     TextEditor *editor = m_tabWidget->currentEditor();
@@ -361,6 +547,19 @@ void MainWindow::toggleLineNumbers()
     }
 }
 
+void MainWindow::toggleFollowMode()
+{
+    TextEditor *editor = m_tabWidget->currentEditor();
+    if (!editor) {
+        return;
+    }
+    
+    if (!editor->setFollowMode(m_followAction->isChecked(), m_settingsManager->loadFollowMaxLines())) {
+        m_followAction->setChecked(false);
+        statusBar()->showMessage(tr("Save the file before following it"), 3000);
+    }
+}
+
 void MainWindow::toggleSessionRestore()
 {
     bool enabled = !m_settingsManager->loadRestoreSession();
@@ -368,6 +567,30 @@ void MainWindow::toggleSessionRestore()
     m_sessionRestoreAction->setChecked(enabled);
 }
 
+void MainWindow::toggleSearchIndex()
+{
+    bool enabled = !m_settingsManager->loadSearchIndexing();
+    m_settingsManager->saveSearchIndexing(enabled);
+    m_searchIndexAction->setChecked(enabled);
+    
+    // An empty root path stops indexing
+    m_trigramIndex->setRootPath(enabled ? m_fileExplorer->rootPath() : QString());
+}
+
+void MainWindow::onExplorerRootPathChanged(const QString &path)
+{
+    m_pathIndex->setRootPath(path);
+    
+    if (m_settingsManager->loadSearchIndexing()) {
+        m_trigramIndex->setRootPath(path);
+    }
+}
+
+void MainWindow::onSearchIndexReady(int fileCount)
+{
+    statusBar()->showMessage(tr("Search index ready: %1 files").arg(fileCount), 3000);
+}
+
 void MainWindow::setLightTheme()
 {
     if (m_themeManager) {
@@ -494,25 +717,16 @@ void MainWindow::onFileChangedExternally(const QString &filePath)
         // Reload the file
         QFile file(filePath);
         if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream in(&file);
+            const QByteArray data = file.readAll();
+            QTextStream in(data);
             QString content = in.readAll();
             
-            // Save cursor position
-            QTextCursor cursor = editor->textCursor();
-            int position = cursor.position();
-            
-            // Reload content
-            editor->setPlainText(content);
-            editor->setModified(false);
-            m_tabWidget->setTabModified(tabIndex, false);
-            
-            // Restore cursor position (if still valid)
-            cursor = editor->textCursor();
-            cursor.setPosition(qMin(position, editor->document()->characterCount()));
-            editor->setTextCursor(cursor);
+            // Apply only the changed lines; the editor marks itself unmodified
+            editor->reloadText(content);
             
             // Re-add to file watcher
             editor->setFilePath(filePath);
+            editor->setDiskContent(data);
         } else {
             ErrorHandler::handleFileError(this, filePath, file.errorString(),
                                         ErrorHandler::FileOperation::Opening);
@@ -527,6 +741,11 @@ void MainWindow::setupUI()
     
     connect(m_tabWidget, &TabWidget::currentChanged, this, &MainWindow::onTabChanged);
     connect(m_tabWidget, &TabWidget::tabCloseRequested, this, &MainWindow::onTabCloseRequested);
+    connect(m_tabWidget->tabBar(), &QTabBar::tabBarDoubleClicked, this, [this](int index) {
+        if (index >= 0 && m_previewEditor && m_tabWidget->editorAt(index) == m_previewEditor) {
+            promotePreview();
+        }
+    });
 }
 
 void MainWindow::setupMenuBar()
@@ -537,6 +756,7 @@ void MainWindow::setupMenuBar()
     QMenu *fileMenu = menuBar->addMenu(tr("&File"));
     fileMenu->addAction(m_newAction);
     fileMenu->addAction(m_openAction);
+    fileMenu->addAction(m_quickOpenAction);
     
     // Recent Files submenu
     m_recentFilesMenu = fileMenu->addMenu(tr("Recent &Files"));
@@ -575,6 +795,8 @@ void MainWindow::setupMenuBar()
     editMenu->addSeparator();
     editMenu->addAction(m_findAction);
     editMenu->addAction(m_replaceAction);
+    editMenu->addAction(m_findInFilesAction);
+    editMenu->addAction(m_searchIndexAction);
     
     // View Menu
     QMenu *viewMenu = menuBar->addMenu(tr("&View"));
@@ -584,6 +806,7 @@ void MainWindow::setupMenuBar()
     viewMenu->addSeparator();
     viewMenu->addAction(m_wordWrapAction);
     viewMenu->addAction(m_lineNumbersAction);
+    viewMenu->addAction(m_followAction);
     viewMenu->addSeparator();
     
     // Theme submenu
@@ -632,12 +855,38 @@ void MainWindow::setupDockWidgets()
     
     // Find/Replace Panel
     m_findReplacePanel = new FindReplacePanel(this);
+    m_findReplacePanel->setTabWidget(m_tabWidget);
     m_findReplaceDock = new QDockWidget(tr("Find and Replace"), this);
     m_findReplaceDock->setWidget(m_findReplacePanel);
     addDockWidget(Qt::BottomDockWidgetArea, m_findReplaceDock);
     m_findReplaceDock->hide();
     
+    // Find in Files Panel
+    m_findInFilesPanel = new FindInFilesPanel(this);
+    m_findInFilesDock = new QDockWidget(tr("Find in Files"), this);
+    m_findInFilesDock->setWidget(m_findInFilesPanel);
+    addDockWidget(Qt::BottomDockWidgetArea, m_findInFilesDock);
+    tabifyDockWidget(m_findReplaceDock, m_findInFilesDock);
+    m_findInFilesDock->hide();
+    
+    connect(m_findInFilesPanel, &FindInFilesPanel::resultActivated, this, &MainWindow::openSearchResult);
+    
+    // Search index for the explorer folder, built in the background when enabled
+    m_trigramIndex = new TrigramIndex(this);
+    m_findInFilesPanel->setTrigramIndex(m_trigramIndex);
+    m_findInFilesPanel->setTabWidget(m_tabWidget);
+    connect(m_trigramIndex, &TrigramIndex::indexReady, this, &MainWindow::onSearchIndexReady);
+    connect(m_fileExplorer, &FileExplorer::rootPathChanged, this, &MainWindow::onExplorerRootPathChanged);
+    
+    // Path index for quick open and the explorer filter, always built in the background
+    m_pathIndex = new PathIndex(this);
+    m_pathIndex->setRootPath(m_fileExplorer->rootPath());
+    m_fileExplorer->setPathIndex(m_pathIndex);
+    if (m_settingsManager->loadSearchIndexing()) {
+        m_trigramIndex->setRootPath(m_fileExplorer->rootPath());
+    }
     connect(m_fileExplorer, &FileExplorer::fileDoubleClicked, this, QOverload<const QString&>::of(&MainWindow::openFile));
+    connect(m_fileExplorer, &FileExplorer::fileSelected, this, &MainWindow::previewFile);
 }
 
 void MainWindow::createActions()
@@ -652,6 +901,11 @@ void MainWindow::createActions()
     m_openAction->setStatusTip(tr("Open an existing file"));
     connect(m_openAction, &QAction::triggered, this, QOverload<>::of(&MainWindow::openFile));
     
+    m_quickOpenAction = new QAction(tr("&Quick Open..."), this);
+    m_quickOpenAction->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_P));
+    m_quickOpenAction->setStatusTip(tr("Open a file below the file explorer folder by name"));
+    connect(m_quickOpenAction, &QAction::triggered, this, &MainWindow::quickOpen);
+    
     m_saveAction = new QAction(tr("&Save"), this);
     m_saveAction->setShortcut(QKeySequence::Save);
     m_saveAction->setStatusTip(tr("Save the document to disk"));
@@ -721,6 +975,17 @@ void MainWindow::createActions()
     m_replaceAction->setStatusTip(tr("Find and replace text"));
     connect(m_replaceAction, &QAction::triggered, this, &MainWindow::replace);
     
+    m_findInFilesAction = new QAction(tr("Find in &Files..."), this);
+    m_findInFilesAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F));
+    m_findInFilesAction->setStatusTip(tr("Search the files below the file explorer folder"));
+    connect(m_findInFilesAction, &QAction::triggered, this, &MainWindow::findInFiles);
+    
+    m_searchIndexAction = new QAction(tr("&Index Folder for Fast Search"), this);
+    m_searchIndexAction->setCheckable(true);
+    m_searchIndexAction->setChecked(m_settingsManager->loadSearchIndexing());
+    m_searchIndexAction->setStatusTip(tr("Keep a search index of the file explorer folder to speed up Find in Files"));
+    connect(m_searchIndexAction, &QAction::triggered, this, &MainWindow::toggleSearchIndex);
+    
     m_zoomInAction = new QAction(tr("Zoom &In"), this);
     m_zoomInAction->setShortcut(QKeySequence::ZoomIn);
     m_zoomInAction->setStatusTip(tr("Zoom in"));
@@ -747,6 +1012,11 @@ void MainWindow::createActions()
     m_lineNumbersAction->setStatusTip(tr("Toggle line numbers"));
     connect(m_lineNumbersAction, &QAction::triggered, this, &MainWindow::toggleLineNumbers);
     
+    m_followAction = new QAction(tr("&Follow File"), this);
+    m_followAction->setCheckable(true);
+    m_followAction->setStatusTip(tr("Show lines appended to the file as they arrive"));
+    connect(m_followAction, &QAction::triggered, this, &MainWindow::toggleFollowMode);
+    
     m_sessionRestoreAction = new QAction(tr("&Restore Session on Startup"), this);
     m_sessionRestoreAction->setCheckable(true);
     m_sessionRestoreAction->setChecked(m_settingsManager->loadRestoreSession());
@@ -799,24 +1069,30 @@ void MainWindow::updateActions()
         canRedo = editor->document()->isRedoAvailable();
     }
     
-    m_saveAction->setEnabled(hasEditor);
-    m_saveAsAction->setEnabled(hasEditor);
+    // A preview holds only part of its file, so it is not saved or edited
+    bool isPreview = hasEditor && m_tabWidget->currentEditor()->isPreview();
+    
+    m_saveAction->setEnabled(hasEditor && !isPreview);
+    m_saveAsAction->setEnabled(hasEditor && !isPreview);
     m_closeTabAction->setEnabled(hasEditor);
     
     m_undoAction->setEnabled(canUndo);
     m_redoAction->setEnabled(canRedo);
-    m_cutAction->setEnabled(hasSelection);
+    m_cutAction->setEnabled(hasSelection && !isPreview);
     m_copyAction->setEnabled(hasSelection);
-    m_pasteAction->setEnabled(hasEditor);
+    m_pasteAction->setEnabled(hasEditor && !isPreview);
     m_selectAllAction->setEnabled(hasEditor);
     
     m_findAction->setEnabled(hasEditor);
-    m_replaceAction->setEnabled(hasEditor);
+    m_replaceAction->setEnabled(hasEditor && !isPreview);
     m_zoomInAction->setEnabled(hasEditor);
     m_zoomOutAction->setEnabled(hasEditor);
     m_resetZoomAction->setEnabled(hasEditor);
     m_wordWrapAction->setEnabled(hasEditor);
     m_lineNumbersAction->setEnabled(hasEditor);
+    TextEditor *currentEditor = m_tabWidget->currentEditor();
+    m_followAction->setEnabled(currentEditor && !currentEditor->filePath().isEmpty());
+    m_followAction->setChecked(currentEditor && currentEditor->isFollowMode());
     
     m_saveAllAction->setEnabled(m_tabWidget->hasUnsavedChanges());
     m_closeAllTabsAction->setEnabled(m_tabWidget->count() > 0);
@@ -828,7 +1104,8 @@ void MainWindow::updateWindowTitle()
     TextEditor *editor = m_tabWidget->currentEditor();
     
     if (editor) {
-        QString fileName = editor->filePath().isEmpty() ? "Untitled" : QFileInfo(editor->filePath()).fileName();
+        QString filePath = editor->isPreview() ? editor->previewPath() : editor->filePath();
+        QString fileName = filePath.isEmpty() ? "Untitled" : QFileInfo(filePath).fileName();
         if (editor->isModified()) {
             fileName += " *";
         }
@@ -901,6 +1178,11 @@ bool MainWindow::saveDocument(int index)
         return false;
     }
     
+    // A followed file mirrors the disk, possibly only its last lines
+    if (editor->isFollowMode()) {
+        return true;
+    }
+    
     QString filePath = editor->filePath();
     
     // Validate file path
@@ -931,10 +1213,18 @@ bool MainWindow::saveDocument(int index)
     }
     
     QTextStream out(&file);
-    out << editor->toPlainText();
+    out << content;
+    out.flush();
     
+    // QTextStream writes UTF-8, so the encoded text is what reading the file back yields
+    editor->setDiskContent(content.toUtf8());
     editor->setModified(false);
     m_tabWidget->setTabModified(index, false);
+    editor->saveHighlightCache();
+    
+    if (m_trigramIndex) {
+        m_trigramIndex->fileChanged(editor->filePath());
+    }
     
     m_settingsManager->addRecentFile(editor->filePath());
     updateRecentFileActions();
@@ -990,10 +1280,12 @@ void MainWindow::restoreSession()
             // Restore saved file
             QFile file(tabData.filePath);
             if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                QTextStream in(&file);
+                const QByteArray data = file.readAll();
+                QTextStream in(data);
                 QString content = in.readAll();
                 editor->setPlainText(content);
                 editor->setFilePath(tabData.filePath);
+                editor->setDiskContent(data);
                 editor->setModified(false);
                 
                 QFileInfo fileInfo(tabData.filePath);
@@ -1041,6 +1333,17 @@ SessionData MainWindow::getCurrentSession() const
         TextEditor *editor = m_tabWidget->editorAt(i);
         if (!editor) continue;
         
+        // The preview tab is not restored; later tabs move down by one
+        if (editor->isPreview()) {
+            if (i == m_tabWidget->currentIndex()) {
+                // Select the tab before it, or the first one if it came first
+                sessionData.currentTabIndex = qMax(int(sessionData.tabs.size()) - 1, 0);
+            } else if (i < m_tabWidget->currentIndex()) {
+                --sessionData.currentTabIndex;
+            }
+            continue;
+        }
+        
         SessionTab tab;
         tab.filePath = editor->filePath();
         tab.content = editor->toPlainText();
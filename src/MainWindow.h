@@ -21,6 +21,7 @@
 #include <QCloseEvent>
 #include <QSettings>
 #include <QTimer>
+#include <QPointer>
 #include <memory>
 
 #include "SettingsManager.h"
@@ -29,6 +30,10 @@ class TabWidget;
 class TextEditor;
 class FileExplorer;
 class FindReplacePanel;
+class FindInFilesPanel;
+class TrigramIndex;
+class PathIndex;
+class QuickOpenDialog;
 class ThemeManager;
 
 /**
@@ -94,6 +99,22 @@ private slots:
      */
     void openFile(const QString &filePath);
     
+    /**
+     * @brief Shows a file in the preview tab
+     * @param filePath Path of the file selected in the explorer
+     * 
+     * The preview tab is reused for every file previewed, shows only the
+     * start of the file and does not watch it or add it to the recent
+     * files. Files already open are switched to instead.
+     */
+    void previewFile(const QString &filePath);
+    
+    /** @brief Turns the preview tab into a regular tab with the whole file */
+    void promotePreview();
+    
+    /** @brief Opens the quick open palette for the file explorer root */
+    void quickOpen();
+    
     /** @brief Saves the current document */
     void saveFile();
     
@@ -136,6 +157,19 @@ private slots:
     /** @brief Opens the find and replace panel */
     void replace();
     
+    /** @brief Opens the find in files panel for the file explorer root */
+    void findInFiles();
+    
+    /**
+     * @brief Opens a find in files result
+     * @param filePath File containing the match
+     * @param line Line of the match (1-based)
+     * @param column Column of the match (1-based)
+     * 
+     * Switches to the file's tab if it is already open.
+     */
+    void openSearchResult(const QString &filePath, int line, int column);
+    
     /** @brief Increases font size in current editor */
     void zoomIn();
     
@@ -151,9 +185,27 @@ private slots:
     /** @brief Toggles line number visibility in current editor */
     void toggleLineNumbers();
     
+    /** @brief Toggles following the file of the current editor as it grows */
+    void toggleFollowMode();
+    
     /** @brief Toggles session restore functionality on/off */
     void toggleSessionRestore();
     
+    /** @brief Toggles indexing of the file explorer folder for fast searching */
+    void toggleSearchIndex();
+    
+    /**
+     * @brief Follows the file explorer to a new folder
+     * @param path New root folder of the file explorer
+     */
+    void onExplorerRootPathChanged(const QString &path);
+    
+    /**
+     * @brief Reports a finished search index
+     * @param fileCount Number of indexed files
+     */
+    void onSearchIndexReady(int fileCount);
+    
     /** @brief Switches to light theme */
     void setLightTheme();
     
@@ -290,6 +342,18 @@ private:
     /** @brief Find and replace panel for text search operations */
     FindReplacePanel *m_findReplacePanel;
     
+    /** @brief Find in files panel for searching the explorer root */
+    FindInFilesPanel *m_findInFilesPanel;
+    
+    /** @brief Trigram index of the explorer root, used when indexing is enabled */
+    TrigramIndex *m_trigramIndex;
+    
+    /** @brief Path index of the explorer root, used by quick open */
+    PathIndex *m_pathIndex;
+    
+    /** @brief Quick open palette, created on first use */
+    QuickOpenDialog *m_quickOpenDialog;
+    
     /** @brief Settings manager for persistent configuration */
     SettingsManager *m_settingsManager;
     
@@ -303,6 +367,9 @@ private:
     /** @brief Dock widget container for find/replace panel */
     QDockWidget *m_findReplaceDock;
     
+    /** @brief Dock widget container for find in files panel */
+    QDockWidget *m_findInFilesDock;
+    
     // File Menu Actions
     /** @brief Action for creating new files */
     QAction *m_newAction;
@@ -310,6 +377,9 @@ private:
     /** @brief Action for opening existing files */
     QAction *m_openAction;
     
+    /** @brief Action for opening a file by fuzzy name search */
+    QAction *m_quickOpenAction;
+    
     /** @brief Action for saving current file */
     QAction *m_saveAction;
     
@@ -353,6 +423,12 @@ private:
     /** @brief Action for find and replace operation */
     QAction *m_replaceAction;
     
+    /** @brief Action for find in files operation */
+    QAction *m_findInFilesAction;
+    
+    /** @brief Action for toggling the search index */
+    QAction *m_searchIndexAction;
+    
     // View Menu Actions
     /** @brief Action for zooming in */
     QAction *m_zoomInAction;
@@ -369,6 +445,9 @@ private:
     /** @brief Action for toggling line numbers */
     QAction *m_lineNumbersAction;
     
+    /** @brief Action for following the current file as it grows */
+    QAction *m_followAction;
+    
     /** @brief Action for toggling session restore functionality */
     QAction *m_sessionRestoreAction;
     
@@ -409,10 +488,16 @@ private:
     /** @brief Timer for memory usage monitoring */
     QTimer *m_memoryCheckTimer;
     
+    /** @brief Editor of the preview tab, if one is open */
+    QPointer<TextEditor> m_previewEditor;
+    
     // Constants
     /** @brief Maximum number of recent files to remember */
     static const int MAX_RECENT_FILES = 10;
     
     /** @brief Auto-save interval in milliseconds (30 seconds) */
     static const int AUTO_SAVE_INTERVAL = 30000;
+    
+    /** @brief Age in milliseconds after which quick open walks the folder again (1 minute) */
+    static const int PATH_INDEX_MAX_AGE = 60000;
 };
\ No newline at end of file
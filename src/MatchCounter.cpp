@@ -0,0 +1,94 @@
+#include "MatchCounter.h"
+
+#include <QPromise>
+#include <QThreadPool>
+#include <memory>
+
+MatchCounter::MatchCounter(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<int>::resultReadyAt, this, &MatchCounter::onResultReady);
+    connect(&m_watcher, &QFutureWatcher<int>::finished, this, &MatchCounter::onFinished);
+}
+
+MatchCounter::~MatchCounter()
+{
+    cancel();
+}
+
+void MatchCounter::start(const QString &text, const QString &pattern, const SearchOptions &options)
+{
+    cancel();
+
+    auto promise = std::make_shared<QPromise<int>>();
+    m_watcher.setFuture(promise->future());
+
+    QThreadPool::globalInstance()->start([promise, text, pattern, options]() {
+        promise->start();
+        count(*promise, text, pattern, options);
+        promise->finish();
+    });
+}
+
+void MatchCounter::cancel()
+{
+    if (!m_watcher.isFinished()) {
+        m_watcher.cancel();
+    }
+}
+
+void MatchCounter::onResultReady(int index)
+{
+    emit progress(m_watcher.resultAt(index));
+}
+
+void MatchCounter::onFinished()
+{
+    const QFuture<int> future = m_watcher.future();
+    if (future.isCanceled() || future.resultCount() == 0) {
+        return;
+    }
+    emit finished(future.resultAt(future.resultCount() - 1));
+}
+
+void MatchCounter::count(QPromise<int> &promise, const QString &text, const QString &pattern,
+                         const SearchOptions &options)
+{
+    int matches = 0;
+
+    if (options.useRegex) {
+        const QRegularExpression expression = TextSearch::compile(pattern, options);
+        QRegularExpressionMatchIterator matchIterator = expression.globalMatch(text);
+        while (matchIterator.hasNext()) {
+            if (promise.isCanceled()) {
+                return;
+            }
+            // Empty matches cannot be selected, so they are not counted
+            if (matchIterator.next().capturedLength() > 0 && ++matches % REGEX_REPORT_INTERVAL == 0) {
+                promise.addResult(matches);
+            }
+        }
+        promise.addResult(matches);
+        return;
+    }
+
+    // Scan in chunks so cancellation is noticed even when matches are rare
+    const LiteralSearcher searcher(pattern, options);
+    const QStringView haystack(text);
+    qsizetype position = 0;
+    while (position < haystack.size()) {
+        if (promise.isCanceled()) {
+            return;
+        }
+
+        const qsizetype limit = qMin(haystack.size(), position + qsizetype(CHUNK_SIZE));
+        qsizetype match = 0;
+        while ((match = searcher.find(haystack, position, limit)) >= 0) {
+            ++matches;
+            position = match + searcher.length();
+        }
+        position = qMax(position, limit);
+        promise.addResult(matches);
+    }
+    promise.addResult(matches);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file MatchCounter.h
+ * @brief Background counting of search matches
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+
+#include "TextSearch.h"
+
+template <typename T> class QPromise;
+
+/**
+ * @class MatchCounter
+ * @brief Counts the matches of a search pattern on a worker thread
+ *
+ * Counting runs on the global thread pool against a text snapshot, so the
+ * GUI stays responsive while large documents are scanned. Partial counts
+ * are reported as the scan proceeds. Starting a new count cancels the one
+ * in progress, and results of a cancelled count are never reported.
+ *
+ * @see FindReplacePanel, TextSearch
+ */
+class MatchCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle counter
+     * @param parent Parent object
+     */
+    explicit MatchCounter(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor - cancels a count in progress
+     */
+    ~MatchCounter();
+
+    /**
+     * @brief Starts counting, cancelling any count in progress
+     * @param text Text snapshot to search
+     * @param pattern Search pattern (must be valid for regex searches)
+     * @param options Search options
+     */
+    void start(const QString &text, const QString &pattern, const SearchOptions &options);
+
+    /**
+     * @brief Cancels the count in progress, if any
+     */
+    void cancel();
+
+signals:
+    /**
+     * @brief Emitted periodically while counting
+     * @param matches Matches found so far
+     */
+    void progress(int matches);
+
+    /**
+     * @brief Emitted when a count completes without being cancelled
+     * @param matches Total number of matches
+     */
+    void finished(int matches);
+
+private slots:
+    /** @brief Forwards a partial count from the worker */
+    void onResultReady(int index);
+
+    /** @brief Forwards the final count from the worker */
+    void onFinished();
+
+private:
+    /**
+     * @brief Counts matches; runs on a worker thread
+     * @param promise Receives partial and final counts; polled for cancellation
+     * @param text Text snapshot to search
+     * @param pattern Search pattern
+     * @param options Search options
+     */
+    static void count(QPromise<int> &promise, const QString &text, const QString &pattern,
+                      const SearchOptions &options);
+
+    /** @brief Watches the count in progress */
+    QFutureWatcher<int> m_watcher;
+
+    /** @brief Characters scanned between cancellation checks in literal searches */
+    static const int CHUNK_SIZE = 1 << 20;
+
+    /** @brief Regex matches found between progress reports */
+    static const int REGEX_REPORT_INTERVAL = 1000;
+};
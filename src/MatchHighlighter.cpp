@@ -0,0 +1,319 @@
+#include "MatchHighlighter.h"
+
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QPromise>
+#include <QThreadPool>
+#include <algorithm>
+
+MatchHighlighter::MatchHighlighter(QTextDocument *document, QObject *parent)
+    : QObject(parent)
+    , m_document(document)
+    , m_active(false)
+    , m_scanPending(false)
+    , m_scanOutdated(false)
+    , m_histogramValid(false)
+    , m_histogramBlockCount(0)
+{
+    connect(m_document, &QTextDocument::contentsChange, this, &MatchHighlighter::onContentsChange);
+    connect(&m_scanWatcher, &QFutureWatcher<QVector<SearchSession::Match>>::finished,
+            this, &MatchHighlighter::onScanFinished);
+}
+
+MatchHighlighter::~MatchHighlighter()
+{
+    if (!m_scanWatcher.isFinished()) {
+        m_scanWatcher.cancel();
+    }
+}
+
+void MatchHighlighter::setPattern(const QString &pattern, const SearchOptions &options, const QString &text)
+{
+    if (m_active && pattern == m_pattern && options.caseSensitive == m_options.caseSensitive
+        && options.wholeWords == m_options.wholeWords && options.useRegex == m_options.useRegex) {
+        return;
+    }
+
+    clear();
+    m_pattern = pattern;
+    m_options = options;
+
+    if (pattern.isEmpty()) {
+        return;
+    }
+
+    if (options.useRegex) {
+        m_expression = TextSearch::compile(pattern, options);
+        if (!m_expression.isValid()) {
+            return;
+        }
+    } else {
+        m_literal.reset(new LiteralSearcher(pattern, options));
+    }
+
+    m_active = true;
+    startScan(text);
+}
+
+void MatchHighlighter::rescan(const QString &text)
+{
+    if (m_active) {
+        startScan(text);
+    }
+}
+
+void MatchHighlighter::clear()
+{
+    const bool hadMatches = !m_matches.isEmpty();
+
+    if (!m_scanWatcher.isFinished()) {
+        m_scanWatcher.cancel();
+    }
+    m_scanPending = false;
+    m_scanOutdated = false;
+
+    m_active = false;
+    m_pattern.clear();
+    m_expression = QRegularExpression();
+    m_literal.reset();
+    m_matches.clear();
+    m_histogramValid = false;
+
+    if (hadMatches) {
+        emit matchesChanged();
+    }
+}
+
+bool MatchHighlighter::isActive() const
+{
+    return m_active;
+}
+
+int MatchHighlighter::matchCount() const
+{
+    return int(m_matches.size());
+}
+
+const SearchSession::Match &MatchHighlighter::matchAt(int index) const
+{
+    return m_matches.at(index);
+}
+
+int MatchHighlighter::firstMatchEndingAfter(qsizetype offset) const
+{
+    const auto it = std::upper_bound(m_matches.cbegin(), m_matches.cend(), offset,
+                                     [](qsizetype value, const SearchSession::Match &match) {
+                                         return value < match.start + match.length;
+                                     });
+    return int(it - m_matches.cbegin());
+}
+
+const QVector<int> &MatchHighlighter::histogram(int buckets)
+{
+    const int blockCount = m_document->blockCount();
+    if (m_histogramValid && m_histogram.size() == buckets && m_histogramBlockCount == blockCount) {
+        return m_histogram;
+    }
+
+    m_histogram.fill(0, qMax(buckets, 0));
+    m_histogramValid = true;
+    m_histogramBlockCount = blockCount;
+    if (buckets <= 0) {
+        return m_histogram;
+    }
+
+    // Matches are sorted, so most lookups stay within the current line
+    QTextBlock block = m_document->firstBlock();
+    for (const SearchSession::Match &match : std::as_const(m_matches)) {
+        if (!block.isValid() || match.start >= block.position() + block.length()) {
+            block = m_document->findBlock(int(match.start));
+            if (!block.isValid()) {
+                break;
+            }
+        }
+        ++m_histogram[int(qint64(block.blockNumber()) * buckets / blockCount)];
+    }
+
+    return m_histogram;
+}
+
+void MatchHighlighter::onContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (!m_active) {
+        return;
+    }
+
+    // The search in progress covers the old text; its result is dropped
+    if (m_scanPending) {
+        m_scanOutdated = true;
+        return;
+    }
+
+    const qsizetype delta = qsizetype(charsAdded) - charsRemoved;
+    const int lastPosition = m_document->characterCount() - 1;
+
+    // Search the edited lines again, in the new positions
+    qsizetype rescanStart = m_document->findBlock(position).position();
+    QTextBlock lastBlock = m_document->findBlock(qMin(position + charsAdded, lastPosition));
+    qsizetype rescanEnd = lastBlock.position() + lastBlock.length();
+
+    // Matches touching those lines are replaced; ones reaching beyond them
+    // (regular expressions can span lines) widen the search
+    const int first = firstMatchEndingAfter(rescanStart);
+    int last = first;
+    while (last < m_matches.size() && m_matches.at(last).start < rescanEnd - delta) {
+        ++last;
+    }
+    if (first < last) {
+        const SearchSession::Match &lastMatch = m_matches.at(last - 1);
+        rescanStart = m_document->findBlock(int(qMin(rescanStart, m_matches.at(first).start))).position();
+        lastBlock = m_document->findBlock(int(qMin(qMax(rescanEnd, lastMatch.start + lastMatch.length + delta),
+                                                   qsizetype(lastPosition))));
+        rescanEnd = lastBlock.position() + lastBlock.length();
+        while (last < m_matches.size() && m_matches.at(last).start < rescanEnd - delta) {
+            ++last;
+        }
+    }
+
+    QString text;
+    for (QTextBlock block = m_document->findBlock(int(rescanStart)); block.isValid() && block.position() < rescanEnd;
+         block = block.next()) {
+        text.append(block.text());
+        if (block.next().isValid()) {
+            text.append(QLatin1Char('\n'));
+        }
+    }
+
+    QVector<SearchSession::Match> found;
+    scan(m_expression, m_literal.get(), text, rescanStart, MAX_MATCHES - (m_matches.size() - (last - first)), found);
+
+    if (found.size() == last - first) {
+        // Same number of matches: update in place, shifting the rest
+        std::copy(found.cbegin(), found.cend(), m_matches.begin() + first);
+        if (delta != 0) {
+            for (auto it = m_matches.begin() + last; it != m_matches.end(); ++it) {
+                it->start += delta;
+            }
+        }
+    } else {
+        QVector<SearchSession::Match> updated;
+        updated.reserve(m_matches.size() - (last - first) + found.size());
+        updated.append(m_matches.mid(0, first));
+        updated.append(found);
+        for (qsizetype i = last; i < m_matches.size(); ++i) {
+            SearchSession::Match match = m_matches.at(i);
+            match.start += delta;
+            updated.append(match);
+        }
+        m_matches.swap(updated);
+    }
+
+    if (first != last || !found.isEmpty()) {
+        m_histogramValid = false;
+    }
+    emit matchesChanged();
+}
+
+void MatchHighlighter::onScanFinished()
+{
+    const QFuture<QVector<SearchSession::Match>> future = m_scanWatcher.future();
+    if (!m_scanPending || future.isCanceled() || future.resultCount() == 0) {
+        return;
+    }
+
+    if (m_scanOutdated) {
+        emit scanOutdated();
+        return;
+    }
+
+    m_scanPending = false;
+    m_matches = future.result();
+    m_histogramValid = false;
+    emit matchesChanged();
+}
+
+void MatchHighlighter::startScan(const QString &text)
+{
+    if (!m_scanWatcher.isFinished()) {
+        m_scanWatcher.cancel();
+    }
+    m_scanPending = true;
+    m_scanOutdated = false;
+
+    // Edits are not followed until the new matches are installed
+    if (!m_matches.isEmpty()) {
+        m_matches.clear();
+        m_histogramValid = false;
+        emit matchesChanged();
+    }
+
+    auto promise = std::make_shared<QPromise<QVector<SearchSession::Match>>>();
+    m_scanWatcher.setFuture(promise->future());
+    promise->start();
+
+    // The worker compiles its own copy of the pattern
+    const QString pattern = m_pattern;
+    const SearchOptions options = m_options;
+    QThreadPool::globalInstance()->start([promise, text, pattern, options]() {
+        if (!promise->isCanceled()) {
+            std::unique_ptr<LiteralSearcher> literal;
+            QRegularExpression expression;
+            if (options.useRegex) {
+                expression = TextSearch::compile(pattern, options);
+            } else {
+                literal.reset(new LiteralSearcher(pattern, options));
+            }
+
+            QVector<SearchSession::Match> matches;
+            if (scan(expression, literal.get(), text, 0, MAX_MATCHES, matches, promise.get())) {
+                promise->addResult(std::move(matches));
+            }
+        }
+        promise->finish();
+    });
+}
+
+bool MatchHighlighter::scan(const QRegularExpression &expression, const LiteralSearcher *literal, const QString &text,
+                            qsizetype base, qsizetype limit, QVector<SearchSession::Match> &matches,
+                            const QPromise<QVector<SearchSession::Match>> *promise)
+{
+    SearchSession::Match match;
+    int untilCheck = CANCEL_CHECK_INTERVAL;
+
+    if (literal) {
+        qsizetype position = 0;
+        while (limit > 0 && (position = literal->find(text, position, text.size())) >= 0) {
+            match.start = base + position;
+            match.length = literal->length();
+            matches.append(match);
+            position += match.length;
+            --limit;
+            if (promise && --untilCheck == 0) {
+                if (promise->isCanceled()) {
+                    return false;
+                }
+                untilCheck = CANCEL_CHECK_INTERVAL;
+            }
+        }
+        return !promise || !promise->isCanceled();
+    }
+
+    QRegularExpressionMatchIterator it = expression.globalMatch(text);
+    while (limit > 0 && it.hasNext()) {
+        const QRegularExpressionMatch result = it.next();
+        // Empty matches cannot be shown
+        if (result.capturedLength() > 0) {
+            match.start = base + result.capturedStart();
+            match.length = result.capturedLength();
+            matches.append(match);
+            --limit;
+        }
+        if (promise && --untilCheck == 0) {
+            if (promise->isCanceled()) {
+                return false;
+            }
+            untilCheck = CANCEL_CHECK_INTERVAL;
+        }
+    }
+    return !promise || !promise->isCanceled();
+}
@@ -0,0 +1,213 @@
+/**
+ * @file MatchHighlighter.h
+ * @brief Store of every search match in a document, kept current while editing
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+#include <QFutureWatcher>
+#include <memory>
+
+#include "TextSearch.h"
+#include "SearchSession.h"
+
+class QTextDocument;
+template <typename T> class QPromise;
+
+/**
+ * @class MatchHighlighter
+ * @brief Keeps the matches of a search pattern for highlighting in an editor
+ *
+ * Matches are stored as a sorted array of offsets rather than as
+ * QTextEdit::ExtraSelections, so the editor can afford to highlight
+ * hundreds of thousands of them: at paint time it looks up only the
+ * matches within the visible lines, and the scroll bar ticks come from a
+ * histogram that is downsampled to the height of the scroll bar.
+ *
+ * The document is searched on the global thread pool against a text
+ * snapshot, and the matches are installed when the search completes. If
+ * the document was edited meanwhile, the result is dropped and
+ * scanOutdated() asks for a new snapshot.
+ *
+ * Once the matches are installed, edits are applied incrementally. Matches
+ * after an edit are shifted, and only the lines touched by the edit are
+ * searched again.
+ *
+ * @see TextEditor, SearchSession
+ */
+class MatchHighlighter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a highlighter without a pattern
+     * @param document Document whose edits are followed
+     * @param parent Parent object
+     */
+    explicit MatchHighlighter(QTextDocument *document, QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor
+     */
+    ~MatchHighlighter();
+
+    /**
+     * @brief Sets the pattern and starts finding every match in the document
+     * @param pattern Search pattern; empty or invalid patterns clear the matches
+     * @param options Search options
+     * @param text Current document text (see TextEditor::plainTextSnapshot())
+     *
+     * Setting the pattern already in use keeps the current matches.
+     */
+    void setPattern(const QString &pattern, const SearchOptions &options, const QString &text);
+
+    /**
+     * @brief Searches the document again for the current pattern
+     * @param text Current document text
+     *
+     * Called in response to scanOutdated(). Does nothing without a pattern.
+     */
+    void rescan(const QString &text);
+
+    /**
+     * @brief Removes the pattern and every match
+     */
+    void clear();
+
+    /**
+     * @brief Checks whether a pattern is set
+     * @return true while matches are being tracked
+     */
+    bool isActive() const;
+
+    /**
+     * @brief Gets the number of matches
+     * @return Number of matches in the document
+     */
+    int matchCount() const;
+
+    /**
+     * @brief Gets a match
+     * @param index Index of the match, in text order
+     * @return Match at the index
+     */
+    const SearchSession::Match &matchAt(int index) const;
+
+    /**
+     * @brief Gets the index of the first match ending after an offset
+     * @param offset Document position
+     * @return Index of the match, which may equal matchCount()
+     *
+     * Matches never overlap, so their ends are sorted like their starts.
+     */
+    int firstMatchEndingAfter(qsizetype offset) const;
+
+    /**
+     * @brief Gets the number of matches per section of the document
+     * @param buckets Number of sections, usually the scroll bar height in pixels
+     * @return Match count of every section, by line number
+     *
+     * The histogram is cached until the matches or the bucket count change.
+     */
+    const QVector<int> &histogram(int buckets);
+
+    /** @brief Matches tracked at most */
+    static const int MAX_MATCHES = 1000000;
+
+signals:
+    /**
+     * @brief Emitted when matches were found, removed or moved
+     */
+    void matchesChanged();
+
+    /**
+     * @brief Emitted when a search finished after the document was edited
+     *
+     * The result was dropped; rescan() with the current text installs
+     * up-to-date matches.
+     */
+    void scanOutdated();
+
+private slots:
+    /**
+     * @brief Updates the matches after an edit
+     * @param position Position of the edit
+     * @param charsRemoved Number of characters removed
+     * @param charsAdded Number of characters added
+     */
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+    /** @brief Installs the matches of a completed search */
+    void onScanFinished();
+
+private:
+    /**
+     * @brief Starts searching a snapshot on a worker thread
+     * @param text Text snapshot to search
+     */
+    void startScan(const QString &text);
+
+    /**
+     * @brief Appends the matches within a piece of text
+     * @param expression Compiled expression, used when @p literal is null
+     * @param literal Prepared needle for literal searches, or null
+     * @param text Text to search
+     * @param base Document position of the text
+     * @param limit Number of matches that may still be added
+     * @param matches Receives the matches
+     * @param promise Polled for cancellation, or null
+     * @return false if the search was cancelled
+     */
+    static bool scan(const QRegularExpression &expression, const LiteralSearcher *literal, const QString &text,
+                     qsizetype base, qsizetype limit, QVector<SearchSession::Match> &matches,
+                     const QPromise<QVector<SearchSession::Match>> *promise = nullptr);
+
+    /** @brief Document being followed */
+    QTextDocument *m_document;
+
+    /** @brief Pattern in use */
+    QString m_pattern;
+
+    /** @brief Options in use */
+    SearchOptions m_options;
+
+    /** @brief Whether a usable pattern is set */
+    bool m_active;
+
+    /** @brief Compiled expression for regex searches */
+    QRegularExpression m_expression;
+
+    /** @brief Prepared needle for literal searches */
+    std::unique_ptr<LiteralSearcher> m_literal;
+
+    /** @brief Matches in text order */
+    QVector<SearchSession::Match> m_matches;
+
+    /** @brief Watches the search of the whole document */
+    QFutureWatcher<QVector<SearchSession::Match>> m_scanWatcher;
+
+    /** @brief Whether a search of the whole document has not been installed yet */
+    bool m_scanPending;
+
+    /** @brief Whether the document was edited during the pending search */
+    bool m_scanOutdated;
+
+    /** @brief Cached result of histogram() */
+    QVector<int> m_histogram;
+
+    /** @brief Whether m_histogram matches the current matches */
+    bool m_histogramValid;
+
+    /** @brief Line count the histogram was computed for */
+    int m_histogramBlockCount;
+
+    /** @brief Matches found between cancellation checks */
+    static const int CANCEL_CHECK_INTERVAL = 1000;
+};
@@ -0,0 +1,125 @@
+#include "MultiPatternMatcher.h"
+
+namespace
+{
+
+const qsizetype MAX_SPAN_LENGTH = 0x00ffffff;
+
+} // namespace
+
+bool MultiPatternMatcher::build(const QVector<HighlightingRule> &rules)
+{
+    m_expressions.clear();
+    m_alternatives.clear();
+    m_valid = false;
+
+    if (rules.isEmpty()) {
+        return false;
+    }
+
+    QString combined;
+    int nextGroup = 1;
+
+    // PCRE tries alternatives left to right, so the highest priority rule goes first
+    for (int i = rules.size() - 1; i >= 0; --i) {
+        const HighlightingRule &rule = rules.at(i);
+        const QString pattern = rule.pattern.pattern();
+        if (hasBackreference(pattern)) {
+            m_expressions.clear();
+            m_alternatives.clear();
+            return false;
+        }
+
+        if (!combined.isEmpty()) {
+            combined += QLatin1Char('|');
+        }
+        combined += QLatin1Char('(') + pattern + QLatin1Char(')');
+
+        Alternative alternative;
+        alternative.group = nextGroup;
+        alternative.type = rule.type;
+        m_alternatives.append(alternative);
+
+        nextGroup += 1 + rule.pattern.captureCount();
+
+        // Every prefix of the alternation keeps the group numbers of the whole
+        m_expressions.append(QRegularExpression(combined));
+    }
+
+    const QRegularExpression &expression = m_expressions.constLast();
+    if (!expression.isValid()) {
+        qWarning("Cannot combine highlighting rules: %s", qPrintable(expression.errorString()));
+        m_expressions.clear();
+        m_alternatives.clear();
+        return false;
+    }
+
+    for (QRegularExpression &prefix : m_expressions) {
+        prefix.optimize();
+    }
+    m_valid = true;
+    return true;
+}
+
+bool MultiPatternMatcher::isValid() const
+{
+    return m_valid;
+}
+
+void MultiPatternMatcher::scan(const QString &text, QVector<TokenSpan> &spans) const
+{
+    scanRange(text, 0, text.size(), int(m_alternatives.size()), spans);
+}
+
+qsizetype MultiPatternMatcher::scanRange(const QString &text, qsizetype from, qsizetype limit, int count,
+                                         QVector<TokenSpan> &spans) const
+{
+    const QRegularExpression &expression = m_expressions.at(count - 1);
+    qsizetype position = from;
+    qsizetype end = from;
+    while (position < limit) {
+        const QRegularExpressionMatch match = expression.match(text, position);
+        if (!match.hasMatch() || match.capturedStart() >= limit) {
+            break;
+        }
+        if (match.capturedLength() == 0) {
+            position = match.capturedStart() + 1;
+            continue;
+        }
+
+        int index = 0;
+        while (index < count && match.capturedStart(m_alternatives.at(index).group) < 0) {
+            ++index;
+        }
+
+        TokenSpan span;
+        span.start = quint32(match.capturedStart());
+        span.length = quint32(qMin(match.capturedLength(), MAX_SPAN_LENGTH));
+        span.type = quint32(m_alternatives.at(index).type);
+        spans.append(span);
+        position = match.capturedEnd();
+
+        // Higher priority rules starting inside the match paint over it
+        if (index > 0) {
+            position = qMax(position, scanRange(text, match.capturedStart() + 1, match.capturedEnd(), index, spans));
+        }
+        end = position;
+    }
+    return end;
+}
+
+bool MultiPatternMatcher::hasBackreference(const QString &pattern)
+{
+    for (int i = 0; i + 1 < pattern.size(); ++i) {
+        if (pattern.at(i) != QLatin1Char('\\')) {
+            continue;
+        }
+
+        const QChar next = pattern.at(i + 1);
+        if ((next.isDigit() && next != QLatin1Char('0')) || next == QLatin1Char('g') || next == QLatin1Char('k')) {
+            return true;
+        }
+        ++i; // Skip the escaped character
+    }
+    return pattern.contains(QLatin1String("(?P="));
+}
@@ -0,0 +1,102 @@
+/**
+ * @file MultiPatternMatcher.h
+ * @brief Single-pass matching of a prioritized set of highlighting rules
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+
+#include "SyntaxHighlighter.h"
+
+/**
+ * @class MultiPatternMatcher
+ * @brief Combines several rule patterns into one expression scanned once per line
+ *
+ * Instead of running a separate global match for every rule, the rule
+ * patterns are joined into a single alternation where each rule is wrapped
+ * in its own capture group. One left-to-right scan then reports the rule
+ * of every match.
+ *
+ * Rules are prioritized the same way SyntaxHighlighter applies them: a rule
+ * later in the list wins over an earlier one. Where several rules match at
+ * the same position the highest priority rule is reported. Inside a match,
+ * the rules of higher priority are scanned again and their matches are
+ * reported after it, so they paint over it as they did when every rule was
+ * matched on its own. Rules of lower priority are not reported inside a
+ * match; the scan resumes after it.
+ *
+ * @see Grammar, HighlightingRule
+ */
+class MultiPatternMatcher
+{
+public:
+    /**
+     * @brief Builds the combined expression from a list of rules
+     * @param rules Compiled rules in priority order (lowest first)
+     * @return true if the rules could be combined; otherwise isValid() is false
+     *         and the rules must be matched one by one
+     *
+     * Rules using numbered or named backreferences cannot be combined,
+     * because wrapping them in additional groups would renumber the groups
+     * they refer to.
+     */
+    bool build(const QVector<HighlightingRule> &rules);
+
+    /**
+     * @brief Checks whether a combined expression is available
+     * @return true if build() succeeded
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Scans a line and records a span for every rule match
+     * @param text Text to scan
+     * @param spans Receives the spans in painting order: a span is followed
+     *        by the higher priority spans starting inside it
+     */
+    void scan(const QString &text, QVector<TokenSpan> &spans) const;
+
+private:
+    /**
+     * @struct Alternative
+     * @brief Capture group and token type of one rule inside the combined expression
+     */
+    struct Alternative
+    {
+        int group;      ///< Capture group wrapping the rule's pattern
+        TokenType type; ///< Token type reported for matches of the rule
+    };
+
+    /**
+     * @brief Scans part of a line with the rules of a priority and above
+     * @param text Text to scan
+     * @param from Position to start at
+     * @param limit Matches must start before this position
+     * @param count Number of alternatives to match, highest priority first
+     * @param spans Receives the spans
+     * @return End of the last span recorded, or @p from if there was none
+     */
+    qsizetype scanRange(const QString &text, qsizetype from, qsizetype limit, int count,
+                        QVector<TokenSpan> &spans) const;
+
+    /**
+     * @brief Checks whether a pattern refers back to its own capture groups
+     * @param pattern Regular expression source
+     * @return true if the pattern contains a backreference
+     */
+    static bool hasBackreference(const QString &pattern);
+
+    /** @brief Combined expressions of the first 1, 2, ... alternatives; the last holds all rules */
+    QVector<QRegularExpression> m_expressions;
+
+    /** @brief Rules in alternation order, highest priority first */
+    QVector<Alternative> m_alternatives;
+
+    /** @brief Whether m_expressions were built successfully */
+    bool m_valid = false;
+};
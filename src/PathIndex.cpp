@@ -0,0 +1,459 @@
+#include "PathIndex.h"
+#include "WorkspaceWalker.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QThreadPool>
+#include <algorithm>
+
+namespace
+{
+
+/** @brief Score added when the whole query matches within the file name */
+const int NAME_MATCH_BONUS = 20;
+
+char foldAscii(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? char(ch + 0x20) : ch;
+}
+
+bool isSeparator(char ch)
+{
+    return ch == '/' || ch == '_' || ch == '-' || ch == '.' || ch == ' ';
+}
+
+quint64 characterMask(const char *data, qsizetype size)
+{
+    quint64 mask = 0;
+    for (qsizetype i = 0; i < size; ++i) {
+        const char ch = foldAscii(data[i]);
+        if (ch >= 'a' && ch <= 'z') {
+            mask |= quint64(1) << (ch - 'a');
+        } else if (ch >= '0' && ch <= '9') {
+            mask |= quint64(1) << (26 + ch - '0');
+        } else if (ch == '.') {
+            mask |= quint64(1) << 36;
+        } else if (ch == '_') {
+            mask |= quint64(1) << 37;
+        } else if (ch == '-') {
+            mask |= quint64(1) << 38;
+        }
+    }
+    return mask;
+}
+
+/**
+ * @brief Matches the needle greedily within a span of the path
+ * @return Score, or -1 if the needle is not a subsequence of the span
+ */
+int spanScore(const char *path, int from, int to, const QByteArray &needle)
+{
+    int score = 0;
+    int matched = 0;
+    int previous = -2;
+    for (int i = from; i < to && matched < needle.size(); ++i) {
+        const char ch = path[i];
+        if (foldAscii(ch) != needle.at(matched)) {
+            continue;
+        }
+
+        int bonus = 1;
+        if (i == previous + 1) {
+            bonus += 4; // Consecutive characters
+        }
+        if (i == from || isSeparator(path[i - 1])) {
+            bonus += 6; // Start of a word
+        } else if (ch >= 'A' && ch <= 'Z' && path[i - 1] >= 'a' && path[i - 1] <= 'z') {
+            bonus += 5; // Start of a camel case word
+        }
+        score += bonus;
+        previous = i;
+        ++matched;
+    }
+    return matched == needle.size() ? score : -1;
+}
+
+/**
+ * @brief Scores a path for a needle
+ * @return Score, or -1 if the path does not match
+ */
+int pathScore(const char *path, int length, const QByteArray &needle)
+{
+    const int score = spanScore(path, 0, length, needle);
+    if (score < 0) {
+        return -1;
+    }
+
+    int nameStart = length;
+    while (nameStart > 0 && path[nameStart - 1] != '/') {
+        --nameStart;
+    }
+    const int nameScore = spanScore(path, nameStart, length, needle);
+
+    // Shorter paths win ties
+    return qMax(score, nameScore >= 0 ? nameScore + NAME_MATCH_BONUS : -1) - length / 16;
+}
+
+bool isSubsequence(const QByteArray &shorter, const QByteArray &longer)
+{
+    qsizetype matched = 0;
+    for (qsizetype i = 0; i < longer.size() && matched < shorter.size(); ++i) {
+        if (longer.at(i) == shorter.at(matched)) {
+            ++matched;
+        }
+    }
+    return matched == shorter.size();
+}
+
+/**
+ * @brief Checks whether a span contains a folded word, ignoring ASCII case
+ */
+bool containsFolded(const char *path, qsizetype length, QByteArrayView word)
+{
+    for (qsizetype start = 0; start + word.size() <= length; ++start) {
+        qsizetype i = 0;
+        while (i < word.size() && foldAscii(path[start + i]) == word.at(i)) {
+            ++i;
+        }
+        if (i == word.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** @brief Paths checked between cancellation checks while filtering */
+const qsizetype FILTER_CANCEL_INTERVAL = 4096;
+
+} // namespace
+
+/**
+ * @brief Paths matching the query of the last completed filter
+ */
+struct PathIndex::FilterCache
+{
+    QMutex mutex;                      ///< Guards the other members
+    std::shared_ptr<const Data> data;  ///< Paths the ids refer to
+    QByteArray query;                  ///< Folded query
+    QVector<quint32> ids;              ///< Every matching path
+};
+
+PathIndex::PathIndex(QObject *parent)
+    : QObject(parent)
+    , m_filterCache(std::make_shared<FilterCache>())
+{
+    connect(&m_watcher, &QFutureWatcher<std::shared_ptr<const Data>>::finished, this, &PathIndex::onWalkFinished);
+}
+
+PathIndex::~PathIndex()
+{
+    if (!m_watcher.isFinished()) {
+        m_watcher.cancel();
+    }
+}
+
+void PathIndex::setRootPath(const QString &rootPath)
+{
+    QString root = rootPath.isEmpty() ? QString() : QDir(rootPath).absolutePath();
+    if (!root.isEmpty() && !root.endsWith(QLatin1Char('/'))) {
+        root += QLatin1Char('/');
+    }
+    if (root == m_rootPath) {
+        return;
+    }
+
+    m_rootPath = root;
+    m_data.reset();
+    m_lastData.reset();
+    m_lastCandidates.clear();
+    refresh();
+}
+
+QString PathIndex::rootPath() const
+{
+    return m_rootPath;
+}
+
+void PathIndex::refresh(qint64 maxAge)
+{
+    if (maxAge > 0 && m_age.isValid() && m_age.elapsed() < maxAge) {
+        return;
+    }
+
+    if (!m_watcher.isFinished()) {
+        m_watcher.cancel();
+    }
+    if (m_rootPath.isEmpty()) {
+        return;
+    }
+
+    auto promise = std::make_shared<QPromise<std::shared_ptr<const Data>>>();
+    m_watcher.setFuture(promise->future());
+    m_age.start();
+    promise->start();
+
+    const QString rootPath = m_rootPath;
+    QThreadPool::globalInstance()->start([promise, rootPath]() {
+        std::shared_ptr<const Data> data = walk(*promise, rootPath);
+        if (!promise->isCanceled()) {
+            promise->addResult(std::move(data));
+        }
+        promise->finish();
+    });
+}
+
+bool PathIndex::isReady() const
+{
+    return m_data != nullptr;
+}
+
+int PathIndex::pathCount() const
+{
+    return m_data ? int(m_data->masks.size()) : 0;
+}
+
+int PathIndex::findPath(const QString &filePath) const
+{
+    if (!m_data || !filePath.startsWith(m_data->rootPath)) {
+        return -1;
+    }
+
+    // Paths are sorted, so a binary search finds the file
+    const QByteArray relative = filePath.mid(m_data->rootPath.size()).toUtf8();
+    const Data &data = *m_data;
+    const auto pathAt = [&data](qsizetype id) {
+        return QByteArrayView(data.paths.constData() + data.offsets.at(id),
+                              data.offsets.at(id + 1) - data.offsets.at(id));
+    };
+
+    qsizetype low = 0;
+    qsizetype high = data.masks.size();
+    while (low < high) {
+        const qsizetype middle = (low + high) / 2;
+        if (pathAt(middle) < QByteArrayView(relative)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return (low < data.masks.size() && pathAt(low) == QByteArrayView(relative)) ? int(low) : -1;
+}
+
+QString PathIndex::filePath(int id) const
+{
+    return m_data->rootPath + relativePath(id);
+}
+
+QString PathIndex::relativePath(int id) const
+{
+    const quint32 start = m_data->offsets.at(id);
+    return QString::fromUtf8(m_data->paths.constData() + start, m_data->offsets.at(id + 1) - start);
+}
+
+QVector<int> PathIndex::match(const QString &query, int maxResults, const QHash<int, int> &bonuses)
+{
+    QVector<int> ids;
+    if (!m_data || maxResults <= 0) {
+        return ids;
+    }
+
+    QByteArray needle;
+    for (const char ch : query.toUtf8()) {
+        if (ch != ' ') {
+            needle.append(foldAscii(ch));
+        }
+    }
+    if (needle.isEmpty()) {
+        return ids;
+    }
+
+    const Data &data = *m_data;
+    const char *paths = data.paths.constData();
+    const quint32 *offsets = data.offsets.constData();
+
+    // Paths matching a shorter query are the only ones that can match a longer one
+    QVector<quint32> candidates;
+    if (m_lastData == m_data && !m_lastNeedle.isEmpty() && isSubsequence(m_lastNeedle, needle)) {
+        candidates = m_lastCandidates;
+    } else {
+        // Branch-free filter over the masks, which the compiler can vectorize
+        const quint64 needleMask = characterMask(needle.constData(), needle.size());
+        const quint64 *masks = data.masks.constData();
+        const qsizetype count = data.masks.size();
+        candidates.resize(count);
+        quint32 *out = candidates.data();
+        qsizetype kept = 0;
+        for (qsizetype id = 0; id < count; ++id) {
+            out[kept] = quint32(id);
+            kept += (masks[id] & needleMask) == needleMask;
+        }
+        candidates.resize(kept);
+    }
+
+    struct Scored
+    {
+        int score;
+        quint32 id;
+    };
+    QVector<Scored> scored;
+    QVector<quint32> matched;
+    matched.reserve(candidates.size());
+    for (const quint32 id : std::as_const(candidates)) {
+        const int score = pathScore(paths + offsets[id], int(offsets[id + 1] - offsets[id]), needle);
+        if (score < 0) {
+            continue;
+        }
+        matched.append(id);
+        scored.append({ score + bonuses.value(int(id)), id });
+    }
+
+    m_lastData = m_data;
+    m_lastNeedle = needle;
+    m_lastCandidates.swap(matched);
+
+    // Best score first, then the earlier path in sort order
+    const qsizetype resultCount = qMin<qsizetype>(maxResults, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + resultCount, scored.end(),
+                      [](const Scored &a, const Scored &b) {
+                          return a.score != b.score ? a.score > b.score : a.id < b.id;
+                      });
+
+    ids.reserve(resultCount);
+    for (qsizetype i = 0; i < resultCount; ++i) {
+        ids.append(int(scored.at(i).id));
+    }
+    return ids;
+}
+
+QFuture<QStringList> PathIndex::filter(const QString &query, int maxResults)
+{
+    QByteArray folded;
+    for (const char ch : query.trimmed().toUtf8()) {
+        folded.append(foldAscii(ch));
+    }
+
+    auto promise = std::make_shared<QPromise<QStringList>>();
+    QFuture<QStringList> future = promise->future();
+    promise->start();
+
+    const std::shared_ptr<const Data> data = m_data;
+    const std::shared_ptr<FilterCache> cache = m_filterCache;
+    QThreadPool::globalInstance()->start([promise, data, folded, maxResults, cache]() {
+        QStringList paths = filterPaths(*promise, data, folded, maxResults, cache);
+        if (!promise->isCanceled()) {
+            promise->addResult(std::move(paths));
+        }
+        promise->finish();
+    });
+    return future;
+}
+
+QStringList PathIndex::filterPaths(QPromise<QStringList> &promise, const std::shared_ptr<const Data> &data,
+                                   const QByteArray &query, int maxResults, const std::shared_ptr<FilterCache> &cache)
+{
+    QStringList paths;
+    QVector<QByteArray> words;
+    for (const QByteArray &word : query.split(' ')) {
+        if (!word.isEmpty()) {
+            words.append(word);
+        }
+    }
+    if (!data || words.isEmpty()) {
+        return paths;
+    }
+
+    const char *pathData = data->paths.constData();
+    const quint32 *offsets = data->offsets.constData();
+    const quint64 *masks = data->masks.constData();
+    const quint64 queryMask = characterMask(query.constData(), query.size());
+
+    // A longer query can only match paths that matched the shorter one
+    QVector<quint32> candidates;
+    bool narrowing = false;
+    {
+        QMutexLocker locker(&cache->mutex);
+        if (cache->data == data && !cache->query.isEmpty() && query.startsWith(cache->query)) {
+            candidates = cache->ids;
+            narrowing = true;
+        }
+    }
+    const qsizetype count = narrowing ? candidates.size() : data->masks.size();
+
+    QVector<quint32> matched;
+    for (qsizetype i = 0; i < count; ++i) {
+        if (i % FILTER_CANCEL_INTERVAL == 0 && promise.isCanceled()) {
+            return QStringList();
+        }
+
+        const quint32 id = narrowing ? candidates.at(i) : quint32(i);
+        if ((masks[id] & queryMask) != queryMask) {
+            continue;
+        }
+        const char *path = pathData + offsets[id];
+        const qsizetype length = offsets[id + 1] - offsets[id];
+        const bool containsAll = std::all_of(words.cbegin(), words.cend(), [path, length](const QByteArray &word) {
+            return containsFolded(path, length, word);
+        });
+        if (containsAll) {
+            matched.append(id);
+        }
+    }
+
+    // Ids are in path order, so the result is sorted
+    const qsizetype resultCount = qMin<qsizetype>(maxResults, matched.size());
+    paths.reserve(resultCount);
+    for (qsizetype i = 0; i < resultCount; ++i) {
+        const quint32 id = matched.at(i);
+        paths.append(data->rootPath + QString::fromUtf8(pathData + offsets[id], offsets[id + 1] - offsets[id]));
+    }
+
+    QMutexLocker locker(&cache->mutex);
+    cache->data = data;
+    cache->query = query;
+    cache->ids.swap(matched);
+    return paths;
+}
+
+void PathIndex::onWalkFinished()
+{
+    if (m_watcher.future().isCanceled() || m_watcher.future().resultCount() == 0) {
+        return;
+    }
+
+    m_data = m_watcher.result();
+    m_lastData.reset();
+    m_lastCandidates.clear();
+    emit indexReady(int(m_data->masks.size()));
+}
+
+std::shared_ptr<const PathIndex::Data> PathIndex::walk(QPromise<std::shared_ptr<const Data>> &promise,
+                                                       const QString &rootPath)
+{
+    QVector<QByteArray> relativePaths;
+
+    QVector<WorkspaceWalker::Directory> pending { WorkspaceWalker::root(QDir(rootPath).absolutePath()) };
+    while (!pending.isEmpty() && !promise.isCanceled() && relativePaths.size() < MAX_PATHS) {
+        QVector<QFileInfo> files;
+        WorkspaceWalker::list(pending.takeLast(), files, pending);
+        for (const QFileInfo &fileInfo : std::as_const(files)) {
+            relativePaths.append(fileInfo.filePath().mid(rootPath.size()).toUtf8());
+        }
+    }
+
+    std::sort(relativePaths.begin(), relativePaths.end());
+
+    auto data = std::make_shared<Data>();
+    data->rootPath = rootPath;
+    data->offsets.reserve(relativePaths.size() + 1);
+    data->masks.reserve(relativePaths.size());
+    for (const QByteArray &path : std::as_const(relativePaths)) {
+        data->offsets.append(quint32(data->paths.size()));
+        data->masks.append(characterMask(path.constData(), path.size()));
+        data->paths.append(path);
+    }
+    data->offsets.append(quint32(data->paths.size()));
+    return data;
+}
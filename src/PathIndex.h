@@ -0,0 +1,201 @@
+/**
+ * @file PathIndex.h
+ * @brief In-memory index of the file paths below a folder for fuzzy lookup
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <memory>
+
+template <typename T> class QPromise;
+
+/**
+ * @class PathIndex
+ * @brief Lists every file below a folder and matches paths fuzzily
+ *
+ * The folder is walked on a worker thread with WorkspaceWalker, skipping
+ * ignored files, version control folders and symbolic links like Find in
+ * Files does. Relative paths are kept sorted as UTF-8 in a single buffer,
+ * with a 64-bit mask of the characters each path contains.
+ *
+ * A query matches a path when its characters appear in the path in order,
+ * ignoring ASCII case. Each query first drops every path whose character
+ * mask lacks a query character, in a tight loop over the masks, then
+ * scores the remaining paths. Typing more characters only rescores the
+ * paths that matched the shorter query.
+ *
+ * filter() instead selects every path containing some words, for the
+ * explorer's filter box. It runs on a worker thread, and likewise only
+ * rescans the paths matching the previous query when the query grows.
+ *
+ * @see QuickOpenDialog, FileExplorer
+ */
+class PathIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an empty index
+     * @param parent Parent object
+     */
+    explicit PathIndex(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor - cancels a walk in progress
+     */
+    ~PathIndex();
+
+    /**
+     * @brief Sets the folder to index and starts walking it
+     * @param rootPath Folder to index; an empty path clears the index
+     */
+    void setRootPath(const QString &rootPath);
+
+    /**
+     * @brief Gets the indexed folder
+     * @return Folder path, or an empty string
+     */
+    QString rootPath() const;
+
+    /**
+     * @brief Walks the folder again in the background
+     * @param maxAge Only rebuild when the index is older than this many milliseconds
+     *
+     * The current paths stay available until the new list is complete.
+     */
+    void refresh(qint64 maxAge = 0);
+
+    /**
+     * @brief Checks whether a walk has completed
+     * @return true once paths can be matched
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Gets the number of indexed files
+     * @return Number of paths
+     */
+    int pathCount() const;
+
+    /**
+     * @brief Looks up a file
+     * @param filePath Absolute path of the file
+     * @return Id of the path, or -1 if it is not indexed
+     */
+    int findPath(const QString &filePath) const;
+
+    /**
+     * @brief Gets the absolute path of a file
+     * @param id Id of the path
+     * @return Absolute path
+     */
+    QString filePath(int id) const;
+
+    /**
+     * @brief Gets the path of a file relative to the indexed folder
+     * @param id Id of the path
+     * @return Relative path
+     */
+    QString relativePath(int id) const;
+
+    /**
+     * @brief Finds the paths best matching a query
+     * @param query Characters to look for in order; spaces are ignored
+     * @param maxResults Number of paths to return at most
+     * @param bonuses Score added to particular path ids, e.g. open or recent files
+     * @return Path ids, best match first
+     */
+    QVector<int> match(const QString &query, int maxResults, const QHash<int, int> &bonuses = QHash<int, int>());
+
+    /**
+     * @brief Finds the paths containing every word of a query on a worker thread
+     * @param query Words separated by spaces, matched ignoring ASCII case
+     * @param maxResults Number of paths to return at most
+     * @return Future of the absolute paths in sorted order; cancel it to stop the search
+     */
+    QFuture<QStringList> filter(const QString &query, int maxResults);
+
+    /** @brief Files indexed at most */
+    static const int MAX_PATHS = 2000000;
+
+signals:
+    /**
+     * @brief Emitted when a walk has completed
+     * @param pathCount Number of indexed files
+     */
+    void indexReady(int pathCount);
+
+private slots:
+    /** @brief Takes over the paths of a completed walk */
+    void onWalkFinished();
+
+private:
+    /**
+     * @brief Indexed paths of one walk
+     */
+    struct Data
+    {
+        QString rootPath;         ///< Folder, ending with '/'
+        QByteArray paths;         ///< Sorted relative UTF-8 paths, back to back
+        QVector<quint32> offsets; ///< Start of each path, followed by the end of the last
+        QVector<quint64> masks;   ///< Characters contained in each path
+    };
+
+    /**
+     * @brief Walks a folder; runs on a worker thread
+     * @param promise Polled for cancellation
+     * @param rootPath Folder, ending with '/'
+     * @return Indexed paths
+     */
+    static std::shared_ptr<const Data> walk(QPromise<std::shared_ptr<const Data>> &promise, const QString &rootPath);
+
+    struct FilterCache;
+
+    /**
+     * @brief Selects the paths containing every word; runs on a worker thread
+     * @param promise Polled for cancellation
+     * @param data Paths to search
+     * @param query Folded query
+     * @param maxResults Number of paths to return at most
+     * @param cache Ids matching the previous query, updated when the search completes
+     * @return Absolute paths in sorted order
+     */
+    static QStringList filterPaths(QPromise<QStringList> &promise, const std::shared_ptr<const Data> &data,
+                                   const QByteArray &query, int maxResults, const std::shared_ptr<FilterCache> &cache);
+
+    /** @brief Paths of the last completed walk */
+    std::shared_ptr<const Data> m_data;
+
+    /** @brief Watches the walk in progress */
+    QFutureWatcher<std::shared_ptr<const Data>> m_watcher;
+
+    /** @brief Folder being indexed, ending with '/' */
+    QString m_rootPath;
+
+    /** @brief Time since the last walk started */
+    QElapsedTimer m_age;
+
+    /** @brief Folded query of the last match() call */
+    QByteArray m_lastNeedle;
+
+    /** @brief Paths matching m_lastNeedle, for narrowing longer queries */
+    QVector<quint32> m_lastCandidates;
+
+    /** @brief Paths m_lastCandidates refers to */
+    std::shared_ptr<const Data> m_lastData;
+
+    /** @brief Result of the last completed filter(), shared with its workers */
+    std::shared_ptr<FilterCache> m_filterCache;
+};
@@ -0,0 +1,169 @@
+#include "QuickOpenDialog.h"
+#include "PathIndex.h"
+
+#include <QVBoxLayout>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QSet>
+
+QuickOpenDialog::QuickOpenDialog(PathIndex *pathIndex, QWidget *parent)
+    : QDialog(parent)
+    , m_queryLineEdit(nullptr)
+    , m_resultList(nullptr)
+    , m_statusLabel(nullptr)
+    , m_pathIndex(pathIndex)
+{
+    setupUI();
+
+    connect(m_queryLineEdit, &QLineEdit::textChanged, this, &QuickOpenDialog::updateResults);
+    connect(m_queryLineEdit, &QLineEdit::returnPressed, this, &QuickOpenDialog::openCurrent);
+    connect(m_resultList, &QListWidget::itemActivated, this, &QuickOpenDialog::openCurrent);
+    connect(m_pathIndex, &PathIndex::indexReady, this, &QuickOpenDialog::onIndexReady);
+}
+
+QuickOpenDialog::~QuickOpenDialog()
+{
+}
+
+void QuickOpenDialog::setupUI()
+{
+    setWindowTitle(tr("Quick Open"));
+    resize(640, 420);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setSpacing(5);
+    mainLayout->setContentsMargins(10, 10, 10, 10);
+
+    m_queryLineEdit = new QLineEdit(this);
+    m_queryLineEdit->setPlaceholderText(tr("Type part of a file name or path..."));
+    m_queryLineEdit->installEventFilter(this);
+
+    m_resultList = new QListWidget(this);
+    m_resultList->setUniformItemSizes(true);
+    m_resultList->setTextElideMode(Qt::ElideMiddle);
+
+    m_statusLabel = new QLabel(this);
+    m_statusLabel->setStyleSheet("color: gray; font-style: italic;");
+
+    mainLayout->addWidget(m_queryLineEdit);
+    mainLayout->addWidget(m_resultList, 1);
+    mainLayout->addWidget(m_statusLabel);
+}
+
+void QuickOpenDialog::setPreferredFiles(const QStringList &openFiles, const QStringList &recentFiles)
+{
+    m_openFiles = openFiles;
+    m_recentFiles = recentFiles;
+
+    // Open files rank above recent ones, and recent ones by recency
+    m_bonuses.clear();
+    for (const QString &filePath : openFiles) {
+        const int id = m_pathIndex->findPath(filePath);
+        if (id >= 0) {
+            m_bonuses.insert(id, OPEN_FILE_BONUS);
+        }
+    }
+    for (int i = 0; i < recentFiles.size(); ++i) {
+        const int id = m_pathIndex->findPath(recentFiles.at(i));
+        if (id >= 0 && !m_bonuses.contains(id)) {
+            m_bonuses.insert(id, qMax(RECENT_FILE_BONUS - i, 1));
+        }
+    }
+}
+
+void QuickOpenDialog::popup()
+{
+    m_queryLineEdit->selectAll();
+    updateResults();
+
+    show();
+    raise();
+    activateWindow();
+    m_queryLineEdit->setFocus();
+}
+
+void QuickOpenDialog::updateResults()
+{
+    m_resultList->clear();
+    const QString query = m_queryLineEdit->text().trimmed();
+
+    if (query.isEmpty()) {
+        // Without a query, offer the open and recent files
+        QSet<QString> listed;
+        for (const QString &filePath : m_openFiles + m_recentFiles) {
+            if (!listed.contains(filePath)) {
+                listed.insert(filePath);
+                addResult(filePath, QDir::toNativeSeparators(filePath));
+            }
+        }
+        m_statusLabel->setText(m_pathIndex->isReady() ? tr("%1 file(s) indexed").arg(m_pathIndex->pathCount())
+                                                      : tr("Indexing files..."));
+    } else if (!m_pathIndex->isReady()) {
+        m_statusLabel->setText(tr("Indexing files..."));
+    } else {
+        QElapsedTimer timer;
+        timer.start();
+        const QVector<int> ids = m_pathIndex->match(query, MAX_RESULTS, m_bonuses);
+        for (const int id : ids) {
+            addResult(m_pathIndex->filePath(id), QDir::toNativeSeparators(m_pathIndex->relativePath(id)));
+        }
+        m_statusLabel->setText(tr("%1 file(s) indexed, searched in %2 ms")
+                                   .arg(m_pathIndex->pathCount())
+                                   .arg(timer.elapsed()));
+    }
+
+    if (m_resultList->count() > 0) {
+        m_resultList->setCurrentRow(0);
+    }
+}
+
+void QuickOpenDialog::addResult(const QString &filePath, const QString &displayPath)
+{
+    QListWidgetItem *item = new QListWidgetItem(
+        QString("%1    %2").arg(QFileInfo(filePath).fileName(), displayPath), m_resultList);
+    item->setData(Qt::UserRole, filePath);
+    item->setToolTip(filePath);
+}
+
+void QuickOpenDialog::openCurrent()
+{
+    QListWidgetItem *item = m_resultList->currentItem();
+    if (!item) {
+        return;
+    }
+
+    const QString filePath = item->data(Qt::UserRole).toString();
+    hide();
+    emit fileSelected(filePath);
+}
+
+void QuickOpenDialog::onIndexReady(int /* pathCount */)
+{
+    // Path ids change with every walk
+    setPreferredFiles(m_openFiles, m_recentFiles);
+    if (isVisible()) {
+        updateResults();
+    }
+}
+
+bool QuickOpenDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    // Let the arrow keys move through the results while typing
+    if (watched == m_queryLineEdit && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key()) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QApplication::sendEvent(m_resultList, event);
+            return true;
+        default:
+            break;
+        }
+    }
+
+    return QDialog::eventFilter(watched, event);
+}
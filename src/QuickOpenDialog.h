@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QDialog>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QLabel>
+#include <QHash>
+#include <QStringList>
+#include <QKeyEvent>
+
+class PathIndex;
+
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit QuickOpenDialog(PathIndex *pathIndex, QWidget *parent = nullptr);
+    ~QuickOpenDialog();
+
+    void setPreferredFiles(const QStringList &openFiles, const QStringList &recentFiles);
+    void popup();
+
+signals:
+    void fileSelected(const QString &filePath);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void updateResults();
+    void openCurrent();
+    void onIndexReady(int pathCount);
+
+private:
+    void setupUI();
+    void addResult(const QString &filePath, const QString &displayPath);
+
+    QLineEdit *m_queryLineEdit;
+    QListWidget *m_resultList;
+    QLabel *m_statusLabel;
+
+    PathIndex *m_pathIndex;
+    QStringList m_openFiles;
+    QStringList m_recentFiles;
+    QHash<int, int> m_bonuses;
+
+    static const int MAX_RESULTS = 50;
+    static const int OPEN_FILE_BONUS = 40;
+    static const int RECENT_FILE_BONUS = 30;
+};
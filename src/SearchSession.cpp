@@ -0,0 +1,207 @@
+#include "SearchSession.h"
+
+#include <algorithm>
+
+SearchSession::SearchSession()
+    : m_hasPattern(false)
+    , m_iteratorStarted(false)
+    , m_scanOffset(0)
+    , m_scanComplete(false)
+    , m_lastIndex(-1)
+{
+}
+
+SearchSession::~SearchSession()
+{
+}
+
+bool SearchSession::setPattern(const QString &pattern, const SearchOptions &options)
+{
+    if (m_hasPattern && pattern == m_pattern && options.caseSensitive == m_options.caseSensitive
+        && options.wholeWords == m_options.wholeWords && options.useRegex == m_options.useRegex) {
+        return isValid();
+    }
+
+    m_pattern = pattern;
+    m_options = options;
+    m_hasPattern = true;
+    m_expression = QRegularExpression();
+    m_literal.reset();
+
+    if (options.useRegex) {
+        m_expression = TextSearch::compile(pattern, options);
+    } else if (!pattern.isEmpty()) {
+        m_literal.reset(new LiteralSearcher(pattern, options));
+    }
+
+    resetScan();
+    return isValid();
+}
+
+void SearchSession::setText(const QString &text)
+{
+    // Snapshots are shared until the document changes, so identity is enough
+    if (text.constData() == m_text.constData() && text.size() == m_text.size()) {
+        return;
+    }
+
+    m_text = text;
+    resetScan();
+}
+
+bool SearchSession::isValid() const
+{
+    if (!m_hasPattern || m_pattern.isEmpty()) {
+        return false;
+    }
+    return m_options.useRegex ? m_expression.isValid() : m_literal != nullptr;
+}
+
+QString SearchSession::errorString() const
+{
+    return m_options.useRegex && !m_expression.isValid() ? m_expression.errorString() : QString();
+}
+
+SearchSession::Match SearchSession::findNext(qsizetype from, bool wrap)
+{
+    if (!isValid()) {
+        return Match();
+    }
+
+    // Sequential Find Next continues right after the previous match
+    int index = -1;
+    if (m_lastIndex >= 0 && m_lastIndex + 1 < m_matches.size()
+        && m_matches.at(m_lastIndex).start < from && m_matches.at(m_lastIndex + 1).start >= from) {
+        index = m_lastIndex + 1;
+    } else {
+        scanTo(from);
+        index = lowerBound(from);
+    }
+
+    if (index >= m_matches.size()) {
+        if (!wrap) {
+            return Match();
+        }
+        scanTo(0);
+        index = 0;
+        if (m_matches.isEmpty()) {
+            return Match();
+        }
+    }
+
+    m_lastIndex = index;
+    return m_matches.at(index);
+}
+
+SearchSession::Match SearchSession::findPrevious(qsizetype before, bool wrap)
+{
+    if (!isValid()) {
+        return Match();
+    }
+
+    scanTo(before);
+    int index = lowerBound(before) - 1;
+
+    if (index < 0) {
+        if (!wrap) {
+            return Match();
+        }
+        allMatches();
+        index = m_matches.size() - 1;
+        if (index < 0) {
+            return Match();
+        }
+    }
+
+    m_lastIndex = index;
+    return m_matches.at(index);
+}
+
+const QVector<SearchSession::Match> &SearchSession::allMatches()
+{
+    if (isValid()) {
+        while (scanNext()) {
+        }
+    }
+    return m_matches;
+}
+
+void SearchSession::resetScan()
+{
+    m_iterator = QRegularExpressionMatchIterator();
+    m_iteratorStarted = false;
+    m_scanOffset = 0;
+    m_scanComplete = false;
+    m_matches.clear();
+    m_lastIndex = -1;
+}
+
+bool SearchSession::scanNext()
+{
+    if (m_scanComplete) {
+        return false;
+    }
+
+    if (m_options.useRegex) {
+        // One iterator spans the whole scan, so the subject is validated once
+        if (!m_iteratorStarted) {
+            m_iterator = m_expression.globalMatch(m_text);
+            m_iteratorStarted = true;
+        }
+        while (m_iterator.hasNext()) {
+            const QRegularExpressionMatch match = m_iterator.next();
+            // Empty matches cannot be selected
+            if (match.capturedLength() > 0) {
+                Match result;
+                result.start = match.capturedStart();
+                result.length = match.capturedLength();
+                m_matches.append(result);
+                return true;
+            }
+        }
+    } else {
+        const qsizetype position = m_literal->find(m_text, m_scanOffset, m_text.size());
+        if (position >= 0) {
+            Match result;
+            result.start = position;
+            result.length = m_literal->length();
+            m_matches.append(result);
+            m_scanOffset = position + result.length;
+            return true;
+        }
+    }
+
+    m_scanComplete = true;
+    return false;
+}
+
+void SearchSession::scanTo(qsizetype offset)
+{
+    while ((m_matches.isEmpty() || m_matches.constLast().start < offset) && scanNext()) {
+    }
+}
+
+QString SearchSession::replaceMatches(QStringView text, const QVector<Match> &matches, const QString &replacement)
+{
+    const qsizetype rangeStart = matches.constFirst().start;
+    const qsizetype rangeEnd = matches.constLast().start + matches.constLast().length;
+
+    QString result;
+    result.reserve(rangeEnd - rangeStart + matches.size() * replacement.size());
+    qsizetype copied = rangeStart;
+    for (const Match &match : matches) {
+        result.append(text.mid(copied, match.start - copied));
+        result.append(replacement);
+        copied = match.start + match.length;
+    }
+    return result;
+}
+
+int SearchSession::lowerBound(qsizetype offset) const
+{
+    auto it = std::lower_bound(m_matches.cbegin(), m_matches.cend(), offset,
+                               [](const Match &match, qsizetype value) {
+                                   return match.start < value;
+                               });
+    return int(it - m_matches.cbegin());
+}
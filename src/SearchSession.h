@@ -0,0 +1,176 @@
+/**
+ * @file SearchSession.h
+ * @brief Incremental search over a document snapshot with cached matches
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+#include <memory>
+
+#include "TextSearch.h"
+
+/**
+ * @class SearchSession
+ * @brief Keeps a compiled pattern and the matches found so far for one text
+ *
+ * The pattern is compiled (and JIT-optimized, for regular expressions) only
+ * when the pattern or the options change. Matches are found by one
+ * continuous forward scan over the whole text snapshot, where lines are
+ * separated by '\n', so regular expressions can match across lines.
+ *
+ * The scan only advances as far as a query needs, and every match found is
+ * kept. Repeated Find Next/Previous calls are answered from the cache
+ * until a different text snapshot is set.
+ *
+ * @see FindReplacePanel, TextSearch, LiteralSearcher
+ */
+class SearchSession
+{
+public:
+    /**
+     * @struct Match
+     * @brief Location of a match in the text
+     */
+    struct Match
+    {
+        qsizetype start = -1; ///< Offset of the match, or -1 for no match
+        qsizetype length = 0; ///< Length of the match
+
+        /** @brief Checks whether this describes an actual match */
+        bool isValid() const { return start >= 0; }
+    };
+
+    /**
+     * @brief Constructs a session without a pattern
+     */
+    SearchSession();
+
+    /**
+     * @brief Destructor
+     */
+    ~SearchSession();
+
+    /**
+     * @brief Sets the pattern, recompiling only if it or the options changed
+     * @param pattern Search pattern
+     * @param options Search options
+     * @return true if the pattern is usable
+     */
+    bool setPattern(const QString &pattern, const SearchOptions &options);
+
+    /**
+     * @brief Sets the text to search, discarding cached matches if it changed
+     * @param text Text snapshot (see TextEditor::plainTextSnapshot())
+     *
+     * Snapshots are compared by identity, so passing the same unchanged
+     * snapshot again keeps the cache.
+     */
+    void setText(const QString &text);
+
+    /**
+     * @brief Checks whether the current pattern is usable
+     * @return false for empty patterns and invalid regular expressions
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Gets the error for an invalid regular expression
+     * @return Error message, or an empty string
+     */
+    QString errorString() const;
+
+    /**
+     * @brief Finds the first match starting at or after an offset
+     * @param from Offset to search from
+     * @param wrap Whether to continue from the start of the text
+     * @return Match, or an invalid match if there is none
+     */
+    Match findNext(qsizetype from, bool wrap = true);
+
+    /**
+     * @brief Finds the last match starting before an offset
+     * @param before Offset to search back from
+     * @param wrap Whether to continue from the end of the text
+     * @return Match, or an invalid match if there is none
+     */
+    Match findPrevious(qsizetype before, bool wrap = true);
+
+    /**
+     * @brief Gets every match in the text
+     * @return Matches in text order
+     */
+    const QVector<Match> &allMatches();
+
+    /**
+     * @brief Builds the text spanned by a run of matches with each one replaced
+     * @param text Text the matches were found in
+     * @param matches Non-empty list of matches in text order
+     * @param replacement Text inserted for every match
+     * @return Replaced text from the start of the first match to the end of the last
+     */
+    static QString replaceMatches(QStringView text, const QVector<Match> &matches, const QString &replacement);
+
+private:
+    /** @brief Discards cached matches and restarts the scan */
+    void resetScan();
+
+    /**
+     * @brief Finds the next match of the forward scan and caches it
+     * @return false once the end of the text is reached
+     */
+    bool scanNext();
+
+    /**
+     * @brief Scans until a match starting at or after an offset is cached
+     * @param offset Offset that must be covered
+     */
+    void scanTo(qsizetype offset);
+
+    /**
+     * @brief Gets the index of the first cached match starting at or after an offset
+     * @param offset Offset to look up
+     * @return Index into m_matches, which may equal its size
+     */
+    int lowerBound(qsizetype offset) const;
+
+    /** @brief Pattern in use */
+    QString m_pattern;
+
+    /** @brief Options in use */
+    SearchOptions m_options;
+
+    /** @brief Whether a pattern has been set */
+    bool m_hasPattern;
+
+    /** @brief Compiled expression for regex searches */
+    QRegularExpression m_expression;
+
+    /** @brief Prepared needle for literal searches */
+    std::unique_ptr<LiteralSearcher> m_literal;
+
+    /** @brief Text being searched */
+    QString m_text;
+
+    /** @brief Regex scan position, valid once m_iteratorStarted is set */
+    QRegularExpressionMatchIterator m_iterator;
+
+    /** @brief Whether m_iterator has been created for the current text */
+    bool m_iteratorStarted;
+
+    /** @brief Literal scan position */
+    qsizetype m_scanOffset;
+
+    /** @brief Whether the scan has reached the end of the text */
+    bool m_scanComplete;
+
+    /** @brief Matches found so far, in text order */
+    QVector<Match> m_matches;
+
+    /** @brief Index of the match returned last, used to answer sequential queries directly */
+    int m_lastIndex;
+};
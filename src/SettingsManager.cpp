@@ -283,6 +283,28 @@ bool SettingsManager::loadRestoreSession() const
     return m_settings->value("restoreSession", true).toBool();
 }
 
+void SettingsManager::saveSearchIndexing(bool enabled)
+{
+    m_settings->setValue("searchIndexing", enabled);
+    emit settingsChanged();
+}
+
+bool SettingsManager::loadSearchIndexing() const
+{
+    return m_settings->value("searchIndexing", false).toBool();
+}
+
+void SettingsManager::saveFollowMaxLines(int lines)
+{
+    m_settings->setValue("followMaxLines", lines);
+    emit settingsChanged();
+}
+
+int SettingsManager::loadFollowMaxLines() const
+{
+    return qMax(0, m_settings->value("followMaxLines", 0).toInt());
+}
+
 // Auto-save for unsaved files
 void SettingsManager::saveAutoSaveContent(const QString &tabId, const QString &content)
 {
@@ -268,6 +268,30 @@ public:
      */
     bool loadRestoreSession() const;
     
+    /**
+     * @brief Saves search index preference
+     * @param enabled true to index the file explorer folder for fast searching
+     */
+    void saveSearchIndexing(bool enabled);
+    
+    /**
+     * @brief Loads search index preference
+     * @return true if the file explorer folder should be indexed
+     */
+    bool loadSearchIndexing() const;
+    
+    /**
+     * @brief Saves the number of lines kept while following a file
+     * @param lines Lines kept at most, 0 to keep all
+     */
+    void saveFollowMaxLines(int lines);
+    
+    /**
+     * @brief Loads the number of lines kept while following a file
+     * @return Lines kept at most, 0 to keep all
+     */
+    int loadFollowMaxLines() const;
+    
     // Auto-save for unsaved files
     /**
      * @brief Saves auto-save content for crash recovery
@@ -1,10 +1,19 @@
 #include "SyntaxHighlighter.h"
+#include "HighlightCache.h"
+#include "GrammarRegistry.h"
+
+#include <QTextBlock>
 
 SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
+    : QSyntaxHighlighter(static_cast<QObject *>(parent))
+    , m_bracketStructure(new BracketStructure(parent, this))
     , m_currentLanguage("text")
+    , m_firstVisibleBlock(0)
+    , m_lastVisibleBlock(INITIAL_VISIBLE_BLOCKS)
+    , m_reapplyingSpans(false)
 {
-    setupPlainTextHighlighting();
+    // Attach only now so the bracket structure sees document changes first
+    setDocument(parent);
 }
 
 SyntaxHighlighter::~SyntaxHighlighter()
@@ -18,23 +27,12 @@ void SyntaxHighlighter::setLanguage(const QString &language)
     }
     
     m_currentLanguage = language;
-    m_highlightingRules.clear();
-    
-    if (language == "cpp" || language == "c") {
-        setupCppHighlighting();
-    } else if (language == "python") {
-        setupPythonHighlighting();
-    } else if (language == "javascript") {
-        setupJavaScriptHighlighting();
-    } else if (language == "json") {
-        setupJsonHighlighting();
-    } else if (language == "xml" || language == "html") {
-        setupXmlHighlighting();
-    } else {
-        setupPlainTextHighlighting();
-    }
+    m_grammar = GrammarRegistry::instance().grammar(language);
     
     rehighlight();
+    
+    // Cached spans refer to block numbers of the initial content only
+    m_tokenCache.reset();
 }
 
 QString SyntaxHighlighter::language() const
@@ -42,28 +40,122 @@ QString SyntaxHighlighter::language() const
     return m_currentLanguage;
 }
 
+void SyntaxHighlighter::setTokenCache(std::unique_ptr<HighlightCache> cache)
+{
+    m_tokenCache = std::move(cache);
+}
+
+const QTextCharFormat &SyntaxHighlighter::formatForToken(TokenType type)
+{
+    const QVector<QTextCharFormat> &formats = palette();
+    const int index = int(type);
+    return index < formats.size() ? formats.at(index) : formats.at(0);
+}
+
+const QVector<QTextCharFormat> &SyntaxHighlighter::palette()
+{
+    // One format per token type, shared by every highlighter instance
+    static const QVector<QTextCharFormat> formats = [] {
+        QVector<QTextCharFormat> result(TOKEN_TYPE_COUNT);
+        
+        QTextCharFormat &keyword = result[int(TokenType::Keyword)];
+        keyword.setForeground(QColor(86, 156, 214)); // VS Code blue
+        keyword.setFontWeight(QFont::Bold);
+        
+        QTextCharFormat &className = result[int(TokenType::Class)];
+        className.setForeground(QColor(78, 201, 176)); // VS Code cyan
+        className.setFontWeight(QFont::Bold);
+        
+        result[int(TokenType::Comment)].setForeground(QColor(106, 153, 85)); // VS Code green
+        result[int(TokenType::MultiLineComment)].setForeground(QColor(106, 153, 85)); // VS Code green
+        result[int(TokenType::String)].setForeground(QColor(206, 145, 120)); // VS Code orange
+        result[int(TokenType::Function)].setForeground(QColor(220, 220, 170)); // VS Code yellow
+        result[int(TokenType::Number)].setForeground(QColor(181, 206, 168)); // VS Code light green
+        result[int(TokenType::Preprocessor)].setForeground(QColor(155, 155, 155)); // VS Code gray
+        result[int(TokenType::Tag)].setForeground(QColor(86, 156, 214)); // VS Code blue
+        
+        return result;
+    }();
+    
+    return formats;
+}
+
+void SyntaxHighlighter::setVisibleBlockRange(int firstBlock, int lastBlock)
+{
+    m_firstVisibleBlock = firstBlock;
+    m_lastVisibleBlock = lastBlock;
+    
+    QTextDocument *doc = document();
+    if (!doc) {
+        return;
+    }
+    
+    const int first = qMax(0, firstBlock - VISIBLE_BLOCK_MARGIN);
+    const int last = qMin(doc->blockCount() - 1, lastBlock + VISIBLE_BLOCK_MARGIN);
+    
+    // Build Qt format ranges for blocks that were lexed while off-screen
+    m_reapplyingSpans = true;
+    for (QTextBlock block = doc->findBlockByNumber(first);
+         block.isValid() && block.blockNumber() <= last; block = block.next()) {
+        const HighlightBlockData *data = static_cast<const HighlightBlockData *>(block.userData());
+        if (data && !data->formatted && !data->spans.isEmpty()) {
+            rehighlightBlock(block);
+        }
+    }
+    m_reapplyingSpans = false;
+}
+
 void SyntaxHighlighter::highlightBlock(const QString &text)
 {
-    // Apply highlighting rules
-    for (const HighlightingRule &rule : m_highlightingRules) {
-        QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
-        while (matchIterator.hasNext()) {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+    if (m_reapplyingSpans) {
+        HighlightBlockData *data = static_cast<HighlightBlockData *>(currentBlockUserData());
+        if (data) {
+            // Spans and state are already current; only the formats are missing
+            setCurrentBlockState(currentBlockState());
+            applySpans(data);
+            return;
         }
     }
     
-    // Multi-line comment highlighting
+    if (m_tokenCache && applyCachedBlock(text)) {
+        return;
+    }
+    
+    QVector<TokenSpan> spans;
     setCurrentBlockState(0);
     
-    if (m_currentLanguage == "cpp" || m_currentLanguage == "c" || m_currentLanguage == "javascript") {
-        QRegularExpressionMatch startMatch = m_commentStartExpression.match(text);
+    if (!m_grammar) {
+        storeBlockSpans(text, spans);
+        return;
+    }
+    
+    // Keywords
+    if (!m_grammar->keywords.isEmpty()) {
+        highlightKeywords(text, spans);
+    }
+    
+    // Apply highlighting rules, in a single scan when they could be combined
+    if (m_grammar->matcher.isValid()) {
+        m_grammar->matcher.scan(text, spans);
+    } else {
+        for (const HighlightingRule &rule : m_grammar->rules) {
+            QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
+            while (matchIterator.hasNext()) {
+                QRegularExpressionMatch match = matchIterator.next();
+                appendSpan(spans, match.capturedStart(), match.capturedLength(), rule.type);
+            }
+        }
+    }
+    
+    // Multi-line comment highlighting
+    if (m_grammar->hasBlockComments) {
+        QRegularExpressionMatch startMatch = m_grammar->blockCommentStart.match(text);
         int startIndex = 0;
         if (previousBlockState() != 1)
             startIndex = startMatch.capturedStart();
         
         while (startIndex >= 0) {
-            QRegularExpressionMatch endMatch = m_commentEndExpression.match(text, startIndex);
+            QRegularExpressionMatch endMatch = m_grammar->blockCommentEnd.match(text, startIndex);
             int endIndex = endMatch.capturedStart();
             int commentLength = 0;
             if (endIndex == -1) {
@@ -72,247 +164,147 @@ void SyntaxHighlighter::highlightBlock(const QString &text)
             } else {
                 commentLength = endIndex - startIndex + endMatch.capturedLength();
             }
-            setFormat(startIndex, commentLength, m_multiLineCommentFormat);
-            startMatch = m_commentStartExpression.match(text, startIndex + commentLength);
+            appendSpan(spans, startIndex, commentLength, TokenType::MultiLineComment);
+            startMatch = m_grammar->blockCommentStart.match(text, startIndex + commentLength);
             startIndex = startMatch.capturedStart();
         }
     }
+    
+    applySpans(storeBlockSpans(text, spans));
 }
 
-void SyntaxHighlighter::setupCppHighlighting()
+void SyntaxHighlighter::highlightKeywords(const QString &text, QVector<TokenSpan> &spans) const
 {
-    HighlightingRule rule;
+    const int length = text.length();
+    int index = 0;
     
-    // Keyword format
-    m_keywordFormat.setForeground(QColor(86, 156, 214)); // VS Code blue
-    m_keywordFormat.setFontWeight(QFont::Bold);
-    QStringList keywordPatterns;
-    keywordPatterns << "\\bauto\\b" << "\\bbool\\b" << "\\bbreak\\b" << "\\bcase\\b"
-                    << "\\bcatch\\b" << "\\bchar\\b" << "\\bclass\\b" << "\\bconst\\b"
-                    << "\\bconstexpr\\b" << "\\bcontinue\\b" << "\\bdefault\\b" << "\\bdelete\\b"
-                    << "\\bdo\\b" << "\\bdouble\\b" << "\\belse\\b" << "\\benum\\b"
-                    << "\\bexplicit\\b" << "\\bextern\\b" << "\\bfloat\\b" << "\\bfor\\b"
-                    << "\\bfriend\\b" << "\\bif\\b" << "\\binline\\b" << "\\bint\\b"
-                    << "\\blong\\b" << "\\bnamespace\\b" << "\\bnew\\b" << "\\boperator\\b"
-                    << "\\bprivate\\b" << "\\bprotected\\b" << "\\bpublic\\b" << "\\breturn\\b"
-                    << "\\bshort\\b" << "\\bsigned\\b" << "\\bsizeof\\b" << "\\bstatic\\b"
-                    << "\\bstruct\\b" << "\\bswitch\\b" << "\\btemplate\\b" << "\\bthis\\b"
-                    << "\\bthrow\\b" << "\\btry\\b" << "\\btypedef\\b" << "\\btypename\\b"
-                    << "\\bunion\\b" << "\\bunsigned\\b" << "\\busing\\b" << "\\bvirtual\\b"
-                    << "\\bvoid\\b" << "\\bvolatile\\b" << "\\bwhile\\b";
-    
-    for (const QString &pattern : keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = m_keywordFormat;
-        m_highlightingRules.append(rule);
+    while (index < length) {
+        if (!isWordCharacter(text.at(index))) {
+            ++index;
+            continue;
+        }
+        
+        const int wordStart = index;
+        while (index < length && isWordCharacter(text.at(index))) {
+            ++index;
+        }
+        
+        if (m_grammar->isKeyword(QStringView(text).mid(wordStart, index - wordStart))) {
+            appendSpan(spans, wordStart, index - wordStart, TokenType::Keyword);
+        }
     }
-    
-    // Class format
-    m_classFormat.setForeground(QColor(78, 201, 176)); // VS Code cyan
-    m_classFormat.setFontWeight(QFont::Bold);
-    rule.pattern = QRegularExpression("\\b[A-Z][a-zA-Z0-9_]*\\b");
-    rule.format = m_classFormat;
-    m_highlightingRules.append(rule);
-    
-    // Single line comment
-    m_singleLineCommentFormat.setForeground(QColor(106, 153, 85)); // VS Code green
-    rule.pattern = QRegularExpression("//[^\n]*");
-    rule.format = m_singleLineCommentFormat;
-    m_highlightingRules.append(rule);
-    
-    // Multi-line comment
-    m_multiLineCommentFormat.setForeground(QColor(106, 153, 85)); // VS Code green
-    m_commentStartExpression = QRegularExpression("/\\*");
-    m_commentEndExpression = QRegularExpression("\\*/");
-    
-    // Quotation
-    m_quotationFormat.setForeground(QColor(206, 145, 120)); // VS Code orange
-    rule.pattern = QRegularExpression("\".*\"");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
-    
-    // Function
-    m_functionFormat.setForeground(QColor(220, 220, 170)); // VS Code yellow
-    rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-    rule.format = m_functionFormat;
-    m_highlightingRules.append(rule);
-    
-    // Numbers
-    m_numberFormat.setForeground(QColor(181, 206, 168)); // VS Code light green
-    rule.pattern = QRegularExpression("\\b\\d+(\\.\\d+)?\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
-    
-    // Preprocessor
-    m_preprocessorFormat.setForeground(QColor(155, 155, 155)); // VS Code gray
-    rule.pattern = QRegularExpression("#[a-zA-Z_][a-zA-Z0-9_]*");
-    rule.format = m_preprocessorFormat;
-    m_highlightingRules.append(rule);
 }
 
-void SyntaxHighlighter::setupPythonHighlighting()
+bool SyntaxHighlighter::isWordCharacter(QChar ch)
 {
-    HighlightingRule rule;
-    
-    // Keyword format
-    m_keywordFormat.setForeground(QColor(86, 156, 214)); // VS Code blue
-    m_keywordFormat.setFontWeight(QFont::Bold);
-    QStringList keywordPatterns;
-    keywordPatterns << "\\band\\b" << "\\bas\\b" << "\\bassert\\b" << "\\bbreak\\b"
-                    << "\\bclass\\b" << "\\bcontinue\\b" << "\\bdef\\b" << "\\bdel\\b"
-                    << "\\belif\\b" << "\\belse\\b" << "\\bexcept\\b" << "\\bexec\\b"
-                    << "\\bfinally\\b" << "\\bfor\\b" << "\\bfrom\\b" << "\\bglobal\\b"
-                    << "\\bif\\b" << "\\bimport\\b" << "\\bin\\b" << "\\bis\\b"
-                    << "\\blambda\\b" << "\\bnot\\b" << "\\bor\\b" << "\\bpass\\b"
-                    << "\\bprint\\b" << "\\braise\\b" << "\\breturn\\b" << "\\btry\\b"
-                    << "\\bwhile\\b" << "\\bwith\\b" << "\\byield\\b";
-    
-    for (const QString &pattern : keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = m_keywordFormat;
-        m_highlightingRules.append(rule);
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+bool SyntaxHighlighter::applyCachedBlock(const QString &text)
+{
+    const HighlightCache::BlockRecord *record = m_tokenCache->block(currentBlock().blockNumber());
+    if (!record || record->textHash != HighlightCache::hashBlockText(text)) {
+        return false;
     }
     
-    // Class format
-    m_classFormat.setForeground(QColor(78, 201, 176)); // VS Code cyan
-    m_classFormat.setFontWeight(QFont::Bold);
-    rule.pattern = QRegularExpression("\\b[A-Z][a-zA-Z0-9_]*\\b");
-    rule.format = m_classFormat;
-    m_highlightingRules.append(rule);
-    
-    // Single line comment
-    m_singleLineCommentFormat.setForeground(QColor(106, 153, 85)); // VS Code green
-    rule.pattern = QRegularExpression("#[^\n]*");
-    rule.format = m_singleLineCommentFormat;
-    m_highlightingRules.append(rule);
-    
-    // Quotation
-    m_quotationFormat.setForeground(QColor(206, 145, 120)); // VS Code orange
-    rule.pattern = QRegularExpression("\".*\"|'.*'");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
-    
-    // Function
-    m_functionFormat.setForeground(QColor(220, 220, 170)); // VS Code yellow
-    rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-    rule.format = m_functionFormat;
-    m_highlightingRules.append(rule);
+    // The cached spans are only valid if lexing starts in the same state
+    const int previousState = qMax(previousBlockState(), 0);
+    if (previousState != m_tokenCache->previousState(currentBlock().blockNumber())) {
+        return false;
+    }
     
-    // Numbers
-    m_numberFormat.setForeground(QColor(181, 206, 168)); // VS Code light green
-    rule.pattern = QRegularExpression("\\b\\d+(\\.\\d+)?\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
+    setCurrentBlockState(record->endState);
+    applySpans(storeBlockSpans(text, m_tokenCache->spans(*record)));
+    return true;
 }
 
-void SyntaxHighlighter::setupJavaScriptHighlighting()
+void SyntaxHighlighter::appendSpan(QVector<TokenSpan> &spans, int start, int length, TokenType type)
 {
-    HighlightingRule rule;
-    
-    // Keyword format
-    m_keywordFormat.setForeground(QColor(86, 156, 214)); // VS Code blue
-    m_keywordFormat.setFontWeight(QFont::Bold);
-    QStringList keywordPatterns;
-    keywordPatterns << "\\bbreak\\b" << "\\bcase\\b" << "\\bcatch\\b" << "\\bcontinue\\b"
-                    << "\\bdefault\\b" << "\\bdelete\\b" << "\\bdo\\b" << "\\belse\\b"
-                    << "\\bfinally\\b" << "\\bfor\\b" << "\\bfunction\\b" << "\\bif\\b"
-                    << "\\bin\\b" << "\\binstanceof\\b" << "\\bnew\\b" << "\\breturn\\b"
-                    << "\\bswitch\\b" << "\\bthis\\b" << "\\bthrow\\b" << "\\btry\\b"
-                    << "\\btypeof\\b" << "\\bvar\\b" << "\\bvoid\\b" << "\\bwhile\\b"
-                    << "\\bwith\\b" << "\\bconst\\b" << "\\blet\\b";
-    
-    for (const QString &pattern : keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = m_keywordFormat;
-        m_highlightingRules.append(rule);
+    if (start < 0 || length <= 0) {
+        return;
     }
     
-    // Single line comment
-    m_singleLineCommentFormat.setForeground(QColor(106, 153, 85)); // VS Code green
-    rule.pattern = QRegularExpression("//[^\n]*");
-    rule.format = m_singleLineCommentFormat;
-    m_highlightingRules.append(rule);
-    
-    // Multi-line comment
-    m_multiLineCommentFormat.setForeground(QColor(106, 153, 85)); // VS Code green
-    m_commentStartExpression = QRegularExpression("/\\*");
-    m_commentEndExpression = QRegularExpression("\\*/");
-    
-    // Quotation
-    m_quotationFormat.setForeground(QColor(206, 145, 120)); // VS Code orange
-    rule.pattern = QRegularExpression("\".*\"|'.*'|`.*`");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
-    
-    // Function
-    m_functionFormat.setForeground(QColor(220, 220, 170)); // VS Code yellow
-    rule.pattern = QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()");
-    rule.format = m_functionFormat;
-    m_highlightingRules.append(rule);
-    
-    // Numbers
-    m_numberFormat.setForeground(QColor(181, 206, 168)); // VS Code light green
-    rule.pattern = QRegularExpression("\\b\\d+(\\.\\d+)?\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
+    TokenSpan span;
+    span.start = quint32(start);
+    span.length = quint32(length > MAX_SPAN_LENGTH ? MAX_SPAN_LENGTH : length);
+    span.type = quint32(type);
+    spans.append(span);
 }
 
-void SyntaxHighlighter::setupJsonHighlighting()
+HighlightBlockData *SyntaxHighlighter::storeBlockSpans(const QString &text, const QVector<TokenSpan> &spans)
 {
-    HighlightingRule rule;
-    
-    // String values
-    m_quotationFormat.setForeground(QColor(206, 145, 120)); // VS Code orange
-    rule.pattern = QRegularExpression("\"[^\"]*\"");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
+    QVector<BracketToken> brackets = collectBrackets(text, spans);
+    m_bracketStructure->setBlockBrackets(currentBlock().blockNumber(), brackets);
     
-    // Numbers
-    m_numberFormat.setForeground(QColor(181, 206, 168)); // VS Code light green
-    rule.pattern = QRegularExpression("\\b\\d+(\\.\\d+)?\\b");
-    rule.format = m_numberFormat;
-    m_highlightingRules.append(rule);
-    
-    // Boolean values
-    m_keywordFormat.setForeground(QColor(86, 156, 214)); // VS Code blue
-    m_keywordFormat.setFontWeight(QFont::Bold);
-    rule.pattern = QRegularExpression("\\b(true|false|null)\\b");
-    rule.format = m_keywordFormat;
-    m_highlightingRules.append(rule);
+    HighlightBlockData *data = static_cast<HighlightBlockData *>(currentBlockUserData());
+    if (!data) {
+        if (spans.isEmpty() && brackets.isEmpty()) {
+            return nullptr;
+        }
+        data = new HighlightBlockData;
+        setCurrentBlockUserData(data);
+    }
+    data->spans = spans;
+    data->spans.squeeze();
+    data->brackets = std::move(brackets);
+    data->formatted = false;
+    return data;
 }
 
-void SyntaxHighlighter::setupXmlHighlighting()
+QVector<BracketToken> SyntaxHighlighter::collectBrackets(const QString &text, const QVector<TokenSpan> &spans)
 {
-    HighlightingRule rule;
+    QVector<BracketToken> brackets;
     
-    // XML element
-    m_classFormat.setForeground(QColor(86, 156, 214)); // VS Code blue
-    rule.pattern = QRegularExpression("</?\\b[A-Za-z0-9_-]+(?=\\s|>)");
-    rule.format = m_classFormat;
-    m_highlightingRules.append(rule);
-    
-    // XML attribute
-    m_functionFormat.setForeground(QColor(220, 220, 170)); // VS Code yellow
-    rule.pattern = QRegularExpression("\\b[A-Za-z0-9_-]+(?=\\s*=)");
-    rule.format = m_functionFormat;
-    m_highlightingRules.append(rule);
-    
-    // XML value
-    m_quotationFormat.setForeground(QColor(206, 145, 120)); // VS Code orange
-    rule.pattern = QRegularExpression("\"[^\"]*\"|'[^']*'");
-    rule.format = m_quotationFormat;
-    m_highlightingRules.append(rule);
+    for (int i = 0; i < text.length(); ++i) {
+        const QChar ch = text.at(i);
+        if (!BracketStructure::isOpeningBracket(ch) && !BracketStructure::isClosingBracket(ch)) {
+            continue;
+        }
+        
+        // Brackets inside strings and comments do not take part in nesting
+        bool excluded = false;
+        for (const TokenSpan &span : spans) {
+            const TokenType type = span.tokenType();
+            if ((type == TokenType::String || type == TokenType::Comment || type == TokenType::MultiLineComment)
+                && quint32(i) >= span.start && quint32(i) < span.start + span.length) {
+                excluded = true;
+                break;
+            }
+        }
+        
+        if (!excluded) {
+            BracketToken token;
+            token.offset = quint32(i);
+            token.character = ch;
+            brackets.append(token);
+        }
+    }
     
-    // XML comment
-    m_singleLineCommentFormat.setForeground(QColor(106, 153, 85)); // VS Code green
-    rule.pattern = QRegularExpression("<!--[^>]*-->");
-    rule.format = m_singleLineCommentFormat;
-    m_highlightingRules.append(rule);
+    brackets.squeeze();
+    return brackets;
 }
 
-void SyntaxHighlighter::setupPlainTextHighlighting()
+const BracketStructure *SyntaxHighlighter::bracketStructure() const
 {
-    // No highlighting for plain text
-    m_highlightingRules.clear();
+    return m_bracketStructure;
 }
 
+void SyntaxHighlighter::applySpans(HighlightBlockData *data)
+{
+    if (!data) {
+        return;
+    }
+    
+    // Off-screen blocks keep only their compact spans; setVisibleBlockRange()
+    // builds the format ranges once they scroll into view
+    const int blockNumber = currentBlock().blockNumber();
+    if (blockNumber < m_firstVisibleBlock - VISIBLE_BLOCK_MARGIN ||
+        blockNumber > m_lastVisibleBlock + VISIBLE_BLOCK_MARGIN) {
+        return;
+    }
+    
+    for (const TokenSpan &span : data->spans) {
+        setFormat(int(span.start), int(span.length), formatForToken(span.tokenType()));
+    }
+    data->formatted = true;
+}
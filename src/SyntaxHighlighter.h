@@ -13,18 +13,86 @@
 #include <QRegularExpression>
 #include <QHash>
 #include <QTextBlockUserData>
+#include <QVector>
+#include <memory>
+
+#include "BracketStructure.h"
+
+class HighlightCache;
+struct Grammar;
+
+/**
+ * @enum TokenType
+ * @brief Identifies the syntax element a highlighted span belongs to
+ * 
+ * Token types are stored instead of formats wherever spans need to be
+ * persisted, so the values must stay stable across releases.
+ */
+enum class TokenType : quint8
+{
+    None = 0,          ///< No highlighting
+    Keyword,           ///< Language keywords
+    Class,             ///< Class and type names
+    Comment,           ///< Single-line comments
+    MultiLineComment,  ///< Block comments
+    String,            ///< Quoted strings and character literals
+    Function,          ///< Function names and calls
+    Number,            ///< Numeric literals
+    Operator,          ///< Operators
+    Preprocessor,      ///< Preprocessor directives
+    Tag                ///< Markup element names
+};
+
+/**
+ * @struct TokenSpan
+ * @brief A highlighted range within a single text block
+ * 
+ * Packed into 8 bytes so that large documents can keep the spans of every
+ * block in memory while only visible blocks carry Qt format ranges.
+ */
+struct TokenSpan
+{
+    quint32 start;       ///< Offset of the span within the block
+    quint32 length : 24; ///< Length of the span in characters
+    quint32 type : 8;    ///< TokenType of the span
+    
+    /** @brief Gets the span's token type */
+    TokenType tokenType() const { return TokenType(type); }
+};
 
 /**
  * @struct HighlightingRule
- * @brief Associates a regular expression pattern with text formatting
+ * @brief Associates a regular expression pattern with a token type
  * 
  * Used by SyntaxHighlighter to define highlighting rules for different
- * language elements like keywords, strings, comments, etc.
+ * language elements like keywords, strings, comments, etc. The format
+ * for the token type comes from the shared palette.
  */
 struct HighlightingRule
 {
     QRegularExpression pattern; ///< Regular expression to match text
-    QTextCharFormat format;     ///< Formatting to apply to matched text
+    TokenType type;             ///< Token type recorded for matched text
+};
+
+/**
+ * @class HighlightBlockData
+ * @brief Per-block highlighting results kept alongside the text block
+ * 
+ * Spans are recorded in the order they were applied, so replaying them
+ * reproduces the block's formatting exactly. HighlightCache serializes
+ * these spans together with the block state.
+ */
+class HighlightBlockData : public QTextBlockUserData
+{
+public:
+    /** @brief Token spans applied to the block, in application order */
+    QVector<TokenSpan> spans;
+    
+    /** @brief Brackets outside strings and comments, in text order */
+    QVector<BracketToken> brackets;
+    
+    /** @brief Whether Qt format ranges have been built from the spans */
+    bool formatted = false;
 };
 
 /**
@@ -32,18 +100,11 @@ struct HighlightingRule
  * @brief Multi-language syntax highlighter for the text editor
  * 
  * SyntaxHighlighter extends QSyntaxHighlighter to provide syntax highlighting
- * for multiple programming languages:
- * - C/C++ with keywords, preprocessor directives, and comments
- * - Python with indentation-aware highlighting
- * - JavaScript with modern ES6+ features
- * - JSON with proper structure highlighting
- * - XML with tag and attribute highlighting
- * - Plain text (no highlighting)
+ * for every language known to GrammarRegistry. The keywords, pattern rules
+ * and block comment delimiters of each language come from a declarative
+ * grammar definition; languages without a grammar are shown as plain text.
  * 
- * The highlighter automatically detects language based on file extension
- * and applies appropriate color schemes for different syntax elements.
- * 
- * @see TextEditor, HighlightingRule
+ * @see TextEditor, GrammarRegistry, HighlightingRule
  */
 class SyntaxHighlighter : public QSyntaxHighlighter
 {
@@ -63,9 +124,9 @@ public:
 
     /**
      * @brief Sets the programming language for highlighting
-     * @param language Language identifier (cpp, python, javascript, json, xml, plain)
+     * @param language Language identifier or alias known to GrammarRegistry
      * 
-     * Changes the highlighting rules to match the specified language.
+     * Switches to the language's compiled grammar, compiling it on first use.
      * Triggers re-highlighting of the entire document.
      */
     void setLanguage(const QString &language);
@@ -75,6 +136,40 @@ public:
      * @return Language identifier currently in use
      */
     QString language() const;
+    
+    /**
+     * @brief Installs a persisted token cache for the next full rehighlight
+     * @param cache Cache loaded for the current document content, or nullptr
+     * 
+     * Blocks whose text and incoming state still match the cache are colored
+     * from the stored spans instead of being lexed. The cache is released
+     * once the next rehighlight triggered by setLanguage() has finished.
+     */
+    void setTokenCache(std::unique_ptr<HighlightCache> cache);
+    
+    /**
+     * @brief Gets the text format used for a token type
+     * @param type Token type to look up
+     * @return Interned format shared by all highlighters
+     */
+    static const QTextCharFormat &formatForToken(TokenType type);
+    
+    /**
+     * @brief Tells the highlighter which blocks are currently on screen
+     * @param firstBlock Number of the first visible block
+     * @param lastBlock Number of the last visible block
+     * 
+     * Every block is lexed, but Qt format ranges are only built for blocks
+     * near the visible range. Blocks entering the range are formatted from
+     * their stored spans without being lexed again.
+     */
+    void setVisibleBlockRange(int firstBlock, int lastBlock);
+    
+    /**
+     * @brief Gets the bracket nesting maintained from the lexed blocks
+     * @return Bracket structure of the highlighted document
+     */
+    const BracketStructure *bracketStructure() const;
 
 protected:
     /**
@@ -87,64 +182,98 @@ protected:
     void highlightBlock(const QString &text) override;
 
 private:
-    // Language Setup Methods
-    /** @brief Configures highlighting rules for C/C++ syntax */
-    void setupCppHighlighting();
+    /**
+     * @brief Colors the current block from the token cache if it is still valid
+     * @param text Text content of the block
+     * @return true if the block was highlighted from the cache
+     */
+    bool applyCachedBlock(const QString &text);
     
-    /** @brief Configures highlighting rules for Python syntax */
-    void setupPythonHighlighting();
+    /**
+     * @brief Records keyword spans for every word of the block found in the grammar
+     * @param text Text content of the block
+     * @param spans Span list of the block being highlighted
+     */
+    void highlightKeywords(const QString &text, QVector<TokenSpan> &spans) const;
     
-    /** @brief Configures highlighting rules for JavaScript syntax */
-    void setupJavaScriptHighlighting();
+    /**
+     * @brief Checks whether a character can be part of a keyword
+     * @param ch Character to test
+     * @return true for letters, digits and underscores
+     */
+    static bool isWordCharacter(QChar ch);
     
-    /** @brief Configures highlighting rules for JSON syntax */
-    void setupJsonHighlighting();
+    /**
+     * @brief Records a token span for the block being highlighted
+     * @param spans Span list of the block being highlighted
+     * @param start Offset within the block
+     * @param length Length of the span
+     * @param type Token type of the span
+     */
+    static void appendSpan(QVector<TokenSpan> &spans, int start, int length, TokenType type);
     
-    /** @brief Configures highlighting rules for XML/HTML syntax */
-    void setupXmlHighlighting();
+    /**
+     * @brief Stores the recorded spans and brackets in the current block's user data
+     * @param text Text content of the block
+     * @param spans Spans recorded while highlighting the block
+     * @return Block data holding the spans, or nullptr if there are none
+     * 
+     * Also reports the block's brackets to the bracket structure.
+     */
+    HighlightBlockData *storeBlockSpans(const QString &text, const QVector<TokenSpan> &spans);
     
-    /** @brief Disables syntax highlighting for plain text */
-    void setupPlainTextHighlighting();
+    /**
+     * @brief Finds the brackets of a block that lie outside strings and comments
+     * @param text Text content of the block
+     * @param spans Token spans of the block
+     * @return Bracket tokens in text order
+     */
+    static QVector<BracketToken> collectBrackets(const QString &text, const QVector<TokenSpan> &spans);
     
-    // Highlighting Data
-    /** @brief Vector of all highlighting rules for current language */
-    QVector<HighlightingRule> m_highlightingRules;
+    /**
+     * @brief Builds Qt format ranges from stored spans if the block is visible
+     * @param data Block data of the current block (may be nullptr)
+     */
+    void applySpans(HighlightBlockData *data);
     
-    // Text Formats for Different Elements
-    /** @brief Format for language keywords (if, while, class, etc.) */
-    QTextCharFormat m_keywordFormat;
+    /**
+     * @brief Gets the interned format palette indexed by TokenType
+     * @return Formats shared by all highlighter instances
+     */
+    static const QVector<QTextCharFormat> &palette();
     
-    /** @brief Format for class and type names */
-    QTextCharFormat m_classFormat;
+    // Highlighting Data
+    /** @brief Bracket nesting of the document, updated as blocks are lexed */
+    BracketStructure *m_bracketStructure;
     
-    /** @brief Format for single-line comments (// in C++, # in Python) */
-    QTextCharFormat m_singleLineCommentFormat;
+    /** @brief Compiled grammar of the current language (nullptr for plain text) */
+    std::shared_ptr<const Grammar> m_grammar;
     
-    /** @brief Format for multi-line comments (block comments) */
-    QTextCharFormat m_multiLineCommentFormat;
+    /** @brief Currently active language identifier */
+    QString m_currentLanguage;
     
-    /** @brief Format for quoted strings and character literals */
-    QTextCharFormat m_quotationFormat;
+    /** @brief Persisted token cache used during the initial highlight pass */
+    std::unique_ptr<HighlightCache> m_tokenCache;
     
-    /** @brief Format for function names and calls */
-    QTextCharFormat m_functionFormat;
+    // Visible Range Tracking
+    /** @brief First block reported visible by the editor */
+    int m_firstVisibleBlock;
     
-    /** @brief Format for numeric literals */
-    QTextCharFormat m_numberFormat;
+    /** @brief Last block reported visible by the editor */
+    int m_lastVisibleBlock;
     
-    /** @brief Format for operators (+, -, *, etc.) */
-    QTextCharFormat m_operatorFormat;
+    /** @brief Whether highlightBlock() only rebuilds formats from stored spans */
+    bool m_reapplyingSpans;
     
-    /** @brief Format for preprocessor directives (#include, #define) */
-    QTextCharFormat m_preprocessorFormat;
+    /** @brief Number of token types in the palette */
+    static const int TOKEN_TYPE_COUNT = int(TokenType::Tag) + 1;
     
-    // Multi-line Comment Handling
-    /** @brief Regular expression to find start of block comments */
-    QRegularExpression m_commentStartExpression;
+    /** @brief Longest span representable in TokenSpan::length */
+    static const int MAX_SPAN_LENGTH = 0x00ffffff;
     
-    /** @brief Regular expression to find end of block comments */
-    QRegularExpression m_commentEndExpression;
+    /** @brief Blocks formatted before the editor reports a visible range */
+    static const int INITIAL_VISIBLE_BLOCKS = 200;
     
-    /** @brief Currently active language identifier */
-    QString m_currentLanguage;
+    /** @brief Blocks above and below the visible range that are formatted too */
+    static const int VISIBLE_BLOCK_MARGIN = 50;
 };
\ No newline at end of file
@@ -72,6 +72,23 @@ TextEditor *TabWidget::editorAt(int index) const
     return qobject_cast<TextEditor*>(widget(index));
 }
 
+int TabWidget::findFile(const QString &filePath) const
+{
+    const QString canonicalPath = QFileInfo(filePath).canonicalFilePath();
+    if (canonicalPath.isEmpty()) {
+        return -1;
+    }
+    
+    for (int i = 0; i < count(); ++i) {
+        TextEditor *editor = editorAt(i);
+        if (editor && !editor->filePath().isEmpty()
+            && QFileInfo(editor->filePath()).canonicalFilePath() == canonicalPath) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 bool TabWidget::closeTab(int index)
 {
     if (index < 0 || index >= count()) {
@@ -164,8 +181,18 @@ void TabWidget::updateTabTitle(int index)
     TextEditor *editor = editorAt(index);
     if (!editor) return;
     
+    // Preview tabs show the previewed file and are reused for the next one
+    if (editor->isPreview()) {
+        setTabText(index, getTabTitle(editor->previewPath()));
+        setTabToolTip(index, editor->isPreviewTruncated()
+            ? tr("Preview of the start of %1").arg(editor->previewPath())
+            : tr("Preview of %1").arg(editor->previewPath()));
+        return;
+    }
+    
     QString title = getTabTitle(editor->filePath(), editor->isModified());
     setTabText(index, title);
+    setTabToolTip(index, editor->filePath());
 }
 
 QString TabWidget::getTabTitle(const QString &filePath, bool modified)
@@ -74,6 +74,13 @@ public:
      */
     TextEditor *editorAt(int index) const;
     
+    /**
+     * @brief Finds the tab index of the editor showing a file
+     * @param filePath Path of the file; symbolic links are resolved
+     * @return Tab index, or -1 if the file is not open
+     */
+    int findFile(const QString &filePath) const;
+    
     /**
      * @brief Closes tab at specified index with unsaved change handling
      * @param index Index of tab to close
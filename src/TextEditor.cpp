@@ -1,5 +1,10 @@
 #include "TextEditor.h"
 #include "SyntaxHighlighter.h"
+#include "HighlightCache.h"
+#include "GrammarRegistry.h"
+#include "MatchHighlighter.h"
+#include "FileWatchService.h"
+#include "ContentHash.h"
 
 #include <QApplication>
 #include <QPainter>
@@ -14,8 +19,12 @@
 #include <QCompleter>
 #include <QAbstractItemView>
 #include <QScrollArea>
+#include <QFile>
 #include <QFileInfo>
 #include <QAbstractTextDocumentLayout>
+#include <QTextLayout>
+#include <QPromise>
+#include <QThreadPool>
 
 TextEditor::TextEditor(QWidget *parent)
     : QTextEdit(parent)
@@ -26,23 +35,63 @@ TextEditor::TextEditor(QWidget *parent)
     , m_baseZoomLevel(0)
     , m_lineNumberArea(nullptr)
     , m_syntaxHighlighter(nullptr)
+    , m_matchHighlighter(nullptr)
+    , m_matchTickArea(nullptr)
     , m_completer(nullptr)
     , m_cursorTimer(nullptr)
-    , m_fileWatcher(nullptr)
+    , m_hashWatcher(nullptr)
+    , m_reloadWatcher(nullptr)
+    , m_reloadRevision(0)
+    , m_followMode(false)
+    , m_followOffset(0)
+    , m_followWatcher(nullptr)
+    , m_followReadPending(false)
+    , m_preview(false)
+    , m_previewTruncated(false)
+    , m_snapshotValid(false)
 {
     setupEditor();
     setupSyntaxHighlighter();
     
     m_lineNumberArea = new LineNumberArea(this);
     
+    // Search match highlights
+    m_matchHighlighter = new MatchHighlighter(document(), this);
+    m_matchTickArea = new MatchTickArea(this);
+    m_matchTickArea->hide();
+    verticalScrollBar()->installEventFilter(this);
+    connect(m_matchHighlighter, &MatchHighlighter::matchesChanged, this, [this]() {
+        viewport()->update();
+        m_matchTickArea->update();
+    });
+    connect(m_matchHighlighter, &MatchHighlighter::scanOutdated, this, [this]() {
+        m_matchHighlighter->rescan(plainTextSnapshot());
+    });
+    
     connect(document(), &QTextDocument::blockCountChanged, this, &TextEditor::updateLineNumberAreaWidth);
-    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() { m_lineNumberArea->update(); });
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() {
+        m_lineNumberArea->update();
+        updateVisibleHighlighting();
+    });
     connect(this, &QTextEdit::cursorPositionChanged, this, &TextEditor::onCursorPositionChanged);
     connect(this, &QTextEdit::textChanged, this, &TextEditor::onTextChanged);
+    connect(document(), &QTextDocument::contentsChanged, this, [this]() {
+        m_snapshotValid = false;
+        m_snapshot.clear();
+    });
+    
+    // Content check of changed files
+    m_hashWatcher = new QFutureWatcher<quint64>(this);
+    connect(m_hashWatcher, &QFutureWatcher<quint64>::finished, this, &TextEditor::onDiskHashReady);
     
-    // File change detection
-    m_fileWatcher = new QFileSystemWatcher(this);
-    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged, this, &TextEditor::onFileChanged);
+    // Incremental reloads
+    m_reloadWatcher = new QFutureWatcher<QVector<LineDiff::Hunk>>(this);
+    connect(m_reloadWatcher, &QFutureWatcher<QVector<LineDiff::Hunk>>::finished,
+            this, &TextEditor::onReloadDiffReady);
+    
+    // Follow mode
+    m_followWatcher = new QFutureWatcher<FollowChunk>(this);
+    connect(m_followWatcher, &QFutureWatcher<FollowChunk>::finished, this, &TextEditor::onFollowReadReady);
     
     updateLineNumberAreaWidth(0);
     highlightCurrentLine();
@@ -50,6 +99,7 @@ TextEditor::TextEditor(QWidget *parent)
 
 TextEditor::~TextEditor()
 {
+    saveHighlightCache();
 }
 
 void TextEditor::setupEditor()
@@ -85,37 +135,166 @@ void TextEditor::setFilePath(const QString &filePath)
 {
     // Remove previous file from watcher
     if (!m_filePath.isEmpty()) {
-        m_fileWatcher->removePath(m_filePath);
+        FileWatchService::instance().unwatch(m_filePath, this);
     }
     
     m_filePath = filePath;
+    m_diskHash.reset();
+    if (!m_hashWatcher->isFinished()) {
+        m_hashWatcher->cancel();
+    }
     
     // Add new file to watcher and store last modified time
     if (!filePath.isEmpty() && QFile::exists(filePath)) {
-        m_fileWatcher->addPath(filePath);
+        FileWatchService::instance().watch(filePath, this, [this](const QString &) {
+            onFileChanged(m_filePath);
+        });
         QFileInfo fileInfo(filePath);
         m_lastModified = fileInfo.lastModified();
     }
     
-    // Auto-detect language from file extension
+    // Auto-detect language from the file name
     if (!filePath.isEmpty()) {
-        QFileInfo fileInfo(filePath);
-        QString extension = fileInfo.suffix().toLower();
+        QString language = GrammarRegistry::instance().languageForFile(filePath);
+        
+        // Reuse highlighting results from a previous session when available
+        if (language != m_language && m_syntaxHighlighter) {
+            m_syntaxHighlighter->setTokenCache(HighlightCache::load(document(), language));
+        }
+        setLanguage(language);
+    }
+}
+
+void TextEditor::setDiskContent(QByteArrayView data)
+{
+    m_diskHash = ContentHash::hash(data);
+    if (!m_filePath.isEmpty()) {
+        m_lastModified = QFileInfo(m_filePath).lastModified();
+    }
+}
+
+bool TextEditor::setFollowMode(bool enabled, int maxLines)
+{
+    if (enabled == m_followMode) {
+        if (enabled) {
+            document()->setMaximumBlockCount(maxLines);
+        }
+        return true;
+    }
+    
+    if (enabled) {
+        if (m_filePath.isEmpty() || m_modified) {
+            return false;
+        }
+        if (!m_reloadWatcher->isFinished()) {
+            m_reloadWatcher->cancel();
+        }
+        if (!m_hashWatcher->isFinished()) {
+            m_hashWatcher->cancel();
+        }
         
-        if (extension == "cpp" || extension == "cxx" || extension == "cc" || extension == "c" || extension == "h" || extension == "hpp") {
-            setLanguage("cpp");
-        } else if (extension == "py") {
-            setLanguage("python");
-        } else if (extension == "js" || extension == "ts") {
-            setLanguage("javascript");
-        } else if (extension == "json") {
-            setLanguage("json");
-        } else if (extension == "xml" || extension == "html") {
-            setLanguage("xml");
+        m_followMode = true;
+        if (!syncFollowedFile()) {
+            m_followMode = false;
+            return false;
+        }
+        
+        // Appends are not undoable, and old lines drop off past the limit
+        setReadOnly(true);
+        document()->setUndoRedoEnabled(false);
+        document()->setMaximumBlockCount(maxLines);
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+        return true;
+    }
+    
+    m_followMode = false;
+    m_followReadPending = false;
+    if (!m_followWatcher->isFinished()) {
+        m_followWatcher->cancel();
+    }
+    
+    // Bring back dropped lines and anything appended since the last read
+    document()->setMaximumBlockCount(0);
+    syncFollowedFile();
+    document()->setUndoRedoEnabled(true);
+    setReadOnly(false);
+    return true;
+}
+
+bool TextEditor::isFollowMode() const
+{
+    return m_followMode;
+}
+
+bool TextEditor::showPreview(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    // Map just the head of the file; reading is the fallback where mapping fails
+    const qint64 fileSize = file.size();
+    const qint64 size = qMin<qint64>(fileSize, PREVIEW_SIZE);
+    QByteArray buffer;
+    QByteArrayView head;
+    if (size > 0) {
+        if (const uchar *mapped = file.map(0, size)) {
+            head = QByteArrayView(mapped, size);
         } else {
-            setLanguage("text");
+            buffer = file.read(size);
+            head = buffer;
         }
     }
+    
+    // Line breaks are stripped of '\r' as when following the file
+    if (head.contains('\r')) {
+        buffer = head.toByteArray();
+        buffer.replace("\r", "");
+        head = buffer;
+    }
+    
+    // A character cut off by the end of the preview is left out
+    QStringDecoder decoder(QStringConverter::encodingForData(head).value_or(QStringConverter::Utf8));
+    const QString text = decoder.decode(head);
+    
+    m_preview = true;
+    m_previewPath = filePath;
+    m_previewTruncated = fileSize > size;
+    setReadOnly(true);
+    document()->setUndoRedoEnabled(false);
+    setLanguage(GrammarRegistry::instance().languageForFile(filePath));
+    setPlainText(text);
+    setModified(false);
+    return true;
+}
+
+void TextEditor::endPreview()
+{
+    if (!m_preview) {
+        return;
+    }
+    
+    m_preview = false;
+    m_previewPath.clear();
+    m_previewTruncated = false;
+    document()->setUndoRedoEnabled(true);
+    setReadOnly(false);
+}
+
+bool TextEditor::isPreview() const
+{
+    return m_preview;
+}
+
+QString TextEditor::previewPath() const
+{
+    return m_previewPath;
+}
+
+bool TextEditor::isPreviewTruncated() const
+{
+    return m_previewTruncated;
 }
 
 QString TextEditor::filePath() const
@@ -136,6 +315,23 @@ QString TextEditor::language() const
     return m_language;
 }
 
+void TextEditor::saveHighlightCache()
+{
+    // Unsaved content would never match the file on disk again
+    if (!m_filePath.isEmpty() && !m_modified) {
+        HighlightCache::store(document(), m_language);
+    }
+}
+
+QString TextEditor::plainTextSnapshot() const
+{
+    if (!m_snapshotValid) {
+        m_snapshot = toPlainText();
+        m_snapshotValid = true;
+    }
+    return m_snapshot;
+}
+
 bool TextEditor::isModified() const
 {
     return m_modified;
@@ -234,6 +430,347 @@ void TextEditor::resizeEvent(QResizeEvent *e)
 
     QRect cr = contentsRect();
     m_lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    
+    updateVisibleHighlighting();
+}
+
+void TextEditor::setSearchHighlight(const QString &pattern, const SearchOptions &options)
+{
+    m_matchHighlighter->setPattern(pattern, options, plainTextSnapshot());
+    m_matchTickArea->setGeometry(verticalScrollBar()->rect());
+    m_matchTickArea->setVisible(m_matchHighlighter->isActive());
+}
+
+void TextEditor::clearSearchHighlight()
+{
+    m_matchHighlighter->clear();
+    m_matchTickArea->hide();
+}
+
+void TextEditor::replaceMatches(const QVector<SearchSession::Match> &matches, const QString &replacement)
+{
+    // Cursor edits are not blocked by the read-only flag
+    if (matches.isEmpty() || isReadOnly()) {
+        return;
+    }
+    
+    // Build the replaced text between the first and last match in one pass
+    const qsizetype rangeStart = matches.constFirst().start;
+    const qsizetype rangeEnd = matches.constLast().start + matches.constLast().length;
+    const QString result = SearchSession::replaceMatches(plainTextSnapshot(), matches, replacement);
+    
+    // Keep the cursor where it was relative to the surrounding text
+    const int cursorPosition = textCursor().position();
+    int newCursorPosition = cursorPosition;
+    if (cursorPosition >= rangeEnd) {
+        newCursorPosition = int(cursorPosition + result.size() - (rangeEnd - rangeStart));
+    } else if (cursorPosition > rangeStart) {
+        newCursorPosition = int(rangeStart);
+    }
+    
+    // A single edit: one undo step, one layout update and one highlight pass
+    QTextCursor cursor(document());
+    cursor.beginEditBlock();
+    cursor.setPosition(int(rangeStart));
+    cursor.setPosition(int(rangeEnd), QTextCursor::KeepAnchor);
+    cursor.insertText(result);
+    cursor.endEditBlock();
+    
+    QTextCursor editorCursor = textCursor();
+    editorCursor.setPosition(newCursorPosition);
+    setTextCursor(editorCursor);
+}
+
+void TextEditor::reloadText(const QString &text)
+{
+    if (!m_reloadWatcher->isFinished()) {
+        m_reloadWatcher->cancel();
+    }
+    
+    m_reloadText = text;
+    m_reloadRevision = document()->revision();
+    
+    auto promise = std::make_shared<QPromise<QVector<LineDiff::Hunk>>>();
+    m_reloadWatcher->setFuture(promise->future());
+    promise->start();
+    
+    const QString current = plainTextSnapshot();
+    QThreadPool::globalInstance()->start([promise, current, text]() {
+        if (!promise->isCanceled()) {
+            QVector<LineDiff::Hunk> hunks = LineDiff::compute(*promise, current, text);
+            if (!promise->isCanceled()) {
+                promise->addResult(std::move(hunks));
+            }
+        }
+        promise->finish();
+    });
+}
+
+void TextEditor::onReloadDiffReady()
+{
+    if (m_reloadWatcher->future().isCanceled() || m_reloadWatcher->future().resultCount() == 0) {
+        return;
+    }
+    
+    // The document was edited meanwhile; compare again
+    if (document()->revision() != m_reloadRevision) {
+        reloadText(m_reloadText);
+        return;
+    }
+    
+    applyLineHunks(m_reloadWatcher->result(), m_reloadText);
+    m_reloadText.clear();
+    setModified(false);
+}
+
+void TextEditor::applyLineHunks(const QVector<LineDiff::Hunk> &hunks, const QString &text)
+{
+    if (hunks.isEmpty()) {
+        return;
+    }
+    
+    const QList<QStringView> lines = QStringView(text).split(QLatin1Char('\n'));
+    const int scrollValue = verticalScrollBar()->value();
+    QTextDocument *doc = document();
+    
+    // Last hunk first, so earlier hunks keep their line numbers
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+    for (auto it = hunks.crbegin(); it != hunks.crend(); ++it) {
+        const LineDiff::Hunk &hunk = *it;
+        
+        QString inserted;
+        for (int line = hunk.newStart; line < hunk.newStart + hunk.newCount; ++line) {
+            if (line > hunk.newStart) {
+                inserted += QLatin1Char('\n');
+            }
+            inserted.append(lines.at(line));
+        }
+        
+        // Positions exclude the newline of the last line they cover
+        const QTextBlock lastBlock = doc->lastBlock();
+        const int documentEnd = lastBlock.position() + lastBlock.length() - 1;
+        int start = 0;
+        int end = 0;
+        if (hunk.oldCount > 0 && hunk.newCount > 0) {
+            const QTextBlock last = doc->findBlockByNumber(hunk.oldStart + hunk.oldCount - 1);
+            start = doc->findBlockByNumber(hunk.oldStart).position();
+            end = last.position() + last.length() - 1;
+        } else if (hunk.oldCount == 0) {
+            if (hunk.oldStart < doc->blockCount()) {
+                start = end = doc->findBlockByNumber(hunk.oldStart).position();
+                inserted += QLatin1Char('\n');
+            } else {
+                start = end = documentEnd;
+                inserted.prepend(QLatin1Char('\n'));
+            }
+        } else if (hunk.oldStart + hunk.oldCount < doc->blockCount()) {
+            start = doc->findBlockByNumber(hunk.oldStart).position();
+            end = doc->findBlockByNumber(hunk.oldStart + hunk.oldCount).position();
+        } else {
+            // Deleting the last lines also removes the newline before them
+            const QTextBlock before = doc->findBlockByNumber(hunk.oldStart - 1);
+            start = before.isValid() ? before.position() + before.length() - 1 : 0;
+            end = documentEnd;
+        }
+        
+        cursor.setPosition(start);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+        if (inserted.isEmpty()) {
+            cursor.removeSelectedText();
+        } else {
+            cursor.insertText(inserted);
+        }
+    }
+    cursor.endEditBlock();
+    
+    verticalScrollBar()->setValue(scrollValue);
+}
+
+bool TextEditor::syncFollowedFile()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    const QByteArray data = file.readAll();
+    m_followOffset = data.size();
+    m_followTail = data.right(FOLLOW_CHECK_SIZE);
+    
+    // Carriage returns are dropped like reading in text mode does
+    QByteArray textData = data;
+    textData.replace("\r", "");
+    m_followDecoder = QStringDecoder(QStringDecoder::Utf8);
+    const QString text = m_followDecoder.decode(textData);
+    
+    QPromise<QVector<LineDiff::Hunk>> promise;
+    applyLineHunks(LineDiff::compute(promise, plainTextSnapshot(), text), text);
+    setDiskContent(textData);
+    setModified(false);
+    return true;
+}
+
+void TextEditor::startFollowRead()
+{
+    if (!m_followWatcher->isFinished()) {
+        m_followReadPending = true;
+        return;
+    }
+    
+    auto promise = std::make_shared<QPromise<FollowChunk>>();
+    m_followWatcher->setFuture(promise->future());
+    promise->start();
+    
+    const QString path = m_filePath;
+    const qint64 offset = m_followOffset;
+    const QByteArray tail = m_followTail;
+    QThreadPool::globalInstance()->start([promise, path, offset, tail]() {
+        FollowChunk chunk;
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly) && file.size() >= offset
+            && file.seek(offset - tail.size()) && file.read(tail.size()) == tail) {
+            // The bytes before the previous end are unchanged, so the file only grew
+            chunk.appended = true;
+            chunk.data = file.readAll();
+        }
+        promise->addResult(std::move(chunk));
+        promise->finish();
+    });
+}
+
+void TextEditor::onFollowReadReady()
+{
+    if (!m_followMode || m_followWatcher->future().isCanceled() || m_followWatcher->future().resultCount() == 0) {
+        return;
+    }
+    
+    const FollowChunk chunk = m_followWatcher->result();
+    if (!chunk.appended) {
+        // Truncated or rewritten, e.g. rotated logs: start over
+        const int maxLines = document()->maximumBlockCount();
+        document()->setMaximumBlockCount(0);
+        syncFollowedFile();
+        document()->setMaximumBlockCount(maxLines);
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    } else if (!chunk.data.isEmpty()) {
+        m_followOffset += chunk.data.size();
+        m_followTail = (m_followTail + chunk.data).right(FOLLOW_CHECK_SIZE);
+        
+        QByteArray textData = chunk.data;
+        textData.replace("\r", "");
+        const QString text = m_followDecoder.decode(textData);
+        
+        // Appending at the end only lays out the new lines
+        QScrollBar *scrollBar = verticalScrollBar();
+        const bool atEnd = scrollBar->value() == scrollBar->maximum();
+        QTextCursor cursor(document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(text);
+        if (atEnd) {
+            scrollBar->setValue(scrollBar->maximum());
+        }
+    }
+    
+    if (m_followReadPending) {
+        m_followReadPending = false;
+        startFollowRead();
+    }
+}
+
+void TextEditor::paintEvent(QPaintEvent *event)
+{
+    QTextEdit::paintEvent(event);
+    
+    if (m_matchHighlighter->matchCount() == 0) {
+        return;
+    }
+    
+    QPainter painter(viewport());
+    const QColor matchColor(255, 165, 0, 90);
+    
+    // Document coordinates of the area being painted
+    const QPointF scroll(horizontalScrollBar()->value(), verticalScrollBar()->value());
+    const QRectF area = QRectF(event->rect()).translated(scroll);
+    QAbstractTextDocumentLayout *documentLayout = document()->documentLayout();
+    
+    for (QTextBlock block = cursorForPosition(event->rect().topLeft()).block(); block.isValid(); block = block.next()) {
+        const QRectF blockRect = documentLayout->blockBoundingRect(block);
+        if (blockRect.top() > area.bottom()) {
+            break;
+        }
+        
+        QTextLayout *layout = block.layout();
+        if (!block.isVisible() || !layout) {
+            continue;
+        }
+        
+        for (int i = 0; i < layout->lineCount(); ++i) {
+            const QTextLine line = layout->lineAt(i);
+            const QRectF lineRect = line.rect().translated(blockRect.topLeft());
+            if (lineRect.bottom() < area.top() || lineRect.top() > area.bottom()) {
+                continue;
+            }
+            
+            // Only the visible columns of long lines are looked up
+            const int lineStart = line.textStart();
+            const int lineEnd = lineStart + line.textLength();
+            const int firstColumn = qMax(lineStart, line.xToCursor(area.left() - blockRect.left()) - 1);
+            const int lastColumn = qMin(lineEnd, line.xToCursor(area.right() - blockRect.left()) + 1);
+            
+            for (int index = m_matchHighlighter->firstMatchEndingAfter(block.position() + firstColumn);
+                 index < m_matchHighlighter->matchCount(); ++index) {
+                const SearchSession::Match &match = m_matchHighlighter->matchAt(index);
+                const qsizetype start = match.start - block.position();
+                if (start >= lastColumn) {
+                    break;
+                }
+                
+                // Matches spanning lines are drawn up to the end of this line
+                const qreal left = line.cursorToX(int(qMax<qsizetype>(start, lineStart)));
+                const qreal right = line.cursorToX(int(qMin<qsizetype>(start + match.length, lineEnd)));
+                const QRectF rect(left, line.y(), qMax(right - left, 2.0), line.height());
+                painter.fillRect(rect.translated(blockRect.topLeft() - scroll), matchColor);
+            }
+        }
+    }
+}
+
+void TextEditor::matchTickAreaPaintEvent(QPaintEvent *event)
+{
+    QPainter painter(m_matchTickArea);
+    const QColor tickColor(255, 140, 0);
+    
+    // One bucket per pixel row of the scroll bar
+    const QVector<int> &histogram = m_matchHighlighter->histogram(m_matchTickArea->height());
+    const int tickWidth = m_matchTickArea->width() / 2;
+    const int tickLeft = m_matchTickArea->width() - tickWidth;
+    
+    for (int y = event->rect().top(); y <= event->rect().bottom() && y < histogram.size(); ++y) {
+        if (histogram.at(y) > 0) {
+            painter.fillRect(tickLeft, y, tickWidth, 2, tickColor);
+        }
+    }
+}
+
+bool TextEditor::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == verticalScrollBar() && event->type() == QEvent::Resize) {
+        m_matchTickArea->setGeometry(verticalScrollBar()->rect());
+    }
+    
+    return QTextEdit::eventFilter(watched, event);
+}
+
+void TextEditor::updateVisibleHighlighting()
+{
+    if (!m_syntaxHighlighter) {
+        return;
+    }
+    
+    const int firstBlock = cursorForPosition(QPoint(0, 0)).blockNumber();
+    const int lastBlock = cursorForPosition(QPoint(0, viewport()->height())).blockNumber();
+    m_syntaxHighlighter->setVisibleBlockRange(firstBlock, lastBlock);
 }
 
 void TextEditor::highlightCurrentLine()
@@ -251,6 +788,8 @@ void TextEditor::highlightCurrentLine()
         selection.cursor.clearSelection();
         extraSelections.append(selection);
     }
+    
+    extraSelections.append(m_bracketSelections);
 
     setExtraSelections(extraSelections);
 }
@@ -304,6 +843,25 @@ void TextEditor::contextMenuEvent(QContextMenuEvent *event)
 
 void TextEditor::keyPressEvent(QKeyEvent *event)
 {
+    // Editing a preview turns it into a regular editor first
+    if (m_preview) {
+        const QString text = event->text();
+        const bool typing = !text.isEmpty() && text.at(0).isPrint()
+            && !(event->modifiers() & (Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier));
+        const bool editing = typing
+            || event->key() == Qt::Key_Return || event->key() == Qt::Key_Enter
+            || event->key() == Qt::Key_Tab || event->key() == Qt::Key_Backtab
+            || event->key() == Qt::Key_Backspace || event->key() == Qt::Key_Delete
+            || event->matches(QKeySequence::Paste) || event->matches(QKeySequence::Cut);
+        if (editing) {
+            emit promotionRequested();
+        }
+        if (m_preview) {
+            QTextEdit::keyPressEvent(event);
+            return;
+        }
+    }
+    
     if (handleTabIndentation(event)) {
         return;
     }
@@ -333,6 +891,7 @@ void TextEditor::wheelEvent(QWheelEvent *event)
 
 void TextEditor::onCursorPositionChanged()
 {
+    matchBrackets();
     highlightCurrentLine();
     
     QTextCursor cursor = textCursor();
@@ -346,7 +905,8 @@ void TextEditor::onCursorPositionChanged()
 
 void TextEditor::onTextChanged()
 {
-    if (!m_modified) {
+    // Appends of a followed file mirror the disk, and a preview shows it
+    if (!m_modified && !m_followMode && !m_preview) {
         setModified(true);
     }
 }
@@ -357,6 +917,11 @@ void TextEditor::onFileChanged(const QString &path)
         return;
     }
     
+    if (m_followMode) {
+        startFollowRead();
+        return;
+    }
+    
     // Check if file still exists
     QFileInfo fileInfo(path);
     if (!fileInfo.exists()) {
@@ -371,7 +936,45 @@ void TextEditor::onFileChanged(const QString &path)
     }
     
     m_lastModified = newModified;
-    emit fileChangedExternally(path);
+    
+    // Without a recorded content every change is reported
+    if (!m_diskHash) {
+        emit fileChangedExternally(path);
+        return;
+    }
+    
+    // Hash the file off the GUI thread; only different content is reported
+    if (!m_hashWatcher->isFinished()) {
+        m_hashWatcher->cancel();
+    }
+    auto promise = std::make_shared<QPromise<quint64>>();
+    m_hashWatcher->setFuture(promise->future());
+    promise->start();
+    QThreadPool::globalInstance()->start([promise, path]() {
+        if (!promise->isCanceled()) {
+            if (const std::optional<quint64> hash = ContentHash::hashFile(path)) {
+                promise->addResult(*hash);
+            }
+        }
+        promise->finish();
+    });
+}
+
+void TextEditor::onDiskHashReady()
+{
+    if (m_hashWatcher->future().isCanceled()) {
+        return;
+    }
+    
+    // An unreadable file counts as changed
+    const std::optional<quint64> hash = m_hashWatcher->future().resultCount() > 0
+        ? std::optional<quint64>(m_hashWatcher->result()) : std::nullopt;
+    if (hash && hash == m_diskHash) {
+        return;
+    }
+    
+    m_diskHash = hash;
+    emit fileChangedExternally(m_filePath);
 }
 
 void TextEditor::autoIndent()
@@ -405,7 +1008,57 @@ void TextEditor::autoIndent()
 
 void TextEditor::matchBrackets()
 {
-    // TODO: Implement bracket matching
+    m_bracketSelections.clear();
+    
+    if (!m_syntaxHighlighter) {
+        return;
+    }
+    
+    const BracketStructure *brackets = m_syntaxHighlighter->bracketStructure();
+    const int position = textCursor().position();
+    
+    // Prefer the bracket after the cursor, then the one before it
+    int bracketPosition = -1;
+    int matchPosition = -1;
+    for (int candidate : { position, position - 1 }) {
+        if (candidate < 0) {
+            continue;
+        }
+        const QChar ch = document()->characterAt(candidate);
+        if (!BracketStructure::isOpeningBracket(ch) && !BracketStructure::isClosingBracket(ch)) {
+            continue;
+        }
+        matchPosition = brackets->matchingBracket(candidate);
+        bracketPosition = candidate;
+        if (matchPosition >= 0) {
+            break;
+        }
+    }
+    
+    if (bracketPosition < 0) {
+        return;
+    }
+    
+    const QChar bracket = document()->characterAt(bracketPosition);
+    const QChar match = matchPosition >= 0 ? document()->characterAt(matchPosition) : QChar();
+    const bool matched = BracketStructure::isOpeningBracket(bracket)
+        ? BracketStructure::isMatchingPair(bracket, match)
+        : BracketStructure::isMatchingPair(match, bracket);
+    
+    QTextCharFormat format;
+    format.setBackground(matched ? QColor(180, 238, 180) : QColor(255, 180, 180));
+    
+    for (int selectionPosition : { bracketPosition, matchPosition }) {
+        if (selectionPosition < 0) {
+            continue;
+        }
+        QTextEdit::ExtraSelection selection;
+        selection.format = format;
+        selection.cursor = QTextCursor(document());
+        selection.cursor.setPosition(selectionPosition);
+        selection.cursor.setPosition(selectionPosition + 1, QTextCursor::KeepAnchor);
+        m_bracketSelections.append(selection);
+    }
 }
 
 bool TextEditor::handleTabIndentation(QKeyEvent *event)
@@ -21,14 +21,22 @@
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QTimer>
-#include <QFileSystemWatcher>
 #include <QDateTime>
+#include <QFutureWatcher>
+#include <QStringDecoder>
 #include <memory>
+#include <optional>
+
+#include "TextSearch.h"
+#include "SearchSession.h"
+#include "LineDiff.h"
 
 class SyntaxHighlighter;
+class MatchHighlighter;
 class QCompleter;
 
 class LineNumberArea;
+class MatchTickArea;
 
 /**
  * @class TextEditor
@@ -82,6 +90,77 @@ public:
      */
     QString filePath() const;
     
+    /**
+     * @brief Records the content of the file on disk after loading or saving it
+     * @param data Bytes of the file, as read in text mode
+     * 
+     * Change notifications for the file are only forwarded as
+     * fileChangedExternally() when the content on disk differs from the
+     * recorded content, so touching a file or rewriting it unchanged does
+     * not prompt for a reload.
+     */
+    void setDiskContent(QByteArrayView data);
+    
+    /**
+     * @brief Follows the file as it grows, like tail -f
+     * @param enabled Whether to follow the file
+     * @param maxLines Lines kept at most while following, 0 to keep all
+     * @return false if following was requested for an untitled, modified
+     *         or unreadable document
+     * 
+     * While following, the editor is read-only and changes of the file do
+     * not emit fileChangedExternally(). When the file only grew, just the
+     * new bytes are read and appended, and the view keeps scrolling with
+     * the end if it was showing it. A file that was truncated or rewritten
+     * is loaded again. Leaving follow mode restores any lines dropped
+     * because of @p maxLines.
+     */
+    bool setFollowMode(bool enabled, int maxLines = 0);
+    
+    /**
+     * @brief Checks whether the editor follows its file
+     * @return true while following
+     */
+    bool isFollowMode() const;
+    
+    /**
+     * @brief Shows the start of a file as a read-only preview
+     * @param filePath File to preview
+     * @return false if the file cannot be read
+     * 
+     * Only the first PREVIEW_SIZE bytes are mapped and decoded, and the
+     * file is neither watched nor set as the editor's file path, so
+     * browsing through many files stays cheap. Highlighting covers the
+     * visible lines as usual. Typing into a preview emits
+     * promotionRequested() before the key is handled.
+     */
+    bool showPreview(const QString &filePath);
+    
+    /**
+     * @brief Leaves preview mode and makes the editor editable again
+     * 
+     * The previewed text stays until it is replaced by the whole file.
+     */
+    void endPreview();
+    
+    /**
+     * @brief Checks whether the editor shows a preview
+     * @return true between showPreview() and endPreview()
+     */
+    bool isPreview() const;
+    
+    /**
+     * @brief Gets the previewed file
+     * @return Path passed to showPreview(), or empty if not previewing
+     */
+    QString previewPath() const;
+    
+    /**
+     * @brief Checks whether the preview shows only part of its file
+     * @return true if the file is larger than PREVIEW_SIZE
+     */
+    bool isPreviewTruncated() const;
+    
     /**
      * @brief Sets the programming language for syntax highlighting
      * @param language Language identifier (e.g., "cpp", "python", "javascript")
@@ -94,6 +173,24 @@ public:
      */
     QString language() const;
     
+    /**
+     * @brief Persists the current highlighting results for this file
+     * 
+     * Reopening the same content later colors it from the cache instead
+     * of lexing it again. Called on save and when the editor is destroyed.
+     */
+    void saveHighlightCache();
+    
+    /**
+     * @brief Gets the document text as plain text
+     * @return Text with lines separated by '\n'
+     * 
+     * The copy is kept until the document changes, so repeated searches do
+     * not convert the document again. The returned string is implicitly
+     * shared and can be handed to worker threads.
+     */
+    QString plainTextSnapshot() const;
+    
     /**
      * @brief Checks if the document has been modified
      * @return true if document has unsaved changes
@@ -156,6 +253,51 @@ public:
      * Called by LineNumberArea widget to draw line numbers.
      */
     void lineNumberAreaPaintEvent(QPaintEvent *event);
+    
+    /**
+     * @brief Highlights every match of a search pattern
+     * @param pattern Search pattern; empty or invalid patterns remove the highlights
+     * @param options Search options
+     * 
+     * The document is searched on a worker thread. Matches are kept current
+     * while the document is edited and are marked on the vertical scroll bar.
+     */
+    void setSearchHighlight(const QString &pattern, const SearchOptions &options);
+    
+    /**
+     * @brief Removes the highlights set by setSearchHighlight()
+     */
+    void clearSearchHighlight();
+    
+    /**
+     * @brief Replaces matches found in plainTextSnapshot() as one undo step
+     * @param matches Matches in text order, taken from the current snapshot
+     * @param replacement Text inserted for every match
+     * 
+     * The text between the first and last match is rebuilt in one pass and
+     * inserted with a single edit, and the cursor keeps its place relative
+     * to the surrounding text. A read-only editor is left unchanged.
+     */
+    void replaceMatches(const QVector<SearchSession::Match> &matches, const QString &replacement);
+    
+    /**
+     * @brief Replaces the content with new text, e.g. the file reloaded from disk
+     * @param text New content
+     * 
+     * The changed lines are found on a worker thread (see LineDiff) and
+     * applied as one undoable edit, so unchanged lines keep their
+     * highlighting and bookmarks, and the cursor and scroll position stay
+     * in place. The document is marked unmodified once the text is applied.
+     */
+    void reloadText(const QString &text);
+    
+    /**
+     * @brief Handles paint events for the scroll bar match ticks
+     * @param event Paint event containing drawing region
+     * 
+     * Called by MatchTickArea widget to draw the ticks.
+     */
+    void matchTickAreaPaintEvent(QPaintEvent *event);
 
 public slots:
     /** @brief Highlights the current line with background color */
@@ -199,6 +341,14 @@ signals:
      * @param filePath Path of the file that was modified
      */
     void fileChangedExternally(const QString &filePath);
+    
+    /**
+     * @brief Emitted when the user starts editing a preview
+     * 
+     * Receivers are expected to load the whole file and call endPreview()
+     * before returning; otherwise the key is dropped.
+     */
+    void promotionRequested();
 
 protected:
     /**
@@ -224,6 +374,22 @@ protected:
      * @param event Resize event
      */
     void resizeEvent(QResizeEvent *event) override;
+    
+    /**
+     * @brief Paints the text, then the search match highlights
+     * @param event Paint event
+     * 
+     * Only the matches within the visible lines are looked up.
+     */
+    void paintEvent(QPaintEvent *event) override;
+    
+    /**
+     * @brief Keeps the match ticks sized to the vertical scroll bar
+     * @param watched Object receiving the event
+     * @param event Event being delivered
+     * @return false, so the event is always delivered
+     */
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private slots:
     /** @brief Internal handler for cursor position changes */
@@ -231,6 +397,15 @@ private slots:
     
     /** @brief Internal handler for text content changes */
     void onTextChanged();
+    
+    /** @brief Compares the hash of the changed file with the recorded content */
+    void onDiskHashReady();
+    
+    /** @brief Applies the changed lines found for reloadText() */
+    void onReloadDiffReady();
+    
+    /** @brief Appends the bytes read from the followed file */
+    void onFollowReadReady();
 
 private:
     /** @brief Sets up editor configuration and connections */
@@ -239,10 +414,18 @@ private:
     /** @brief Initializes syntax highlighter based on file type */
     void setupSyntaxHighlighter();
     
+    /** @brief Reports the on-screen block range to the syntax highlighter */
+    void updateVisibleHighlighting();
+    
     /** @brief Performs automatic indentation on new lines */
     void autoIndent();
     
-    /** @brief Highlights matching brackets/parentheses */
+    /**
+     * @brief Highlights the bracket at the cursor and its match
+     * 
+     * Uses the highlighter's bracket structure, so brackets in strings and
+     * comments are ignored and no document-wide scan is needed.
+     */
     void matchBrackets();
     
     /**
@@ -252,6 +435,22 @@ private:
      */
     bool handleTabIndentation(QKeyEvent *event);
     
+    /**
+     * @brief Replaces changed lines in one edit block
+     * @param hunks Changed lines, computed against the current content
+     * @param text New content the hunks refer to
+     */
+    void applyLineHunks(const QVector<LineDiff::Hunk> &hunks, const QString &text);
+    
+    /**
+     * @brief Makes the content match the followed file
+     * @return false if the file cannot be read
+     */
+    bool syncFollowedFile();
+    
+    /** @brief Reads what was appended to the followed file on a worker thread */
+    void startFollowRead();
+    
     // File Association
     /** @brief Full path to associated file (empty for untitled documents) */
     QString m_filePath;
@@ -275,17 +474,86 @@ private:
     /** @brief Syntax highlighter for code coloring */
     SyntaxHighlighter *m_syntaxHighlighter;
     
+    /** @brief Matches of the search pattern, highlighted at paint time */
+    MatchHighlighter *m_matchHighlighter;
+    
+    /** @brief Widget drawing match ticks over the vertical scroll bar */
+    MatchTickArea *m_matchTickArea;
+    
     /** @brief Auto-completion provider (future enhancement) */
     QCompleter *m_completer;
     
     /** @brief Timer for cursor-related updates */
     QTimer *m_cursorTimer;
     
-    /** @brief File system watcher for external change detection */
-    QFileSystemWatcher *m_fileWatcher;
-    
     /** @brief Last modification time for change detection */
     QDateTime m_lastModified;
+    
+    /** @brief Hash of the file content last loaded, saved or reported as changed */
+    std::optional<quint64> m_diskHash;
+    
+    /** @brief Watches the hashing of the changed file */
+    QFutureWatcher<quint64> *m_hashWatcher;
+    
+    /** @brief Watches the comparison started by reloadText() */
+    QFutureWatcher<QVector<LineDiff::Hunk>> *m_reloadWatcher;
+    
+    /** @brief Text being reloaded */
+    QString m_reloadText;
+    
+    /** @brief Document revision the reload comparison started from */
+    int m_reloadRevision;
+    
+    /**
+     * @brief Bytes appended to the followed file
+     */
+    struct FollowChunk
+    {
+        bool appended = false; ///< false if the file was truncated or rewritten instead
+        QByteArray data;       ///< New bytes
+    };
+    
+    /** @brief Whether the editor follows its file */
+    bool m_followMode;
+    
+    /** @brief Size of the followed file when it was last read */
+    qint64 m_followOffset;
+    
+    /** @brief Last bytes read from the followed file, for telling appends from rewrites */
+    QByteArray m_followTail;
+    
+    /** @brief Decodes appended bytes, keeping characters split between reads */
+    QStringDecoder m_followDecoder;
+    
+    /** @brief Watches the read of appended bytes */
+    QFutureWatcher<FollowChunk> *m_followWatcher;
+    
+    /** @brief Whether the file changed again while it was being read */
+    bool m_followReadPending;
+    
+    /** @brief Bytes compared before the previous end of a followed file */
+    static const int FOLLOW_CHECK_SIZE = 4096;
+    
+    /** @brief Whether the editor shows a preview */
+    bool m_preview;
+    
+    /** @brief File shown by the preview */
+    QString m_previewPath;
+    
+    /** @brief Whether the previewed file is larger than the preview */
+    bool m_previewTruncated;
+    
+    /** @brief Bytes of a file shown by a preview */
+    static const int PREVIEW_SIZE = 256 * 1024;
+    
+    /** @brief Cached result of plainTextSnapshot() */
+    mutable QString m_snapshot;
+    
+    /** @brief Whether m_snapshot matches the current document content */
+    mutable bool m_snapshotValid;
+    
+    /** @brief Highlights of the bracket at the cursor and its match */
+    QList<QTextEdit::ExtraSelection> m_bracketSelections;
 };
 
 /**
@@ -332,4 +600,43 @@ protected:
 private:
     /** @brief Pointer to associated text editor */
     TextEditor *m_textEditor;
-};
\ No newline at end of file
+};
+
+/**
+ * @class MatchTickArea
+ * @brief Transparent overlay marking search matches on the scroll bar
+ * 
+ * MatchTickArea covers the vertical scroll bar of a TextEditor, lets
+ * mouse events through and delegates all painting to the TextEditor.
+ * 
+ * @see TextEditor, MatchHighlighter
+ */
+class MatchTickArea : public QWidget
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the tick area over an editor's scroll bar
+     * @param editor TextEditor that this tick area serves
+     */
+    MatchTickArea(TextEditor *editor)
+        : QWidget(editor->verticalScrollBar()), m_textEditor(editor)
+    {
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+    }
+
+protected:
+    /**
+     * @brief Handles paint events by delegating to TextEditor
+     * @param event Paint event to handle
+     */
+    void paintEvent(QPaintEvent *event) override
+    {
+        m_textEditor->matchTickAreaPaintEvent(event);
+    }
+
+private:
+    /** @brief Pointer to associated text editor */
+    TextEditor *m_textEditor;
+};
@@ -0,0 +1,253 @@
+#include "TextSearch.h"
+
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTSEARCH_USE_SSE2
+#endif
+
+namespace
+{
+
+#ifdef TEXTSEARCH_USE_SSE2
+/** @brief Folds the ASCII upper-case letters of eight UTF-16 units */
+inline __m128i foldAscii8(__m128i chars)
+{
+    const __m128i upper = _mm_and_si128(_mm_cmpgt_epi16(chars, _mm_set1_epi16('A' - 1)),
+                                        _mm_cmplt_epi16(chars, _mm_set1_epi16('Z' + 1)));
+    return _mm_add_epi16(chars, _mm_and_si128(upper, _mm_set1_epi16(0x20)));
+}
+#endif
+
+bool isAscii(QStringView text)
+{
+    for (QChar ch : text) {
+        if (ch.unicode() >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+QRegularExpression TextSearch::compile(const QString &pattern, const SearchOptions &options)
+{
+    QRegularExpression::PatternOptions patternOptions = QRegularExpression::MultilineOption;
+    if (!options.caseSensitive) {
+        patternOptions |= QRegularExpression::CaseInsensitiveOption;
+    }
+
+    const QString source = options.wholeWords
+        ? QString("\\b(?:%1)\\b").arg(pattern)
+        : pattern;
+
+    QRegularExpression expression(source, patternOptions);
+    expression.optimize();
+    return expression;
+}
+
+bool TextSearch::isWholeWord(QStringView text, qsizetype start, qsizetype length)
+{
+    if (start > 0 && isWordCharacter(text.at(start - 1))) {
+        return false;
+    }
+    const qsizetype end = start + length;
+    if (end < text.size() && isWordCharacter(text.at(end))) {
+        return false;
+    }
+    return true;
+}
+
+bool TextSearch::isWordCharacter(QChar ch)
+{
+    return ch.isLetterOrNumber() || ch == QLatin1Char('_');
+}
+
+LiteralSearcher::LiteralSearcher(const QString &needle, const SearchOptions &options)
+    : m_needle(needle)
+    , m_fold(false)
+    , m_wholeWords(options.wholeWords)
+    , m_mode(Mode::Filter)
+{
+    if (!options.caseSensitive) {
+        if (isAscii(needle)) {
+            m_fold = true;
+            for (QChar &ch : m_needle) {
+                ch = QChar(foldAscii(ch.unicode()));
+            }
+        } else {
+            m_mode = Mode::Fallback;
+        }
+    }
+
+    if (m_mode == Mode::Filter && m_needle.size() >= LONG_NEEDLE) {
+        m_mode = Mode::Horspool;
+
+        // Shifts are keyed by the low byte only, which keeps the table small
+        // and only ever makes a shift shorter than the exact one
+        const qsizetype last = m_needle.size() - 1;
+        const quint16 defaultShift = quint16(qMin<qsizetype>(m_needle.size(), 0xffff));
+        m_shifts.fill(defaultShift, 256);
+        for (qsizetype i = 0; i < last; ++i) {
+            const int index = m_needle.at(i).unicode() & 0xff;
+            m_shifts[index] = quint16(qMin<qsizetype>(last - i, 0xffff));
+        }
+    }
+}
+
+qsizetype LiteralSearcher::find(QStringView text, qsizetype from, qsizetype limit) const
+{
+    const qsizetype needleSize = m_needle.size();
+    if (needleSize == 0 || from < 0) {
+        return -1;
+    }
+
+    // Candidates start in [from, end) and must fit inside the text
+    const qsizetype end = qMin(limit, text.size() - needleSize + 1);
+    if (from >= end) {
+        return -1;
+    }
+
+    switch (m_mode) {
+    case Mode::Filter:
+        return findFiltered(text.utf16(), text.size(), from, end);
+    case Mode::Horspool:
+        return findHorspool(text.utf16(), text.size(), from, end);
+    case Mode::Fallback:
+        return findFallback(text, from, end);
+    }
+    return -1;
+}
+
+qsizetype LiteralSearcher::findLast(QStringView text, qsizetype before) const
+{
+    // Search windows backwards from before, keeping the last match of the
+    // first window that has one
+    qsizetype windowEnd = qMin(before, text.size());
+    while (windowEnd > 0) {
+        const qsizetype windowStart = qMax<qsizetype>(0, windowEnd - REVERSE_WINDOW);
+        qsizetype last = -1;
+        qsizetype position = windowStart;
+        while ((position = find(text, position, windowEnd)) >= 0) {
+            last = position;
+            ++position;
+        }
+        if (last >= 0) {
+            return last;
+        }
+        windowEnd = windowStart;
+    }
+    return -1;
+}
+
+qsizetype LiteralSearcher::length() const
+{
+    return m_needle.size();
+}
+
+qsizetype LiteralSearcher::findFiltered(const char16_t *data, qsizetype size, qsizetype from, qsizetype end) const
+{
+    const qsizetype lastOffset = m_needle.size() - 1;
+    const char16_t first = m_needle.at(0).unicode();
+    const char16_t last = m_needle.at(lastOffset).unicode();
+    qsizetype position = from;
+
+#ifdef TEXTSEARCH_USE_SSE2
+    // Compare the first and last needle characters against eight candidate
+    // positions per step; end guarantees both loads stay inside the text
+    const __m128i firstChars = _mm_set1_epi16(short(first));
+    const __m128i lastChars = _mm_set1_epi16(short(last));
+    for (; position + 8 <= end; position += 8) {
+        __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + position));
+        __m128i lastBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + position + lastOffset));
+        if (m_fold) {
+            firstBlock = foldAscii8(firstBlock);
+            lastBlock = foldAscii8(lastBlock);
+        }
+
+        uint mask = uint(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(firstBlock, firstChars),
+                                                         _mm_cmpeq_epi16(lastBlock, lastChars))));
+        while (mask) {
+            const uint bit = qCountTrailingZeroBits(mask);
+            const qsizetype candidate = position + bit / 2;
+            if (verify(data, candidate) && accept(data, size, candidate)) {
+                return candidate;
+            }
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+
+    for (; position < end; ++position) {
+        char16_t firstChar = data[position];
+        char16_t lastChar = data[position + lastOffset];
+        if (m_fold) {
+            firstChar = foldAscii(firstChar);
+            lastChar = foldAscii(lastChar);
+        }
+        if (firstChar == first && lastChar == last && verify(data, position) && accept(data, size, position)) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+qsizetype LiteralSearcher::findHorspool(const char16_t *data, qsizetype size, qsizetype from, qsizetype end) const
+{
+    const qsizetype lastOffset = m_needle.size() - 1;
+    const char16_t last = m_needle.at(lastOffset).unicode();
+
+    qsizetype position = from;
+    while (position < end) {
+        char16_t ch = data[position + lastOffset];
+        if (m_fold) {
+            ch = foldAscii(ch);
+        }
+        if (ch == last && verify(data, position) && accept(data, size, position)) {
+            return position;
+        }
+        position += m_shifts.at(ch & 0xff);
+    }
+    return -1;
+}
+
+qsizetype LiteralSearcher::findFallback(QStringView text, qsizetype from, qsizetype end) const
+{
+    const QStringView haystack = text.first(end + m_needle.size() - 1);
+    qsizetype position = from;
+    while ((position = haystack.indexOf(m_needle, position, Qt::CaseInsensitive)) >= 0) {
+        if (accept(text.utf16(), text.size(), position)) {
+            return position;
+        }
+        ++position;
+    }
+    return -1;
+}
+
+bool LiteralSearcher::verify(const char16_t *data, qsizetype position) const
+{
+    const char16_t *needle = reinterpret_cast<const char16_t *>(m_needle.utf16());
+    const qsizetype size = m_needle.size();
+
+    if (!m_fold) {
+        return std::memcmp(data + position, needle, size_t(size) * sizeof(char16_t)) == 0;
+    }
+
+    for (qsizetype i = 0; i < size; ++i) {
+        if (foldAscii(data[position + i]) != needle[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LiteralSearcher::accept(const char16_t *data, qsizetype size, qsizetype position) const
+{
+    if (!m_wholeWords) {
+        return true;
+    }
+    return TextSearch::isWholeWord(QStringView(data, size), position, m_needle.size());
+}
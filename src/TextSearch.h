@@ -0,0 +1,167 @@
+/**
+ * @file TextSearch.h
+ * @brief Search primitives shared by the find features
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QString>
+#include <QStringView>
+#include <QRegularExpression>
+#include <QVector>
+
+/**
+ * @struct SearchOptions
+ * @brief Options selected in the find panel
+ */
+struct SearchOptions
+{
+    bool caseSensitive = false; ///< Match letter case exactly
+    bool wholeWords = false;    ///< Only match complete words
+    bool useRegex = false;      ///< Treat the pattern as a regular expression
+};
+
+/**
+ * @class TextSearch
+ * @brief Stateless search helpers that work on plain text snapshots
+ *
+ * The helpers operate on QString or QStringView data rather than on a
+ * QTextDocument, so they can run on a worker thread against a snapshot
+ * taken with TextEditor::plainTextSnapshot(). Lines are separated by '\n'.
+ *
+ * @see LiteralSearcher, MatchCounter, FindReplacePanel
+ */
+class TextSearch
+{
+public:
+    /**
+     * @brief Builds the regular expression for a regex search
+     * @param pattern Pattern typed by the user
+     * @param options Search options
+     * @return Expression honoring case and whole-word options; check isValid()
+     *
+     * '^' and '$' match at line boundaries, as they do when searching a
+     * document block by block.
+     */
+    static QRegularExpression compile(const QString &pattern, const SearchOptions &options);
+
+    /**
+     * @brief Checks whether a range of text is delimited by word boundaries
+     * @param text Text containing the range
+     * @param start Start of the range
+     * @param length Length of the range
+     * @return true if neither neighbor of the range continues a word
+     */
+    static bool isWholeWord(QStringView text, qsizetype start, qsizetype length);
+
+    /**
+     * @brief Checks whether a character can be part of a word
+     * @param ch Character to test
+     * @return true for letters, digits and underscores
+     */
+    static bool isWordCharacter(QChar ch);
+};
+
+/**
+ * @class LiteralSearcher
+ * @brief Prepared literal needle with a fast scanning kernel
+ *
+ * The searcher scans contiguous UTF-16 text directly instead of walking
+ * document blocks. Candidate positions are filtered by comparing the first
+ * and last needle characters against eight positions at once with SSE2
+ * where available, and only candidates passing both checks are verified.
+ * Needles of LONG_NEEDLE characters or more use Horspool skipping instead.
+ *
+ * Case-insensitive searches for ASCII needles fold ASCII letters inline;
+ * other case-insensitive needles fall back to QStringView::indexOf().
+ * Whole-word checks are applied to each verified match before it is
+ * returned.
+ *
+ * @see TextSearch, MatchCounter
+ */
+class LiteralSearcher
+{
+public:
+    /**
+     * @brief Prepares a needle for searching
+     * @param needle Text to find
+     * @param options Search options (useRegex is ignored)
+     */
+    LiteralSearcher(const QString &needle, const SearchOptions &options);
+
+    /**
+     * @brief Finds the first match starting in a range
+     * @param text Text to search
+     * @param from Offset to start searching at
+     * @param limit Only matches starting before this offset are reported
+     * @return Offset of the match, or -1 if there is none
+     */
+    qsizetype find(QStringView text, qsizetype from, qsizetype limit) const;
+
+    /**
+     * @brief Finds the last match starting before an offset
+     * @param text Text to search
+     * @param before Only matches starting before this offset are reported
+     * @return Offset of the match, or -1 if there is none
+     */
+    qsizetype findLast(QStringView text, qsizetype before) const;
+
+    /**
+     * @brief Gets the length of a match
+     * @return Needle length in UTF-16 code units
+     */
+    qsizetype length() const;
+
+private:
+    /**
+     * @enum Mode
+     * @brief Scanning strategy chosen for the needle
+     */
+    enum class Mode
+    {
+        Filter,   ///< First/last character filter, vectorized where possible
+        Horspool, ///< Horspool skip loop for long needles
+        Fallback  ///< QStringView::indexOf() for non-ASCII case folding
+    };
+
+    /** @brief Scans with the first/last character filter */
+    qsizetype findFiltered(const char16_t *data, qsizetype size, qsizetype from, qsizetype end) const;
+
+    /** @brief Scans with Horspool skipping */
+    qsizetype findHorspool(const char16_t *data, qsizetype size, qsizetype from, qsizetype end) const;
+
+    /** @brief Scans with QStringView::indexOf() */
+    qsizetype findFallback(QStringView text, qsizetype from, qsizetype end) const;
+
+    /** @brief Compares the needle against the text at a candidate offset */
+    bool verify(const char16_t *data, qsizetype position) const;
+
+    /** @brief Checks the whole-word condition for a verified candidate */
+    bool accept(const char16_t *data, qsizetype size, qsizetype position) const;
+
+    /** @brief Folds an ASCII upper-case letter to lower case */
+    static char16_t foldAscii(char16_t ch) { return (ch >= u'A' && ch <= u'Z') ? char16_t(ch + 0x20) : ch; }
+
+    /** @brief Needle, with ASCII letters folded when m_fold is set */
+    QString m_needle;
+
+    /** @brief Whether ASCII letters are compared case-insensitively */
+    bool m_fold;
+
+    /** @brief Whether matches must be whole words */
+    bool m_wholeWords;
+
+    /** @brief Strategy used by find() */
+    Mode m_mode;
+
+    /** @brief Horspool shift by low byte of the text character */
+    QVector<quint16> m_shifts;
+
+    /** @brief Needles at least this long use Horspool skipping */
+    static const int LONG_NEEDLE = 32;
+
+    /** @brief Characters searched per step of findLast() */
+    static const int REVERSE_WINDOW = 1 << 16;
+};
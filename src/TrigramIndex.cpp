@@ -0,0 +1,983 @@
+#include "TrigramIndex.h"
+#include "FileSearchEngine.h"
+#include "FileWatchService.h"
+#include "WorkspaceWalker.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QReadWriteLock>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QRegularExpression>
+#include <QThread>
+#include <QTimer>
+#include <QHash>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+
+const quint32 INDEX_MAGIC = 0x54524749; // "TRGI"
+const quint32 INDEX_VERSION = 1;
+
+/** @brief File ids of one trigram as delta-encoded varints */
+struct PostingList
+{
+    QByteArray data;
+    quint32 last = 0;
+    quint32 count = 0;
+};
+
+struct FileEntry
+{
+    QString path; // Relative to the indexed folder
+    qint64 size = 0;
+    qint64 modified = 0;
+    bool live = true;
+};
+
+void appendPosting(PostingList &list, quint32 id)
+{
+    // Ids are appended in ascending order, so deltas are small
+    quint32 delta = id - list.last;
+    while (delta >= 0x80) {
+        list.data.append(char((delta & 0x7f) | 0x80));
+        delta >>= 7;
+    }
+    list.data.append(char(delta));
+    list.last = id;
+    ++list.count;
+}
+
+QVector<quint32> decodePostings(const PostingList &list)
+{
+    QVector<quint32> ids;
+    ids.reserve(list.count);
+
+    const uchar *data = reinterpret_cast<const uchar *>(list.data.constData());
+    const uchar *end = data + list.data.size();
+    quint32 value = 0;
+    while (data < end) {
+        quint32 delta = 0;
+        int shift = 0;
+        while (data < end && (*data & 0x80)) {
+            delta |= quint32(*data++ & 0x7f) << shift;
+            shift += 7;
+        }
+        if (data < end) {
+            delta |= quint32(*data++) << shift;
+        }
+        value += delta;
+        ids.append(value);
+    }
+    return ids;
+}
+
+inline uchar foldByte(uchar ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? uchar(ch + ('a' - 'A')) : ch;
+}
+
+/** @brief Reads a file and returns its distinct trigrams */
+QVector<quint32> extractTrigrams(const QString &filePath)
+{
+    QVector<quint32> trigrams;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return trigrams;
+    }
+
+    const qint64 size = file.size();
+    if (size < 3 || size > FileSearchEngine::MAX_FILE_SIZE) {
+        return trigrams;
+    }
+
+    QByteArray buffer;
+    const uchar *data = file.map(0, size);
+    if (!data) {
+        buffer = file.readAll();
+        data = reinterpret_cast<const uchar *>(buffer.constData());
+    }
+
+    if (FileSearchEngine::isBinaryData(reinterpret_cast<const char *>(data), size)) {
+        return trigrams;
+    }
+
+    // One bit per possible trigram; only the bits set here are cleared again
+    thread_local std::vector<quint64> seen(size_t(1) << 18);
+
+    quint32 key = (quint32(foldByte(data[0])) << 8) | foldByte(data[1]);
+    for (qint64 i = 2; i < size; ++i) {
+        key = ((key << 8) | foldByte(data[i])) & 0xffffff;
+        quint64 &word = seen[key >> 6];
+        const quint64 bit = quint64(1) << (key & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            trigrams.append(key);
+        }
+    }
+
+    for (quint32 trigram : trigrams) {
+        seen[trigram >> 6] = 0;
+    }
+    return trigrams;
+}
+
+/** @brief Checks whether a stored entry still describes a file */
+bool isUpToDate(const FileEntry &entry, const QFileInfo &fileInfo)
+{
+    return entry.size == fileInfo.size() && entry.modified == fileInfo.lastModified().toMSecsSinceEpoch();
+}
+
+} // namespace
+
+/**
+ * @brief Index of one folder, shared with the background tasks
+ *
+ * The file table and posting lists are only modified by the maintenance
+ * thread, which holds the write lock while doing so; queries from the GUI
+ * thread hold the read lock. The remaining members are private to the
+ * maintenance thread.
+ */
+struct TrigramIndex::IndexData
+{
+    QString rootPath;
+    QString prefix;
+
+    std::atomic<bool> canceled { false };
+    std::atomic<bool> ready { false };
+    std::atomic<int> pendingRescans { 0 };
+
+    mutable QReadWriteLock lock;
+    QVector<FileEntry> files;
+    QHash<QString, quint32> fileIds;
+    QHash<quint32, PostingList> postings;
+
+    QSet<QString> directories;
+    int deadFiles = 0;
+    bool modified = false;
+};
+
+TrigramIndex::TrigramIndex(QObject *parent)
+    : QObject(parent)
+    , m_rescanTimer(nullptr)
+{
+    // A single maintenance thread keeps updates in order
+    m_maintenancePool.setMaxThreadCount(1);
+    m_extractionPool.setMaxThreadCount(QThread::idealThreadCount());
+
+    m_rescanTimer = new QTimer(this);
+    m_rescanTimer->setSingleShot(true);
+    m_rescanTimer->setInterval(RESCAN_DELAY);
+    connect(m_rescanTimer, &QTimer::timeout, this, &TrigramIndex::rescanPendingPaths);
+}
+
+TrigramIndex::~TrigramIndex()
+{
+    if (m_data) {
+        m_data->canceled = true;
+    }
+    m_maintenancePool.clear();
+    m_maintenancePool.waitForDone();
+}
+
+void TrigramIndex::setRootPath(const QString &rootPath)
+{
+    const QString absolutePath = rootPath.isEmpty() ? QString() : QDir(rootPath).absolutePath();
+    if ((m_data && m_data->rootPath == absolutePath) || (!m_data && absolutePath.isEmpty())) {
+        return;
+    }
+
+    if (m_data) {
+        m_data->canceled = true;
+        m_data.reset();
+    }
+    m_maintenancePool.clear();
+    m_pendingPaths.clear();
+    m_unwatchedDirectories.clear();
+    m_rescanTimer->stop();
+    FileWatchService::instance().unwatchAll(this);
+
+    if (absolutePath.isEmpty() || !QFileInfo(absolutePath).isDir()) {
+        return;
+    }
+
+    auto data = std::make_shared<IndexData>();
+    data->rootPath = absolutePath;
+    data->prefix = absolutePath.endsWith(QLatin1Char('/')) ? absolutePath : absolutePath + QLatin1Char('/');
+    m_data = data;
+
+    m_maintenancePool.start([this, data]() {
+        initialize(data);
+    });
+}
+
+QString TrigramIndex::rootPath() const
+{
+    return m_data ? m_data->rootPath : QString();
+}
+
+bool TrigramIndex::isReady() const
+{
+    return m_data && m_data->ready;
+}
+
+bool TrigramIndex::candidateFiles(const QString &pattern, const SearchOptions &options, const QString &directory,
+                                  FileSearchScope &scope) const
+{
+    const std::shared_ptr<IndexData> data = m_data;
+    if (!data || !data->ready) {
+        return false;
+    }
+
+    // New files are only indexed once the changes have been rescanned
+    if (!m_pendingPaths.isEmpty() || data->pendingRescans > 0) {
+        return false;
+    }
+
+    const QString directoryPath = QDir(directory).absolutePath();
+    if (directoryPath != data->rootPath && !directoryPath.startsWith(data->prefix)) {
+        return false;
+    }
+
+    // Unwatched folders are searched in full, from the topmost one down
+    scope.rootPath = data->rootPath;
+    scope.directories.clear();
+    QSet<QString> unwatchedPrefixes;
+    for (const QString &path : m_unwatchedDirectories) {
+        if (path == directoryPath || directoryPath.startsWith(path + QLatin1Char('/'))) {
+            return false;
+        }
+        if (path.startsWith(directoryPath + QLatin1Char('/'))
+            && !m_unwatchedDirectories.contains(path.left(path.lastIndexOf(QLatin1Char('/'))))) {
+            scope.directories.append(path);
+            unwatchedPrefixes.insert(path.mid(data->prefix.size()) + QLatin1Char('/'));
+        }
+    }
+    auto isUnwatched = [&unwatchedPrefixes](const QString &path) {
+        for (qsizetype slash = path.lastIndexOf(QLatin1Char('/')); slash > 0;
+             slash = path.lastIndexOf(QLatin1Char('/'), slash - 1)) {
+            if (unwatchedPrefixes.contains(path.left(slash + 1))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const QVector<quint32> keys = queryTrigrams(pattern, options);
+    if (keys.isEmpty()) {
+        return false;
+    }
+
+    const QString relativeDirectory = directoryPath == data->rootPath
+        ? QString()
+        : directoryPath.mid(data->prefix.size()) + QLatin1Char('/');
+
+    scope.files.clear();
+    scope.indexedFiles.clear();
+    {
+        QReadLocker locker(&data->lock);
+
+        QVector<const PostingList *> lists;
+        bool missing = false;
+        for (quint32 key : keys) {
+            auto it = data->postings.constFind(key);
+            if (it == data->postings.constEnd()) {
+                missing = true; // No indexed file contains this trigram
+                break;
+            }
+            lists.append(&it.value());
+        }
+
+        QVector<quint32> ids;
+        if (!missing) {
+            // Intersect the shortest lists; longer ones would barely narrow the result
+            std::sort(lists.begin(), lists.end(), [](const PostingList *first, const PostingList *second) {
+                return first->count < second->count;
+            });
+            if (lists.size() > MAX_QUERY_TRIGRAMS) {
+                lists.resize(MAX_QUERY_TRIGRAMS);
+            }
+
+            ids = decodePostings(*lists.constFirst());
+            for (qsizetype i = 1; i < lists.size() && !ids.isEmpty(); ++i) {
+                const QVector<quint32> other = decodePostings(*lists.at(i));
+                QVector<quint32> intersection;
+                std::set_intersection(ids.cbegin(), ids.cend(), other.cbegin(), other.cend(),
+                                      std::back_inserter(intersection));
+                ids.swap(intersection);
+            }
+        }
+
+        // Both the ids and the file table are in ascending order; the other
+        // files are checked against the disk by the search workers
+        scope.files.reserve(ids.size());
+        scope.indexedFiles.reserve(data->fileIds.size() - ids.size());
+        auto nextId = ids.cbegin();
+        for (qsizetype id = 0; id < data->files.size(); ++id) {
+            while (nextId != ids.cend() && *nextId < quint32(id)) {
+                ++nextId;
+            }
+            const FileEntry &entry = data->files.at(id);
+            if (!entry.live || (!relativeDirectory.isEmpty() && !entry.path.startsWith(relativeDirectory))
+                || (!unwatchedPrefixes.isEmpty() && isUnwatched(entry.path))) {
+                continue;
+            }
+            if (nextId != ids.cend() && *nextId == quint32(id)) {
+                scope.files.append(data->prefix + entry.path);
+            } else {
+                scope.indexedFiles.append(IndexedFile { data->prefix + entry.path, entry.size, entry.modified });
+            }
+        }
+    }
+    return true;
+}
+
+void TrigramIndex::fileChanged(const QString &filePath)
+{
+    if (!m_data || !filePath.startsWith(m_data->prefix)) {
+        return;
+    }
+
+    m_pendingPaths.insert(filePath);
+    m_rescanTimer->start();
+}
+
+void TrigramIndex::onDirectoryChanged(const QString &path)
+{
+    m_pendingPaths.insert(path);
+    m_rescanTimer->start();
+}
+
+void TrigramIndex::rescanPendingPaths()
+{
+    if (!m_data || m_pendingPaths.isEmpty()) {
+        return;
+    }
+
+    const std::shared_ptr<IndexData> data = m_data;
+    const QStringList paths = m_pendingPaths.values();
+    m_pendingPaths.clear();
+
+    ++data->pendingRescans;
+    m_maintenancePool.start([this, data, paths]() {
+        rescan(data, paths);
+        --data->pendingRescans;
+    });
+}
+
+void TrigramIndex::initialize(const std::shared_ptr<IndexData> &data)
+{
+    // A stored index only needs the files changed since it was written
+    load(*data);
+
+    QVector<bool> seen(data->files.size(), false);
+    QStringList changed;
+    QStringList directories;
+    walk(*data, data->rootPath, &seen, changed, directories);
+    if (data->canceled) {
+        return;
+    }
+
+    {
+        QWriteLocker locker(&data->lock);
+        for (qsizetype id = 0; id < seen.size(); ++id) {
+            FileEntry &entry = data->files[id];
+            if (entry.live && !seen.at(id)) {
+                entry.live = false;
+                data->fileIds.remove(entry.path);
+                ++data->deadFiles;
+                data->modified = true;
+            }
+        }
+    }
+
+    indexFiles(*data, changed);
+    if (data->canceled) {
+        return;
+    }
+
+    if (data->deadFiles > 0) {
+        compact(*data);
+    }
+    if (data->modified) {
+        save(*data);
+        data->modified = false;
+    }
+
+    data->ready = true;
+    const int fileCount = int(data->fileIds.size());
+
+    QMetaObject::invokeMethod(this, [this, data, directories, fileCount]() {
+        watchDirectories(data, directories);
+        if (m_data == data) {
+            emit indexReady(fileCount);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void TrigramIndex::rescan(const std::shared_ptr<IndexData> &data, const QStringList &paths)
+{
+    QStringList changed;
+    QStringList directories;
+    QStringList removedDirectories;
+
+    for (const QString &path : paths) {
+        if (data->canceled) {
+            return;
+        }
+
+        const QFileInfo fileInfo(path);
+        if (fileInfo.isDir()) {
+            // Drops deleted entries, then picks up changed files and any new subfolder trees
+            dropMissingEntries(*data, path, removedDirectories);
+            walk(*data, path, nullptr, changed, directories);
+        } else if (fileInfo.isFile()) {
+            auto it = data->fileIds.constFind(path.mid(data->prefix.size()));
+            if (it != data->fileIds.constEnd()) {
+                if (!isUpToDate(data->files.at(*it), fileInfo)) {
+                    changed.append(path);
+                }
+            } else if (!WorkspaceWalker::isIgnored(WorkspaceWalker::directory(data->rootPath, fileInfo.path()),
+                                                   fileInfo)) {
+                changed.append(path);
+            }
+        } else if (data->directories.contains(path)) {
+            removeDirectory(*data, path, removedDirectories);
+        } else {
+            QWriteLocker locker(&data->lock);
+            auto it = data->fileIds.find(path.mid(data->prefix.size()));
+            if (it != data->fileIds.end()) {
+                data->files[*it].live = false;
+                data->fileIds.erase(it);
+                ++data->deadFiles;
+                data->modified = true;
+            }
+        }
+    }
+
+    indexFiles(*data, changed);
+    if (data->canceled) {
+        return;
+    }
+
+    if (data->deadFiles > 1024 && data->deadFiles > data->fileIds.size()) {
+        compact(*data);
+    }
+    if (data->modified) {
+        save(*data);
+        data->modified = false;
+    }
+
+    if (!directories.isEmpty() || !removedDirectories.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this, data, directories, removedDirectories]() {
+            if (m_data != data) {
+                return;
+            }
+            for (const QString &directory : removedDirectories) {
+                FileWatchService::instance().unwatch(directory, this);
+                m_unwatchedDirectories.remove(directory);
+            }
+            watchDirectories(data, directories);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void TrigramIndex::dropMissingEntries(IndexData &data, const QString &directory, QStringList &removedDirectories)
+{
+    const WorkspaceWalker::Directory walkerDirectory = WorkspaceWalker::directory(data.rootPath, directory);
+    const QString relativeDirectory = directory == data.rootPath
+        ? QString()
+        : directory.mid(data.prefix.size()) + QLatin1Char('/');
+
+    // Subfolders that were deleted or are now ignored
+    const QString directoryPrefix = directory + QLatin1Char('/');
+    QStringList missingDirectories;
+    for (const QString &path : std::as_const(data.directories)) {
+        if (!path.startsWith(directoryPrefix) || path.indexOf(QLatin1Char('/'), directoryPrefix.size()) >= 0) {
+            continue;
+        }
+        const QFileInfo fileInfo(path);
+        if (!fileInfo.isDir() || WorkspaceWalker::isIgnored(walkerDirectory, fileInfo)) {
+            missingDirectories.append(path);
+        }
+    }
+    for (const QString &path : std::as_const(missingDirectories)) {
+        removeDirectory(data, path, removedDirectories);
+    }
+
+    // Files of the folder itself that were deleted or are now ignored
+    QStringList missingFiles;
+    {
+        QReadLocker locker(&data.lock);
+        for (auto it = data.fileIds.cbegin(); it != data.fileIds.cend(); ++it) {
+            const QString &path = it.key();
+            if (!path.startsWith(relativeDirectory)
+                || path.indexOf(QLatin1Char('/'), relativeDirectory.size()) >= 0) {
+                continue;
+            }
+            const QFileInfo fileInfo(data.prefix + path);
+            if (!fileInfo.isFile() || WorkspaceWalker::isIgnored(walkerDirectory, fileInfo)) {
+                missingFiles.append(path);
+            }
+        }
+    }
+    if (missingFiles.isEmpty()) {
+        return;
+    }
+
+    QWriteLocker locker(&data.lock);
+    for (const QString &path : std::as_const(missingFiles)) {
+        auto it = data.fileIds.find(path);
+        if (it != data.fileIds.end()) {
+            data.files[*it].live = false;
+            data.fileIds.erase(it);
+            ++data.deadFiles;
+        }
+    }
+    data.modified = true;
+}
+
+void TrigramIndex::removeDirectory(IndexData &data, const QString &directory, QStringList &removedDirectories)
+{
+    const QString directoryPrefix = directory + QLatin1Char('/');
+    for (auto it = data.directories.begin(); it != data.directories.end();) {
+        if (*it == directory || it->startsWith(directoryPrefix)) {
+            removedDirectories.append(*it);
+            it = data.directories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const QString relativePrefix = directoryPrefix.mid(data.prefix.size());
+    QWriteLocker locker(&data.lock);
+    for (auto it = data.fileIds.begin(); it != data.fileIds.end();) {
+        if (it.key().startsWith(relativePrefix)) {
+            data.files[*it].live = false;
+            it = data.fileIds.erase(it);
+            ++data.deadFiles;
+            data.modified = true;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TrigramIndex::indexFiles(IndexData &data, const QStringList &paths)
+{
+    for (qsizetype start = 0; start < paths.size() && !data.canceled; start += INDEX_BATCH_SIZE) {
+        const qsizetype count = qMin(qsizetype(INDEX_BATCH_SIZE), paths.size() - start);
+        QVector<FileEntry> entries(count);
+        QVector<QVector<quint32>> trigrams(count);
+        QVector<bool> exists(count, false);
+
+        // Each task writes its own slot; the containers are not touched otherwise
+        FileEntry *entrySlots = entries.data();
+        QVector<quint32> *trigramSlots = trigrams.data();
+        bool *existsSlots = exists.data();
+        const QString &prefix = data.prefix;
+
+        for (qsizetype i = 0; i < count; ++i) {
+            const QString path = paths.at(start + i);
+            m_extractionPool.start([=]() {
+                // Stat before reading, so a concurrent write shows up as a change later
+                const QFileInfo fileInfo(path);
+                existsSlots[i] = fileInfo.isFile();
+                entrySlots[i].path = path.mid(prefix.size());
+                entrySlots[i].size = fileInfo.size();
+                entrySlots[i].modified = fileInfo.lastModified().toMSecsSinceEpoch();
+                trigramSlots[i] = extractTrigrams(path);
+            });
+        }
+        m_extractionPool.waitForDone();
+
+        QWriteLocker locker(&data.lock);
+        for (qsizetype i = 0; i < count; ++i) {
+            // A changed file gets a new id so posting lists only grow at the end
+            auto previous = data.fileIds.find(entries.at(i).path);
+            if (previous != data.fileIds.end()) {
+                data.files[*previous].live = false;
+                data.fileIds.erase(previous);
+                ++data.deadFiles;
+            }
+
+            if (!exists.at(i)) {
+                continue;
+            }
+
+            const quint32 id = quint32(data.files.size());
+            data.files.append(entries.at(i));
+            data.fileIds.insert(entries.at(i).path, id);
+            for (quint32 key : trigrams.at(i)) {
+                appendPosting(data.postings[key], id);
+            }
+        }
+        data.modified = true;
+    }
+}
+
+void TrigramIndex::watchDirectories(const std::shared_ptr<IndexData> &data, const QStringList &directories)
+{
+    if (m_data != data) {
+        return;
+    }
+
+    FileWatchService &service = FileWatchService::instance();
+    const qsizetype room = qMax<qsizetype>(MAX_WATCHED_DIRECTORIES - service.watchedCount(this), 0);
+    if (room > 0 && !directories.isEmpty()) {
+        service.watch(directories.mid(0, room), this, [this](const QString &path) {
+            onDirectoryChanged(path);
+        });
+    }
+
+    // New files in the rest go unnoticed, so queries search them in full
+    for (qsizetype i = room; i < directories.size(); ++i) {
+        m_unwatchedDirectories.insert(directories.at(i));
+    }
+}
+
+void TrigramIndex::walk(IndexData &data, const QString &directory, QVector<bool> *seen,
+                        QStringList &changed, QStringList &directories)
+{
+    // Breadth first, so the folder watch limit favours the upper levels
+    QVector<WorkspaceWalker::Directory> pending { WorkspaceWalker::directory(data.rootPath, directory) };
+    for (qsizetype next = 0; next < pending.size() && !data.canceled; ++next) {
+        const WorkspaceWalker::Directory current = pending.at(next);
+        if (!data.directories.contains(current.path)) {
+            data.directories.insert(current.path);
+            directories.append(current.path);
+        }
+
+        QVector<QFileInfo> files;
+        QVector<WorkspaceWalker::Directory> subdirectories;
+        WorkspaceWalker::list(current, files, subdirectories);
+
+        // Known subfolders are only rescanned when they report changes
+        for (const WorkspaceWalker::Directory &subdirectory : std::as_const(subdirectories)) {
+            if (!data.directories.contains(subdirectory.path)) {
+                pending.append(subdirectory);
+            }
+        }
+
+        for (const QFileInfo &fileInfo : std::as_const(files)) {
+            auto id = data.fileIds.constFind(fileInfo.filePath().mid(data.prefix.size()));
+            if (id != data.fileIds.constEnd() && isUpToDate(data.files.at(*id), fileInfo)) {
+                if (seen) {
+                    (*seen)[*id] = true;
+                }
+                continue;
+            }
+            changed.append(fileInfo.filePath());
+        }
+    }
+}
+
+void TrigramIndex::compact(IndexData &data)
+{
+    const quint32 removed = quint32(-1);
+    QVector<quint32> newIds(data.files.size(), removed);
+    QVector<FileEntry> files;
+    QHash<QString, quint32> fileIds;
+    files.reserve(data.fileIds.size());
+    fileIds.reserve(data.fileIds.size());
+
+    for (qsizetype id = 0; id < data.files.size(); ++id) {
+        const FileEntry &entry = data.files.at(id);
+        if (entry.live) {
+            newIds[id] = quint32(files.size());
+            fileIds.insert(entry.path, quint32(files.size()));
+            files.append(entry);
+        }
+    }
+
+    // Renumbering keeps the order, so the lists stay sorted
+    QHash<quint32, PostingList> postings;
+    postings.reserve(data.postings.size());
+    for (auto it = data.postings.cbegin(); it != data.postings.cend() && !data.canceled; ++it) {
+        PostingList list;
+        const QVector<quint32> ids = decodePostings(it.value());
+        for (quint32 id : ids) {
+            if (newIds.at(id) != removed) {
+                appendPosting(list, newIds.at(id));
+            }
+        }
+        if (list.count > 0) {
+            postings.insert(it.key(), list);
+        }
+    }
+
+    if (data.canceled) {
+        return;
+    }
+
+    QWriteLocker locker(&data.lock);
+    data.files.swap(files);
+    data.fileIds.swap(fileIds);
+    data.postings.swap(postings);
+    data.deadFiles = 0;
+    data.modified = true;
+}
+
+bool TrigramIndex::load(IndexData &data)
+{
+    QFile file(indexFilePath(data.rootPath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString rootPath;
+    in >> magic >> version >> rootPath;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION || rootPath != data.rootPath) {
+        return false;
+    }
+
+    quint32 fileCount = 0;
+    in >> fileCount;
+    QVector<FileEntry> files;
+    QHash<QString, quint32> fileIds;
+    for (quint32 id = 0; id < fileCount && in.status() == QDataStream::Ok; ++id) {
+        FileEntry entry;
+        in >> entry.path >> entry.size >> entry.modified;
+        fileIds.insert(entry.path, id);
+        files.append(entry);
+    }
+
+    quint32 postingCount = 0;
+    in >> postingCount;
+    QHash<quint32, PostingList> postings;
+    postings.reserve(postingCount);
+    for (quint32 i = 0; i < postingCount && in.status() == QDataStream::Ok; ++i) {
+        quint32 key = 0;
+        PostingList list;
+        in >> key >> list.count >> list.last >> list.data;
+        if (list.last >= fileCount) {
+            in.setStatus(QDataStream::ReadCorruptData);
+        }
+        postings.insert(key, list);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    QWriteLocker locker(&data.lock);
+    data.files.swap(files);
+    data.fileIds.swap(fileIds);
+    data.postings.swap(postings);
+    return true;
+}
+
+void TrigramIndex::save(const IndexData &data)
+{
+    // Only called after compact(), so every entry is live
+    const QString filePath = indexFilePath(data.rootPath);
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << INDEX_MAGIC << INDEX_VERSION << data.rootPath << quint32(data.files.size());
+    for (const FileEntry &entry : data.files) {
+        out << entry.path << entry.size << entry.modified;
+    }
+
+    out << quint32(data.postings.size());
+    for (auto it = data.postings.cbegin(); it != data.postings.cend(); ++it) {
+        out << it.key() << it.value().count << it.value().last << it.value().data;
+    }
+
+    file.commit();
+}
+
+QString TrigramIndex::indexFilePath(const QString &rootPath)
+{
+    const QByteArray hash = QCryptographicHash::hash(rootPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return QDir(cacheDir).filePath(QString("search-index/%1.idx").arg(QString::fromLatin1(hash)));
+}
+
+QVector<quint32> TrigramIndex::queryTrigrams(const QString &pattern, const SearchOptions &options)
+{
+    const QStringList literals = options.useRegex ? requiredLiterals(pattern) : QStringList { pattern };
+
+    // Only ASCII is folded in the index, so case-insensitive queries cannot
+    // rely on trigrams containing other characters
+    const bool asciiOnly = !options.caseSensitive || options.useRegex;
+
+    QVector<quint32> keys;
+    for (const QString &literal : literals) {
+        const QByteArray bytes = literal.toUtf8();
+        for (qsizetype i = 0; i + 2 < bytes.size(); ++i) {
+            const uchar first = uchar(bytes.at(i));
+            const uchar second = uchar(bytes.at(i + 1));
+            const uchar third = uchar(bytes.at(i + 2));
+            if (asciiOnly && ((first | second | third) & 0x80)) {
+                continue;
+            }
+            keys.append((quint32(foldByte(first)) << 16) | (quint32(foldByte(second)) << 8) | foldByte(third));
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+QStringList TrigramIndex::requiredLiterals(const QString &pattern)
+{
+    // Extended syntax gives whitespace a different meaning
+    static const QRegularExpression extendedOption("\\(\\?[a-zA-Z-]*x");
+    if (pattern.contains(extendedOption)) {
+        return QStringList();
+    }
+
+    // Escapes that stand for a single character class or assertion
+    static const QString simpleEscapes = QStringLiteral("bBdDsSwWAzZGhHvVRXKntrfeaQE");
+
+    QStringList literals;
+    QString current;
+    auto flush = [&literals, &current]() {
+        if (current.size() >= 3) {
+            literals.append(current);
+        }
+        current.clear();
+    };
+
+    auto isQuantifier = [](QChar ch) {
+        return ch == QLatin1Char('*') || ch == QLatin1Char('?') || ch == QLatin1Char('+') || ch == QLatin1Char('{');
+    };
+
+    // Adds a literal character, unless a quantifier makes it optional
+    auto appendLiteral = [&](QChar ch, qsizetype next) {
+        const QChar following = next < pattern.size() ? pattern.at(next) : QChar();
+        if (following == QLatin1Char('+')) {
+            current.append(ch);
+            flush();
+        } else if (isQuantifier(following)) {
+            flush();
+        } else {
+            current.append(ch);
+        }
+    };
+
+    const qsizetype length = pattern.size();
+    qsizetype i = 0;
+    while (i < length) {
+        const QChar ch = pattern.at(i);
+
+        if (ch == QLatin1Char('|')) {
+            return QStringList(); // Any branch may match on its own
+        }
+
+        if (ch == QLatin1Char('\\') && i + 1 < length) {
+            const QChar escaped = pattern.at(i + 1);
+            if (!escaped.isLetterOrNumber()) {
+                appendLiteral(escaped, i + 2);
+                i += 2;
+                continue;
+            }
+
+            flush();
+            i += 2;
+            if (escaped == QLatin1Char('c')) {
+                ++i;
+            } else if (!simpleEscapes.contains(escaped)) {
+                // Escapes with arguments: \x41, \x{263a}, \p{L}, \k<name>, \1 ...
+                if (i < length && (pattern.at(i) == QLatin1Char('{') || pattern.at(i) == QLatin1Char('<'))) {
+                    const QChar close = pattern.at(i) == QLatin1Char('{') ? QLatin1Char('}') : QLatin1Char('>');
+                    const qsizetype end = pattern.indexOf(close, i);
+                    i = end < 0 ? length : end + 1;
+                } else {
+                    while (i < length && pattern.at(i).isLetterOrNumber()) {
+                        ++i;
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (ch == QLatin1Char('[')) {
+            // Skip the character class
+            flush();
+            ++i;
+            if (i < length && pattern.at(i) == QLatin1Char('^')) {
+                ++i;
+            }
+            if (i < length && pattern.at(i) == QLatin1Char(']')) {
+                ++i;
+            }
+            while (i < length && pattern.at(i) != QLatin1Char(']')) {
+                i += pattern.at(i) == QLatin1Char('\\') ? 2 : 1;
+            }
+            ++i;
+            continue;
+        }
+
+        if (ch == QLatin1Char('(')) {
+            // Skip the group; it may be optional, and alternatives inside it
+            // only affect the group itself
+            flush();
+            int depth = 0;
+            while (i < length) {
+                const QChar groupChar = pattern.at(i);
+                if (groupChar == QLatin1Char('\\')) {
+                    i += 2;
+                    continue;
+                }
+                if (groupChar == QLatin1Char('[')) {
+                    const qsizetype end = pattern.indexOf(QLatin1Char(']'), i + 2);
+                    i = end < 0 ? length : end + 1;
+                    continue;
+                }
+                if (groupChar == QLatin1Char('(')) {
+                    ++depth;
+                } else if (groupChar == QLatin1Char(')') && --depth == 0) {
+                    ++i;
+                    break;
+                }
+                ++i;
+            }
+            continue;
+        }
+
+        if (ch == QLatin1Char('{')) {
+            flush();
+            const qsizetype end = pattern.indexOf(QLatin1Char('}'), i);
+            i = end < 0 ? length : end + 1;
+            continue;
+        }
+
+        if (ch == QLatin1Char('.') || ch == QLatin1Char('^') || ch == QLatin1Char('$') || ch == QLatin1Char(')')
+            || isQuantifier(ch)) {
+            flush();
+            ++i;
+            continue;
+        }
+
+        appendLiteral(ch, i + 1);
+        ++i;
+    }
+
+    flush();
+    return literals;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file TrigramIndex.h
+ * @brief Persistent trigram index of the files below a folder
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QThreadPool>
+#include <memory>
+
+#include "TextSearch.h"
+#include "FileSearchEngine.h"
+
+class QTimer;
+
+/**
+ * @class TrigramIndex
+ * @brief Narrows find-in-files searches to files that can contain a match
+ *
+ * The index records, for every three-byte sequence of UTF-8 text (with
+ * ASCII letters folded to lower case), the files containing it. A query
+ * extracts the trigrams every match must contain and intersects their
+ * posting lists, so only the surviving files need to be searched.
+ *
+ * Posting lists hold ascending file ids as delta-encoded varints, both in
+ * memory and in the index file stored in the cache directory. Changed
+ * files get a new id and the old one is marked dead, so updates only ever
+ * append to posting lists; dead ids are dropped when enough accumulate.
+ *
+ * Building, loading and updating run on a background thread. On startup
+ * a stored index is loaded and then synchronized with the file system by
+ * comparing sizes and modification times, so only changed files are read
+ * again. Afterwards directory change notifications and saved files keep
+ * the index current. Folder watches do not report files written in place,
+ * so a narrowed search also checks the other indexed files against the
+ * disk (see FileSearchEngine::startInScope()). Files and folders ignored through .gitignore or
+ * .ignore files are left out (see WorkspaceWalker).
+ *
+ * @see FileSearchEngine, FindInFilesPanel
+ */
+class TrigramIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an index without a folder
+     * @param parent Parent object
+     */
+    explicit TrigramIndex(QObject *parent = nullptr);
+
+    /**
+     * @brief Destructor - stops background work
+     */
+    ~TrigramIndex();
+
+    /**
+     * @brief Sets the folder to index
+     * @param rootPath Folder to index, or an empty string to disable the index
+     */
+    void setRootPath(const QString &rootPath);
+
+    /**
+     * @brief Gets the indexed folder
+     * @return Absolute path of the folder, or an empty string
+     */
+    QString rootPath() const;
+
+    /**
+     * @brief Checks whether the index can answer queries
+     * @return true once the folder has been indexed
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Finds the files that may contain matches of a pattern
+     * @param pattern Search pattern
+     * @param options Search options
+     * @param directory Only files below this folder are returned
+     * @param scope Receives the candidate files, and every other indexed
+     *        file below @p directory with its indexed size and modification
+     *        time, so the search can also pick up files written in place
+     * @return false if the index cannot narrow the search (not ready,
+     *         changes waiting to be indexed, folder outside the index or not
+     *         watched, or no trigram every match must contain); the caller
+     *         then has to search all files
+     *
+     * Folders beyond the watch limit would not report new files, so the
+     * unwatched folders below @p directory are returned in the scope to be
+     * searched in full.
+     */
+    bool candidateFiles(const QString &pattern, const SearchOptions &options, const QString &directory,
+                        FileSearchScope &scope) const;
+
+    /**
+     * @brief Schedules a file for re-indexing
+     * @param filePath File that was written by the editor
+     */
+    void fileChanged(const QString &filePath);
+
+signals:
+    /**
+     * @brief Emitted when the folder has been indexed
+     * @param fileCount Number of indexed files
+     */
+    void indexReady(int fileCount);
+
+private slots:
+    /** @brief Schedules a changed directory for rescanning */
+    void onDirectoryChanged(const QString &path);
+
+    /** @brief Queues a rescan of the paths changed since the last one */
+    void rescanPendingPaths();
+
+private:
+    struct IndexData;
+
+    /** @brief Loads the stored index and synchronizes it with the file system */
+    void initialize(const std::shared_ptr<IndexData> &data);
+
+    /** @brief Re-indexes changed files and folders */
+    void rescan(const std::shared_ptr<IndexData> &data, const QStringList &paths);
+
+    /**
+     * @brief Drops the entries of a folder that are gone from the disk
+     * @param data Index being updated
+     * @param directory Folder that reported a change
+     * @param removedDirectories Receives the subfolders dropped
+     *
+     * Only the direct contents are compared: files that no longer exist
+     * or are now ignored are marked dead, and missing subfolders are
+     * removed with everything below them.
+     */
+    static void dropMissingEntries(IndexData &data, const QString &directory, QStringList &removedDirectories);
+
+    /**
+     * @brief Removes a folder and everything below it from the index
+     * @param data Index being updated
+     * @param directory Folder to remove
+     * @param removedDirectories Receives the folders removed
+     */
+    static void removeDirectory(IndexData &data, const QString &directory, QStringList &removedDirectories);
+
+    /** @brief Reads and indexes files, replacing their previous entries */
+    void indexFiles(IndexData &data, const QStringList &paths);
+
+    /** @brief Starts watching folders; called on the GUI thread */
+    void watchDirectories(const std::shared_ptr<IndexData> &data, const QStringList &directories);
+
+    /**
+     * @brief Walks a folder tree
+     * @param data Index being synchronized
+     * @param directory Folder to start at
+     * @param seen If not nullptr, marks the ids of unchanged files
+     * @param changed Receives files that are new or changed
+     * @param directories Receives every folder found
+     */
+    static void walk(IndexData &data, const QString &directory, QVector<bool> *seen,
+                     QStringList &changed, QStringList &directories);
+
+    /** @brief Drops dead file ids from all posting lists */
+    static void compact(IndexData &data);
+
+    /** @brief Loads the index file of the folder */
+    static bool load(IndexData &data);
+
+    /** @brief Writes the index file of the folder */
+    static void save(const IndexData &data);
+
+    /** @brief Gets the index file path for a folder */
+    static QString indexFilePath(const QString &rootPath);
+
+    /** @brief Extracts the trigrams every match of a pattern must contain */
+    static QVector<quint32> queryTrigrams(const QString &pattern, const SearchOptions &options);
+
+    /** @brief Extracts the literal runs every match of a regular expression must contain */
+    static QStringList requiredLiterals(const QString &pattern);
+
+    /** @brief Runs the serialized index updates */
+    QThreadPool m_maintenancePool;
+
+    /** @brief Reads files in parallel while indexing */
+    QThreadPool m_extractionPool;
+
+    /** @brief Index of the current folder, or nullptr */
+    std::shared_ptr<IndexData> m_data;
+
+    /** @brief Collects change notifications before rescanning */
+    QTimer *m_rescanTimer;
+
+    /** @brief Paths changed since the last rescan */
+    QSet<QString> m_pendingPaths;
+
+    /** @brief Indexed folders left unwatched because of MAX_WATCHED_DIRECTORIES */
+    QSet<QString> m_unwatchedDirectories;
+
+    /** @brief Files read in parallel before they are added to the index */
+    static const int INDEX_BATCH_SIZE = 64;
+
+    /** @brief Posting lists intersected per query; the rest only narrow further */
+    static const int MAX_QUERY_TRIGRAMS = 8;
+
+    /** @brief Folders watched at most, to stay within system limits */
+    static const int MAX_WATCHED_DIRECTORIES = 8192;
+
+    /** @brief Delay before changed folders are rescanned in milliseconds */
+    static const int RESCAN_DELAY = 500;
+};
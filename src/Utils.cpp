@@ -1,4 +1,5 @@
 #include "Utils.h"
+#include "FileClassifier.h"
 
 #include <QDateTime>
 #include <QApplication>
@@ -70,12 +71,7 @@ QString detectLanguageFromContent(const QString &content)
 
 bool isTextFile(const QString &filePath)
 {
-    QMimeDatabase mimeDb;
-    QMimeType mimeType = mimeDb.mimeTypeForFile(filePath);
-    
-    return mimeType.name().startsWith("text/") || 
-           mimeType.inherits("text/plain") ||
-           getSupportedTextExtensions().contains(getFileExtension(filePath));
+    return FileClassifier::isText(filePath);
 }
 
 QString readFileContent(const QString &filePath)
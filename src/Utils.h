@@ -11,7 +11,6 @@
 #include <QStringList>
 #include <QFileInfo>
 #include <QDir>
-#include <QMimeDatabase>
 #include <QTextStream>
 #include <QStringConverter>
 #include <QByteArray>
@@ -52,7 +51,7 @@ namespace Utils
     /**
      * @brief Checks if file is a text file (not binary)
      * @param filePath Full path to the file to check
-     * @return true if file appears to be text-based
+     * @return true if file content appears to be text (see FileClassifier)
      */
     bool isTextFile(const QString &filePath);
     
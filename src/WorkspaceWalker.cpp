@@ -0,0 +1,126 @@
+#include "WorkspaceWalker.h"
+#include "IgnoreMatcher.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+
+/**
+ * @brief Patterns of the ignore files of one folder
+ */
+struct WorkspaceWalker::Rules
+{
+    std::shared_ptr<const Rules> parent; ///< Rules of the nearest parent folder with ignore files
+    QString prefix;                      ///< Folder path with a trailing '/'
+    IgnoreMatcher matcher;               ///< Patterns of the folder's ignore files
+};
+
+namespace
+{
+
+void addIgnoreFile(IgnoreMatcher &matcher, const QString &filePath)
+{
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        matcher.addPatterns(file.readAll());
+    }
+}
+
+} // namespace
+
+WorkspaceWalker::Directory WorkspaceWalker::root(const QString &rootPath)
+{
+    return { rootPath, loadRules(nullptr, rootPath, true) };
+}
+
+WorkspaceWalker::Directory WorkspaceWalker::directory(const QString &rootPath, const QString &path)
+{
+    Directory directory = root(rootPath);
+    const QString relativePath = QDir(rootPath).relativeFilePath(path);
+    if (relativePath.isEmpty() || relativePath == QLatin1String(".") || relativePath.startsWith(QLatin1String(".."))) {
+        return directory;
+    }
+
+    for (const QString &name : relativePath.split(QLatin1Char('/'), Qt::SkipEmptyParts)) {
+        directory.path = QDir(directory.path).filePath(name);
+        directory.rules = loadRules(directory.rules, directory.path, false);
+    }
+    directory.path = path;
+    return directory;
+}
+
+void WorkspaceWalker::list(const Directory &directory, QVector<QFileInfo> &files, QVector<Directory> &subdirectories)
+{
+    QDirIterator it(directory.path, QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fileInfo = it.fileInfo();
+
+        // Symbolic links are not followed, which also rules out cycles
+        if (fileInfo.isSymLink()) {
+            continue;
+        }
+
+        if (fileInfo.isDir()) {
+            // Pruned before descending, so nothing below is ever listed
+            if (!isSkippedDirectory(fileInfo.fileName()) && !isIgnored(directory, fileInfo)) {
+                subdirectories.append({ fileInfo.filePath(), loadRules(directory.rules, fileInfo.filePath(), false) });
+            }
+            continue;
+        }
+
+        if (!isIgnored(directory, fileInfo)) {
+            files.append(fileInfo);
+        }
+    }
+}
+
+bool WorkspaceWalker::isIgnored(const Directory &directory, const QFileInfo &fileInfo)
+{
+    const QString filePath = fileInfo.filePath();
+    const bool isDirectory = fileInfo.isDir();
+
+    // Deeper ignore files take precedence
+    for (const Rules *rules = directory.rules.get(); rules; rules = rules->parent.get()) {
+        if (!filePath.startsWith(rules->prefix)) {
+            continue;
+        }
+        switch (rules->matcher.match(QStringView(filePath).mid(rules->prefix.size()), isDirectory)) {
+        case IgnoreMatcher::Match::Ignored:
+            return true;
+        case IgnoreMatcher::Match::Included:
+            return false;
+        case IgnoreMatcher::Match::None:
+            break;
+        }
+    }
+    return false;
+}
+
+bool WorkspaceWalker::isSkippedDirectory(const QString &name)
+{
+    return name == QLatin1String(".git") || name == QLatin1String(".hg") || name == QLatin1String(".svn");
+}
+
+std::shared_ptr<const WorkspaceWalker::Rules> WorkspaceWalker::loadRules(const std::shared_ptr<const Rules> &parent,
+                                                                         const QString &path, bool isRoot)
+{
+    const QDir dir(path);
+    IgnoreMatcher matcher;
+    if (isRoot) {
+        addIgnoreFile(matcher, dir.filePath(QStringLiteral(".git/info/exclude")));
+    }
+    addIgnoreFile(matcher, dir.filePath(QStringLiteral(".gitignore")));
+    addIgnoreFile(matcher, dir.filePath(QStringLiteral(".ignore")));
+
+    // Folders without patterns share the rules of their parent
+    if (matcher.isEmpty()) {
+        return parent;
+    }
+
+    auto rules = std::make_shared<Rules>();
+    rules->parent = parent;
+    rules->prefix = path.endsWith(QLatin1Char('/')) ? path : path + QLatin1Char('/');
+    rules->matcher = std::move(matcher);
+    return rules;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file WorkspaceWalker.h
+ * @brief Folder listing that honours .gitignore and .ignore files
+ * @author Multi-Tab Editor Team
+ * @date 2025
+ */
+
+#pragma once
+
+#include <QFileInfo>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+/**
+ * @class WorkspaceWalker
+ * @brief Lists workspace folders without ignored entries
+ *
+ * Every folder may contain a .gitignore and an .ignore file; their
+ * patterns apply to everything below that folder, with deeper files and
+ * .ignore taking precedence, as in git. The .git/info/exclude file of the
+ * workspace root applies to the whole workspace. Version control metadata
+ * folders and symbolic links are always skipped.
+ *
+ * The ignore files of a folder are parsed once, when the folder is
+ * reached, into an IgnoreMatcher shared by everything below it. Ignored
+ * folders are dropped from the listing, so walks never descend into build
+ * output or dependency trees and only pay for the rest of the workspace.
+ *
+ * All functions are reentrant and may run on worker threads; a Directory
+ * can be handed between threads.
+ *
+ * @see IgnoreMatcher, FileSearchEngine, TrigramIndex, PathIndex
+ */
+class WorkspaceWalker
+{
+public:
+    struct Rules;
+
+    /**
+     * @struct Directory
+     * @brief A folder together with the ignore rules for its entries
+     */
+    struct Directory
+    {
+        QString path;                       ///< Path of the folder
+        std::shared_ptr<const Rules> rules; ///< Rules of the folder and its parents, or nullptr for none
+    };
+
+    /**
+     * @brief Prepares the root folder of a walk
+     * @param rootPath Workspace root
+     * @return Root folder with its ignore rules loaded
+     */
+    static Directory root(const QString &rootPath);
+
+    /**
+     * @brief Prepares a folder inside the workspace
+     * @param rootPath Workspace root
+     * @param path Folder at or below the root
+     * @return Folder with the ignore rules of every folder from the root down
+     */
+    static Directory directory(const QString &rootPath, const QString &path);
+
+    /**
+     * @brief Lists the entries of a folder that are not ignored
+     * @param directory Folder to list
+     * @param files Receives the files
+     * @param subdirectories Receives the subfolders, with their rules loaded
+     */
+    static void list(const Directory &directory, QVector<QFileInfo> &files, QVector<Directory> &subdirectories);
+
+    /**
+     * @brief Checks whether an entry of a folder is ignored
+     * @param directory Folder containing the entry
+     * @param fileInfo Entry to check
+     * @return true if the entry matches an ignore pattern
+     */
+    static bool isIgnored(const Directory &directory, const QFileInfo &fileInfo);
+
+    /**
+     * @brief Checks whether a folder is never walked
+     * @param name Folder name
+     * @return true for version control metadata folders
+     */
+    static bool isSkippedDirectory(const QString &name);
+
+private:
+    /** @brief Adds the rules of a folder's own ignore files */
+    static std::shared_ptr<const Rules> loadRules(const std::shared_ptr<const Rules> &parent, const QString &path,
+                                                  bool isRoot);
+};